@@ -117,7 +117,7 @@ int main(int argc, char* argv[])
   Kill_Stack(out2);
 #endif
 
-#if 1
+#if 0
   Stack *stack = Read_Stack("../data/system/29.tif");
   Print_Stack_Info(stack);
 
@@ -137,5 +137,33 @@ int main(int argc, char* argv[])
 #endif
 
 
+#if 1 /* compare Stack_Bwdist_Sqr() with Stack_Bwdist_L_U16() */
+  Stack *stack = Read_Stack("../data/system/29.tif");
+  Print_Stack_Info(stack);
+
+  int slice_wise;
+  for (slice_wise = 0; slice_wise <= 1; slice_wise++) {
+    tic();
+    Stack *golden = slice_wise ? Stack_Bwdist_L_U16P(stack, NULL, 0) :
+      Stack_Bwdist_L_U16(stack, NULL, 0);
+    printf("Old: %lld ms\n", (long long) toc());
+
+    tic();
+    Stack *out = Stack_Bwdist_Sqr(stack, NULL, 0, slice_wise);
+    printf("New: %lld ms\n", (long long) toc());
+
+    if (Stack_Identical(out, golden) == FALSE) {
+      printf("Result unmatched.\n");
+    } else {
+      printf("Good.\n");
+    }
+
+    Kill_Stack(golden);
+    Kill_Stack(out);
+  }
+
+  Kill_Stack(stack);
+#endif
+
   return 0;
 }
@@ -19,6 +19,7 @@
 #include "tz_darray.h"
 #include "tz_image_io.h"
 #include "tz_stack.h"
+#include "tz_stack_utils.h"
 
 INIT_EXCEPTION_MAIN(e)
 
@@ -388,7 +389,7 @@ int main(int argc, char* argv[])
   ptoc();
 #endif
 
-#if 1
+#if 0
   Stack *stack = Read_Stack("../data/benchmark/mouse_neuron_big/slice15_3to33ds_C2.tif");
   tic();
   dim_type dim[3];
@@ -408,5 +409,67 @@ int main(int argc, char* argv[])
 #endif
 
 
+#if 1 /* separable filtering */
+  Stack *stack = Make_Stack(GREY, 256, 256, 64);
+  size_t volume = Stack_Voxel_Number(stack);
+  size_t i;
+  srand(1);
+  for (i = 0; i < volume; i++) {
+    stack->array[i] = rand() % 256;
+  }
+
+  double sigma[3] = {2.0, 2.0, 1.0};
+
+  tic();
+  Separable_Filter_3d sfilter;
+  Gaussian_Separable_Filter_3d(sigma[0], sigma[1], sigma[2], &sfilter);
+  Stack *out = Make_Stack(FLOAT32, stack->width, stack->height, stack->depth);
+  Filter_Stack_Separable(stack, &sfilter, out);
+  printf("Separable filtering: %lld ms\n", (long long) toc());
+
+  /* compare with the dense filter normalized within the stack */
+  FMatrix *filter = Gaussian_3D_Filter_F(sigma, NULL);
+  int rx = filter->dim[0] / 2;
+  int ry = filter->dim[1] / 2;
+  int rz = filter->dim[2] / 2;
+  float *array = (float*) out->array;
+  double max_diff = 0.0;
+  int n;
+  for (n = 0; n < 1000; n++) {
+    int x = rand() % stack->width;
+    int y = rand() % stack->height;
+    int z = rand() % stack->depth;
+    double v = 0.0;
+    double w = 0.0;
+    int dx, dy, dz;
+    for (dz = -rz; dz <= rz; dz++) {
+      for (dy = -ry; dy <= ry; dy++) {
+        for (dx = -rx; dx <= rx; dx++) {
+          if (x + dx >= 0 && x + dx < stack->width &&
+              y + dy >= 0 && y + dy < stack->height &&
+              z + dz >= 0 && z + dz < stack->depth) {
+            double weight = filter->array[
+                ((dz + rz) * filter->dim[1] + dy + ry) * filter->dim[0] +
+                dx + rx];
+            v += weight * Get_Stack_Pixel(stack, x + dx, y + dy, z + dz, 0);
+            w += weight;
+          }
+        }
+      }
+    }
+    double diff = fabs(array[Stack_Util_Offset(x, y, z, stack->width,
+                                               stack->height, stack->depth)] -
+                       v / w);
+    if (diff > max_diff) {
+      max_diff = diff;
+    }
+  }
+  printf("Max difference: %g\n", max_diff);
+
+  Kill_FMatrix(filter);
+  Kill_Stack(out);
+  Kill_Stack(stack);
+#endif
+
   return 0;
 }
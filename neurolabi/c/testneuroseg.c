@@ -21,6 +21,7 @@
 #include "tz_rpi_neuroseg.h"
 #include "tz_local_rpi_neuroseg.h"
 #include "tz_image_io.h"
+#include "tz_stack_sampling.h"
 
 INIT_EXCEPTION_MAIN(e)
 
@@ -2147,7 +2148,7 @@ int main(int argc, char* argv[])
   }
 #endif
 
-#if 1
+#if 0
   Local_Neuroseg *locseg = New_Local_Neuroseg();
   locseg->seg.r1 = 2.0;
   Print_Local_Neuroseg(locseg);
@@ -2168,6 +2169,74 @@ int main(int argc, char* argv[])
   printf("Score: %g (Expected: 0.0643115)\n", Local_Neuroseg_Score_W(locseg, stack, 1.0, ws));
 #endif
 
+#if 1 /* fitting benchmark */
+  /* A synthetic tube along the x axis */
+  Stack *stack = Make_Stack(GREY, 128, 96, 64);
+  int i, j, k;
+  size_t offset = 0;
+  for (k = 0; k < stack->depth; k++) {
+    for (j = 0; j < stack->height; j++) {
+      for (i = 0; i < stack->width; i++) {
+        double d2 = (j - 48.3) * (j - 48.3) + (k - 31.7) * (k - 31.7);
+        stack->array[offset++] = (uint8) (20.0 + 200.0 * exp(-d2 / 8.0) +
+                                          (i * 7 + j * 13 + k * 5) % 11);
+      }
+    }
+  }
+
+  int var_index[LOCAL_NEUROSEG_NPARAM];
+  int nvar = Local_Neuroseg_Var_Mask_To_Index
+    (NEUROSEG_VAR_MASK_R | NEUROSEG_VAR_MASK_ORIENTATION,
+     NEUROPOS_VAR_MASK_ALL, var_index);
+
+  int nfit = 200;
+  Local_Neuroseg *locseg = New_Local_Neuroseg();
+  tic();
+  for (i = 0; i < nfit; i++) {
+    Set_Local_Neuroseg(locseg, 2.5, 0.0, 12, TZ_PI_2, TZ_PI_2 + 0.2, 0.0, 0.0,
+                       1.0, 60 + i % 10, 47, 32);
+    Fit_Local_Neuroseg_P(locseg, stack, var_index, nvar, NULL, 1.0, NULL);
+  }
+  double t = (double) toc();
+  printf("Fitting: %g fits per second\n", nfit * 1000.0 / t);
+  Print_Local_Neuroseg(locseg);
+
+  /* Sampling the template of the fitted segment */
+  Geo3d_Scalar_Field *field = Local_Neuroseg_Field_S(locseg, NULL, NULL);
+  double *points = Coordinate_3d_Double_Array(field->points);
+  double *value = darray_malloc(field->size);
+  double *expected = darray_malloc(field->size);
+  int nsample = 20000;
+
+  tic();
+  for (i = 0; i < nsample; i++) {
+    for (j = 0; j < field->size; j++) {
+      expected[j] = Stack_Point_Sampling(stack, points[j * 3],
+                                         points[j * 3 + 1], points[j * 3 + 2]);
+    }
+  }
+  printf("Point-wise sampling: %lld ms\n", (long long) toc());
+
+  tic();
+  for (i = 0; i < nsample; i++) {
+    Stack_Points_Sampling(stack, points, field->size, value);
+  }
+  printf("Batch sampling: %lld ms\n", (long long) toc());
+
+  for (j = 0; j < field->size; j++) {
+    if (value[j] != expected[j]) {
+      printf("Sampling mismatch at %d: %g vs %g\n", j, value[j], expected[j]);
+      break;
+    }
+  }
+
+  free(value);
+  free(expected);
+  Kill_Geo3d_Scalar_Field(field);
+  Delete_Local_Neuroseg(locseg);
+  Kill_Stack(stack);
+#endif
+
 
   return 0;
 }
@@ -35,6 +35,7 @@ void Default_Sp_Grow_Workspace(Sp_Grow_Workspace *sgw)
   sgw->value = 0.0;
   sgw->fgratio = 0.0;
   sgw->sp_option = 0;
+  sgw->queue_option = SP_GROW_BINARY_HEAP;
   sgw->width = 0;
   sgw->height = 0;
   sgw->depth = 0;
@@ -72,9 +73,161 @@ void Sp_Grow_Workspace_Disable_Eucdist_Buffer(Sp_Grow_Workspace *sgw)
   OBJECT_SAFE_FREE(sgw->length, free);
 }
 
+/* Binary heap of voxels keyed by their distances. It follows the indexed
+ * heap of Int_Heap_Add_I(), Int_Heap_Update_I(), Int_Heap_Remove_I() and
+ * Int_Heap_Remove_I_At() step by step, including the position records in
+ * sgw->checked, so voxels are popped in exactly the same order. The
+ * difference is that each entry keeps a copy of its distance, which saves
+ * the scattered reads of sgw->dist while sifting. Entry 0 is not used. */
+typedef struct _Sp_Grow_Heap_Entry {
+  double key;
+  int index;
+} Sp_Grow_Heap_Entry;
+
+typedef struct _Sp_Grow_Keyed_Heap {
+  Sp_Grow_Heap_Entry *entry;
+  int length; /* including entry 0 */
+  int capacity;
+} Sp_Grow_Keyed_Heap;
+
+static Sp_Grow_Keyed_Heap* new_sp_grow_keyed_heap()
+{
+  Sp_Grow_Keyed_Heap *heap = (Sp_Grow_Keyed_Heap*)
+    Guarded_Malloc(sizeof(Sp_Grow_Keyed_Heap), "new_sp_grow_keyed_heap");
+  heap->capacity = 1024;
+  heap->entry = (Sp_Grow_Heap_Entry*) Guarded_Malloc(
+      sizeof(Sp_Grow_Heap_Entry) * heap->capacity, "new_sp_grow_keyed_heap");
+  heap->length = 1;
+
+  return heap;
+}
+
+static void kill_sp_grow_keyed_heap(Sp_Grow_Keyed_Heap *heap)
+{
+  free(heap->entry);
+  free(heap);
+}
+
+static inline void sp_grow_keyed_heap_set(Sp_Grow_Keyed_Heap *heap, int i,
+                                          Sp_Grow_Heap_Entry e, int *checked)
+{
+  heap->entry[i] = e;
+  checked[e.index] = i + 1;
+}
+
+/* move the entry at <child> up, as Int_Heap_Update_I() does */
+static void sp_grow_keyed_heap_sift_up(Sp_Grow_Keyed_Heap *heap, int child,
+                                       int *checked)
+{
+  Sp_Grow_Heap_Entry e = heap->entry[child];
+  while (child > 1) {
+    int parent = child / 2;
+    if (e.key < heap->entry[parent].key) {
+      sp_grow_keyed_heap_set(heap, child, heap->entry[parent], checked);
+      child = parent;
+    } else {
+      break;
+    }
+  }
+  sp_grow_keyed_heap_set(heap, child, e, checked);
+}
+
+/* move the entry at <parent> down, as Int_Heap_Remove_I() does */
+static void sp_grow_keyed_heap_sift_down(Sp_Grow_Keyed_Heap *heap, int parent,
+                                         int *checked)
+{
+  Sp_Grow_Heap_Entry e = heap->entry[parent];
+  checked[e.index] = parent + 1;
+  if (parent >= heap->length) { /* the removed entry was the last one */
+    return;
+  }
+
+  for (;;) {
+    int child = parent * 2;
+    if (child >= heap->length) {
+      break;
+    }
+    if (child + 1 < heap->length &&
+        heap->entry[child].key > heap->entry[child + 1].key) {
+      child++;
+    }
+    if (e.key > heap->entry[child].key) {
+      sp_grow_keyed_heap_set(heap, parent, heap->entry[child], checked);
+      parent = child;
+    } else {
+      break;
+    }
+  }
+  sp_grow_keyed_heap_set(heap, parent, e, checked);
+}
+
+static void sp_grow_keyed_heap_add(Sp_Grow_Keyed_Heap *heap, int index,
+                                   double key, int *checked)
+{
+  if (heap->length == heap->capacity) {
+    heap->capacity *= 2;
+    heap->entry = (Sp_Grow_Heap_Entry*) Guarded_Realloc(
+        heap->entry, sizeof(Sp_Grow_Heap_Entry) * heap->capacity,
+        "sp_grow_keyed_heap_add");
+  }
+  heap->entry[heap->length].key = key;
+  heap->entry[heap->length].index = index;
+  heap->length++;
+  sp_grow_keyed_heap_sift_up(heap, heap->length - 1, checked);
+}
+
+static void sp_grow_keyed_heap_update(Sp_Grow_Keyed_Heap *heap, int index,
+                                      double key, int *checked)
+{
+  int i = checked[index] - 1;
+  /* Int_Heap_Update_I() does not move anything if the recorded position is
+   * no longer that of the voxel */
+  if (i < heap->length && heap->entry[i].index == index) {
+    heap->entry[i].key = key;
+    sp_grow_keyed_heap_sift_up(heap, i, checked);
+  }
+}
+
+/* remove the entry at <i> and return its voxel */
+static int sp_grow_keyed_heap_remove_at(Sp_Grow_Keyed_Heap *heap, int i,
+                                        int *checked)
+{
+  int removed = heap->entry[i].index;
+  checked[removed] = 0;
+  heap->length--;
+  heap->entry[i] = heap->entry[heap->length];
+  sp_grow_keyed_heap_sift_down(heap, i, checked);
+
+  return removed;
+}
+
+/* Pop the voxel with the smallest distance, which is marked as checked. It
+ * returns -1 if no reachable voxel is left. */
+static ssize_t sp_grow_keyed_heap_pop(Sp_Grow_Keyed_Heap *heap,
+                                      Sp_Grow_Workspace *sgw)
+{
+  if (heap->length <= 1) {
+    return -1;
+  }
+
+  int index = sp_grow_keyed_heap_remove_at(heap, 1, sgw->checked);
+  if (sgw->dist[index] == Infinity) {
+    return -1;
+  }
+  sgw->checked[index] = 1;
+
+  return index;
+}
+
+/* The priority queue selected by sgw->queue_option */
+typedef struct _Sp_Grow_Queue {
+  Int_Arraylist *heap;
+  Sp_Grow_Keyed_Heap *keyed_heap;
+} Sp_Grow_Queue;
+
 /* check the neighbor and update the heap if necessary */
 static void update_waiting(const Stack *stack, size_t r, size_t nbr_index, 
-			   double weight, Int_Arraylist *heap, 
+			   double weight, Sp_Grow_Queue *queue, 
 			   Int_Arraylist *result, Sp_Grow_Workspace *sgw)
 {
   if ((sgw->checked[nbr_index] != 1) && 
@@ -117,11 +270,43 @@ static void update_waiting(const Stack *stack, size_t r, size_t nbr_index,
     }
 
     if (sgw->checked[nbr_index] > 1) { /* update heap */
-      Int_Heap_Update_I(heap, nbr_index, sgw->dist, sgw->checked);
+      if (queue->keyed_heap != NULL) {
+        sp_grow_keyed_heap_update(queue->keyed_heap, nbr_index,
+                                  sgw->dist[nbr_index], sgw->checked);
+      } else {
+        Int_Heap_Update_I(queue->heap, nbr_index, sgw->dist, sgw->checked);
+      }
     } else if (sgw->checked[nbr_index] <= 0) { /* add to heap */
-      Int_Heap_Add_I(heap, nbr_index, sgw->dist, sgw->checked);
+      if (queue->keyed_heap != NULL) {
+        sp_grow_keyed_heap_add(queue->keyed_heap, nbr_index,
+                               sgw->dist[nbr_index], sgw->checked);
+      } else {
+        Int_Heap_Add_I(queue->heap, nbr_index, sgw->dist, sgw->checked);
+      }
+    }
+  }
+}
+
+static void sp_grow_queue_remove(Sp_Grow_Queue *queue, size_t index,
+                                 Sp_Grow_Workspace *sgw)
+{
+  if (queue->keyed_heap != NULL) {
+    int i = sgw->checked[index] - 1;
+    if (i > 0) {
+      sp_grow_keyed_heap_remove_at(queue->keyed_heap, i, sgw->checked);
     }
+  } else {
+    Int_Heap_Remove_I_At(queue->heap, index, sgw->dist, sgw->checked);
+  }
+}
+
+static ssize_t sp_grow_queue_pop(Sp_Grow_Queue *queue, Sp_Grow_Workspace *sgw)
+{
+  if (queue->keyed_heap != NULL) {
+    return sp_grow_keyed_heap_pop(queue->keyed_heap, sgw);
   }
+
+  return extract_min(sgw->dist, sgw->checked, sgw->size, queue->heap);
 }
 
 /* add a neighbor to the flood filling queue for super conductor */
@@ -261,8 +446,15 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
   //  for (i = 0; i < nseed; i++) {
   // size_t r = seeds[i];
 
-  /* alloc <heap> */
-  Int_Arraylist *heap = New_Int_Arraylist();
+  /* alloc <queue> */
+  Sp_Grow_Queue queue;
+  queue.heap = NULL;
+  queue.keyed_heap = NULL;
+  if (sgw->queue_option == SP_GROW_KEYED_HEAP) {
+    queue.keyed_heap = new_sp_grow_keyed_heap();
+  } else {
+    queue.heap = New_Int_Arraylist();
+  }
 
   size_t r;
   for (r = 0; r < nvoxel; r++) {
@@ -274,7 +466,7 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
         for (j = 0; j < sgw->conn; j++) {
           size_t nbr_index = r + neighbors[j];
           if (sgw->checked[nbr_index] != 1) {
-            update_waiting(stack, r, nbr_index, dist[j], heap, result, sgw);
+            update_waiting(stack, r, nbr_index, dist[j], &queue, result, sgw);
           }
         }
       } else if (nbound > 0) {
@@ -282,7 +474,7 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
           if (is_in_bound[j]) {
             size_t nbr_index = r + neighbors[j];
             if (sgw->checked[nbr_index] != 1) {
-              update_waiting(stack, r, nbr_index, dist[j], heap, result, sgw);
+              update_waiting(stack, r, nbr_index, dist[j], &queue, result, sgw);
             }
           }
         }
@@ -295,7 +487,7 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
   ssize_t last_r = -1;
 
   while (stop == FALSE) {
-    ssize_t r = extract_min(sgw->dist, sgw->checked, sgw->size, heap);
+    ssize_t r = sp_grow_queue_pop(&queue, sgw);
 
     if (r >= 0) {
       last_r = r;
@@ -307,7 +499,7 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
           for (j = 0; j < sgw->conn; j++) {
             size_t nbr_index = r + neighbors[j];
             if (sgw->checked[nbr_index] != 1) {
-              update_waiting(stack, r, nbr_index, dist[j], heap, result, sgw);
+              update_waiting(stack, r, nbr_index, dist[j], &queue, result, sgw);
             }
           }
         } else if (nbound > 0) {
@@ -315,7 +507,7 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
             if (is_in_bound[j]) {
               size_t nbr_index = r + neighbors[j];
               if (sgw->checked[nbr_index] != 1) {
-                update_waiting(stack, r, nbr_index, dist[j], heap, result, sgw);
+                update_waiting(stack, r, nbr_index, dist[j], &queue, result, sgw);
               }
             }
           }
@@ -340,12 +532,12 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
         size_t nbr_index = cur_index + neighbors[j];	\
         if (sgw->flag[nbr_index] == 4) {				\
           if (sgw->checked[nbr_index] > 1) {				\
-            Int_Heap_Remove_I_At(heap, nbr_index, sgw->dist,		\
-                sgw->checked);				\
+            sp_grow_queue_remove(&queue, nbr_index, sgw);		\
           }								\
           tail_index = update_neighbor(cur_index, tail_index, nbr_index,sgw); \
         } else {							\
-          update_waiting(stack, cur_index, nbr_index, dist[j], heap, result,sgw); \
+          update_waiting(stack, cur_index, nbr_index, dist[j], &queue, result, \
+                         sgw);						\
         }
 
         if (nbound == sgw->conn) { /* all neighbors are in bound */
@@ -413,8 +605,12 @@ Int_Arraylist* Stack_Sp_Grow(const Stack *stack, const size_t *seeds,
       cur_index = sgw->path[cur_index];
     }
   }
-  /* free <heap> */
-  Kill_Int_Arraylist(heap);
+  /* free <queue> */
+  if (queue.keyed_heap != NULL) {
+    kill_sp_grow_keyed_heap(queue.keyed_heap);
+  } else {
+    Kill_Int_Arraylist(queue.heap);
+  }
 
   return result;
 }
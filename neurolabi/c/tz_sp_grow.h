@@ -30,6 +30,7 @@ typedef struct _Sp_Grow_Workspace {
   double value; /* distance value */
   double fgratio; /* background ratio */
   int sp_option; /* shortest path option (1 for maxmin) */
+  int queue_option; /* priority queue (SP_GROW_BINARY_HEAP by default) */
   int width;
   int height;
   int depth;
@@ -38,6 +39,12 @@ typedef struct _Sp_Grow_Workspace {
 
 enum {SP_GROW_TARGET = 1, SP_GROW_SOURCE, SP_GROW_BARRIER, SP_GROW_CONDUCTOR};
 
+/* Priority queues of Stack_Sp_Grow(). The keyed heap is the same binary
+ * heap as the default one with the distances stored in the heap entries. It
+ * pops voxels in the same order, including ties, so the results are
+ * identical. */
+enum {SP_GROW_BINARY_HEAP = 0, SP_GROW_KEYED_HEAP};
+
 DECLARE_ZOBJECT_INTERFACE(Sp_Grow_Workspace)
 
 /**@brief Set the mask of sp grow workspace.
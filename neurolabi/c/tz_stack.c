@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "tz_stack_lib.h"
 #include "tz_stack_utils.h"
 #include "tz_stack_neighborhood.h"
@@ -9,6 +11,7 @@
 #include "tz_stack.h"
 #include "tz_fimage_lib.h"
 #include "tz_interface.h"
+#include "tz_utilities.h"
 
 void Stack_Bc_Autoadjust(Stack *stack)
 {
@@ -212,3 +215,403 @@ Stack* Filter_Stack(const Stack *stack, const Filter_3d *filter)
   Kill_FMatrix(result);
   return out;
 }
+
+void Gaussian_Separable_Filter_3d(double sigma_x, double sigma_y,
+                                  double sigma_z, Separable_Filter_3d *filter)
+{
+  Gaussian_Derivative_Separable_Filter_3d(sigma_x, sigma_y, sigma_z, 0, 0, 0,
+                                          filter);
+}
+
+void Gaussian_Derivative_Separable_Filter_3d(
+    double sigma_x, double sigma_y, double sigma_z, int ox, int oy, int oz,
+    Separable_Filter_3d *filter)
+{
+  filter->sigma[0] = sigma_x;
+  filter->sigma[1] = sigma_y;
+  filter->sigma[2] = sigma_z;
+  filter->nterm = 1;
+  filter->order[0][0] = ox;
+  filter->order[0][1] = oy;
+  filter->order[0][2] = oz;
+  filter->weight[0] = 1.0;
+}
+
+void Mexihat_Separable_Filter_3d(double sigma, Separable_Filter_3d *filter)
+{
+  /* (1 - r^2 / (3 sigma^2)) G = -sigma^2 / 3 (Gxx + Gyy + Gzz) */
+  int i, j;
+  for (i = 0; i < 3; i++) {
+    filter->sigma[i] = sigma;
+  }
+  filter->nterm = 3;
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      filter->order[i][j] = (i == j) ? 2 : 0;
+    }
+    filter->weight[i] = -sigma * sigma / 3.0;
+  }
+}
+
+/* Same window size as Gaussian_3D_Filter_F() */
+static int separable_filter_radius(double sigma)
+{
+  if (sigma <= 0.0) {
+    return 0;
+  }
+
+  int r = ((int) (sigma + 0.5)) * 3;
+  if (r == 0) {
+    r = 1;
+  }
+
+  return r;
+}
+
+/* The kernel is for correlation, i.e. out[x] = sum(kernel[k + r] * in[x + k])*/
+static void separable_filter_kernel(double sigma, int order, int r,
+                                    float *kernel)
+{
+  int k;
+
+  if (sigma <= 0.0) {
+    kernel[0] = (order == 0) ? 1.0f : 0.0f;
+    return;
+  }
+
+  double sigma2 = sigma * sigma;
+  double sum = 0.0;
+  for (k = -r; k <= r; k++) {
+    sum += exp(-k * k / sigma2 / 2.0);
+  }
+
+  for (k = -r; k <= r; k++) {
+    double g = exp(-k * k / sigma2 / 2.0) / sum;
+    switch (order) {
+    case 0:
+      kernel[k + r] = g;
+      break;
+    case 1:
+      kernel[k + r] = k / sigma2 * g;
+      break;
+    case 2:
+      kernel[k + r] = (k * k / sigma2 - 1.0) / sigma2 * g;
+      break;
+    default:
+      TZ_ERROR(ERROR_DATA_VALUE);
+    }
+  }
+}
+
+static float separable_filter_border_voxel(const float *in, int length,
+                                           int x, const float *kernel, int r,
+                                           BOOL normalized)
+{
+  int k;
+  double v = 0.0;
+  double w = 0.0;
+  for (k = -r; k <= r; k++) {
+    int p = x + k;
+    if (p < 0 || p >= length) {
+      if (normalized) {
+        continue;
+      }
+      p = (p < 0) ? 0 : length - 1;
+    }
+    v += kernel[k + r] * in[p];
+    w += kernel[k + r];
+  }
+
+  return (normalized && w != 0.0) ? v / w : v;
+}
+
+/* Filter a contiguous line. Out-of-bound voxels are skipped with weight
+ * normalization if <normalized> is TRUE, or replaced by the boundary voxels
+ * otherwise. */
+static void separable_filter_line(const float *in, int length,
+                                  const float *kernel, int r, BOOL normalized,
+                                  float *out)
+{
+  int x, k;
+  int x0 = imin2(r, length);
+  int x1 = imax2(x0, length - r);
+
+  for (x = 0; x < x0; x++) {
+    out[x] = separable_filter_border_voxel(in, length, x, kernel, r,
+                                           normalized);
+  }
+
+  for (x = x0; x < x1; x++) {
+    float v = 0.0f;
+    for (k = -r; k <= r; k++) {
+      v += kernel[k + r] * in[x + k];
+    }
+    out[x] = v;
+  }
+
+  for (x = x1; x < length; x++) {
+    out[x] = separable_filter_border_voxel(in, length, x, kernel, r,
+                                           normalized);
+  }
+}
+
+/* Filter across lines. Line <p> starts at base + (p % nmod) * stride and
+ * <index> is the line to compute among <length> lines. */
+static void separable_filter_across(const float *base, size_t stride,
+                                    int nmod, int index, int length,
+                                    const float *kernel, int r,
+                                    BOOL normalized, size_t n, float *out)
+{
+  int k;
+  size_t i;
+
+  double wsum = 1.0;
+  if (normalized) {
+    wsum = 0.0;
+    for (k = -r; k <= r; k++) {
+      if (index + k >= 0 && index + k < length) {
+        wsum += kernel[k + r];
+      }
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    out[i] = 0.0f;
+  }
+
+  for (k = -r; k <= r; k++) {
+    int p = index + k;
+    if (p < 0 || p >= length) {
+      if (normalized) {
+        continue;
+      }
+      p = (p < 0) ? 0 : length - 1;
+    }
+    const float *line = base + (p % nmod) * stride;
+    float w = kernel[k + r] / wsum;
+    for (i = 0; i < n; i++) {
+      out[i] += w * line[i];
+    }
+  }
+}
+
+static void stack_line_to_float(const Stack *stack, size_t offset, int n,
+                                float *line)
+{
+  int i;
+  Image_Array ima;
+  ima.array = stack->array;
+
+  switch (stack->kind) {
+  case GREY:
+    for (i = 0; i < n; i++) {
+      line[i] = ima.array[offset + i];
+    }
+    break;
+  case GREY16:
+    for (i = 0; i < n; i++) {
+      line[i] = ima.array16[offset + i];
+    }
+    break;
+  case FLOAT32:
+    for (i = 0; i < n; i++) {
+      line[i] = ima.array32[offset + i];
+    }
+    break;
+  case FLOAT64:
+    for (i = 0; i < n; i++) {
+      line[i] = ima.array64[offset + i];
+    }
+    break;
+  default:
+    TZ_ERROR(ERROR_DATA_TYPE);
+  }
+}
+
+static void float_to_stack_line(const float *line, size_t n, Stack *stack,
+                                size_t offset)
+{
+  size_t i;
+  Image_Array ima;
+  ima.array = stack->array;
+
+  switch (stack->kind) {
+  case GREY:
+    for (i = 0; i < n; i++) {
+      float v = line[i];
+      ima.array[offset + i] =
+        (v <= 0.0f) ? 0 : ((v >= 255.0f) ? 255 : (uint8) (v + 0.5f));
+    }
+    break;
+  case GREY16:
+    for (i = 0; i < n; i++) {
+      float v = line[i];
+      ima.array16[offset + i] =
+        (v <= 0.0f) ? 0 : ((v >= 65535.0f) ? 65535 : (uint16) (v + 0.5f));
+    }
+    break;
+  case FLOAT32:
+    for (i = 0; i < n; i++) {
+      ima.array32[offset + i] = line[i];
+    }
+    break;
+  case FLOAT64:
+    for (i = 0; i < n; i++) {
+      ima.array64[offset + i] = line[i];
+    }
+    break;
+  default:
+    TZ_ERROR(ERROR_DATA_TYPE);
+  }
+}
+
+size_t Filter_Stack_Separable_Buffer_Size(const Stack *stack,
+                                          const Separable_Filter_3d *filter)
+{
+  int i;
+  size_t area = Stack_Plane_Area(stack);
+  size_t kernel_size = 0;
+  for (i = 0; i < 3; i++) {
+    kernel_size += separable_filter_radius(filter->sigma[i]) * 2 + 1;
+  }
+  size_t nring = separable_filter_radius(filter->sigma[2]) * 2 + 1;
+
+  /* line, plane buffer, accumulated plane, rings and kernels */
+  return stack->width + area * 2 + (area * nring + kernel_size) * filter->nterm;
+}
+
+static void separable_filter_store_plane(const float *plane, size_t area,
+                                         int z, void *data)
+{
+  float_to_stack_line(plane, area, (Stack*) data, area * z);
+}
+
+void Filter_Stack_Separable_Slab(const Stack *stack,
+                                 const Separable_Filter_3d *filter,
+                                 int z0, int z1, float *buffer, Stack *out)
+{
+  TZ_ASSERT(out->width == stack->width && out->height == stack->height &&
+            out->depth == stack->depth, "Unmatched stack size");
+
+  Filter_Stack_Separable_Slab_Plane(stack, filter, z0, z1, buffer,
+                                    separable_filter_store_plane, out);
+}
+
+void Filter_Stack_Separable_Slab_Plane(const Stack *stack,
+                                       const Separable_Filter_3d *filter,
+                                       int z0, int z1, float *buffer,
+                                       Separable_Filter_Plane_f plane_fn,
+                                       void *data)
+{
+  int width = stack->width;
+  int height = stack->height;
+  int depth = stack->depth;
+
+  if (z0 < 0) {
+    z0 = 0;
+  }
+  if (z1 > depth) {
+    z1 = depth;
+  }
+  if (z0 >= z1) {
+    return;
+  }
+
+  TZ_ASSERT(filter->nterm > 0 && filter->nterm <= SEPARABLE_FILTER_3D_MAX_TERM,
+            "Invalid filter");
+
+  BOOL own_buffer = FALSE;
+  if (buffer == NULL) {
+    buffer = (float*) Guarded_Malloc(
+          sizeof(float) * Filter_Stack_Separable_Buffer_Size(stack, filter),
+          "Filter_Stack_Separable_Slab");
+    own_buffer = TRUE;
+  }
+
+  int i, t, y, z;
+  int r[3];
+  for (i = 0; i < 3; i++) {
+    r[i] = separable_filter_radius(filter->sigma[i]);
+  }
+  int nring = r[2] * 2 + 1;
+  size_t area = (size_t) width * height;
+
+  float *line = buffer;
+  float *plane = line + width;
+  float *acc = plane + area;
+  float *ring[SEPARABLE_FILTER_3D_MAX_TERM];
+  float *kernel[SEPARABLE_FILTER_3D_MAX_TERM][3];
+  BOOL normalized[SEPARABLE_FILTER_3D_MAX_TERM][3];
+  float *next_buffer = acc + area;
+  for (t = 0; t < filter->nterm; t++) {
+    ring[t] = next_buffer;
+    next_buffer += area * nring;
+    for (i = 0; i < 3; i++) {
+      kernel[t][i] = next_buffer;
+      separable_filter_kernel(filter->sigma[i], filter->order[t][i], r[i],
+                              kernel[t][i]);
+      normalized[t][i] = (filter->order[t][i] == 0);
+      next_buffer += r[i] * 2 + 1;
+    }
+  }
+
+  /* The ring of each term keeps the xy-filtered planes within the z window
+   * of the current plane. */
+  int next_plane = imax2(0, z0 - r[2]);
+  for (z = z0; z < z1; z++) {
+    int last_plane = imin2(depth - 1, z + r[2]);
+    for (; next_plane <= last_plane; next_plane++) {
+      size_t plane_offset = area * next_plane;
+      for (t = 0; t < filter->nterm; t++) {
+        for (y = 0; y < height; y++) {
+          stack_line_to_float(stack, plane_offset + (size_t) y * width, width,
+                              line);
+          separable_filter_line(line, width, kernel[t][0], r[0],
+                                normalized[t][0], plane + (size_t) y * width);
+        }
+        float *ring_plane = ring[t] + (next_plane % nring) * area;
+        for (y = 0; y < height; y++) {
+          separable_filter_across(plane, width, height, y, height,
+                                  kernel[t][1], r[1], normalized[t][1],
+                                  width, ring_plane + (size_t) y * width);
+        }
+      }
+    }
+
+    if (filter->nterm == 1 && filter->weight[0] == 1.0) {
+      separable_filter_across(ring[0], area, nring, z, depth, kernel[0][2],
+                              r[2], normalized[0][2], area, acc);
+    } else {
+      size_t offset;
+      for (offset = 0; offset < area; offset++) {
+        acc[offset] = 0.0f;
+      }
+      for (t = 0; t < filter->nterm; t++) {
+        separable_filter_across(ring[t], area, nring, z, depth, kernel[t][2],
+                                r[2], normalized[t][2], area, plane);
+        float weight = filter->weight[t];
+        for (offset = 0; offset < area; offset++) {
+          acc[offset] += weight * plane[offset];
+        }
+      }
+    }
+
+    plane_fn(acc, area, z, data);
+  }
+
+  if (own_buffer) {
+    free(buffer);
+  }
+}
+
+Stack* Filter_Stack_Separable(const Stack *stack,
+                              const Separable_Filter_3d *filter, Stack *out)
+{
+  if (out == NULL) {
+    out = Make_Stack(stack->kind, stack->width, stack->height, stack->depth);
+  }
+
+  Filter_Stack_Separable_Slab(stack, filter, 0, stack->depth, NULL, out);
+
+  return out;
+}
@@ -57,6 +57,78 @@ Filter_3d* Gaussian_Filter_3d(double sigma_x, double sigma_y, double sigma_z);
 Filter_3d* Mexihat_Filter_3d(double sigma);
 Stack* Filter_Stack(const Stack *stack, const Filter_3d *filter);
 
+/**@brief Separable filter.
+ *
+ * A separable filter is a weighted sum of at most
+ * SEPARABLE_FILTER_3D_MAX_TERM terms. Each term is a product of 1D Gaussian
+ * kernels or their derivatives along x, y and z, whose derivative orders
+ * (0, 1 or 2) are stored in <order>. A 1D kernel with non-positive sigma is
+ * the identity for order 0 and zero for other orders. Gaussian kernels are
+ * normalized at the stack boundary, and derivative kernels replicate the
+ * boundary voxels.
+ */
+#define SEPARABLE_FILTER_3D_MAX_TERM 3
+
+typedef struct _Separable_Filter_3d {
+  double sigma[3];
+  int nterm;
+  int order[SEPARABLE_FILTER_3D_MAX_TERM][3];
+  double weight[SEPARABLE_FILTER_3D_MAX_TERM];
+} Separable_Filter_3d;
+
+/**@brief Make separable filters.
+ *
+ * Gaussian_Separable_Filter_3d() makes a Gaussian filter.
+ * Gaussian_Derivative_Separable_Filter_3d() makes a derivative-of-Gaussian
+ * filter with the derivative orders <ox>, <oy> and <oz>.
+ * Mexihat_Separable_Filter_3d() makes a Mexican-hat filter, which is the
+ * negative Laplacian of Gaussian up to a scale.
+ */
+void Gaussian_Separable_Filter_3d(double sigma_x, double sigma_y,
+                                  double sigma_z, Separable_Filter_3d *filter);
+void Gaussian_Derivative_Separable_Filter_3d(
+    double sigma_x, double sigma_y, double sigma_z, int ox, int oy, int oz,
+    Separable_Filter_3d *filter);
+void Mexihat_Separable_Filter_3d(double sigma, Separable_Filter_3d *filter);
+
+/**@brief Separable filtering.
+ *
+ * Filter_Stack_Separable() filters <stack> with <filter> and stores the result
+ * in <out>, which must have the same size as <stack>. A new stack with the
+ * same kind as <stack> is created if <out> is NULL. Unlike Filter_Stack(),
+ * the intensities are not stretched. They are rounded and clamped if <out>
+ * is GREY or GREY16, so a FLOAT32 output is needed for signed filters. The
+ * function returns the output stack.
+ *
+ * The stack is processed plane by plane with a float buffer of
+ * Filter_Stack_Separable_Buffer_Size() elements, which depends on the plane
+ * size and the z size of the filter, but not the stack depth.
+ *
+ * Filter_Stack_Separable_Slab() only fills the planes [<z0>, <z1>) of <out>.
+ * Different slabs can be done in parallel as long as each has its own
+ * <buffer>, which is allocated within the function if it is NULL.
+ *
+ * Filter_Stack_Separable_Slab_Plane() does not store the result. Instead it
+ * calls <plane_fn> with each filtered plane of [<z0>, <z1>) in order, along
+ * with the number of voxels in the plane, the plane index and <data>. The
+ * plane is only valid during the call.
+ */
+typedef void (*Separable_Filter_Plane_f) (const float *plane, size_t area,
+                                          int z, void *data);
+
+Stack* Filter_Stack_Separable(const Stack *stack,
+                              const Separable_Filter_3d *filter, Stack *out);
+size_t Filter_Stack_Separable_Buffer_Size(const Stack *stack,
+                                          const Separable_Filter_3d *filter);
+void Filter_Stack_Separable_Slab(const Stack *stack,
+                                 const Separable_Filter_3d *filter,
+                                 int z0, int z1, float *buffer, Stack *out);
+void Filter_Stack_Separable_Slab_Plane(const Stack *stack,
+                                       const Separable_Filter_3d *filter,
+                                       int z0, int z1, float *buffer,
+                                       Separable_Filter_Plane_f plane_fn,
+                                       void *data);
+
 /**@brief find objects
  *
  * Find_Stack_Objects() returns an array of 3d objects. The number of objects
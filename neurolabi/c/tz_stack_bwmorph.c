@@ -5,6 +5,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "tz_error.h"
 #include "tz_image_lib.h"
 #include "tz_objdetect.h"
@@ -1566,6 +1567,280 @@ Stack *Stack_Bwdist_L_U16P(const Stack *in, Stack *out, int pad)
   return out;
 }
 
+/* Number of adjacent lines transformed together in Stack_Bwdist_Sqr(); 32
+ * GREY16 voxels fill a cache line */
+#define BWDIST_SQR_BLOCK 32
+
+/* Lower envelope of parabolas (Felzenszwalb & Huttenlocher). <v> and <z>
+ * must have at least <n> and <n> + 1 elements. */
+static void bwdist_sqr_1d(const double *f, int n, double *d, int *v,
+                          double *z)
+{
+  int q;
+  int k = -1;
+
+  /* Nothing changes in a line of background */
+  for (q = 0; q < n; q++) {
+    if (f[q] != 0.0) {
+      break;
+    }
+  }
+  if (q == n) {
+    memcpy(d, f, sizeof(double) * n);
+    return;
+  }
+
+  for (q = 0; q < n; q++) {
+    if (f[q] >= STACK_BWDIST_SQR_INF) {
+      continue;
+    }
+
+    /* <d> keeps f[q] + q^2 until the envelope is done */
+    d[q] = f[q] + (double) q * q;
+
+    if (k < 0) {
+      k = 0;
+      v[0] = q;
+      z[0] = -STACK_BWDIST_SQR_INF;
+      z[1] = STACK_BWDIST_SQR_INF;
+      continue;
+    }
+
+    double s;
+    while ((s = (d[q] - d[v[k]]) / (2.0 * (q - v[k]))) <= z[k]) {
+      k--;
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = STACK_BWDIST_SQR_INF;
+  }
+
+  if (k < 0) {
+    for (q = 0; q < n; q++) {
+      d[q] = STACK_BWDIST_SQR_INF;
+    }
+    return;
+  }
+
+  k = 0;
+  for (q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    if (f[q] == 0.0) {
+      d[q] = 0.0;
+    } else {
+      double dq = q - v[k];
+      d[q] = dq * dq + f[v[k]];
+    }
+  }
+}
+
+/* Squared distance to the nearest zero in a binary row */
+static void bwdist_sqr_row(const uint8 *in, int n, BOOL border_zero,
+                           double *d)
+{
+  int x;
+  int last = border_zero ? -1 : INT_MIN;
+  for (x = 0; x < n; x++) {
+    if (in[x] == 0) {
+      last = x;
+    }
+    d[x] = (last == INT_MIN) ? STACK_BWDIST_SQR_INF : x - last;
+  }
+
+  int next = border_zero ? n : INT_MAX;
+  for (x = n - 1; x >= 0; x--) {
+    if (in[x] == 0) {
+      next = x;
+    }
+    if (next != INT_MAX && next - x < d[x]) {
+      d[x] = next - x;
+    }
+    if (d[x] < STACK_BWDIST_SQR_INF) {
+      d[x] *= d[x];
+    }
+  }
+}
+
+/* Load <nb> adjacent lines starting from <offset> into <f>, in which line b
+ * starts at b * <length> + <start>. The lines run with <stride>. */
+static void bwdist_sqr_gather(const Stack *stack, size_t offset, size_t stride,
+                              int n, int nb, double *f, int length, int start)
+{
+  int i, b;
+  Image_Array ima;
+  ima.array = stack->array;
+
+  switch (stack->kind) {
+  case GREY16:
+    for (i = 0; i < n; i++) {
+      const uint16 *src = ima.array16 + offset + stride * i;
+      for (b = 0; b < nb; b++) {
+        f[b * length + start + i] =
+          (src[b] == 65535) ? STACK_BWDIST_SQR_INF : src[b];
+      }
+    }
+    break;
+  case FLOAT32:
+    for (i = 0; i < n; i++) {
+      const float32 *src = ima.array32 + offset + stride * i;
+      for (b = 0; b < nb; b++) {
+        f[b * length + start + i] = src[b];
+      }
+    }
+    break;
+  default:
+    TZ_ERROR(ERROR_DATA_TYPE);
+  }
+}
+
+static void bwdist_sqr_scatter(const double *d, int length, int start, int n,
+                               int nb, Stack *stack, size_t offset,
+                               size_t stride)
+{
+  int i, b;
+  Image_Array ima;
+  ima.array = stack->array;
+
+  switch (stack->kind) {
+  case GREY16:
+    for (i = 0; i < n; i++) {
+      uint16 *dst = ima.array16 + offset + stride * i;
+      for (b = 0; b < nb; b++) {
+        double v = d[b * length + start + i];
+        if (v >= STACK_BWDIST_SQR_INF) {
+          dst[b] = 65535;
+        } else if (v > 65534.0) {
+          dst[b] = 65534;
+        } else {
+          dst[b] = (uint16) v;
+        }
+      }
+    }
+    break;
+  case FLOAT32:
+    for (i = 0; i < n; i++) {
+      float32 *dst = ima.array32 + offset + stride * i;
+      for (b = 0; b < nb; b++) {
+        dst[b] = d[b * length + start + i];
+      }
+    }
+    break;
+  default:
+    TZ_ERROR(ERROR_DATA_TYPE);
+  }
+}
+
+/* Transform <n> voxels of the lines starting from <offset> with <stride> in
+ * blocks. <f> and <d> hold BWDIST_SQR_BLOCK lines of (n + 2) elements. */
+static void bwdist_sqr_lines(Stack *out, size_t offset, size_t stride,
+                             size_t line_step, int nline, int n, int pad,
+                             double *f, double *d, int *v, double *z)
+{
+  /* Out-of-range background is two extra sites at both ends */
+  int start = (pad == 0) ? 1 : 0;
+  int length = n + start * 2;
+  int i, b;
+
+  for (i = 0; i < nline; i += BWDIST_SQR_BLOCK) {
+    int nb = imin2(BWDIST_SQR_BLOCK, nline - i);
+    size_t block_offset = offset + line_step * i;
+    bwdist_sqr_gather(out, block_offset, stride, n, nb, f, length, start);
+    for (b = 0; b < nb; b++) {
+      double *line = f + b * length;
+      if (pad == 0) {
+        line[0] = 0.0;
+        line[length - 1] = 0.0;
+      }
+      bwdist_sqr_1d(line, length, d + b * length, v, z);
+    }
+    bwdist_sqr_scatter(d, length, start, n, nb, out, block_offset, stride);
+  }
+}
+
+void Stack_Bwdist_Sqr_Plane(const Stack *in, Stack *out, int pad,
+                            int z0, int z1)
+{
+  ASSERT(in->kind == GREY, "GREY stack only");
+
+  int width = in->width;
+  int height = in->height;
+  size_t area = (size_t) width * height;
+  int length = imax2(width, height) + 2;
+
+  double *f = (double*) Guarded_Malloc(
+      sizeof(double) * length * BWDIST_SQR_BLOCK, "Stack_Bwdist_Sqr_Plane");
+  double *d = (double*) Guarded_Malloc(
+      sizeof(double) * length * BWDIST_SQR_BLOCK, "Stack_Bwdist_Sqr_Plane");
+  int *v = iarray_malloc(length);
+  double *z = (double*) Guarded_Malloc(sizeof(double) * (length + 1),
+                                       "Stack_Bwdist_Sqr_Plane");
+
+  int i, j;
+  z0 = imax2(z0, 0);
+  z1 = imin2(z1, in->depth);
+  for (i = z0; i < z1; i++) {
+    size_t plane_offset = area * i;
+    for (j = 0; j < height; j++) {
+      size_t offset = plane_offset + (size_t) width * j;
+      bwdist_sqr_row(in->array + offset, width, pad == 0, d);
+      bwdist_sqr_scatter(d, width, 0, width, 1, out, offset, 1);
+    }
+    bwdist_sqr_lines(out, plane_offset, width, 1, width, height, pad,
+                     f, d, v, z);
+  }
+
+  free(f);
+  free(d);
+  free(v);
+  free(z);
+}
+
+void Stack_Bwdist_Sqr_Column(Stack *out, int pad, int y0, int y1)
+{
+  int width = out->width;
+  size_t area = (size_t) width * out->height;
+  int length = out->depth + 2;
+
+  double *f = (double*) Guarded_Malloc(
+      sizeof(double) * length * BWDIST_SQR_BLOCK, "Stack_Bwdist_Sqr_Column");
+  double *d = (double*) Guarded_Malloc(
+      sizeof(double) * length * BWDIST_SQR_BLOCK, "Stack_Bwdist_Sqr_Column");
+  int *v = iarray_malloc(length);
+  double *z = (double*) Guarded_Malloc(sizeof(double) * (length + 1),
+                                       "Stack_Bwdist_Sqr_Column");
+
+  int j;
+  y0 = imax2(y0, 0);
+  y1 = imin2(y1, out->height);
+  for (j = y0; j < y1; j++) {
+    bwdist_sqr_lines(out, (size_t) width * j, area, 1, width, out->depth, pad,
+                     f, d, v, z);
+  }
+
+  free(f);
+  free(d);
+  free(v);
+  free(z);
+}
+
+Stack* Stack_Bwdist_Sqr(const Stack *in, Stack *out, int pad,
+                        BOOL slice_wise)
+{
+  if (out == NULL) {
+    out = Make_Stack(GREY16, in->width, in->height, in->depth);
+  }
+
+  Stack_Bwdist_Sqr_Plane(in, out, pad, 0, in->depth);
+  if (slice_wise == FALSE) {
+    Stack_Bwdist_Sqr_Column(out, pad, 0, in->height);
+  }
+
+  return out;
+}
+
 Stack_Seed_Workspace* New_Stack_Seed_Workspace()
 {
   Stack_Seed_Workspace *ws = (Stack_Seed_Workspace *)Guarded_Malloc(sizeof(Stack_Seed_Workspace),
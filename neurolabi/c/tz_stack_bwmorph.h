@@ -192,6 +192,35 @@ Stack* Stack_Bwdist_L_U16(const Stack *in, Stack *out, int pad);
  */
 Stack *Stack_Bwdist_L_U16P(const Stack *in, Stack *out, int pad);
 
+#define STACK_BWDIST_SQR_INF 1e30
+
+/**@brief Exact squared distance transformation
+ *
+ * Stack_Bwdist_Sqr() computes the squared Euclidean distance from each
+ * foreground voxel of the GREY stack <in> to the nearest background voxel.
+ * The result is stored in <out>, which must be GREY16 or FLOAT32. A new GREY16
+ * stack is created if <out> is NULL. The values of a GREY16 result are
+ * saturated at 65534, and a voxel without any background voxel to reach gets
+ * 65535 (GREY16) or STACK_BWDIST_SQR_INF (FLOAT32). <pad> is the value of the
+ * out-of-range field, which can be 0 or 1. The transform is done in each
+ * plane separately if <slice_wise> is TRUE. With a GREY16 output and <pad> 0,
+ * the result is the same as Stack_Bwdist_L_U16() or Stack_Bwdist_L_U16P().
+ * With <pad> 1, the result is exact, while those two functions can give wrong
+ * distances near the stack border.
+ *
+ * The transform is separable and runs in two stages. The stages work on
+ * blocks of adjacent lines so that the memory is accessed in rows.
+ * Stack_Bwdist_Sqr_Plane() transforms the planes [<z0>, <z1>) of <in> into
+ * <out>. After all planes are done, Stack_Bwdist_Sqr_Column() transforms
+ * <out> along z for the columns in the rows [<y0>, <y1>). Calls of the same
+ * stage with disjoint ranges can run in parallel.
+ */
+Stack* Stack_Bwdist_Sqr(const Stack *in, Stack *out, int pad,
+                        BOOL slice_wise);
+void Stack_Bwdist_Sqr_Plane(const Stack *in, Stack *out, int pad,
+                            int z0, int z1);
+void Stack_Bwdist_Sqr_Column(Stack *out, int pad, int y0, int y1);
+
 
 /**@}*/
 
@@ -160,6 +160,16 @@ int ZBodySplitCommand::run(
     preservingGap = ZJsonParser::booleanValue(config["preserving_gap"]);
   }
 
+  bool computingSparse = false;
+  if (config.hasKey("sparse")) {
+    computingSparse = ZJsonParser::booleanValue(config["sparse"]);
+  }
+
+  bool computingParallel = false;
+  if (config.hasKey("parallel")) {
+    computingParallel = ZJsonParser::booleanValue(config["parallel"]);
+  }
+
   ZDvidReader *reader = ParseInputPath(
        inputPath, inputJson, splitTaskKey, splitResultKey, dataDir, isFile);
 
@@ -243,6 +253,8 @@ int ZBodySplitCommand::run(
   container.setRefiningBorder(true);
   container.setCcaPost(true);
   container.setPreservingGap(preservingGap);
+  container.setComputingSparse(computingSparse);
+  container.setComputingParallel(computingParallel);
 
   if (!container.isEmpty()) {
     if (!range.isEmpty()) {
@@ -0,0 +1,92 @@
+#ifndef ZBOUNDEDQUEUE_H
+#define ZBOUNDEDQUEUE_H
+
+#include <cstddef>
+#include <QQueue>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+/*!
+ * \brief The class of a blocking queue with a limited capacity
+ *
+ * It connects producer threads to consumer threads. A producer is blocked
+ * when the queue is full and a consumer is blocked when the queue is empty.
+ * After the queue is closed, no item can be added and the consumers are
+ * released once the remaining items are taken.
+ */
+template <typename T>
+class ZBoundedQueue
+{
+public:
+  explicit ZBoundedQueue(size_t capacity) :
+    m_capacity(capacity > 0 ? capacity : 1) {}
+
+  /*!
+   * \brief Add an item to the queue
+   *
+   * It waits until the queue has space.
+   *
+   * \return false iff the queue is closed, in which case \a item is not added.
+   */
+  bool push(const T &item) {
+    QMutexLocker locker(&m_mutex);
+    while (size_t(m_queue.size()) >= m_capacity && !m_closed) {
+      m_notFull.wait(&m_mutex);
+    }
+
+    if (m_closed) {
+      return false;
+    }
+
+    m_queue.enqueue(item);
+    m_notEmpty.wakeOne();
+
+    return true;
+  }
+
+  /*!
+   * \brief Take an item from the queue
+   *
+   * It waits until the queue has an item.
+   *
+   * \return false iff the queue is closed and empty.
+   */
+  bool pop(T *item) {
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.isEmpty() && !m_closed) {
+      m_notEmpty.wait(&m_mutex);
+    }
+
+    if (m_queue.isEmpty()) {
+      return false;
+    }
+
+    *item = m_queue.dequeue();
+    m_notFull.wakeOne();
+
+    return true;
+  }
+
+  void close() {
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_notEmpty.wakeAll();
+    m_notFull.wakeAll();
+  }
+
+  size_t size() const {
+    QMutexLocker locker(&m_mutex);
+    return m_queue.size();
+  }
+
+private:
+  QQueue<T> m_queue;
+  size_t m_capacity;
+  bool m_closed = false;
+  mutable QMutex m_mutex;
+  QWaitCondition m_notEmpty;
+  QWaitCondition m_notFull;
+};
+
+#endif // ZBOUNDEDQUEUE_H
@@ -1,41 +1,193 @@
 #include "ztaskqueue.h"
+
+#include <limits>
+#include <sstream>
+#include <algorithm>
+
 #include "ztask.h"
 
-ZTaskQueue::ZTaskQueue(QObject *parent) : QObject(parent)
+double ZTaskQueue::Stat::getMeanLatency() const
 {
+  size_t startedCount = finishedCount + runningCount;
+  if (startedCount == 0) {
+    return 0.0;
+  }
+
+  return double(totalLatency) / startedCount;
+}
+
+std::string ZTaskQueue::Stat::toString() const
+{
+  std::ostringstream stream;
+  stream << "pending: " << pendingCount << "; running: " << runningCount
+         << "; added: " << addedCount << "; finished: " << finishedCount
+         << "; canceled: " << canceledCount
+         << "; latency: " << getMeanLatency() << "ms (max " << maxLatency
+         << "ms)";
+
+  return stream.str();
+}
 
+ZTaskQueue::ZTaskQueue(QObject *parent) : QObject(parent)
+{
+  m_clock.start();
 }
 
 ZTaskQueue::~ZTaskQueue()
 {
-  foreach (ZTask *task, m_queue) {
-    if (task != NULL) {
-      task->deleteLater();
+  foreach (const Entry &entry, m_queue) {
+    entry.task->deleteLater();
+  }
+}
+
+ZTask* ZTaskQueue::takeReadyUnsync(qint64 *waitTime)
+{
+  qint64 currentTime = m_clock.elapsed();
+  *waitTime = std::numeric_limits<qint64>::max();
+
+  for (QList<Entry>::iterator iter = m_queue.begin(); iter != m_queue.end();
+       ++iter) {
+    if (!iter->key.isEmpty() && m_runningKeySet.contains(iter->key)) {
+      continue;
     }
+
+    if (iter->readyTime <= currentTime) {
+      ZTask *task = iter->task;
+      if (!iter->key.isEmpty()) {
+        m_runningKeySet.insert(iter->key);
+      }
+
+      qint64 latency = currentTime - iter->readyTime;
+      m_stat.totalLatency += latency;
+      m_stat.maxLatency = std::max(m_stat.maxLatency, int64_t(latency));
+      ++m_stat.runningCount;
+      m_queue.erase(iter);
+
+      return task;
+    }
+
+    *waitTime = std::min(*waitTime, iter->readyTime - currentTime);
   }
+
+  return NULL;
 }
 
 ZTask* ZTaskQueue::get()
 {
   QMutexLocker locker(&m_queueLock);
 
-  while (m_queue.isEmpty()) {
-    m_queueHasItems.wait(&m_queueLock);
+  while (!m_closed) {
+    qint64 waitTime = 0;
+    ZTask *task = takeReadyUnsync(&waitTime);
+    if (task != NULL) {
+      return task;
+    }
+
+    if (waitTime == std::numeric_limits<qint64>::max()) {
+      m_queueHasItems.wait(&m_queueLock);
+    } else {
+      m_queueHasItems.wait(&m_queueLock, static_cast<unsigned long>(waitTime));
+    }
+  }
+
+  return NULL;
+}
+
+void ZTaskQueue::finishTask(const QString &key)
+{
+  QMutexLocker locker(&m_queueLock);
+
+  --m_stat.runningCount;
+  ++m_stat.finishedCount;
+  if (!key.isEmpty()) {
+    m_runningKeySet.remove(key);
+    //A task waiting for the key may be ready now
+    m_queueHasItems.wakeAll();
   }
-  return m_queue.dequeue();
 }
 
 bool ZTaskQueue::isEmpty() {
-    return m_queue.isEmpty();
+  QMutexLocker locker(&m_queueLock);
+
+  return m_queue.isEmpty();
+}
+
+ZTask* ZTaskQueue::removeUnsync(const QString &key)
+{
+  for (QList<Entry>::iterator iter = m_queue.begin(); iter != m_queue.end();
+       ++iter) {
+    if (iter->key == key) {
+      ZTask *task = iter->task;
+      m_queue.erase(iter);
+      ++m_stat.canceledCount;
+      return task;
+    }
+  }
+
+  return NULL;
 }
 
 void ZTaskQueue::add(ZTask *task)
 {
-  QMutexLocker locker(&m_queueLock);
+  ZTask *supersededTask = NULL;
+
+  {
+    QMutexLocker locker(&m_queueLock);
+
+    if (task == NULL) {
+      m_closed = true;
+      m_queueHasItems.wakeAll();
+      return;
+    }
+
+    Entry entry;
+    entry.task = task;
+    entry.key = task->getKey();
+    entry.priority = task->getPriority();
+    entry.readyTime = m_clock.elapsed() + std::max(0, task->getDelay());
+
+    if (!entry.key.isEmpty()) {
+      supersededTask = removeUnsync(entry.key);
+    }
+
+    QList<Entry>::iterator iter = m_queue.begin();
+    while (iter != m_queue.end() && iter->priority >= entry.priority) {
+      ++iter;
+    }
+    m_queue.insert(iter, entry);
+    ++m_stat.addedCount;
 
-  bool wasEmpty = m_queue.isEmpty();
-  m_queue.enqueue(task);
-  if (wasEmpty) {
     m_queueHasItems.wakeAll();
   }
+
+  if (supersededTask != NULL) {
+    supersededTask->abort();
+  }
+}
+
+void ZTaskQueue::cancel(const QString &key)
+{
+  if (key.isEmpty()) {
+    return;
+  }
+
+  ZTask *task = NULL;
+  {
+    QMutexLocker locker(&m_queueLock);
+    task = removeUnsync(key);
+  }
+
+  if (task != NULL) {
+    task->abort();
+  }
+}
+
+ZTaskQueue::Stat ZTaskQueue::getStat() const
+{
+  QMutexLocker locker(&m_queueLock);
+
+  Stat stat = m_stat;
+  stat.pendingCount = m_queue.size();
+
+  return stat;
 }
@@ -1,13 +1,29 @@
 #ifndef ZTASKQUEUE_H
 #define ZTASKQUEUE_H
 
+#include <string>
+#include <cstdint>
 #include <QObject>
-#include <QQueue>
+#include <QList>
+#include <QSet>
+#include <QString>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QElapsedTimer>
 
 class ZTask;
 
+/*!
+ * \brief The class of a task queue shared by workers
+ *
+ * Tasks are taken in the order of their priorities, and then in the order
+ * of being added. A delayed task is not taken until its delay has passed.
+ *
+ * A task with a non-empty key (ZTask::getKey()) supersedes the pending task
+ * with the same key, which is removed and aborted. A task is not taken while
+ * another task with the same key is running, so that the tasks of the same
+ * kind do not race for the same resource.
+ */
 class ZTaskQueue : public QObject
 {
   Q_OBJECT
@@ -15,7 +31,34 @@ public:
   explicit ZTaskQueue(QObject *parent = nullptr);
   ~ZTaskQueue();
 
+  struct Stat {
+    size_t pendingCount = 0; //queue depth
+    size_t runningCount = 0;
+    size_t addedCount = 0;
+    size_t finishedCount = 0;
+    size_t canceledCount = 0; //superseded or canceled
+    int64_t totalLatency = 0; //total waiting time (ms) after tasks are ready
+    int64_t maxLatency = 0;
+
+    double getMeanLatency() const;
+    std::string toString() const;
+  };
+
+  /*!
+   * \brief Take a task from the queue.
+   *
+   * It waits until a task is ready. Call finishTask() with the key of the
+   * task after running it.
+   *
+   * \return NULL if the queue is closed.
+   */
   ZTask* get();
+
+  /*!
+   * \brief Release the key of a task taken from the queue.
+   */
+  void finishTask(const QString &key);
+
   bool isEmpty();
   /*!
    * \brief Add a task to the queue.
@@ -26,13 +69,36 @@ public:
    */
   void add(ZTask *task);
 
+  /*!
+   * \brief Abort the pending task with the key \a key.
+   */
+  void cancel(const QString &key);
+
+  Stat getStat() const;
+
 signals:
 
 public slots:
 
 private:
-  QQueue<ZTask*> m_queue;
-  QMutex m_queueLock;
+  struct Entry {
+    ZTask *task = NULL;
+    QString key;
+    int priority = 0;
+    qint64 readyTime = 0;
+  };
+
+  ZTask* takeReadyUnsync(qint64 *waitTime);
+  ZTask* removeUnsync(const QString &key);
+
+private:
+  //Sorted by priority; FIFO for the same priority
+  QList<Entry> m_queue;
+  QSet<QString> m_runningKeySet;
+  QElapsedTimer m_clock;
+  Stat m_stat;
+  bool m_closed = false;
+  mutable QMutex m_queueLock;
   QWaitCondition m_queueHasItems;
 };
 
@@ -0,0 +1,66 @@
+#include "ztaskscheduler.h"
+
+#include <algorithm>
+
+#include "zqslog.h"
+#include "ztask.h"
+#include "zworker.h"
+#include "zworkthread.h"
+
+ZTaskScheduler::ZTaskScheduler(int workerCount, QObject *parent) :
+  QObject(parent)
+{
+  m_taskQueue = new ZTaskQueue(this);
+
+  workerCount = std::max(1, workerCount);
+  for (int i = 0; i < workerCount; ++i) {
+    ZWorkThread *thread = new ZWorkThread(new ZWorker(m_taskQueue));
+    m_threadList.append(thread);
+    thread->start();
+  }
+}
+
+ZTaskScheduler::~ZTaskScheduler()
+{
+  quit();
+}
+
+int ZTaskScheduler::getWorkerCount() const
+{
+  return m_threadList.size();
+}
+
+void ZTaskScheduler::addTask(ZTask *task)
+{
+  if (task != NULL) {
+    m_taskQueue->add(task);
+  }
+}
+
+void ZTaskScheduler::cancelTask(const QString &key)
+{
+  m_taskQueue->cancel(key);
+}
+
+ZTaskQueue::Stat ZTaskScheduler::getStat() const
+{
+  return m_taskQueue->getStat();
+}
+
+void ZTaskScheduler::quit()
+{
+  if (!m_threadList.isEmpty()) {
+    LDEBUG() << "Quit task scheduler:" << getStat().toString();
+
+    //A NULL task closes the queue for all workers
+    m_taskQueue->add(NULL);
+    foreach (ZWorkThread *thread, m_threadList) {
+      //The finished() signal of the worker is queued to this thread, so it
+      //cannot stop the event loop of the work thread while we are waiting.
+      thread->quit();
+      thread->wait();
+      delete thread;
+    }
+    m_threadList.clear();
+  }
+}
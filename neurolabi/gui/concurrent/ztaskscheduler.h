@@ -0,0 +1,59 @@
+#ifndef ZTASKSCHEDULER_H
+#define ZTASKSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+
+#include "ztaskqueue.h"
+
+class ZTask;
+class ZWorkThread;
+
+/*!
+ * \brief The class of running tasks with a pool of workers
+ *
+ * The workers share a ZTaskQueue, so tasks are run by priority, superseded
+ * tasks are dropped by key and the queue statistics are available from
+ * getStat().
+ *
+ * Usage:
+ *   ZTaskScheduler *scheduler = new ZTaskScheduler(3, parent);
+ *   task->setKey("label slice");
+ *   task->setPriority(ZTask::PRIORITY_HIGH);
+ *   scheduler->addTask(task);
+ *   ...
+ *   scheduler->quit();
+ */
+class ZTaskScheduler : public QObject
+{
+  Q_OBJECT
+public:
+  explicit ZTaskScheduler(int workerCount, QObject *parent = nullptr);
+  ~ZTaskScheduler();
+
+  int getWorkerCount() const;
+
+  void addTask(ZTask *task);
+
+  /*!
+   * \brief Abort the pending task with the key \a key.
+   *
+   * A running task is not affected.
+   */
+  void cancelTask(const QString &key);
+
+  ZTaskQueue::Stat getStat() const;
+
+  /*!
+   * \brief Stop the workers.
+   *
+   * It waits for the running tasks. Pending tasks are dropped.
+   */
+  void quit();
+
+private:
+  ZTaskQueue *m_taskQueue = nullptr;
+  QList<ZWorkThread*> m_threadList;
+};
+
+#endif // ZTASKSCHEDULER_H
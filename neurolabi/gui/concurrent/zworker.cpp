@@ -17,6 +17,11 @@ ZWorker::ZWorker(EMode mode, QObject *parent) : QObject(parent),
   }
 }
 
+ZWorker::ZWorker(ZTaskQueue *queue, QObject *parent) : QObject(parent),
+  m_taskQueue(queue), m_mode(EMode::QUEUE)
+{
+}
+
 ZWorker::~ZWorker()
 {
   LDEBUG() << "Worker destroyed.";
@@ -41,7 +46,10 @@ void ZWorker::process()
     }
 
     if (task != NULL) {
+      //The task may be deleted once it finishes
+      QString key = task->getKey();
       task->run();
+      m_taskQueue->finishTask(key);
     } else {
       break;
     }
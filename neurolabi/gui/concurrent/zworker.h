@@ -15,6 +15,14 @@ public:
   };
 
   explicit ZWorker(EMode mode, QObject *parent = nullptr);
+
+  /*!
+   * \brief Create a worker in the QUEUE mode with a shared queue.
+   *
+   * Workers sharing the same queue form a worker pool. The queue is not
+   * owned by the worker.
+   */
+  explicit ZWorker(ZTaskQueue *queue, QObject *parent = nullptr);
   virtual ~ZWorker();
 
   EMode getMode() const {
@@ -215,6 +215,8 @@ protected:
 private:
   void init();
 
+  friend class ZDvidAnnotationDecoder;
+
 protected:
   ZIntPoint m_position;
   EKind m_kind;
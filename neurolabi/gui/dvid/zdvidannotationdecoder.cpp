@@ -0,0 +1,496 @@
+#include "zdvidannotationdecoder.h"
+
+#include <cstring>
+#include <cstdint>
+
+#include "zintpoint.h"
+#include "dvid/zdvidannotation.h"
+
+ZDvidAnnotationDecoder::ZDvidAnnotationDecoder(
+    const char *data, size_t size, flyem::EDvidAnnotationLoadMode mode) :
+  m_current(data), m_end(data + size), m_mode(mode)
+{
+  if (data == NULL) {
+    m_end = m_current;
+  }
+}
+
+bool ZDvidAnnotationDecoder::fail()
+{
+  m_hasError = true;
+  m_state = EState::END;
+
+  return false;
+}
+
+void ZDvidAnnotationDecoder::skipSpace()
+{
+  while (m_current < m_end && (*m_current == ' ' || *m_current == '\n' ||
+                               *m_current == '\r' || *m_current == '\t')) {
+    ++m_current;
+  }
+}
+
+bool ZDvidAnnotationDecoder::consume(char c)
+{
+  skipSpace();
+  if (m_current < m_end && *m_current == c) {
+    ++m_current;
+    return true;
+  }
+
+  return false;
+}
+
+bool ZDvidAnnotationDecoder::atValueEnd() const
+{
+  return m_current == m_end || strchr(",]} \n\r\t", *m_current) != NULL;
+}
+
+bool ZDvidAnnotationDecoder::hasNext()
+{
+  switch (m_state) {
+  case EState::START:
+    skipSpace();
+    if (m_current == m_end) {
+      m_state = EState::END;
+    } else if (consume('[')) {
+      m_state = consume(']') ? EState::END : EState::ELEMENT;
+    } else if (size_t(m_end - m_current) >= 4 &&
+               strncmp(m_current, "null", 4) == 0) {
+      m_current += 4;
+      m_state = EState::END;
+    } else {
+      fail();
+    }
+    break;
+  case EState::AFTER_ELEMENT:
+    if (consume(',')) {
+      m_state = EState::ELEMENT;
+    } else if (consume(']')) {
+      m_state = EState::END;
+    } else {
+      fail();
+    }
+    break;
+  default:
+    break;
+  }
+
+  return m_state == EState::ELEMENT;
+}
+
+bool ZDvidAnnotationDecoder::readString(std::string *str)
+{
+  if (!consume('"')) {
+    return false;
+  }
+
+  if (str != NULL) {
+    str->clear();
+  }
+
+  const char *start = m_current;
+  while (m_current < m_end) {
+    char c = *m_current;
+    if (c == '"') {
+      if (str != NULL) {
+        str->append(start, m_current - start);
+      }
+      ++m_current;
+      return true;
+    }
+
+    if (c == '\\') {
+      if (str != NULL) {
+        str->append(start, m_current - start);
+      }
+      if (++m_current == m_end) {
+        return false;
+      }
+      c = *m_current++;
+      if (str != NULL) {
+        switch (c) {
+        case 'b': str->push_back('\b'); break;
+        case 'f': str->push_back('\f'); break;
+        case 'n': str->push_back('\n'); break;
+        case 'r': str->push_back('\r'); break;
+        case 't': str->push_back('\t'); break;
+        case 'u':
+        {
+          if (m_end - m_current < 4) {
+            return false;
+          }
+          unsigned int code = 0;
+          for (int i = 0; i < 4; ++i) {
+            char h = *m_current++;
+            code <<= 4;
+            if (h >= '0' && h <= '9') {
+              code |= h - '0';
+            } else if (h >= 'a' && h <= 'f') {
+              code |= h - 'a' + 10;
+            } else if (h >= 'A' && h <= 'F') {
+              code |= h - 'A' + 10;
+            } else {
+              return false;
+            }
+          }
+          //Surrogate pairs are kept as they are, which is enough for the
+          //ASCII strings in annotations.
+          if (code < 0x80) {
+            str->push_back(char(code));
+          } else if (code < 0x800) {
+            str->push_back(char(0xC0 | (code >> 6)));
+            str->push_back(char(0x80 | (code & 0x3F)));
+          } else {
+            str->push_back(char(0xE0 | (code >> 12)));
+            str->push_back(char(0x80 | ((code >> 6) & 0x3F)));
+            str->push_back(char(0x80 | (code & 0x3F)));
+          }
+        }
+          break;
+        default: //'"', '\\' and '/'
+          str->push_back(c);
+          break;
+        }
+      } else if (c == 'u') {
+        if (m_end - m_current < 4) {
+          return false;
+        }
+        m_current += 4;
+      }
+      start = m_current;
+    } else {
+      ++m_current;
+    }
+  }
+
+  return false;
+}
+
+bool ZDvidAnnotationDecoder::readInteger(int *value)
+{
+  skipSpace();
+
+  const char *start = m_current;
+  bool negative = false;
+  if (m_current < m_end && *m_current == '-') {
+    negative = true;
+    ++m_current;
+  }
+
+  int64_t v = 0;
+  const char *digitStart = m_current;
+  while (m_current < m_end && *m_current >= '0' && *m_current <= '9') {
+    v = v * 10 + (*m_current - '0');
+    ++m_current;
+  }
+
+  if (m_current == digitStart) {
+    m_current = start;
+    return false;
+  }
+
+  if (atValueEnd()) {
+    *value = int(negative ? -v : v);
+  } else {
+    //Not an integer, which is read as 0 as the JSON parser does.
+    m_current = start;
+    if (!skipValue()) {
+      return false;
+    }
+    *value = 0;
+  }
+
+  return true;
+}
+
+bool ZDvidAnnotationDecoder::readPoint(int *coords, int *count)
+{
+  *count = 0;
+  if (!consume('[')) {
+    return false;
+  }
+
+  if (consume(']')) {
+    return true;
+  }
+
+  do {
+    //A non-integer element is read as 0
+    int value = 0;
+    skipSpace();
+    if (m_current < m_end && (*m_current == '-' ||
+                              (*m_current >= '0' && *m_current <= '9'))) {
+      if (!readInteger(&value)) {
+        return false;
+      }
+    } else if (!skipValue()) {
+      return false;
+    }
+    if (*count < 3) {
+      coords[*count] = value;
+    }
+    ++(*count);
+  } while (consume(','));
+
+  return consume(']');
+}
+
+bool ZDvidAnnotationDecoder::readStringArray(
+    std::vector<std::string> *strArray)
+{
+  if (!consume('[')) {
+    return false;
+  }
+
+  if (consume(']')) {
+    return true;
+  }
+
+  std::string str;
+  do {
+    skipSpace();
+    if (m_current < m_end && *m_current == '"') {
+      if (!readString(&str)) {
+        return false;
+      }
+      strArray->push_back(str);
+    } else if (!skipValue()) {
+      return false;
+    }
+  } while (consume(','));
+
+  return consume(']');
+}
+
+bool ZDvidAnnotationDecoder::readPartnerArray(
+    std::vector<ZIntPoint> *partnerArray)
+{
+  if (!consume('[')) {
+    return false;
+  }
+
+  if (consume(']')) {
+    return true;
+  }
+
+  std::string key;
+  do {
+    skipSpace();
+    if (m_current < m_end && *m_current == '{') {
+      ++m_current;
+      bool hasRel = false;
+      int coords[3] = {0, 0, 0};
+      int count = 0;
+      if (!consume('}')) {
+        do {
+          if (!readString(&key) || !consume(':')) {
+            return false;
+          }
+          if (key == "To") {
+            skipSpace();
+            if (m_current < m_end && *m_current == '[') {
+              if (!readPoint(coords, &count)) {
+                return false;
+              }
+            } else if (!skipValue()) {
+              return false;
+            }
+          } else {
+            if (key == "Rel") {
+              hasRel = true;
+            }
+            if (!skipValue()) {
+              return false;
+            }
+          }
+        } while (consume(','));
+
+        if (!consume('}')) {
+          return false;
+        }
+      }
+
+      if (hasRel && count >= 3) {
+        partnerArray->push_back(ZIntPoint(coords[0], coords[1], coords[2]));
+      }
+    } else if (!skipValue()) {
+      return false;
+    }
+  } while (consume(','));
+
+  return consume(']');
+}
+
+bool ZDvidAnnotationDecoder::skipValue()
+{
+  skipSpace();
+  if (m_current == m_end) {
+    return false;
+  }
+
+  char c = *m_current;
+  if (c == '"') {
+    return readString(NULL);
+  }
+
+  if (c == '[' || c == '{') {
+    //Brackets are matched without checking their types
+    int depth = 0;
+    while (m_current < m_end) {
+      c = *m_current;
+      if (c == '"') {
+        if (!readString(NULL)) {
+          return false;
+        }
+        continue;
+      }
+      ++m_current;
+      if (c == '[' || c == '{') {
+        ++depth;
+      } else if (c == ']' || c == '}') {
+        if (--depth == 0) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  //Number or literal
+  const char *start = m_current;
+  while (!atValueEnd()) {
+    ++m_current;
+  }
+
+  return m_current > start;
+}
+
+bool ZDvidAnnotationDecoder::skipValue(const char **start, size_t *length)
+{
+  skipSpace();
+  *start = m_current;
+  if (!skipValue()) {
+    return false;
+  }
+  *length = m_current - *start;
+
+  return true;
+}
+
+bool ZDvidAnnotationDecoder::next(ZDvidAnnotation *annotation)
+{
+  if (!hasNext()) {
+    return false;
+  }
+
+  m_state = EState::AFTER_ELEMENT;
+
+  if (annotation != NULL) {
+    annotation->clear();
+  }
+
+  skipSpace();
+  if (m_current == m_end || *m_current != '{') {
+    //Not an annotation
+    return skipValue() ? false : fail();
+  }
+  ++m_current;
+
+  bool hasPos = false;
+  int pos[3] = {0, 0, 0};
+  bool hasKind = false;
+  std::string kind;
+  std::vector<std::string> tagArray;
+  std::vector<ZIntPoint> partnerArray;
+  const char *relStart = NULL;
+  size_t relLength = 0;
+  const char *propStart = NULL;
+  size_t propLength = 0;
+
+  std::string key;
+  if (!consume('}')) {
+    do {
+      if (!readString(&key) || !consume(':')) {
+        return fail();
+      }
+
+      bool ok = true;
+      skipSpace();
+      char c = (m_current < m_end) ? *m_current : '\0';
+      if (key == "Pos") {
+        hasPos = true;
+        if (c == '[') {
+          int count = 0;
+          ok = readPoint(pos, &count);
+        } else {
+          ok = skipValue();
+        }
+      } else if (key == "Kind") {
+        hasKind = true;
+        ok = (c == '"') ? readString(&kind) : skipValue();
+      } else if (key == "Tags") {
+        ok = (c == '[') ? readStringArray(&tagArray) : skipValue();
+      } else if (key == "Rels") {
+        switch (m_mode) {
+        case flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION:
+          ok = (c == '[') ? readPartnerArray(&partnerArray) : skipValue();
+          break;
+        case flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON:
+          ok = (c == '[') ? skipValue(&relStart, &relLength) : skipValue();
+          break;
+        default:
+          ok = skipValue();
+          break;
+        }
+      } else if (key == "Prop") {
+        ok = (c == '{') ? skipValue(&propStart, &propLength) : skipValue();
+      } else {
+        ok = skipValue();
+      }
+
+      if (!ok) {
+        return fail();
+      }
+    } while (consume(','));
+
+    if (!consume('}')) {
+      return fail();
+    }
+  }
+
+  if (!hasPos || annotation == NULL) {
+    return false;
+  }
+
+  //The same order as ZDvidAnnotation::loadJsonObject()
+  annotation->setPosition(pos[0], pos[1], pos[2]);
+  if (hasKind) {
+    annotation->setKind(kind);
+  } else {
+    annotation->setKind(ZDvidAnnotation::EKind::KIND_INVALID);
+  }
+
+  for (const std::string &tag : tagArray) {
+    annotation->addTag(tag);
+  }
+
+  for (const ZIntPoint &pt : partnerArray) {
+    annotation->addPartner(pt.getX(), pt.getY(), pt.getZ());
+  }
+
+  if (relStart != NULL) {
+    annotation->m_relJson.decode(std::string(relStart, relLength));
+  }
+
+  annotation->setDefaultRadius();
+  annotation->setDefaultColor();
+
+  if (propStart != NULL) {
+    annotation->m_propertyJson.decode(std::string(propStart, propLength));
+  }
+
+  return true;
+}
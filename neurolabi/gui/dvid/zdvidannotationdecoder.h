@@ -0,0 +1,120 @@
+#ifndef ZDVIDANNOTATIONDECODER_H
+#define ZDVIDANNOTATIONDECODER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "neutube_def.h"
+
+class ZDvidAnnotation;
+class ZIntPoint;
+
+/*!
+ * \brief The class of decoding DVID annotations from a JSON array stream
+ *
+ * The decoder reads annotations such as synapses and todo items one by one
+ * from the raw response of an annotation request, without building a JSON
+ * document of the whole array. Each annotation is loaded in the same way
+ * as ZDvidAnnotation::loadJsonObject() does. Only the relation JSON
+ * (flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON) and the properties of an
+ * annotation are kept as JSON objects, which are decoded from their own text.
+ *
+ * An empty buffer or "null" is decoded as an empty array. Decoding stops at
+ * the first syntax error, after which hasError() returns true.
+ *
+ * Usage:
+ *   ZDvidAnnotationDecoder decoder(buffer.constData(), buffer.size(), mode);
+ *   while (decoder.hasNext()) {
+ *     ZDvidSynapse synapse;
+ *     if (decoder.next(&synapse)) {
+ *       ...
+ *     }
+ *   }
+ */
+class ZDvidAnnotationDecoder
+{
+public:
+  /*!
+   * \brief Constructor
+   *
+   * \a data must stay valid during decoding.
+   */
+  ZDvidAnnotationDecoder(const char *data, size_t size,
+                         flyem::EDvidAnnotationLoadMode mode);
+
+  /*!
+   * \brief Check if there is another element in the array.
+   */
+  bool hasNext();
+
+  /*!
+   * \brief Decode the next element into \a annotation.
+   *
+   * \return true iff the element is an annotation with a position. The element
+   *         is consumed even if it returns false.
+   */
+  bool next(ZDvidAnnotation *annotation);
+
+  bool hasError() const {
+    return m_hasError;
+  }
+
+  /*!
+   * \brief Decode all annotations with positions.
+   *
+   * It returns an empty array if \a data has a syntax error, such as being
+   * truncated.
+   */
+  template <typename T>
+  static std::vector<T> Decode(
+      const char *data, size_t size, flyem::EDvidAnnotationLoadMode mode);
+
+private:
+  enum class EState {
+    START, ELEMENT, AFTER_ELEMENT, END
+  };
+
+  bool fail();
+  void skipSpace();
+  bool consume(char c);
+  bool atValueEnd() const;
+
+  bool readString(std::string *str);
+  bool readInteger(int *value);
+  bool readPoint(int *coords, int *count);
+  bool readStringArray(std::vector<std::string> *strArray);
+  bool readPartnerArray(std::vector<ZIntPoint> *partnerArray);
+  bool skipValue();
+  bool skipValue(const char **start, size_t *length);
+
+private:
+  const char *m_current;
+  const char *m_end;
+  flyem::EDvidAnnotationLoadMode m_mode;
+  EState m_state = EState::START;
+  bool m_hasError = false;
+};
+
+template <typename T>
+std::vector<T> ZDvidAnnotationDecoder::Decode(
+    const char *data, size_t size, flyem::EDvidAnnotationLoadMode mode)
+{
+  std::vector<T> annotationArray;
+
+  ZDvidAnnotationDecoder decoder(data, size, mode);
+  while (decoder.hasNext()) {
+    T annotation;
+    if (decoder.next(&annotation)) {
+      annotationArray.push_back(annotation);
+    }
+  }
+
+  if (decoder.hasError()) {
+    annotationArray.clear();
+  }
+
+  return annotationArray;
+}
+
+#endif // ZDVIDANNOTATIONDECODER_H
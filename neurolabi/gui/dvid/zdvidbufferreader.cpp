@@ -276,6 +276,68 @@ void ZDvidBufferReader::read(const QString &url, bool outputingUrl)
 #endif
 }
 
+void ZDvidBufferReader::readStream(
+    const QString &url,
+    const std::function<void (const char *, size_t)> &consumer,
+    bool outputingUrl)
+{
+  m_statusCode = 0;
+
+  if (url.isEmpty()) {
+    return;
+  }
+
+  if (outputingUrl) {
+    qDebug() << "Reading" << url;
+  }
+
+  m_buffer.clear();
+
+#if defined(_ENABLE_LIBDVIDCPP_)
+  ZDvidTarget target;
+  target.setFromUrl(url.toStdString());
+
+  if (target.isValid()) {
+    try {
+      libdvid::BinaryDataPtr data;
+      std::string endPoint = ZDvidUrl::GetPath(url.toStdString());
+      if (m_service.get() != NULL) {
+        data = m_service->custom_request(
+              endPoint, libdvid::BinaryDataPtr(), libdvid::GET, m_tryingCompress);
+      } else {
+        ZSharedPointer<libdvid::DVIDNodeService> service =
+            ZDvid::MakeDvidNodeService(target);
+        data = service->custom_request(
+              endPoint, libdvid::BinaryDataPtr(), libdvid::GET, m_tryingCompress);
+      }
+
+      //Decode in place instead of copying into m_buffer
+      consumer(data->get_data().c_str(), data->length());
+      m_status = neutube::EReadStatus::OK;
+      m_statusCode = 200;
+    } catch (libdvid::DVIDException &e) {
+      STD_COUT << "Exception: " << e.what() << std::endl;
+      m_statusCode = e.getStatus();
+      m_status = neutube::EReadStatus::FAILED;
+    } catch (std::exception &e) {
+      STD_COUT << "Any exception: " << e.what() << std::endl;
+      m_statusCode = 0;
+      m_status = neutube::EReadStatus::FAILED;
+    }
+  } else {
+    ZNetBufferReader bufferReader;
+    bufferReader.readStream(url, consumer, false);
+    m_status = bufferReader.getStatus();
+    m_statusCode = bufferReader.getStatusCode();
+  }
+#else
+  ZNetBufferReader bufferReader;
+  bufferReader.readStream(url, consumer, false);
+  m_status = bufferReader.getStatus();
+  m_statusCode = bufferReader.getStatusCode();
+#endif
+}
+
 #if 0
 void ZDvidBufferReader::readPartial(
     const QString &url, int maxSize, bool outputingUrl)
@@ -1,6 +1,8 @@
 #ifndef ZDVIDBUFFERREADER_H
 #define ZDVIDBUFFERREADER_H
 
+#include <functional>
+
 //#include <QObject>
 #include <QByteArray>
 //#include <QNetworkAccessManager>
@@ -36,6 +38,18 @@ public:
   void readFromPath(const QString &path, bool outputingUrl = true);
 
   void read(const QString &url, bool outputingUrl = true);
+
+  /*!
+   * \brief Read data into a consumer
+   *
+   * The response is handed to \a consumer without being copied into the
+   * buffer of the reader, which stays empty. Data coming from the network
+   * reader are passed as they arrive; libdvid only returns complete responses,
+   * which are passed in one chunk.
+   */
+  void readStream(const QString &url,
+                  const std::function<void(const char*, size_t)> &consumer,
+                  bool outputingUrl = true);
 //  void readPartial(const QString &url, int maxSize, bool outputingUrl);
 
   void read(const QString &url, const QByteArray &payload,
@@ -0,0 +1,184 @@
+#include "zdvidgrayscaleblockfetcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <QtConcurrentRun>
+
+#include "zdvidreader.h"
+#include "zobject3dscan.h"
+#include "zstack.hxx"
+#include "bigdata/zstackblockgrid.h"
+#include "neutubeconfig.h"
+
+ZDvidGrayscaleBlockFetcher::ZDvidGrayscaleBlockFetcher()
+{
+}
+
+bool ZDvidGrayscaleBlockFetcher::isCanceling() const
+{
+  if (m_cancelFunc) {
+    return m_cancelFunc();
+  }
+
+  return false;
+}
+
+std::vector<ZDvidGrayscaleBlockFetcher::Request>
+ZDvidGrayscaleBlockFetcher::makeRequest(
+    const ZObject3dScan &blockObj, const ZStackBlockGrid *grid) const
+{
+  std::vector<Request> requestArray;
+
+  auto isMissing = [&](int x, int y, int z) {
+    return grid == NULL || grid->getStack(ZIntPoint(x, y, z)) == NULL;
+  };
+
+  size_t stripeNumber = blockObj.getStripeNumber();
+  for (size_t s = 0; s < stripeNumber; ++s) {
+    const ZObject3dStripe &stripe = blockObj.getStripe(s);
+    int y = stripe.getY();
+    int z = stripe.getZ();
+    if (!m_blockRange.isEmpty()) {
+      if (y < m_blockRange.getFirstCorner().getY() ||
+          y > m_blockRange.getLastCorner().getY() ||
+          z < m_blockRange.getFirstCorner().getZ() ||
+          z > m_blockRange.getLastCorner().getZ()) {
+        continue;
+      }
+    }
+
+    //Spans of missing blocks as [start, end] pairs
+    std::vector<int> blockSpan;
+    //Missing blocks of the object, which are in increasing order
+    std::vector<int> bodyBlockX;
+    int segmentNumber = stripe.getSegmentNumber();
+    for (int i = 0; i < segmentNumber; ++i) {
+      int x0 = stripe.getSegmentStart(i);
+      int x1 = stripe.getSegmentEnd(i);
+      if (!m_blockRange.isEmpty()) {
+        x0 = std::max(x0, m_blockRange.getFirstCorner().getX());
+        x1 = std::min(x1, m_blockRange.getLastCorner().getX());
+      }
+
+      for (int x = x0; x <= x1; ++x) {
+        if (isMissing(x, y, z)) {
+          bodyBlockX.push_back(x);
+          if (!blockSpan.empty() && x - blockSpan.back() == 1) {
+            blockSpan.back() = x;
+          } else if (!blockSpan.empty() &&
+                     x - blockSpan.back() - 1 <= m_maxGap) {
+            //Bridge the gap if none of its blocks has been loaded
+            bool bridging = true;
+            for (int gx = blockSpan.back() + 1; gx < x; ++gx) {
+              if (!isMissing(gx, y, z)) {
+                bridging = false;
+                break;
+              }
+            }
+            if (bridging) {
+              blockSpan.back() = x;
+            } else {
+              blockSpan.push_back(x);
+              blockSpan.push_back(x);
+            }
+          } else {
+            blockSpan.push_back(x);
+            blockSpan.push_back(x);
+          }
+        }
+      }
+    }
+
+    int maxBlockNumber = std::max(1, m_maxBlockNumberPerRequest);
+    for (size_t i = 0; i < blockSpan.size(); i += 2) {
+      for (int x = blockSpan[i]; x <= blockSpan[i + 1]; x += maxBlockNumber) {
+        Request request(ZIntPoint(x, y, z),
+                        std::min(maxBlockNumber, blockSpan[i + 1] - x + 1));
+        for (int j = 0; j < request.blockNumber; ++j) {
+          if (!std::binary_search(
+                bodyBlockX.begin(), bodyBlockX.end(), x + j)) {
+            request.bridged.resize(request.blockNumber, false);
+            request.bridged[j] = true;
+          }
+        }
+        requestArray.push_back(request);
+      }
+    }
+  }
+
+  return requestArray;
+}
+
+int ZDvidGrayscaleBlockFetcher::fetch(
+    ZDvidReader &reader, const ZObject3dScan &blockObj, ZStackBlockGrid *grid,
+    int zoom)
+{
+  m_canceled = false;
+
+  if (grid == NULL) {
+    return 0;
+  }
+
+  std::vector<Request> requestArray = makeRequest(blockObj, grid);
+  if (requestArray.empty()) {
+    return 0;
+  }
+
+  ZOUT(LTRACE(), 5) << "Fetching" << requestArray.size() << "block requests";
+
+  std::atomic<size_t> nextIndex(0);
+  std::atomic<int> blockCount(0);
+  std::atomic<bool> canceled(false);
+  std::mutex gridMutex;
+
+  auto fetchFunc = [&](ZDvidReader &currentReader) {
+    for (size_t i = nextIndex++; i < requestArray.size(); i = nextIndex++) {
+      if (canceled || isCanceling()) {
+        canceled = true;
+        break;
+      }
+
+      const Request &request = requestArray[i];
+      std::vector<ZStack*> stackArray = currentReader.readGrayScaleBlock(
+            request.blockIndex, m_dvidInfo, request.blockNumber, zoom);
+      for (size_t j = 0; j < stackArray.size(); ++j) {
+        if (request.isBridged(j)) { //Not a block of the body
+          delete stackArray[j];
+          stackArray[j] = NULL;
+        } else if (stackArray[j] != NULL) {
+          ++blockCount;
+        }
+      }
+
+      std::lock_guard<std::mutex> guard(gridMutex);
+      grid->consumeStack(request.blockIndex, stackArray);
+    }
+  };
+
+  int threadCount = std::min(m_threadCount, int(requestArray.size()));
+
+  //Each helper thread has its own connection; the calling thread keeps
+  //working on its own reader, so the requests are drained even if no helper
+  //thread gets started.
+  std::vector<QFuture<void> > futureArray;
+  for (int i = 1; i < threadCount; ++i) {
+    futureArray.push_back(QtConcurrent::run([&]() {
+      ZDvidReader helperReader;
+      helperReader.setVerbose(false);
+      if (helperReader.openRaw(reader.getDvidTarget())) {
+        fetchFunc(helperReader);
+      }
+    }));
+  }
+
+  fetchFunc(reader);
+
+  for (QFuture<void> &future : futureArray) {
+    future.waitForFinished();
+  }
+
+  m_canceled = canceled;
+
+  return blockCount;
+}
@@ -0,0 +1,126 @@
+#ifndef ZDVIDGRAYSCALEBLOCKFETCHER_H
+#define ZDVIDGRAYSCALEBLOCKFETCHER_H
+
+#include <vector>
+#include <functional>
+
+#include "zintpoint.h"
+#include "zintcuboid.h"
+#include "dvid/zdvidinfo.h"
+
+class ZDvidReader;
+class ZObject3dScan;
+class ZStackBlockGrid;
+
+/*!
+ * \brief The class of downloading grayscale blocks into a block grid
+ *
+ * The blocks to download are given as a block object, i.e. each voxel of the
+ * object is the index of a block. Missing blocks of the same stripe are
+ * coalesced into requests of contiguous blocks, bridging gaps of up to
+ * \a maxGap blocks, and long requests are split so that they can be spread
+ * over connections. The requests are then sent by the calling thread and
+ * (threadCount - 1) helper threads, each with its own DVID connection, and the
+ * blocks of each request are put into the grid as soon as it returns.
+ *
+ * The blocks in a bridged gap are not in the block object, so at most
+ * \a maxGap of them are downloaded for each gap. They are discarded instead
+ * of being put into the grid, which only holds blocks of the object.
+ *
+ * Usage:
+ *   ZDvidGrayscaleBlockFetcher fetcher;
+ *   fetcher.setDvidInfo(info);
+ *   fetcher.setThreadCount(4);
+ *   int blockCount = fetcher.fetch(reader, blockObj, grid);
+ */
+class ZDvidGrayscaleBlockFetcher
+{
+public:
+  ZDvidGrayscaleBlockFetcher();
+
+  struct Request {
+    Request() {}
+    Request(const ZIntPoint &index, int n) : blockIndex(index), blockNumber(n) {}
+
+    ZIntPoint blockIndex; //Index of the first block
+    int blockNumber = 0;
+    //Flags of the blocks in bridged gaps. Empty if there is no gap.
+    std::vector<bool> bridged;
+
+    bool isBridged(int i) const {
+      return i < int(bridged.size()) && bridged[i];
+    }
+  };
+
+  void setDvidInfo(const ZDvidInfo &info) { m_dvidInfo = info; }
+
+  /*!
+   * \brief Set the number of requests in flight
+   *
+   * \a n <= 1 means all requests are sent by the calling thread.
+   */
+  void setThreadCount(int n) { m_threadCount = n; }
+  int getThreadCount() const { return m_threadCount; }
+
+  /*!
+   * \brief Set the largest gap (in blocks) to bridge in coalescing requests
+   *
+   * The blocks in a bridged gap are downloaded too, which costs much less than
+   * a separate request, but they are not put into the grid. 0 means no
+   * bridging.
+   */
+  void setMaxGap(int n) { m_maxGap = n; }
+
+  void setMaxBlockNumberPerRequest(int n) { m_maxBlockNumberPerRequest = n; }
+
+  /*!
+   * \brief Set the range of blocks to download
+   *
+   * \a box is a block index box. Blocks out of the range are not
+   * requested. An empty box means no constraint.
+   */
+  void setBlockRange(const ZIntCuboid &box) { m_blockRange = box; }
+
+  /*!
+   * \brief Set the function for checking if fetching should stop
+   *
+   * It is called before sending each request.
+   */
+  void setCancelFunc(const std::function<bool()> &f) { m_cancelFunc = f; }
+
+  /*!
+   * \brief Make requests for the blocks of \a blockObj that are not in \a grid
+   */
+  std::vector<Request> makeRequest(
+      const ZObject3dScan &blockObj, const ZStackBlockGrid *grid) const;
+
+  /*!
+   * \brief Download the blocks of \a blockObj that are not in \a grid
+   *
+   * \a reader is used by the calling thread, and the helper threads open
+   * their own connections to the target of \a reader.
+   *
+   * \return Number of blocks put into \a grid.
+   */
+  int fetch(ZDvidReader &reader, const ZObject3dScan &blockObj,
+            ZStackBlockGrid *grid, int zoom = 0);
+
+  /*!
+   * \brief Check if the last fetch was canceled.
+   */
+  bool isCanceled() const { return m_canceled; }
+
+private:
+  bool isCanceling() const;
+
+private:
+  ZDvidInfo m_dvidInfo;
+  int m_threadCount = 1;
+  int m_maxGap = 2;
+  int m_maxBlockNumberPerRequest = 64;
+  ZIntCuboid m_blockRange;
+  std::function<bool()> m_cancelFunc;
+  bool m_canceled = false;
+};
+
+#endif // ZDVIDGRAYSCALEBLOCKFETCHER_H
@@ -15,6 +15,8 @@
 #include "zutils.h"
 #include "zstack.hxx"
 #include "flyem/zdvidgrayslicehighrestask.h"
+#include "flyem/zdvidgraysliceprefetchtask.h"
+#include "zslicescrollmotion.h"
 
 ZDvidGraySlice::ZDvidGraySlice()
 {
@@ -26,6 +28,7 @@ ZDvidGraySlice::ZDvidGraySlice()
 
   m_helper = std::make_unique<ZDvidDataSliceHelper>(ZDvidData::ROLE_GRAY_SCALE);
   getHelper()->useCenterCut(false);
+  m_cache = std::make_shared<TCache>();
 }
 
 ZDvidGraySlice::~ZDvidGraySlice()
@@ -138,21 +141,28 @@ void ZDvidGraySlice::updateContrast()
 #endif
 }
 
-bool ZDvidGraySlice::hasLowresRegion() const
+bool ZDvidGraySlice::HasLowresRegion(
+    const QRect &viewPort, int zoom, int centerCutWidth, int centerCutHeight)
 {
-  if (getZoom() > 0) {
+  if (zoom > 0) {
     return true;
   }
 
-  QRect viewport = getViewPort();//m_currentViewParam.getViewPort();
-  if (viewport.width() > getHelper()->getCenterCutWidth() ||
-      viewport.height() > getHelper()->getCenterCutHeight()) {
+  if (viewPort.width() > centerCutWidth ||
+      viewPort.height() > centerCutHeight) {
     return true;
   }
 
   return false;
 }
 
+bool ZDvidGraySlice::hasLowresRegion() const
+{
+  return HasLowresRegion(
+        getViewPort(), getZoom(), getHelper()->getCenterCutWidth(),
+        getHelper()->getCenterCutHeight());
+}
+
 void ZDvidGraySlice::invalidatePixmap()
 {
   m_isPixmapValid = false;
@@ -238,7 +248,8 @@ void ZDvidGraySlice::updatePixmap()
   if (!isPixmapValid()) {
     m_pixmap.detach();
     m_pixmap.convertFromImage(m_image);
-    double scale = 1.0 / getScale();
+    //The image can be at a coarser level than the view, e.g. from the cache
+    double scale = 1.0 / getHelper()->getActualScale();
     m_pixmap.setScale(scale, scale);
     m_pixmap.setOffset(-getX(), -getY());
     validatePixmap();
@@ -394,54 +405,79 @@ void ZDvidGraySlice::setCenterCut(int width, int height)
   getHelper()->setCenterCut(width, height);
 }
 
+ZStack* ZDvidGraySlice::ReadStack(
+    const ZDvidReader &reader, const QRect &viewPort, int z, int zoom,
+    int centerCutWidth, int centerCutHeight, bool hasLowresRegion)
+{
+  ZIntCuboid box = ZDvidDataSliceHelper::GetBoundBox(viewPort, z);
+
+  int cx = centerCutWidth;
+  int cy = centerCutHeight;
+
+  int scale = zgeom::GetZoomScale(hasLowresRegion ? zoom + 1 : zoom);
+  int remain = z % scale;
+  ZStack *stack = reader.readGrayScaleLowtis(
+        box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+        z, box.getWidth(), box.getHeight(), zoom, cx, cy, true);
+  if (scale > 1) {
+    if (remain > 0) {
+      //        int z1 = z + scale - remain;
+      int z1 = z - remain + scale;
+      ZStack *stack2 = reader.readGrayScaleLowtis(
+            box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+            z1, box.getWidth(), box.getHeight(), zoom, cx, cy, true);
+      //        double lambda = double(remain) / scale;
+      ZStackProcessor::IntepolateFovia(
+            stack, stack2, cx, cy, scale, z, z1, z, stack);
+      //        ZStackProcessor::Intepolate(stack, stack2, lambda, stack);
+      delete stack2;
+    }
+  }
+
+  return stack;
+}
+
 void ZDvidGraySlice::forceUpdate(const QRect &viewPort, int z)
 {
-  ZIntCuboid box;
-  box.setFirstCorner(viewPort.left(), viewPort.top(), z);
-  box.setSize(viewPort.width(), viewPort.height(), 1);
-
   int cx = getHelper()->getCenterCutWidth();
   int cy = getHelper()->getCenterCutHeight();
-//  int z = box.getFirstCorner().getZ();
-
 
-  ZStack *stack = NULL;
+  std::shared_ptr<const ZStack> stack;
 
   if (getSliceAxis() == neutube::EAxis::Z) {
-    int zoom = getZoom();
-    if (hasLowresRegion()) {
-      ++zoom;
-    }
+    const neutube::EAxis axis = neutube::EAxis::Z;
+    const int zoom = getZoom();
+
+    //From the best quality to the worst: a high-res update, a low-res
+    //update and a low-res update at the coarser level
+    stack = m_cache->get(TCache::Key(axis, z, zoom, viewPort, cx, cy, false));
+    if (stack) {
+      getHelper()->setActualQuality(zoom, cx, cy, false);
+    } else {
+      TCache::Key key(axis, z, zoom, viewPort, cx, cy, true);
+      int actualZoom = zoom;
+      stack = m_cache->get(key);
+      if (!stack && zoom < getHelper()->getMaxZoom()) {
+        stack = m_cache->get(
+              TCache::Key(axis, z, zoom + 1, viewPort, cx, cy, true));
+        if (stack) {
+          actualZoom = zoom + 1;
+        }
+      }
 
-    int scale = zgeom::GetZoomScale(zoom);
-    int remain = z % scale;
-    stack = getDvidReader().readGrayScaleLowtis(
-          box.getFirstCorner().getX(), box.getFirstCorner().getY(),
-          z, box.getWidth(), box.getHeight(),
-          getZoom(), cx, cy, true);
-    if (scale > 1) {
-      if (remain > 0) {
-        //        int z1 = z + scale - remain;
-        int z1 = z - remain + scale;
-        ZStack *stack2 = getDvidReader().readGrayScaleLowtis(
-              box.getFirstCorner().getX(), box.getFirstCorner().getY(),
-              z1, box.getWidth(), box.getHeight(), getZoom(), cx, cy,
-              true);
-        //        double lambda = double(remain) / scale;
-        ZStackProcessor::IntepolateFovia(
-              stack, stack2, cx, cy, scale, z, z1, z, stack);
-        //        ZStackProcessor::Intepolate(stack, stack2, lambda, stack);
-        delete stack2;
+      if (!stack) {
+        ZStack *data = ReadStack(
+              getDvidReader(), viewPort, z, zoom, cx, cy, hasLowresRegion());
+        if (data != NULL) {
+          stack = m_cache->add(key, data, data->getByteNumber());
+        }
       }
-    }
 
-    getHelper()->setActualQuality(
-          getZoom(), cx, cy, true);
+      getHelper()->setActualQuality(actualZoom, cx, cy, true);
+    }
   }
 
-  updateImage(stack);
-
-  delete stack;
+  updateImage(stack.get());
 }
 
 bool ZDvidGraySlice::containedIn(
@@ -464,7 +500,17 @@ bool ZDvidGraySlice::consume(
       getHelper()->setActualQuality(zoom, centerCutX, centerCutY, usingCenterCut);
       getHelper()->setViewParam(viewParam);
 //      getHelper()->setCenterCut(centerCutX, centerCutY);
-      updateImage(stack);
+      if (viewParam.getSliceAxis() == neutube::EAxis::Z) {
+        std::shared_ptr<const ZStack> data = m_cache->add(
+              TCache::Key(neutube::EAxis::Z, viewParam.getZ(), zoom,
+                          viewParam.getViewPort(), centerCutX, centerCutY,
+                          usingCenterCut),
+              stack, stack->getByteNumber());
+        updateImage(data.get());
+      } else {
+        updateImage(stack);
+        delete stack;
+      }
       succ = true;
     } else {
       delete stack;
@@ -484,12 +530,58 @@ ZTask* ZDvidGraySlice::makeFutureTask(ZStackDoc *doc)
     task->setZoom(getHelper()->getZoom());
     task->useCenterCut(false);
     task->setDelay(100);
+    task->setPriority(ZTask::PRIORITY_HIGH);
+    task->setKey(QString("gray slice %1").arg(neutube::EnumValue(m_sliceAxis)));
     task->setDoc(doc);
   }
 
   return task;
 }
 
+ZTask* ZDvidGraySlice::makePrefetchTask(
+    ZStackDoc *doc, const ZSliceScrollMotion &motion)
+{
+  ZDvidGraySlicePrefetchTask *task = NULL;
+  const int maxSize = 1024*1024;
+  const int sliceCount = 4;
+
+  if (m_sliceAxis == neutube::EAxis::Z && motion.isMoving() && isVisible()) {
+    int zoom = getZoom();
+    if (motion.isFast() && zoom < getHelper()->getMaxZoom()) {
+      ++zoom;
+    }
+
+    ZStackViewParam viewParam = getHelper()->getViewParam();
+    if (ZDvidDataSliceHelper::GetViewDataSize(viewParam, zoom) < maxSize) {
+      int cx = getHelper()->getCenterCutWidth();
+      int cy = getHelper()->getCenterCutHeight();
+      std::vector<int> sliceArray;
+      for (int z : motion.predict(viewParam.getZ(), sliceCount)) {
+        if (!m_cache->contains(TCache::Key(
+                                 m_sliceAxis, z, zoom, viewParam.getViewPort(),
+                                 cx, cy, true))) {
+          sliceArray.push_back(z);
+        }
+      }
+
+      if (!sliceArray.empty()) {
+        task = new ZDvidGraySlicePrefetchTask;
+        task->setViewParam(viewParam);
+        task->setZoom(zoom);
+        task->setCenterCut(cx, cy);
+        task->useCenterCut(true);
+        task->setSliceArray(sliceArray);
+        task->setCache(m_cache);
+        task->setPriority(ZTask::PRIORITY_LOW);
+        task->setKey("gray prefetch");
+        task->setDoc(doc);
+      }
+    }
+  }
+
+  return task;
+}
+
 void ZDvidGraySlice::forceUpdate(const ZStackViewParam &viewParam)
 {
   if (viewParam.getSliceAxis() != m_sliceAxis) {
@@ -560,6 +652,7 @@ void ZDvidGraySlice::printInfo() const
 
 void ZDvidGraySlice::setDvidTarget(const ZDvidTarget &target)
 {
+  m_cache->clear();
   getHelper()->setDvidTarget(target);
   getHelper()->setMaxZoom(target.getMaxGrayscaleZoom());
 //  m_dvidTarget = target;
@@ -1,6 +1,8 @@
 #ifndef ZDVIDGRAYSLICE_H
 #define ZDVIDGRAYSLICE_H
 
+#include <memory>
+
 #include "zstackobject.h"
 #include "zimage.h"
 //#include "zdvidreader.h"
@@ -9,6 +11,7 @@
 #include "zpixmap.h"
 #include "zcontrastprotocol.h"
 #include "zuncopyable.h"
+#include "dvid/zdvidslicecache.h"
 
 //#include "zdvidtarget.h"
 
@@ -19,6 +22,7 @@ class ZDvidDataSliceHelper;
 class ZDvidTarget;
 class ZTask;
 class ZStackDoc;
+class ZSliceScrollMotion;
 //class ZStackViewParam;
 
 class ZDvidGraySlice : public ZStackObject, ZUncopyable
@@ -122,6 +126,36 @@ public:
                    int centerCutX, int centerCutY, bool centerCut) const;
   ZTask* makeFutureTask(ZStackDoc *doc);
 
+  typedef ZDvidSliceCache<ZStack> TCache;
+
+  /*!
+   * \brief Make a task of prefetching the slices ahead of scrolling.
+   *
+   * The slices are read into the slice cache, from which they are shown
+   * without reading DVID again. Slices of the next coarser zoom level are
+   * prefetched for fast scrolling.
+   *
+   * \return NULL if there is nothing to prefetch.
+   */
+  ZTask* makePrefetchTask(ZStackDoc *doc, const ZSliceScrollMotion &motion);
+
+  std::shared_ptr<TCache> getCache() const {
+    return m_cache;
+  }
+
+  static bool HasLowresRegion(
+      const QRect &viewPort, int zoom, int centerCutWidth, int centerCutHeight);
+
+  /*!
+   * \brief Read a Z slice as shown in the low-resolution update.
+   *
+   * A slice between two slices of the coarse level is interpolated when there
+   * is any low-resolution region.
+   */
+  static ZStack* ReadStack(
+      const ZDvidReader &reader, const QRect &viewPort, int z, int zoom,
+      int centerCutWidth, int centerCutHeight, bool hasLowresRegion);
+
 public: //for testing
   void saveImage(const std::string &path);
   void savePixmap(const std::string &path);
@@ -176,6 +210,7 @@ private:
 //  int m_maxHeight;
 
   std::unique_ptr<ZDvidDataSliceHelper> m_helper;
+  std::shared_ptr<TCache> m_cache;
 //  ZPoint m_v1;
 //  ZPoint m_v2;
 
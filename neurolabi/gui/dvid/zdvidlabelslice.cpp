@@ -24,6 +24,8 @@
 #include "zdviddataslicehelper.h"
 #include "misc/miscutility.h"
 #include "flyem/zdvidlabelslicehighrestask.h"
+#include "flyem/zdvidlabelsliceprefetchtask.h"
+#include "zslicescrollmotion.h"
 
 /* Implementation details:
  *
@@ -67,6 +69,7 @@ void ZDvidLabelSlice::init(int maxWidth, int maxHeight  , neutube::EAxis sliceAx
 
   m_helper = std::make_unique<ZDvidDataSliceHelper>(ZDvidData::ROLE_LABEL_BLOCK);
   getHelper()->setMaxSize(maxWidth, maxHeight);
+  m_cache = std::make_shared<TCache>();
 //  m_maxWidth = maxWidth;
 //  m_maxHeight = maxHeight;
 
@@ -181,12 +184,67 @@ ZTask* ZDvidLabelSlice::makeFutureTask(ZStackDoc *doc)
     task->setCenterCut(
           getHelper()->getCenterCutWidth(), getHelper()->getCenterCutHeight());
     task->setDelay(100);
+    task->setPriority(ZTask::PRIORITY_HIGH);
+    task->setKey(QString("label slice %1").arg(
+                   neutube::EnumValue(viewParam.getSliceAxis())));
     task->setDoc(doc);
   }
 
   return task;
 }
 
+ZTask* ZDvidLabelSlice::makePrefetchTask(
+    ZStackDoc *doc, const ZSliceScrollMotion &motion)
+{
+  ZDvidLabelSlicePrefetchTask *task = NULL;
+  const int maxSize = 1024*1024;
+  const int sliceCount = 4;
+
+  if (m_sliceAxis == neutube::EAxis::Z && motion.isMoving() && isVisible() &&
+      getHelper()->getUpdatePolicy() != flyem::EDataSliceUpdatePolicy::HIDDEN) {
+    ZStackViewParam viewParam = getHelper()->getViewParam();
+    int zoom = getFirstZoom(viewParam);
+    if (motion.isFast() && zoom < getHelper()->getMaxZoom()) {
+      ++zoom;
+    }
+
+    if (!viewParam.getViewPort().isEmpty() &&
+        ZDvidDataSliceHelper::GetViewDataSize(viewParam, zoom) < maxSize) {
+      int ccw = getHelper()->getCenterCutWidth();
+      int cch = getHelper()->getCenterCutHeight();
+      bool usingCenterCut = getHelper()->usingCenterCut();
+      std::vector<int> sliceArray;
+      for (int z : motion.predict(viewParam.getZ(), sliceCount)) {
+        if (!m_cache->contains(TCache::Key(
+                                 m_sliceAxis, z, zoom, viewParam.getViewPort(),
+                                 ccw, cch, usingCenterCut))) {
+          sliceArray.push_back(z);
+        }
+      }
+
+      if (!sliceArray.empty()) {
+        task = new ZDvidLabelSlicePrefetchTask;
+        task->setViewParam(viewParam);
+        task->setZoom(zoom);
+        task->setCenterCut(ccw, cch);
+        task->useCenterCut(usingCenterCut);
+        task->setSliceArray(sliceArray);
+        task->setCache(m_cache);
+        task->setPriority(ZTask::PRIORITY_LOW);
+        task->setKey("label prefetch");
+        task->setDoc(doc);
+      }
+    }
+  }
+
+  return task;
+}
+
+void ZDvidLabelSlice::clearCache()
+{
+  m_cache->clear();
+}
+
 #if 0
 void ZDvidLabelSlice::forceUpdate(bool ignoringHidden)
 {
@@ -202,6 +260,7 @@ void ZDvidLabelSlice::setDvidTarget(const ZDvidTarget &target)
   m_dvidTarget.setLabelBlockName("labels3");
 #endif
 //  m_reader.open(target);
+  clearCache();
   getHelper()->setDvidTarget(target);
   getHelper()->setMaxZoom(target.getMaxLabelZoom());
   getHelper()->inferUpdatePolicy(getSliceAxis());
@@ -287,12 +346,15 @@ void ZDvidLabelSlice::paintBufferUnsync()
   if (m_labelArray != NULL && m_paintBuffer != NULL) {
     if ((int) m_labelArray->getElementNumber() ==
         m_paintBuffer->width() * m_paintBuffer->height()) {
-      updateRgbTable();
+      QElapsedTimer timer;
+      timer.start();
 
-      // TODO: Consider a way to use m_customColorScheme without remapId(), because remapId()
-      // takes around 3 ms on a Macbook Pro.  That may not sound like much but it is about
-      // 20% of the budget per frame for 60 frames/sec.
+      updateRgbTable();
 
+      // remapId() resolves each distinct label once (see ZLabelRemapper), so
+      // its cost is dominated by a sequential pass over the label array
+      // instead of a set/map lookup per pixel. getPaintTime() reports the
+      // total time of the painting for checking the frame budget.
       remapId();
 
       uint64_t *labelArray = NULL;
@@ -314,6 +376,9 @@ void ZDvidLabelSlice::paintBufferUnsync()
           m_paintBuffer->drawLabelField(labelArray, m_rgbTable, 0, 0xFFFFFFFF);
         }
       }
+
+      m_paintTime = timer.elapsed();
+      ZOUT(LTRACE(), 5) << "Label slice painting time:" << m_paintTime;
     }
   }
 }
@@ -417,14 +482,37 @@ void ZDvidLabelSlice::forceUpdate(const QRect &viewPort, int z, int zoom)
     if (!viewPort.isEmpty()) {
       ZIntCuboid box = ZDvidDataSliceHelper::GetBoundBox(viewPort, z);
       if (getSliceAxis() == neutube::EAxis::Z) {
-        m_labelArray = getHelper()->getDvidReader().readLabels64Lowtis(
-              box.getFirstCorner().getX(), box.getFirstCorner().getY(),
-              box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
-              zoom, getHelper()->getCenterCutWidth(),
-              getHelper()->getCenterCutHeight(), getHelper()->usingCenterCut());
-        getHelper()->setActualQuality(
-              zoom, getHelper()->getCenterCutWidth(),
-              getHelper()->getCenterCutHeight(), getHelper()->usingCenterCut());
+        int ccw = getHelper()->getCenterCutWidth();
+        int cch = getHelper()->getCenterCutHeight();
+        bool usingCenterCut = getHelper()->usingCenterCut();
+
+        //A cached slice at the coarser level is used before reading DVID
+        TCache::Key key(
+              neutube::EAxis::Z, z, zoom, viewPort, ccw, cch, usingCenterCut);
+        int actualZoom = zoom;
+        std::shared_ptr<const ZArray> array = m_cache->get(key);
+        if (!array && zoom < getHelper()->getMaxZoom()) {
+          array = m_cache->get(
+                TCache::Key(neutube::EAxis::Z, z, zoom + 1, viewPort,
+                            ccw, cch, usingCenterCut));
+          if (array) {
+            actualZoom = zoom + 1;
+          }
+        }
+
+        if (array) {
+          m_labelArray = new ZArray(*array);
+        } else {
+          m_labelArray = getHelper()->getDvidReader().readLabels64Lowtis(
+                box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+                box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
+                zoom, ccw, cch, usingCenterCut);
+          if (m_labelArray != NULL) {
+            m_cache->add(key, new ZArray(*m_labelArray),
+                         m_labelArray->getByteNumber());
+          }
+        }
+        getHelper()->setActualQuality(actualZoom, ccw, cch, usingCenterCut);
       } else {
         int zoomRatio = pow(2, zoom);
         int width = box.getWidth() / zoomRatio;
@@ -686,209 +774,25 @@ void ZDvidLabelSlice::remapId()
   remapId(m_mappedLabelArray);
 }
 
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v)
-{
-  if (m_customColorScheme.get() != NULL) {
-
-    QHash<uint64_t, int> idMap;
-
-    idMap = m_customColorScheme->getColorIndexMap();
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        array[i] = 0;
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        array[i] = originalArray[i];
-        if (idMap.contains(array[i])) {
-          array[i] = idMap[array[i]];
-        } else {
-          array[i] = 0;
-        }
-      }
-    }
-  }
-}
-
-
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v,
-    std::set<uint64_t> &selected)
+uint64_t ZDvidLabelSlice::remapLabel(
+    uint64_t label, const ZFlyEmBodyMerger::TLabelMap &bodyMap,
+    const QHash<uint64_t, int> &idMap, bool highlightingSelected) const
 {
-  if (m_customColorScheme.get() != NULL) {
-
-    QHash<uint64_t, int> idMap;
-
-    idMap = m_customColorScheme->getColorIndexMap();
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = originalArray[i];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else {
-          array[i] = originalArray[i];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        }
-      }
-    }
-  } else {
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = originalArray[i];
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selected.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else {
-          array[i] = originalArray[i];
-        }
-      }
+  bool selected = m_selectedOriginal.count(label) > 0;
+  if (highlightingSelected) {
+    if (!selected) {
+      return 0;
     }
+  } else if (selected) {
+    return flyem::LABEL_ID_SELECTION;
   }
-}
-
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v,
-    const ZFlyEmBodyMerger::TLabelMap &bodyMap)
-{
 
+  uint64_t mapped = bodyMap.value(label, label);
   if (m_customColorScheme.get() != NULL) {
-    QHash<uint64_t, int> idMap;
-
-    idMap = m_customColorScheme->getColorIndexMap();
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      m_paintBuffer->setVisible(false);
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-        } else {
-          array[i] = originalArray[i];
-        }
-        if (idMap.contains(array[i])) {
-          array[i] = idMap[array[i]];
-        } else {
-          array[i] = 0;
-        }
-      }
-    }
-  } else {
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      m_paintBuffer->setVisible(false);
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-        } else {
-          array[i] = originalArray[i];
-        }
-      }
-    }
+    mapped = idMap.value(mapped, 0);
   }
-}
-
-void ZDvidLabelSlice::remapId(
-    uint64_t *array, const uint64_t *originalArray, uint64_t v,
-    std::set<uint64_t> &selected, const ZFlyEmBodyMerger::TLabelMap &bodyMap)
-{
-  if (m_customColorScheme.get() != NULL) {
-    QHash<uint64_t, int> idMap;
-
-
-    idMap = m_customColorScheme->getColorIndexMap();
 
-    std::set<uint64_t> selectedSet = selected;
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          if (bodyMap.count(originalArray[i]) > 0) {
-            array[i] = bodyMap[originalArray[i]];
-          } else {
-            array[i] = originalArray[i];
-          }
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        } else {
-          array[i] = originalArray[i];
-          if (idMap.contains(array[i])) {
-            array[i] = idMap[array[i]];
-          } else {
-            array[i] = 0;
-          }
-        }
-      }
-    }
-  } else {
-    std::set<uint64_t> selectedSet = selected;
-
-    if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          if (bodyMap.count(originalArray[i]) > 0) {
-            array[i] = bodyMap[originalArray[i]];
-          } else {
-            array[i] = originalArray[i];
-          }
-        } else {
-          array[i] = 0;
-        }
-      }
-    } else {
-      for (size_t i = 0; i < v; ++i) {
-        if (selectedSet.count(originalArray[i]) > 0) {
-          array[i] = flyem::LABEL_ID_SELECTION;
-        } else if (bodyMap.count(originalArray[i]) > 0) {
-          array[i] = bodyMap[originalArray[i]];
-        } else {
-          array[i] = originalArray[i];
-        }
-      }
-    }
-  }
+  return mapped;
 }
 
 void ZDvidLabelSlice::remapId(ZArray *label)
@@ -902,23 +806,26 @@ void ZDvidLabelSlice::remapId(ZArray *label)
     uint64_t *array = label->getDataPointer<uint64_t>();
     const uint64_t *originalArray = m_labelArray->getDataPointer<uint64_t>();
     size_t v = label->getElementNumber();
-    if (!bodyMap.empty() || !m_selectedOriginal.empty()) {
-      if (bodyMap.empty()) {
-        remapId(array, originalArray, v, m_selectedOriginal);
-      } else if (m_selectedOriginal.empty()) {
-        remapId(array, originalArray, v, bodyMap);
-      } else {
-        remapId(array, originalArray, v, m_selectedOriginal, bodyMap);
+    bool highlightingSelected =
+        hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED);
+
+    if (highlightingSelected && m_selectedOriginal.empty()) {
+      //Nothing to highlight
+      if (m_paintBuffer != NULL) {
+        m_paintBuffer->setVisible(false);
       }
-    } else {
+    } else if (!bodyMap.empty() || !m_selectedOriginal.empty() ||
+               m_customColorScheme.get() != NULL) {
+      QHash<uint64_t, int> idMap;
       if (m_customColorScheme.get() != NULL) {
-        remapId(array, originalArray, v);
-      }
-      if (hasVisualEffect(neutube::display::LabelField::VE_HIGHLIGHT_SELECTED)) {
-        if (m_paintBuffer != NULL) {
-          m_paintBuffer->setVisible(false);
-        }
+        idMap = m_customColorScheme->getColorIndexMap();
       }
+
+      //Each distinct label is resolved once instead of once per pixel
+      m_labelRemapper.remap(
+            originalArray, v, array, [&](uint64_t label) {
+        return remapLabel(label, bodyMap, idMap, highlightingSelected);
+      });
     }
   }
 }
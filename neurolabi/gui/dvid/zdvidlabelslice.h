@@ -1,6 +1,8 @@
 #ifndef ZDVIDLABELSLICE_H
 #define ZDVIDLABELSLICE_H
 
+#include <memory>
+
 #include <QCache>
 #include <QMutex>
 
@@ -17,6 +19,8 @@
 #include "zsharedpointer.h"
 #include "flyem/zflyembodycolorscheme.h"
 #include "flyem/zflyembodymerger.h"
+#include "flyem/zlabelremapper.h"
+#include "dvid/zdvidslicecache.h"
 
 class QColor;
 class ZArray;
@@ -26,6 +30,7 @@ class ZStackViewParam;
 class ZArbSliceViewParam;
 class ZTask;
 class ZStackDoc;
+class ZSliceScrollMotion;
 
 class ZDvidLabelSlice : public ZStackObject
 {
@@ -156,6 +161,15 @@ public:
 
   int64_t getReadingTime() const;
 
+  /*!
+   * \brief Time (ms) of the last painting of the label buffer
+   *
+   * It covers remapping and colorizing the label array.
+   */
+  int64_t getPaintTime() const {
+    return m_paintTime;
+  }
+
   bool refreshReaderBuffer();
 
   void paintBuffer();
@@ -168,6 +182,28 @@ public:
                    int centerCutX, int centerCutY, bool usingCenterCut) const;
   ZTask* makeFutureTask(ZStackDoc *doc);
 
+  typedef ZDvidSliceCache<ZArray> TCache;
+
+  /*!
+   * \brief Make a task of prefetching the slices ahead of scrolling.
+   *
+   * Slices of the next coarser zoom level are prefetched for fast scrolling.
+   *
+   * \return NULL if there is nothing to prefetch.
+   */
+  ZTask* makePrefetchTask(ZStackDoc *doc, const ZSliceScrollMotion &motion);
+
+  std::shared_ptr<TCache> getCache() const {
+    return m_cache;
+  }
+
+  /*!
+   * \brief Clear cached label slices.
+   *
+   * It should be called before updating the slice for modified labels.
+   */
+  void clearCache();
+
   void allowBlinking(bool on);
 
 private:
@@ -187,14 +223,15 @@ private:
   void remapId(ZArray *label);
   void remapId();
 
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v);
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v,
-               std::set<uint64_t> &selected);
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v,
-               const ZFlyEmBodyMerger::TLabelMap &bodyMap);
-  void remapId(uint64_t *array, const uint64_t *originalArray, uint64_t v,
-               std::set<uint64_t> &selected,
-               const ZFlyEmBodyMerger::TLabelMap &bodyMap);
+  /*!
+   * \brief Map an original label to the label to paint
+   *
+   * It combines the selection, the body merging map and the custom color
+   * scheme. \a idMap is the color index map of the custom color scheme.
+   */
+  uint64_t remapLabel(uint64_t label, const ZFlyEmBodyMerger::TLabelMap &bodyMap,
+                      const QHash<uint64_t, int> &idMap,
+                      bool highlightingSelected) const;
 
   void updateRgbTable();
 
@@ -235,6 +272,8 @@ private:
 
   ZArray *m_labelArray;
   ZArray *m_mappedLabelArray;
+  ZLabelRemapper m_labelRemapper;
+  int64_t m_paintTime = 0;
   QMutex m_updateMutex;
 
   std::set<uint64_t> m_prevSelectedOriginal;
@@ -242,6 +281,7 @@ private:
 
 
   std::unique_ptr<ZDvidDataSliceHelper> m_helper;
+  std::shared_ptr<TCache> m_cache;
 
   bool m_selectionFrozen;
 //  bool m_multiResUpdate = true;
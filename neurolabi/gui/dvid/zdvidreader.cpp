@@ -4,6 +4,7 @@
 #include <vector>
 #include <ctime>
 #include <future>
+#include <atomic>
 
 #include <archive.h>
 #include <archive_entry.h>
@@ -25,6 +26,7 @@
 #include "dvid/zdvidfilter.h"
 #include "dvid/zdvidbufferreader.h"
 #include "dvid/zdvidurl.h"
+#include "dvid/zdvidsparsevoldecoder.h"
 #include "zarray.h"
 #include "zstring.h"
 #include "flyem/zflyemneuronbodyinfo.h"
@@ -41,6 +43,7 @@
 #include "flyem/zflyemmisc.h"
 #include "zdvidutil.h"
 #include "dvid/zdvidroi.h"
+#include "dvid/zdvidannotationdecoder.h"
 #include "zflyemutilities.h"
 #include "zobject3dscanarray.h"
 #include "zdvidpath.h"
@@ -312,6 +315,25 @@ void ZDvidReader::testApiLoad()
 #endif
 }
 
+neutube::EReadStatus ZDvidReader::readSparsevol(
+    const std::string &url, ZObject3dScan *result) const
+{
+  ZDvidSparsevolDecoder decoder(result);
+  m_bufferReader.readStream(
+        url.c_str(), [&](const char *data, size_t length) {
+    decoder.consume(data, length);
+  }, isVerbose());
+
+  neutube::EReadStatus status = m_bufferReader.getStatus();
+  if (status == neutube::EReadStatus::FAILED) {
+    result->clear();
+  } else {
+    decoder.finish();
+  }
+
+  return status;
+}
+
 ZObject3dScan *ZDvidReader::readBody(
     uint64_t bodyId, flyem::EBodyLabelType labelType,
     int z, neutube::EAxis axis, bool canonizing,
@@ -326,8 +348,6 @@ ZObject3dScan *ZDvidReader::readBody(
       result = new ZObject3dScan;
     }
 
-    ZDvidBufferReader &reader = m_bufferReader;
-
     //  reader.tryCompress(true);
     ZDvidUrl dvidUrl(getDvidTarget());
 
@@ -340,13 +360,9 @@ ZObject3dScan *ZDvidReader::readBody(
 
     QElapsedTimer timer;
     timer.start();
-    reader.read(url.c_str(), isVerbose());
+    readSparsevol(url, result);
     ZOUT(LTRACE(), 5) << "Reading time:" << url << timer.elapsed() << "ms";
 
-    const QByteArray &buffer = reader.getBuffer();
-    result->importDvidObjectBuffer(buffer.data(), buffer.size());
-    reader.clearBuffer();
-
     if (canonizing) {
       result->canonize();
 //      result->fullySortedCanonize();
@@ -371,21 +387,15 @@ ZObject3dScan *ZDvidReader::readBody(
       result = new ZObject3dScan;
     }
 
-    ZDvidBufferReader &reader = m_bufferReader;
-
     //  reader.tryCompress(true);
     ZDvidUrl dvidUrl(getDvidTarget());
 
     std::string url = dvidUrl.getSparsevolUrl(bodyId, z, z, axis);
     QElapsedTimer timer;
     timer.start();
-    reader.read(url.c_str(), isVerbose());
+    readSparsevol(url, result);
     ZOUT(LTRACE(), 5) << "Reading time:" << url << timer.elapsed() << "ms";
 
-    const QByteArray &buffer = reader.getBuffer();
-    result->importDvidObjectBuffer(buffer.data(), buffer.size());
-    reader.clearBuffer();
-
     if (canonizing) {
       result->canonize();
 //      result->fullySortedCanonize();
@@ -404,11 +414,16 @@ ZObject3dScan* ZDvidReader::readBodyWithPartition(
     result->clear();
   }
 
+  m_partitionReadingTime.clear();
+
   if (isReady()) {
     if (result == NULL) {
       result = new ZObject3dScan;
     }
 
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
     const ZObject3dScan &coarseBody = readCoarseBody(bodyId, labelType);
     ZDvidInfo dvidInfo = readLabelInfo();
     int minZ = dvidInfo.getCoordZ(coarseBody.getMinZ());
@@ -418,31 +433,107 @@ ZObject3dScan* ZDvidReader::readBodyWithPartition(
     int dz = 1024 / dvidInfo.getBlockSize().getZ() *
         dvidInfo.getBlockSize().getZ() - 1;
 
+    std::vector<std::pair<int, int> > zRangeArray;
     int startZ = minZ;
     int endZ = (startZ + dz) / dvidInfo.getBlockSize().getZ() *
         dvidInfo.getBlockSize().getZ() - 1;
-    ZObject3dScan part;
     while (startZ <= maxZ) {
       if (endZ > maxZ) {
         endZ = maxZ;
       }
-      if (startZ == minZ) {
-#ifdef _DEBUG_
-        STD_COUT << "Read first part: " << startZ << "--" << endZ << std::endl;
-#endif
-        readBody(bodyId, labelType, startZ, endZ, true, neutube::EAxis::Z, result);
-      } else {
+      zRangeArray.emplace_back(startZ, endZ);
+      startZ = endZ + 1;
+      endZ = startZ + dz;
+    }
+
+    std::vector<ZObject3dScan> partArray(zRangeArray.size());
+    m_partitionReadingTime.resize(zRangeArray.size(), 0);
+
+    int threadCount = std::min(
+          m_partitionThreadCount, int(zRangeArray.size()));
+    if (threadCount <= 1) {
+      for (size_t i = 0; i < zRangeArray.size(); ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        readBody(bodyId, labelType, zRangeArray[i].first,
+                 zRangeArray[i].second, true, neutube::EAxis::Z,
+                 &(partArray[i]));
+        m_partitionReadingTime[i] = timer.elapsed();
+      }
+    } else {
+      //Each thread has its own connection and keeps taking the next slab
+      std::atomic<size_t> nextIndex(0);
+      std::vector<char> isSlabRead(zRangeArray.size(), 0);
+      auto readFunc = [&]() {
+        ZDvidReader reader;
+        reader.setVerbose(isVerbose());
+        if (reader.openRaw(getDvidTarget())) {
+          for (size_t i = nextIndex++; i < zRangeArray.size();
+               i = nextIndex++) {
 #ifdef _DEBUG_
-        STD_COUT << "Read part: " << startZ << "--" << endZ << std::endl;
+            STD_COUT << "Read part: " << zRangeArray[i].first << "--"
+                     << zRangeArray[i].second << std::endl;
 #endif
-        readBody(bodyId, labelType, startZ, endZ, true, neutube::EAxis::Z, &part);
-        if (!part.isEmpty()) {
-          result->unify(part);
+            QElapsedTimer timer;
+            timer.start();
+            reader.readBody(bodyId, labelType, zRangeArray[i].first,
+                            zRangeArray[i].second, true, neutube::EAxis::Z,
+                            &(partArray[i]));
+            m_partitionReadingTime[i] = timer.elapsed();
+            isSlabRead[i] = 1;
+          }
+        } else {
+          LWARN() << "Failed to open a connection for reading body slabs.";
         }
+      };
+
+      std::vector<QFuture<void> > futureArray;
+      for (int i = 0; i < threadCount; ++i) {
+        futureArray.push_back(QtConcurrent::run(readFunc));
       }
-      startZ = endZ + 1;
-      endZ = startZ + dz;
+      for (QFuture<void> &future : futureArray) {
+        future.waitForFinished();
+      }
+
+      //Slabs left by threads without a connection are read on this one
+      for (size_t i = 0; i < zRangeArray.size(); ++i) {
+        if (!isSlabRead[i]) {
+          QElapsedTimer timer;
+          timer.start();
+          readBody(bodyId, labelType, zRangeArray[i].first,
+                   zRangeArray[i].second, true, neutube::EAxis::Z,
+                   &(partArray[i]));
+          m_partitionReadingTime[i] = timer.elapsed();
+        }
+      }
+    }
+
+    //Slabs do not overlap and are sorted by Z, so concatenating canonized
+    //slabs gives a canonized body.
+    size_t stripeNumber = 0;
+    bool canonized = true;
+    for (const ZObject3dScan &part : partArray) {
+      stripeNumber += part.getStripeNumber();
+      canonized = canonized && part.isCanonized();
+    }
+    result->getStripeArray().reserve(stripeNumber);
+    for (size_t i = 0; i < partArray.size(); ++i) {
+      ZOUT(LTRACE(), 5) << "Slab reading time:" << zRangeArray[i].first
+                        << zRangeArray[i].second << m_partitionReadingTime[i]
+                        << "ms";
+      if (!partArray[i].isEmpty()) {
+        result->concat(partArray[i]);
+      }
+      partArray[i].clear();
     }
+    if (canonized) {
+      result->setCanonized(true);
+    } else {
+      result->canonize();
+    }
+    result->setLabel(bodyId);
+
+    m_readingTime = totalTimer.elapsed();
   }
 
   return result;
@@ -513,15 +604,9 @@ ZObject3dScan *ZDvidReader::readBody(
       result = new ZObject3dScan;
     }
 
-    ZDvidBufferReader &reader = m_bufferReader;
-
     //  reader.tryCompress(true);
     ZDvidUrl dvidUrl(getDvidTarget());
-    reader.read(dvidUrl.getSparsevolUrl(bodyId, minZ, maxZ, axis).c_str(),
-                isVerbose());
-    const QByteArray &buffer = reader.getBuffer();
-    result->importDvidObjectBuffer(buffer.data(), buffer.size());
-    reader.clearBuffer();
+    readSparsevol(dvidUrl.getSparsevolUrl(bodyId, minZ, maxZ, axis), result);
 
     if (canonizing) {
       result->canonize();
@@ -547,23 +632,15 @@ ZObject3dScan *ZDvidReader::readBody(
       result = new ZObject3dScan;
     }
 
-    ZDvidBufferReader &reader = m_bufferReader;
-
     //  reader.tryCompress(true);
     ZDvidUrl dvidUrl(getDvidTarget());
 
     if (labelType == flyem::EBodyLabelType::BODY) {
-      reader.read(dvidUrl.getSparsevolUrl(bodyId, minZ, maxZ, axis).c_str(),
-                  isVerbose());
+      readSparsevol(dvidUrl.getSparsevolUrl(bodyId, minZ, maxZ, axis), result);
     } else if (labelType == flyem::EBodyLabelType::SUPERVOXEL) {
-      reader.read(dvidUrl.getSupervoxelUrl(bodyId, minZ, maxZ, axis).c_str(),
-                  isVerbose());
+      readSparsevol(dvidUrl.getSupervoxelUrl(bodyId, minZ, maxZ, axis), result);
     }
 
-    const QByteArray &buffer = reader.getBuffer();
-    result->importDvidObjectBuffer(buffer.data(), buffer.size());
-    reader.clearBuffer();
-
     if (canonizing) {
       result->canonize();
     }
@@ -636,30 +713,23 @@ ZObject3dScan *ZDvidReader::readBody(
       }
     }
 
-    ZDvidBufferReader &reader = m_bufferReader;
-
     if (needPartition == false) {
       ZDvidUrl dvidUrl(getDvidTarget());
+      neutube::EReadStatus status = neutube::EReadStatus::NONE;
       switch (labelType) {
       case flyem::EBodyLabelType::BODY:
-        reader.read(dvidUrl.getSparsevolUrl(bodyId, box).c_str(),
-                    isVerbose());
+        status = readSparsevol(dvidUrl.getSparsevolUrl(bodyId, box), result);
         break;
       case flyem::EBodyLabelType::SUPERVOXEL:
-        reader.read(dvidUrl.getSupervoxelUrl(bodyId, box).c_str(),
-                    isVerbose());
+        status = readSparsevol(dvidUrl.getSupervoxelUrl(bodyId, box), result);
         break;
       }
 
-      if (reader.getStatus() != neutube::EReadStatus::FAILED) {
-        const QByteArray &buffer = reader.getBuffer();
-        result->importDvidObjectBuffer(buffer.data(), buffer.size());
-      } else {
+      if (status == neutube::EReadStatus::FAILED) {
         if (box.isEmpty()) {
           needPartition = true;
         }
       }
-      reader.clearBuffer();
     }
 
     if (needPartition) {
@@ -1015,16 +1085,15 @@ ZObject3dScan *ZDvidReader::readBody(
     QElapsedTimer timer;
     timer.start();
 
-    reader.read(dvidUrl.getSparsevolUrl(bodyId).c_str(), isVerbose());
+    neutube::EReadStatus status =
+        readSparsevol(dvidUrl.getSparsevolUrl(bodyId), result);
 
     reader.tryCompress(false);
 
     STD_COUT << "Body reading time: " << timer.elapsed() << std::endl;
 
-    if (reader.getStatus() != neutube::EReadStatus::FAILED) {
+    if (status != neutube::EReadStatus::FAILED) {
       timer.start();
-      const QByteArray &buffer = reader.getBuffer();
-      result->importDvidObjectBuffer(buffer.data(), buffer.size());
       if (canonizing) {
         result->canonize();
       }
@@ -1066,12 +1135,13 @@ ZObject3dScan *ZDvidReader::readBody(
     QElapsedTimer timer;
     timer.start();
 
+    neutube::EReadStatus status = neutube::EReadStatus::NONE;
     switch (labelType) {
     case flyem::EBodyLabelType::BODY:
-      reader.read(dvidUrl.getSparsevolUrl(bodyId).c_str(), isVerbose());
+      status = readSparsevol(dvidUrl.getSparsevolUrl(bodyId), result);
       break;
     case flyem::EBodyLabelType::SUPERVOXEL:
-      reader.read(dvidUrl.getSupervoxelUrl(bodyId).c_str(), isVerbose());
+      status = readSparsevol(dvidUrl.getSupervoxelUrl(bodyId), result);
       break;
     }
 
@@ -1079,10 +1149,8 @@ ZObject3dScan *ZDvidReader::readBody(
 
     STD_COUT << "Body reading time: " << timer.elapsed() << std::endl;
 
-    if (reader.getStatus() != neutube::EReadStatus::FAILED) {
+    if (status != neutube::EReadStatus::FAILED) {
       timer.start();
-      const QByteArray &buffer = reader.getBuffer();
-      result->importDvidObjectBuffer(buffer.data(), buffer.size());
       if (canonizing) {
         result->canonize();
       }
@@ -5018,20 +5086,47 @@ ZJsonObject ZDvidReader::readSynapseJson(int x, int y, int z) const
   return synapseJson;
 }
 
+template<typename T>
+std::vector<T> ZDvidReader::readAnnotation(
+    const std::string &url, flyem::EDvidAnnotationLoadMode mode) const
+{
+  std::vector<T> annotationArray;
+
+  for (int trial = 0; trial < 2; ++trial) {
+    QByteArray buffer = readBuffer(url);
+    ZDvidAnnotationDecoder decoder(buffer.constData(), buffer.size(), mode);
+    while (decoder.hasNext()) {
+      T annotation;
+      if (decoder.next(&annotation)) {
+        annotationArray.push_back(annotation);
+      }
+    }
+
+    if (!decoder.hasError()) {
+      return annotationArray;
+    }
+
+    LWARN() << "Failed to decode annotations from" << url;
+    annotationArray.clear();
+
+    //A malformed response is not going to change by reading it again, so
+    //only a failed transfer is retried.
+    neutube::EReadStatus status = m_bufferReader.getStatus();
+    if (status != neutube::EReadStatus::FAILED &&
+        status != neutube::EReadStatus::TIMEOUT) {
+      break;
+    }
+  }
+
+  return annotationArray;
+}
+
 std::vector<ZDvidSynapse> ZDvidReader::readSynapse(
     const ZIntCuboid &box, flyem::EDvidAnnotationLoadMode mode) const
 {
   ZDvidUrl dvidUrl(m_dvidTarget);
-  ZJsonArray obj = readJsonArray(dvidUrl.getSynapseUrl(box));
 
-  std::vector<ZDvidSynapse> synapseArray(obj.size());
-
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    synapseArray[i].loadJsonObject(synapseJson, mode);
-  }
-
-  return synapseArray;
+  return readAnnotation<ZDvidSynapse>(dvidUrl.getSynapseUrl(box), mode);
 }
 
 ZJsonArray ZDvidReader::readSynapseLabelsz(int n, ZDvid::ELabelIndexType index) const
@@ -5075,15 +5170,11 @@ std::vector<ZDvidSynapse> ZDvidReader::readSynapse(
 {
   ZDvidUrl dvidUrl(m_dvidTarget);
 
-  ZJsonArray obj = readJsonArray(
-        dvidUrl.getSynapseUrl(label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER));
-
-  std::vector<ZDvidSynapse> synapseArray(obj.size());
-
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    synapseArray[i].loadJsonObject(synapseJson, mode);
-    synapseArray[i].setBodyId(label);
+  std::vector<ZDvidSynapse> synapseArray = readAnnotation<ZDvidSynapse>(
+        dvidUrl.getSynapseUrl(label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER),
+        mode);
+  for (ZDvidSynapse &synapse : synapseArray) {
+    synapse.setBodyId(label);
   }
 
   return synapseArray;
@@ -5093,20 +5184,23 @@ std::vector<ZDvidSynapse> ZDvidReader::readSynapse(
     uint64_t label, const ZDvidRoi &roi,
     flyem::EDvidAnnotationLoadMode mode) const
 {
-  ZDvidUrl dvidUrl(m_dvidTarget);
+  std::vector<ZDvidSynapse> synapseArray;
 
-  ZJsonArray obj = readJsonArray(
-        dvidUrl.getSynapseUrl(label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER));
+  if (roi.isEmpty()) {
+    return synapseArray;
+  }
 
-  std::vector<ZDvidSynapse> synapseArray;
+  ZDvidUrl dvidUrl(m_dvidTarget);
 
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    ZIntPoint position = ZDvidAnnotation::GetPosition(synapseJson);
-    if (roi.contains(position)) {
-      synapseArray.resize(synapseArray.size() + 1);
-      synapseArray.back().loadJsonObject(synapseJson, mode);
-      synapseArray.back().setBodyId(label);
+  std::vector<ZDvidSynapse> bodySynapseArray = readAnnotation<ZDvidSynapse>(
+        dvidUrl.getSynapseUrl(label, mode != flyem::EDvidAnnotationLoadMode::NO_PARTNER),
+        mode);
+
+  std::shared_ptr<const ZRoiIndex> roiIndex = roi.getIndex();
+  for (ZDvidSynapse &synapse : bodySynapseArray) {
+    if (roiIndex->contains(synapse.getPosition())) {
+      synapse.setBodyId(label);
+      synapseArray.push_back(synapse);
     }
   }
 
@@ -5310,17 +5404,10 @@ std::vector<ZFlyEmToDoItem> ZDvidReader::readToDoItem(
     const ZIntCuboid &box) const
 {
   ZDvidUrl dvidUrl(getDvidTarget());
-  ZJsonArray obj = readJsonArray(dvidUrl.getTodoListUrl(box));
-
-  std::vector<ZFlyEmToDoItem> itemArray(obj.size());
-
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject itemJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    ZFlyEmToDoItem &item = itemArray[i];
-    item.loadJsonObject(itemJson, flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON);
-  }
 
-  return itemArray;
+  return readAnnotation<ZFlyEmToDoItem>(
+        dvidUrl.getTodoListUrl(box),
+        flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON);
 }
 
 ZFlyEmToDoItem ZDvidReader::readToDoItem(int x, int y, int z) const
@@ -181,10 +181,25 @@ public:
                              int zoom, const ZIntCuboid &box, bool canonizing,
                              ZObject3dScan *result) const;
 
+  /*!
+   * \brief Read a body slab by slab
+   *
+   * The body is split into Z slabs, which are read concurrently with at most
+   * getPartitionThreadCount() connections. Each slab is decoded in its reading
+   * thread and the slabs are concatenated in Z order.
+   */
   ZObject3dScan* readBodyWithPartition(uint64_t bodyId, ZObject3dScan *result) const;
   ZObject3dScan* readBodyWithPartition(
       uint64_t bodyId, flyem::EBodyLabelType labelType, ZObject3dScan *result) const;
 
+  /*!
+   * \brief Set the maximum number of slabs read at the same time
+   *
+   * Slabs are read one by one through the current connection if \a n <= 1.
+   */
+  void setPartitionThreadCount(int n) { m_partitionThreadCount = n; }
+  int getPartitionThreadCount() const { return m_partitionThreadCount; }
+
   /*!
    * \brief Read a body at a given scale
    *
@@ -559,6 +574,15 @@ public:
     return m_readingTime;
   }
 
+  /*!
+   * \brief Reading time (ms) of each slab in the last partitioned reading
+   *
+   * getReadingTime() gives the total time of the partitioned reading.
+   */
+  const std::vector<int64_t>& getPartitionReadingTime() const {
+    return m_partitionReadingTime;
+  }
+
   bool good() const;
 
   std::string readMasterNode() const;
@@ -659,6 +683,26 @@ private:
 
   void clearBuffer() const;
 
+  /*!
+   * \brief Read a sparsevol into \a result
+   *
+   * The response is decoded while it is being received, without going through
+   * the buffer of the reader. \a result is cleared if the reading fails.
+   */
+  neutube::EReadStatus readSparsevol(
+      const std::string &url, ZObject3dScan *result) const;
+
+  /*!
+   * \brief Read annotations of type \a T from \a url
+   *
+   * The response is read once more if it cannot be decoded completely, such
+   * as when it is truncated. An empty array is returned if it still fails, so
+   * a partial set of annotations is never returned.
+   */
+  template<typename T>
+  std::vector<T> readAnnotation(
+      const std::string &url, flyem::EDvidAnnotationLoadMode mode) const;
+
   static std::string GetMasterNodeFromBuffer(
       const ZDvidBufferReader &bufferReader);
   static std::vector<std::string> GetMasterListFromBuffer(
@@ -698,6 +742,8 @@ protected:
 
   mutable int m_statusCode;
   mutable int64_t m_readingTime;
+  mutable std::vector<int64_t> m_partitionReadingTime;
+  int m_partitionThreadCount = 4;
 
   mutable ZDvidBufferReader m_bufferReader;
 #if defined(_ENABLE_LIBDVIDCPP_)
@@ -13,6 +13,7 @@ void ZDvidRoi::clear()
 {
   m_roi.clear();
   m_blockSize.set(0, 0, 0);
+  m_index.reset();
 }
 
 void ZDvidRoi::setName(const std::string &name)
@@ -30,6 +31,7 @@ bool ZDvidRoi::isEmpty() const
 void ZDvidRoi::setBlockSize(const ZIntPoint &blockSize)
 {
   m_blockSize = blockSize;
+  m_index.reset();
 }
 
 void ZDvidRoi::setBlockSize(int s)
@@ -63,10 +65,39 @@ bool ZDvidRoi::contains(int x, int y, int z) const
     return false;
   }
 
-  x /= m_blockSize.getX();
-  y /= m_blockSize.getY();
-  z /= m_blockSize.getZ();
+  return getIndex()->contains(x, y, z);
+}
+
+std::vector<bool> ZDvidRoi::contains(
+    const std::vector<ZIntPoint> &ptArray) const
+{
+  if (isEmpty()) {
+    return std::vector<bool>(ptArray.size(), false);
+  }
 
-  return const_cast<ZObject3dScan&>(m_roi).contains(x, y, z);
+  return getIndex()->contains(ptArray);
 }
 
+size_t ZDvidRoi::countContained(const std::vector<ZIntPoint> &ptArray) const
+{
+  if (isEmpty()) {
+    return 0;
+  }
+
+  return getIndex()->countContained(ptArray);
+}
+
+std::shared_ptr<const ZRoiIndex> ZDvidRoi::getIndex() const
+{
+  std::shared_ptr<const ZRoiIndex> index = std::atomic_load(&m_index);
+  if (!index) {
+    //Threads racing here build the same index; only the first one is kept.
+    std::shared_ptr<const ZRoiIndex> newIndex =
+        std::make_shared<ZRoiIndex>(m_roi, m_blockSize);
+    if (std::atomic_compare_exchange_strong(&m_index, &index, newIndex)) {
+      index = newIndex;
+    }
+  }
+
+  return index;
+}
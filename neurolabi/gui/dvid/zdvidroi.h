@@ -1,16 +1,33 @@
 #ifndef ZDVIDROI_H
 #define ZDVIDROI_H
 
+#include <memory>
+#include <vector>
+
 #include "zobject3dscan.h"
+#include "zroiindex.h"
 #include "dvid/zdvidinfo.h"
 
+/*!
+ * \brief The class of a DVID ROI, which is defined in blocks
+ *
+ * Point queries go through a ZRoiIndex, which is built at the first query
+ * after the ROI or the block size changes. The const query functions are thread
+ * safe as long as the ROI is not modified at the same time.
+ */
 class ZDvidRoi
 {
 public:
   ZDvidRoi();
   ~ZDvidRoi();
 
+  /*!
+   * \brief Get the ROI object for modification
+   *
+   * It invalidates the query index.
+   */
   ZObject3dScan* getRoiRef() {
+    m_index.reset();
     return &m_roi;
   }
 
@@ -33,8 +50,27 @@ public:
   bool contains(int x, int y, int z) const;
   bool contains(const ZIntPoint &pt) const;
 
+  /*!
+   * \brief Test a batch of points
+   *
+   * \return A boolean array, the ith element of which is true iff
+   *         \a ptArray[i] is in the ROI.
+   */
+  std::vector<bool> contains(const std::vector<ZIntPoint> &ptArray) const;
+
+  size_t countContained(const std::vector<ZIntPoint> &ptArray) const;
+
+  /*!
+   * \brief Get the query index of the ROI
+   *
+   * The returned index remains valid after the ROI is modified, but it does not
+   * reflect the modification.
+   */
+  std::shared_ptr<const ZRoiIndex> getIndex() const;
+
 private:
   ZObject3dScan m_roi;
+  mutable std::shared_ptr<const ZRoiIndex> m_index; //Accessed atomically
   ZIntPoint m_blockSize;
   std::string m_name;
 };
@@ -0,0 +1,216 @@
+#ifndef ZDVIDSLICECACHE_H
+#define ZDVIDSLICECACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+
+#include <QRect>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "neutube_def.h"
+
+/*!
+ * \brief The class of caching DVID slice data within a byte budget
+ *
+ * A slice is identified by its axis, z, zoom level, viewport and center cut,
+ * which are all the parameters of reading the slice. It is used for keeping
+ * prefetched slices, so that a slice can be shown without accessing DVID
+ * again. The least recently used slices are removed when the total size
+ * exceeds the byte budget.
+ *
+ * All functions are thread safe. The cached data are shared by std::shared_ptr
+ * and must not be modified.
+ *
+ * The version of the cache is increased every time it is cleared. Data read
+ * before clearing can be discarded by adding them with the version obtained
+ * before reading.
+ */
+template <typename T>
+class ZDvidSliceCache
+{
+public:
+  struct Key {
+    Key() {}
+    Key(neutube::EAxis axis, int z, int zoom, const QRect &viewPort,
+        int centerCutWidth, int centerCutHeight, bool usingCenterCut) :
+      axis(axis), z(z), zoom(zoom), viewPort(viewPort),
+      centerCutWidth(centerCutWidth), centerCutHeight(centerCutHeight),
+      usingCenterCut(usingCenterCut) {
+      if (!usingCenterCut) { //The center cut size does not matter
+        this->centerCutWidth = 0;
+        this->centerCutHeight = 0;
+      }
+    }
+
+    bool operator< (const Key &key) const {
+      return std::make_tuple(
+            neutube::EnumValue(axis), z, zoom, viewPort.left(), viewPort.top(),
+            viewPort.width(), viewPort.height(), centerCutWidth,
+            centerCutHeight, usingCenterCut) <
+          std::make_tuple(
+            neutube::EnumValue(key.axis), key.z, key.zoom, key.viewPort.left(),
+            key.viewPort.top(), key.viewPort.width(), key.viewPort.height(),
+            key.centerCutWidth, key.centerCutHeight, key.usingCenterCut);
+    }
+
+    neutube::EAxis axis = neutube::EAxis::Z;
+    int z = 0;
+    int zoom = 0;
+    QRect viewPort;
+    int centerCutWidth = 0;
+    int centerCutHeight = 0;
+    bool usingCenterCut = false;
+  };
+
+  ZDvidSliceCache() {}
+
+  void setByteBudget(size_t byteCount) {
+    QMutexLocker locker(&m_mutex);
+    m_byteBudget = byteCount;
+    evictUnsync();
+  }
+
+  size_t getByteCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_byteCount;
+  }
+
+  size_t size() const {
+    QMutexLocker locker(&m_mutex);
+    return m_entryList.size();
+  }
+
+  /*!
+   * \brief Add slice data to the cache
+   *
+   * The cache takes the ownership of \a data, which is counted as
+   * \a byteCount bytes. An existing slice with the same key is replaced. The
+   * data are not kept if they are larger than the byte budget.
+   *
+   * \return The shared data, which are valid even if they are not kept.
+   */
+  std::shared_ptr<const T> add(const Key &key, T *data, size_t byteCount) {
+    QMutexLocker locker(&m_mutex);
+
+    return addUnsync(key, data, byteCount);
+  }
+
+  /*!
+   * \brief Add slice data read at a certain version of the cache
+   *
+   * \a data are discarded if the cache has been cleared since \a version.
+   */
+  std::shared_ptr<const T> add(
+      const Key &key, T *data, size_t byteCount, uint64_t version) {
+    QMutexLocker locker(&m_mutex);
+
+    if (version != m_version) {
+      delete data;
+      return std::shared_ptr<const T>();
+    }
+
+    return addUnsync(key, data, byteCount);
+  }
+
+  /*!
+   * \brief Get the slice data with \a key
+   *
+   * The slice becomes the most recently used one.
+   *
+   * \return An empty pointer if there is no slice with \a key.
+   */
+  std::shared_ptr<const T> get(const Key &key) {
+    QMutexLocker locker(&m_mutex);
+
+    auto mapIter = m_entryMap.find(key);
+    if (mapIter == m_entryMap.end()) {
+      return std::shared_ptr<const T>();
+    }
+
+    m_entryList.splice(m_entryList.begin(), m_entryList, mapIter->second);
+
+    return mapIter->second->data;
+  }
+
+  bool contains(const Key &key) const {
+    QMutexLocker locker(&m_mutex);
+    return m_entryMap.count(key) > 0;
+  }
+
+  void clear() {
+    QMutexLocker locker(&m_mutex);
+    m_entryList.clear();
+    m_entryMap.clear();
+    m_byteCount = 0;
+    ++m_version;
+  }
+
+  uint64_t getVersion() const {
+    QMutexLocker locker(&m_mutex);
+    return m_version;
+  }
+
+private:
+  struct Entry {
+    Key key;
+    std::shared_ptr<const T> data;
+    size_t byteCount = 0;
+  };
+
+  typedef std::list<Entry> TEntryList;
+
+  std::shared_ptr<const T> addUnsync(const Key &key, T *data, size_t byteCount) {
+    std::shared_ptr<const T> sharedData(data);
+    if (data == NULL) {
+      return sharedData;
+    }
+
+    auto mapIter = m_entryMap.find(key);
+    if (mapIter != m_entryMap.end()) {
+      removeUnsync(mapIter->second);
+    }
+
+    if (byteCount <= m_byteBudget) {
+      Entry entry;
+      entry.key = key;
+      entry.data = sharedData;
+      entry.byteCount = byteCount;
+      m_entryList.push_front(entry);
+      m_entryMap[key] = m_entryList.begin();
+      m_byteCount += byteCount;
+
+      evictUnsync();
+    }
+
+    return sharedData;
+  }
+
+  void removeUnsync(typename TEntryList::iterator iter) {
+    m_byteCount -= iter->byteCount;
+    m_entryMap.erase(iter->key);
+    m_entryList.erase(iter);
+  }
+
+  void evictUnsync() {
+    while (m_byteCount > m_byteBudget && !m_entryList.empty()) {
+      removeUnsync(std::prev(m_entryList.end()));
+    }
+  }
+
+private:
+  //From the most recently used to the least recently used
+  TEntryList m_entryList;
+  std::map<Key, typename TEntryList::iterator> m_entryMap;
+  size_t m_byteBudget = size_t(256) * 1024 * 1024;
+  size_t m_byteCount = 0;
+  uint64_t m_version = 0;
+  mutable QMutex m_mutex;
+};
+
+#endif // ZDVIDSLICECACHE_H
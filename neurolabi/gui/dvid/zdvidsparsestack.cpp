@@ -11,6 +11,7 @@
 #include "c_stack.h"
 #include "zstack.hxx"
 #include "zobject3dscan.h"
+#include "zdvidgrayscaleblockfetcher.h"
 
 ZDvidSparseStack::ZDvidSparseStack()
 {
@@ -314,6 +315,22 @@ void ZDvidSparseStack::cancelFillValueSync()
   }
 }
 
+void ZDvidSparseStack::prepareFetcher(
+    ZDvidGrayscaleBlockFetcher *fetcher, const ZIntCuboid &box,
+    bool cancelable) const
+{
+  fetcher->setDvidInfo(m_grayscaleInfo);
+  fetcher->setThreadCount(m_fetchThreadCount);
+  if (!box.isEmpty()) {
+    fetcher->setBlockRange(
+          ZIntCuboid(m_grayscaleInfo.getBlockIndex(box.getFirstCorner()),
+                     m_grayscaleInfo.getBlockIndex(box.getLastCorner())));
+  }
+  if (cancelable) {
+    fetcher->setCancelFunc([this]() { return m_cancelingValueFill.load(); });
+  }
+}
+
 void ZDvidSparseStack::runFillValueFunc(
     const ZIntCuboid &box, bool syncing, bool cont)
 {
@@ -386,98 +403,18 @@ bool ZDvidSparseStack::fillValue(
       ZObject3dScan blockObj = m_grayscaleInfo.getBlockIndex(*objMask);
       ZStackBlockGrid *grid = m_sparseStack.getStackGrid();
 
-      size_t stripeNumber = blockObj.getStripeNumber();
-      ZIntCuboid blockBox;
-      blockBox.setFirstCorner(
-            m_grayscaleInfo.getBlockIndex(box.getFirstCorner()));
-      blockBox.setLastCorner(
-            m_grayscaleInfo.getBlockIndex(box.getLastCorner()));
-
 #ifdef _DEBUG_2
       objMask->save(GET_TEST_DATA_DIR + "/test.sobj");
       blockObj.save(GET_TEST_DATA_DIR + "/test2.sobj");
 #endif
 
-      for (size_t s = 0; s < stripeNumber; ++s) {
-#ifdef _DEBUG_
-        std::cout << s << "/" << stripeNumber << std::endl;
-#endif
-
-        const ZObject3dStripe &stripe = blockObj.getStripe(s);
-        int segmentNumber = stripe.getSegmentNumber();
-        int y = stripe.getY();
-        int z = stripe.getZ();
-        for (int i = 0; i < segmentNumber; ++i) {
-#ifdef _DEBUG_2
-        std::cout << "seg:" << i << "/" << segmentNumber << std::endl;
-#endif
-          int x0 = stripe.getSegmentStart(i);
-          int x1 = stripe.getSegmentEnd(i);
-
-          std::vector<int> blockSpan;
-          ZIntPoint blockIndex =
-              ZIntPoint(x0, y, z);// - m_grayscaleInfo.getStartBlockIndex();
-          for (int x = x0; x <= x1; ++x) {
-            bool isValidBlock = true;
-            if (!box.isEmpty()) {
-              isValidBlock = blockBox.contains(x, y, z);
-            }
-
-            if (isValidBlock) {
-              if (grid->getStack(blockIndex) == NULL) {
-                if (blockSpan.empty())  {
-                  blockSpan.push_back(x);
-                  blockSpan.push_back(x);
-                } else if (x - blockSpan.back() == 1) {
-                  blockSpan.back() = x;
-                } else {
-                  blockSpan.push_back(x);
-                  blockSpan.push_back(x);
-                }
-              }
-            }
-            blockIndex.setX(blockIndex.getX() + 1);
-          }
-
-          for (size_t i = 0; i < blockSpan.size(); i += 2) {
-            if (cancelable && m_cancelingValueFill) {
-    //          m_cancelingValueFill = false;
-              setCancelFillValue(false);
-              ZOUT(LTRACE(), 5) << "Grayscale fetching canceled";
-              return blockCount > 0;
-            }
-
-#ifdef _DEBUG_
-        std::cout << "block:" << i << "/" << blockSpan.size() << std::endl;
-#endif
-            blockIndex.setX(blockSpan[i]);
-            int blockNumber = blockSpan[i + 1] - blockSpan[i] + 1;
-            ZOUT(LTRACE(), 5) << "Reading" << blockNumber << "blocks";
-#ifdef _DEBUG_2
-        std::cout << "Reading" << blockNumber << "blocks" << std::endl;
-#endif
-            std::vector<ZStack*> stackArray = reader.readGrayScaleBlock(
-                  blockIndex, m_grayscaleInfo, blockNumber);
-#ifdef _DEBUG_2
-        std::cout << "Reading" << blockNumber << "blocks done" << std::endl;
-#endif
-            grid->consumeStack(blockIndex, stackArray);
-            blockCount += stackArray.size();
-
-#ifdef _DEBUG_2
-        std::cout << "Reading" << blockNumber << "blocks done" << std::endl;
-#endif
-#if 0
-                ZIntCuboid box = grid->getBlockBox(blockIndex);
-                ZStack *stack = m_dvidReader.readGrayScale(box);
-                grid->consumeStack(blockIndex, stack);
-                ++blockCount;
-                //              changed = true;
-              }
-            }
-#endif
-          }
-        }
+      ZDvidGrayscaleBlockFetcher fetcher;
+      prepareFetcher(&fetcher, box, cancelable);
+      blockCount = fetcher.fetch(reader, blockObj, grid);
+      if (fetcher.isCanceled()) {
+        setCancelFillValue(false);
+        ZOUT(LTRACE(), 5) << "Grayscale fetching canceled";
+        return blockCount > 0;
       }
       //    ptoc();
 
@@ -551,99 +488,19 @@ bool ZDvidSparseStack::fillValue(
 
       ZStackBlockGrid *grid = new ZStackBlockGrid;
 
-      size_t stripeNumber = blockObj.getStripeNumber();
-      ZIntCuboid blockBox;
-      blockBox.setFirstCorner(
-            m_grayscaleInfo.getBlockIndex(box.getFirstCorner()));
-      blockBox.setLastCorner(
-            m_grayscaleInfo.getBlockIndex(box.getLastCorner()));
-
-
 #ifdef _DEBUG_2
       objMask->save(GET_TEST_DATA_DIR + "/test.sobj");
       blockObj.save(GET_TEST_DATA_DIR + "/test2.sobj");
 #endif
 
-      for (size_t s = 0; s < stripeNumber; ++s) {
-#ifdef _DEBUG_
-        std::cout << s << "/" << stripeNumber << std::endl;
-#endif
-
-        const ZObject3dStripe &stripe = blockObj.getStripe(s);
-        int segmentNumber = stripe.getSegmentNumber();
-        int y = stripe.getY();
-        int z = stripe.getZ();
-        for (int i = 0; i < segmentNumber; ++i) {
-#ifdef _DEBUG_2
-        std::cout << "seg:" << i << "/" << segmentNumber << std::endl;
-#endif
-          int x0 = stripe.getSegmentStart(i);
-          int x1 = stripe.getSegmentEnd(i);
-
-          std::vector<int> blockSpan;
-          ZIntPoint blockIndex =
-              ZIntPoint(x0, y, z);// - m_grayscaleInfo.getStartBlockIndex();
-          for (int x = x0; x <= x1; ++x) {
-            bool isValidBlock = true;
-            if (!box.isEmpty()) {
-              isValidBlock = blockBox.contains(x, y, z);
-            }
-
-            if (isValidBlock) {
-              if (grid->getStack(blockIndex) == NULL) {
-                if (blockSpan.empty())  {
-                  blockSpan.push_back(x);
-                  blockSpan.push_back(x);
-                } else if (x - blockSpan.back() == 1) {
-                  blockSpan.back() = x;
-                } else {
-                  blockSpan.push_back(x);
-                  blockSpan.push_back(x);
-                }
-              }
-            }
-            blockIndex.setX(blockIndex.getX() + 1);
-          }
-
-          for (size_t i = 0; i < blockSpan.size(); i += 2) {
-            if (cancelable && m_cancelingValueFill) {
-    //          m_cancelingValueFill = false;
-              setCancelFillValue(false);
-              ZOUT(LTRACE(), 5) << "Grayscale fetching canceled";
-              return blockCount > 0;
-            }
-
-#ifdef _DEBUG_
-        std::cout << "block:" << i << "/" << blockSpan.size() << std::endl;
-#endif
-            blockIndex.setX(blockSpan[i]);
-            int blockNumber = blockSpan[i + 1] - blockSpan[i] + 1;
-            ZOUT(LTRACE(), 5) << "Reading" << blockNumber << "blocks";
-#ifdef _DEBUG_2
-        std::cout << "Reading" << blockNumber << "blocks" << std::endl;
-#endif
-            std::vector<ZStack*> stackArray = reader.readGrayScaleBlock(
-                  blockIndex, m_grayscaleInfo, blockNumber, zoom);
-#ifdef _DEBUG_2
-        std::cout << "Reading" << blockNumber << "blocks done" << std::endl;
-#endif
-            grid->consumeStack(blockIndex, stackArray);
-            blockCount += stackArray.size();
-
-#ifdef _DEBUG_2
-        std::cout << "Reading" << blockNumber << "blocks done" << std::endl;
-#endif
-#if 0
-                ZIntCuboid box = grid->getBlockBox(blockIndex);
-                ZStack *stack = m_dvidReader.readGrayScale(box);
-                grid->consumeStack(blockIndex, stack);
-                ++blockCount;
-                //              changed = true;
-              }
-            }
-#endif
-          }
-        }
+      ZDvidGrayscaleBlockFetcher fetcher;
+      prepareFetcher(&fetcher, box, cancelable);
+      blockCount = fetcher.fetch(reader, blockObj, grid, zoom);
+      if (fetcher.isCanceled()) {
+        delete grid;
+        setCancelFillValue(false);
+        ZOUT(LTRACE(), 5) << "Grayscale fetching canceled";
+        return blockCount > 0;
       }
 
       if (grid != NULL) {
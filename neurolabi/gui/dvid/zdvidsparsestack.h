@@ -1,6 +1,8 @@
 #ifndef ZDVIDSPARSESTACK_H
 #define ZDVIDSPARSESTACK_H
 
+#include <atomic>
+
 #include <QMutex>
 #include <QMap>
 
@@ -11,6 +13,7 @@
 #include "zthreadfuturemap.h"
 
 class ZIntCuboid;
+class ZDvidGrayscaleBlockFetcher;
 
 class ZDvidSparseStack : public ZStackObject
 {
@@ -140,6 +143,15 @@ public:
   bool fillValue(const ZIntCuboid &box, int zoom,
                  bool cancelable, bool fillingAll);
 
+  /*!
+   * \brief Set the number of grayscale requests in flight
+   *
+   * Missing blocks are downloaded through \a n connections and put into the
+   * block grid as soon as they arrive. \a n <= 1 downloads all blocks through
+   * the grayscale reader of the object.
+   */
+  void setFetchThreadCount(int n) { m_fetchThreadCount = n; }
+
 private:
   void init();
   void initBlockGrid();
@@ -158,6 +170,9 @@ private:
   ZDvidReader& getMaskReader() const;
   ZDvidReader& getGrayscaleReader() const;
 
+  void prepareFetcher(ZDvidGrayscaleBlockFetcher *fetcher,
+                      const ZIntCuboid &box, bool cancelable) const;
+
   /*
   void assignStackValue(ZStack *stack, const ZObject3dScan &obj,
                                const ZStackBlockGrid &stackGrid);
@@ -177,7 +192,8 @@ private:
   mutable ZDvidInfo m_grayscaleInfo;
 
   ZThreadFutureMap m_futureMap;
-  bool m_cancelingValueFill;
+  std::atomic<bool> m_cancelingValueFill;
+  int m_fetchThreadCount = 4;
 
   mutable QMutex m_fillValueMutex;
 };
@@ -0,0 +1,214 @@
+#include "zdvidsparsevoldecoder.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "zerror.h"
+#include "zobject3dscan.h"
+#include "zobject3dstripe.h"
+
+const size_t ZDvidSparsevolDecoder::HEADER_SIZE = 12;
+const size_t ZDvidSparsevolDecoder::SPAN_SIZE = 16;
+
+ZDvidSparsevolDecoder::ZDvidSparsevolDecoder(ZObject3dScan *result)
+{
+  setResult(result);
+}
+
+void ZDvidSparsevolDecoder::setResult(ZObject3dScan *result)
+{
+  m_result = result;
+  reset();
+}
+
+void ZDvidSparsevolDecoder::reset()
+{
+  m_state = STATE_HEADER;
+  m_spanNumber = 0;
+  m_decodedSpanNumber = 0;
+  m_sorted = true;
+  m_carrySize = 0;
+  m_transposeBuffer.clear();
+
+  if (m_result != NULL) {
+    m_result->clear();
+    m_sliceAxis = m_result->getSliceAxis();
+  }
+}
+
+void ZDvidSparsevolDecoder::setError(const char *msg)
+{
+  RECORD_ERROR_UNCOND(msg);
+  m_state = STATE_ERROR;
+}
+
+size_t ZDvidSparsevolDecoder::getUnitSize() const
+{
+  return (m_state == STATE_HEADER) ? HEADER_SIZE : SPAN_SIZE;
+}
+
+void ZDvidSparsevolDecoder::decodeHeader(const char *data)
+{
+  //Layout: flag, #dimensions, run dimension, reserved, #voxels, #spans
+  if (data[1] != 3) {
+    setError("Current version only supports 3D");
+    return;
+  }
+
+  if (data[2] != 0) {
+    setError("Unspported run dimension");
+    return;
+  }
+
+  memcpy(&m_spanNumber, data + 8, sizeof(m_spanNumber));
+
+  if (m_spanNumber > 0) {
+    if (m_sliceAxis == neutube::EAxis::X) {
+      m_transposeBuffer.reserve(m_spanNumber);
+    } else if (m_result != NULL) {
+      //Most bodies have only a few spans per stripe
+      m_result->getStripeArray().reserve(m_spanNumber / 2 + 1);
+    }
+    m_state = STATE_SPAN;
+  } else {
+    m_state = STATE_DONE;
+  }
+}
+
+void ZDvidSparsevolDecoder::appendSegment(int z, int y, int x0, int x1)
+{
+  std::vector<ZObject3dStripe> &stripeArray = m_result->getStripeArray();
+
+  if (stripeArray.empty() || stripeArray.back().getZ() != z ||
+      stripeArray.back().getY() != y) {
+    if (!stripeArray.empty()) {
+      const ZObject3dStripe &lastStripe = stripeArray.back();
+      if (z < lastStripe.getZ() ||
+          (z == lastStripe.getZ() && y < lastStripe.getY())) {
+        m_sorted = false;
+      }
+    }
+    stripeArray.resize(stripeArray.size() + 1);
+    stripeArray.back().setZ(z);
+    stripeArray.back().setY(y);
+  }
+
+  ZObject3dStripe &stripe = stripeArray.back();
+  std::vector<int> &segmentArray = stripe.getSegmentArray();
+  if (!segmentArray.empty() && x0 <= segmentArray.back() + 1) {
+    if (x0 >= segmentArray[segmentArray.size() - 2]) {
+      segmentArray.back() = std::max(segmentArray.back(), x1);
+      return;
+    }
+    stripe.setCanonized(false);
+    m_sorted = false;
+  }
+
+  segmentArray.push_back(x0);
+  segmentArray.push_back(x1);
+}
+
+void ZDvidSparsevolDecoder::decodeSpan(const char *data)
+{
+  int32_t value[4];
+  memcpy(value, data, SPAN_SIZE);
+
+  int runLength = value[3];
+  if (runLength <= 0) {
+    setError("Invalid run length");
+    return;
+  }
+
+  if (m_result != NULL) {
+    switch (m_sliceAxis) {
+    case neutube::EAxis::X:
+      //Each voxel of the run goes to a different slice
+      for (int i = 0; i < runLength; ++i) {
+        m_transposeBuffer.addSegment(
+              value[0] + i, value[1], value[2], value[2], false);
+      }
+      break;
+    case neutube::EAxis::Y:
+      appendSegment(value[1], value[2], value[0], value[0] + runLength - 1);
+      break;
+    default:
+      appendSegment(value[2], value[1], value[0], value[0] + runLength - 1);
+      break;
+    }
+  }
+
+  if (++m_decodedSpanNumber == m_spanNumber) {
+    m_state = STATE_DONE;
+  }
+}
+
+void ZDvidSparsevolDecoder::decodeUnit(const char *data)
+{
+  switch (m_state) {
+  case STATE_HEADER:
+    decodeHeader(data);
+    break;
+  case STATE_SPAN:
+    decodeSpan(data);
+    break;
+  default:
+    break;
+  }
+}
+
+bool ZDvidSparsevolDecoder::consume(const char *data, size_t length)
+{
+  if (data == NULL) {
+    return !hasError();
+  }
+
+  while (length > 0 && (m_state == STATE_HEADER || m_state == STATE_SPAN)) {
+    size_t unitSize = getUnitSize();
+    if (m_carrySize > 0 || length < unitSize) {
+      //Complete the unit split across chunks
+      size_t n = std::min(unitSize - m_carrySize, length);
+      memcpy(m_carry + m_carrySize, data, n);
+      m_carrySize += n;
+      data += n;
+      length -= n;
+      if (m_carrySize == unitSize) {
+        m_carrySize = 0;
+        decodeUnit(m_carry);
+      }
+    } else if (m_state == STATE_SPAN) {
+      size_t spanCount = std::min(
+            length / SPAN_SIZE, size_t(m_spanNumber - m_decodedSpanNumber));
+      for (size_t i = 0; i < spanCount && m_state == STATE_SPAN; ++i) {
+        decodeSpan(data);
+        data += SPAN_SIZE;
+        length -= SPAN_SIZE;
+      }
+    } else {
+      decodeUnit(data);
+      data += unitSize;
+      length -= unitSize;
+    }
+  }
+
+  return !hasError();
+}
+
+bool ZDvidSparsevolDecoder::finish()
+{
+  if (m_state == STATE_HEADER || m_state == STATE_SPAN) {
+    setError("Buffer ended prematurely.");
+  }
+
+  if (m_result != NULL) {
+    if (m_sliceAxis == neutube::EAxis::X) {
+      m_transposeBuffer.canonize();
+      m_transposeBuffer.toObject3dScan(m_result);
+      m_transposeBuffer.clear();
+    } else {
+      m_result->deprecate(ZObject3dScan::COMPONENT_ALL);
+      m_result->setCanonized(m_sorted);
+    }
+  }
+
+  return isComplete();
+}
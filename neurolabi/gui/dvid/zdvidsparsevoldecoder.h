@@ -0,0 +1,97 @@
+#ifndef ZDVIDSPARSEVOLDECODER_H
+#define ZDVIDSPARSEVOLDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "neutube_def.h"
+#include "zobject3dflatscan.h"
+
+class ZObject3dScan;
+
+/*!
+ * \brief The class of decoding a DVID sparsevol stream into an RLE object
+ *
+ * The decoder accepts the payload (see ZObject3dScan::importDvidObject for the
+ * format) in arbitrary chunks, so that it can be fed while a response is still
+ * arriving. Spans are appended to the stripe array of the target object
+ * directly. Since DVID sends spans in ZYX order, the object is normally
+ * canonized once the last span is decoded and no extra canonize pass is needed.
+ *
+ * Usage:
+ *   ZDvidSparsevolDecoder decoder(&obj);
+ *   decoder.consume(data1, n1);
+ *   decoder.consume(data2, n2);
+ *   ...
+ *   decoder.finish();
+ */
+class ZDvidSparsevolDecoder
+{
+public:
+  explicit ZDvidSparsevolDecoder(ZObject3dScan *result = NULL);
+
+  /*!
+   * \brief Set the object to decode into
+   *
+   * \a result is cleared and its slice axis determines how spans are mapped,
+   * the same as ZObject3dScan::importDvidObjectBuffer.
+   */
+  void setResult(ZObject3dScan *result);
+
+  void reset();
+
+  /*!
+   * \brief Decode a chunk of the payload
+   *
+   * \return false iff the payload is invalid. Once it fails, the following
+   *         chunks are ignored.
+   */
+  bool consume(const char *data, size_t length);
+
+  /*!
+   * \brief Finalize the result object
+   *
+   * \return true iff the payload is complete and valid. The spans decoded
+   *         before an error are kept in the result, as
+   *         ZObject3dScan::importDvidObjectBuffer does.
+   */
+  bool finish();
+
+  bool hasError() const { return m_state == STATE_ERROR; }
+  bool isComplete() const { return m_state == STATE_DONE; }
+
+  uint32_t getSpanNumber() const { return m_spanNumber; }
+  uint32_t getDecodedSpanNumber() const { return m_decodedSpanNumber; }
+
+  static const size_t HEADER_SIZE;
+  static const size_t SPAN_SIZE;
+
+private:
+  enum EState {
+    STATE_HEADER, STATE_SPAN, STATE_DONE, STATE_ERROR
+  };
+
+  size_t getUnitSize() const;
+  void decodeUnit(const char *data);
+  void decodeHeader(const char *data);
+  void decodeSpan(const char *data);
+  void appendSegment(int z, int y, int x0, int x1);
+  void setError(const char *msg);
+
+private:
+  ZObject3dScan *m_result = NULL;
+  neutube::EAxis m_sliceAxis = neutube::EAxis::Z;
+  EState m_state = STATE_HEADER;
+  uint32_t m_spanNumber = 0;
+  uint32_t m_decodedSpanNumber = 0;
+  bool m_sorted = true;
+
+  char m_carry[16]; //Partial unit left from the previous chunk
+  size_t m_carrySize = 0;
+
+  //Runs along X become single voxels in the X-axis view, so they are
+  //collected and sorted here before going into the result.
+  ZObject3dFlatScan m_transposeBuffer;
+};
+
+#endif // ZDVIDSPARSEVOLDECODER_H
@@ -67,19 +67,14 @@ ZIntCuboid ZDvidSynapseEnsemble::updateUnsync(const ZIntCuboid &box)
   }
 
   if (!dataBox.isEmpty()) {
-    ZDvidUrl dvidUrl(m_dvidTarget);
     QElapsedTimer timer;
     timer.start();
-    ZJsonArray obj = m_reader.readJsonArray(dvidUrl.getSynapseUrl(dataBox));
+    std::vector<ZDvidSynapse> synapseArray = m_reader.readSynapse(
+          dataBox, flyem::EDvidAnnotationLoadMode::NO_PARTNER);
     LINFO() << "Synapse reading time: " << timer.elapsed();
 
-    for (size_t i = 0; i < obj.size(); ++i) {
-      ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-      if (synapseJson.hasKey("Pos")) {
-        ZDvidSynapse synapse;
-        synapse.loadJsonObject(synapseJson, flyem::EDvidAnnotationLoadMode::NO_PARTNER);
-        addSynapseUnsync(synapse, DATA_LOCAL);
-      }
+    for (const ZDvidSynapse &synapse : synapseArray) {
+      addSynapseUnsync(synapse, DATA_LOCAL);
     }
   }
 
@@ -327,13 +322,12 @@ bool ZDvidSynapseEnsemble::isReady() const
 
 void ZDvidSynapseEnsemble::downloadForLabelUnsync(uint64_t label)
 {
-  ZDvidUrl dvidUrl(m_dvidTarget);
-  ZJsonArray obj = m_reader.readJsonArray(dvidUrl.getSynapseUrl(label, false));
+  //The response has no relations, as requested through
+  //ZDvidUrl::getSynapseUrl(label, false)
+  std::vector<ZDvidSynapse> synapseArray = m_reader.readSynapse(
+        label, flyem::EDvidAnnotationLoadMode::NO_PARTNER);
 
-  for (size_t i = 0; i < obj.size(); ++i) {
-    ZJsonObject synapseJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-    ZDvidSynapse synapse;
-    synapse.loadJsonObject(synapseJson, flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION);
+  for (const ZDvidSynapse &synapse : synapseArray) {
     if (synapse.isValid()) {
       addSynapse(synapse, DATA_LOCAL);
     }
@@ -0,0 +1,33 @@
+#include "zdvidgraysliceprefetchtask.h"
+#include "zflyemproofdoc.h"
+
+ZDvidGraySlicePrefetchTask::ZDvidGraySlicePrefetchTask(QObject *parent) :
+  ZDvidDataSliceTask(parent)
+{
+}
+
+void ZDvidGraySlicePrefetchTask::setSliceArray(
+    const std::vector<int> &sliceArray)
+{
+  m_sliceArray = sliceArray;
+}
+
+void ZDvidGraySlicePrefetchTask::setCache(
+    const std::shared_ptr<ZDvidSliceCache<ZStack> > &cache)
+{
+  m_cache = cache;
+  if (m_cache) {
+    m_cacheVersion = m_cache->getVersion();
+  }
+}
+
+void ZDvidGraySlicePrefetchTask::execute()
+{
+  ZFlyEmProofDoc *doc = qobject_cast<ZFlyEmProofDoc*>(m_doc);
+  if (doc != NULL && m_cache) {
+    doc->prefetchDvidGraySlice(
+          m_cache.get(), m_cacheVersion, m_viewParam.getViewPort(),
+          m_sliceArray, m_zoom, m_centerCutWidth, m_centerCutHeight,
+          m_usingCenterCut);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef ZDVIDGRAYSLICEPREFETCHTASK_H
+#define ZDVIDGRAYSLICEPREFETCHTASK_H
+
+#include <vector>
+#include <memory>
+
+#include "zdviddataslicetask.h"
+#include "dvid/zdvidslicecache.h"
+
+class ZStack;
+
+class ZDvidGraySlicePrefetchTask : public ZDvidDataSliceTask
+{
+  Q_OBJECT
+public:
+  explicit ZDvidGraySlicePrefetchTask(QObject *parent = nullptr);
+
+  void execute();
+
+  void setSliceArray(const std::vector<int> &sliceArray);
+
+  /*!
+   * \brief Set the cache to fill.
+   *
+   * Slices read after the cache is cleared are discarded.
+   */
+  void setCache(const std::shared_ptr<ZDvidSliceCache<ZStack> > &cache);
+
+signals:
+
+public slots:
+
+private:
+  std::vector<int> m_sliceArray;
+  std::shared_ptr<ZDvidSliceCache<ZStack> > m_cache;
+  uint64_t m_cacheVersion = 0;
+};
+
+#endif // ZDVIDGRAYSLICEPREFETCHTASK_H
@@ -0,0 +1,33 @@
+#include "zdvidlabelsliceprefetchtask.h"
+#include "zflyemproofdoc.h"
+
+ZDvidLabelSlicePrefetchTask::ZDvidLabelSlicePrefetchTask(QObject *parent) :
+  ZDvidDataSliceTask(parent)
+{
+}
+
+void ZDvidLabelSlicePrefetchTask::setSliceArray(
+    const std::vector<int> &sliceArray)
+{
+  m_sliceArray = sliceArray;
+}
+
+void ZDvidLabelSlicePrefetchTask::setCache(
+    const std::shared_ptr<ZDvidSliceCache<ZArray> > &cache)
+{
+  m_cache = cache;
+  if (m_cache) {
+    m_cacheVersion = m_cache->getVersion();
+  }
+}
+
+void ZDvidLabelSlicePrefetchTask::execute()
+{
+  ZFlyEmProofDoc *doc = qobject_cast<ZFlyEmProofDoc*>(m_doc);
+  if (doc != NULL && m_cache) {
+    doc->prefetchDvidLabelSlice(
+          m_cache.get(), m_cacheVersion, m_viewParam.getViewPort(),
+          m_sliceArray, m_zoom, m_centerCutWidth, m_centerCutHeight,
+          m_usingCenterCut);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef ZDVIDLABELSLICEPREFETCHTASK_H
+#define ZDVIDLABELSLICEPREFETCHTASK_H
+
+#include <vector>
+#include <memory>
+
+#include "zdviddataslicetask.h"
+#include "dvid/zdvidslicecache.h"
+
+class ZArray;
+
+class ZDvidLabelSlicePrefetchTask : public ZDvidDataSliceTask
+{
+  Q_OBJECT
+public:
+  explicit ZDvidLabelSlicePrefetchTask(QObject *parent = nullptr);
+
+  void execute();
+
+  void setSliceArray(const std::vector<int> &sliceArray);
+
+  /*!
+   * \brief Set the cache to fill.
+   *
+   * Slices read after the cache is cleared are discarded.
+   */
+  void setCache(const std::shared_ptr<ZDvidSliceCache<ZArray> > &cache);
+
+signals:
+
+public slots:
+
+private:
+  std::vector<int> m_sliceArray;
+  std::shared_ptr<ZDvidSliceCache<ZArray> > m_cache;
+  uint64_t m_cacheVersion = 0;
+};
+
+#endif // ZDVIDLABELSLICEPREFETCHTASK_H
@@ -5,6 +5,7 @@
 #include <QtConcurrentRun>
 #include <QMutexLocker>
 #include <QElapsedTimer>
+#include <QWaitCondition>
 #include <algorithm>
 
 #include "zjsondef.h"
@@ -61,8 +62,11 @@ const char* ZFlyEmBody3dDoc::THREAD_SPLIT_KEY = "split";
  * The processEvent() function will be triggered every 200ms to process events
  * in the current event queue on background. The processing function (processEventFunc)
  * first goes through all the events available and generate a new event for each
- * body by merging multiple events of the same body. The priority of an event has
- * not been used yet.
+ * body by merging multiple events of the same body. Events of loading body
+ * meshes are then run through a pipeline (processMeshLoadingEvent()), which
+ * loads the bodies in a bounded thread pool in the order of event priority and
+ * adds each body to the document as soon as it is loaded. Adding many bodies
+ * at once makes bulk events, which yield to interactive events added later.
  *
  * To allow fast toggling, a body recycled into the garbage object (m_garbageMap)
  * can be recovered later if it does not get obsolete. The garbage object was
@@ -107,6 +111,8 @@ ZFlyEmBody3dDoc::ZFlyEmBody3dDoc(QObject *parent) :
   ZWidgetMessage::ConnectMessagePipe(m_splitter, this);
 
   m_helper = ZSharedPointer<ZStackDoc3dHelper>(new ZStackDoc3dHelper);
+
+  m_meshLoadingPool.setMaxThreadCount(4);
 }
 
 ZFlyEmBody3dDoc::~ZFlyEmBody3dDoc()
@@ -248,6 +254,7 @@ void ZFlyEmBody3dDoc::setUnrecycable(const QSet<uint64_t> &bodySet)
   for (QSet<uint64_t>::const_iterator iter = bodySet.begin();
        iter != bodySet.end(); ++iter) {
     m_bodyUpdateMap[*iter] = currentTime;
+    m_objCache.removeBody(*iter);
   }
 
 //  m_unrecycableSet = bodySet;
@@ -538,29 +545,126 @@ void ZFlyEmBody3dDoc::removeDiffBody()
 ZStackObject* ZFlyEmBody3dDoc::takeObjectFromCache(
     ZStackObject::EType type, const std::string &source)
 {
-  TStackObjectList objList = m_objCache.takeSameSource(type, source);
-  if (!objList.isEmpty()) {
-    return objList.back();
+  uint64_t bodyId =
+      ZStackObjectSourceFactory::ExtractIdFromFlyEmBodySource(source);
+  if (bodyId == 0) {
+    return NULL;
   }
 
-  return NULL;
+  return m_objCache.take(
+        type, makeObjectCacheKey(
+          bodyId,
+          ZStackObjectSourceFactory::ExtractZoomFromFlyEmBodySource(source),
+          flyem::EBodyLabelType::BODY));
+}
+
+ZFlyEmBodyObjectCache::Key ZFlyEmBody3dDoc::makeObjectCacheKeyUnsync(
+    uint64_t bodyId, int zoom, flyem::EBodyLabelType labelType) const
+{
+  return ZFlyEmBodyObjectCache::Key(
+        bodyId, zoom, labelType, m_bodyUpdateMap.value(bodyId, 0));
+}
+
+ZFlyEmBodyObjectCache::Key ZFlyEmBody3dDoc::makeObjectCacheKey(
+    uint64_t bodyId, int zoom, flyem::EBodyLabelType labelType)
+{
+  QMutexLocker locker(&m_garbageMutex);
+
+  return makeObjectCacheKeyUnsync(bodyId, zoom, labelType);
+}
+
+bool ZFlyEmBody3dDoc::cacheObjectUnsync(ZStackObject *obj)
+{
+  const std::string &source = obj->getSource();
+  uint64_t bodyId =
+      ZStackObjectSourceFactory::ExtractIdFromFlyEmBodySource(source);
+  if (bodyId == 0) {
+    return false;
+  }
+
+  //Objects created before the last update of the body are stale
+  if (m_bodyUpdateMap.contains(bodyId) &&
+      m_bodyUpdateMap[bodyId] >= obj->getTimeStamp()) {
+    return false;
+  }
+
+  m_objCache.add(
+        makeObjectCacheKeyUnsync(
+          bodyId,
+          ZStackObjectSourceFactory::ExtractZoomFromFlyEmBodySource(source),
+          obj->hasRole(ZStackObjectRole::ROLE_SUPERVOXEL) ?
+            flyem::EBodyLabelType::SUPERVOXEL : flyem::EBodyLabelType::BODY),
+        obj);
+
+  return true;
+}
+
+void ZFlyEmBody3dDoc::readBodyObject(
+    const ZDvidReader &reader, uint64_t bodyId, int zoom,
+    flyem::EBodyLabelType labelType, ZObject3dScan *obj)
+{
+  //The key is made before reading, so that an object read across an update
+  //of the body will never be hit.
+  ZFlyEmBodyObjectCache::Key key = makeObjectCacheKey(bodyId, zoom, labelType);
+  if (m_objCache.copyTo(key, obj)) {
+    return;
+  }
+
+  if (isCoarseLevel(zoom)) {
+    reader.readCoarseBody(bodyId, labelType, obj);
+  } else {
+    reader.readMultiscaleBody(bodyId, zoom, true, obj);
+  }
+
+  if (!obj->isEmpty()) {
+    m_objCache.add(key, new ZObject3dScan(*obj));
+  }
+}
+
+void ZFlyEmBody3dDoc::setObjectCacheByteBudget(size_t byteCount)
+{
+  m_objCache.setByteBudget(byteCount);
+}
+
+size_t ZFlyEmBody3dDoc::getObjectCacheByteBudget() const
+{
+  return m_objCache.getByteBudget();
+}
+
+ZFlyEmBodyObjectCache::Stat ZFlyEmBody3dDoc::getObjectCacheStat() const
+{
+  return m_objCache.getStat();
 }
 
 void ZFlyEmBody3dDoc::processEventFunc(const ZFlyEmBodyEvent &event)
+{
+  processEventFunc(event, NULL);
+}
+
+void ZFlyEmBody3dDoc::processEventFunc(
+    const ZFlyEmBodyEvent &event, const std::vector<ZMesh*> *loadedMeshes)
 {
   ZFlyEmBodyConfig config = event.getBodyConfig();
 
+  auto addBody = [&]() {
+    if (loadedMeshes != NULL) {
+      addBodyMeshFunc(config, *loadedMeshes);
+    } else {
+      addBodyFunc(config);
+    }
+  };
+
   switch (event.getAction()) {
   case ZFlyEmBodyEvent::ACTION_REMOVE:
     removeBodyFunc(event.getBodyId(), true);
     break;
   case ZFlyEmBodyEvent::ACTION_ADD:
-    addBodyFunc(config);
+    addBody();
     break;
   case ZFlyEmBodyEvent::ACTION_UPDATE:
 //    if (event.updating(BodyEvent::UPDATE_CHANGE_COLOR)) {
     if (event.updating(ZFlyEmBodyEvent::UPDATE_MULTIRES)) {
-      addBodyFunc(config);
+      addBody();
     } else {
       updateBody(event.getBodyId(), event.getBodyColor(), getBodyType());
     }
@@ -860,6 +964,10 @@ QMap<uint64_t, ZFlyEmBodyEvent> ZFlyEmBody3dDoc::makeEventMapUnsync(
     }
   }
 
+  if (bm != NULL) { //Publish the registrations together
+    bm->beginBatch();
+  }
+
   for (QMap<uint64_t, ZFlyEmBodyEvent>::iterator iter = actionMap.begin();
        iter != actionMap.end(); ++iter) {
     ZFlyEmBodyEvent &event = iter.value();
@@ -896,6 +1004,10 @@ QMap<uint64_t, ZFlyEmBodyEvent> ZFlyEmBody3dDoc::makeEventMapUnsync(
     }
 //    event.print();
   }
+
+  if (bm != NULL) {
+    bm->endBatch();
+  }
   m_eventQueue.clear();
 
   return actionMap;
@@ -949,22 +1061,189 @@ void ZFlyEmBody3dDoc::processEventFunc()
   }
 
   //Process other events
+  std::vector<ZFlyEmBodyEvent> meshLoadingEventArray;
   for (QMap<uint64_t, ZFlyEmBodyEvent>::const_iterator iter = actionMap.begin();
        iter != actionMap.end(); ++iter) {
     const ZFlyEmBodyEvent &event = iter.value();
     if (event.getAction() != ZFlyEmBodyEvent::ACTION_REMOVE) {
-      processEventFunc(event);
+      if (isMeshLoadingEvent(event)) {
+        meshLoadingEventArray.push_back(event);
+      } else {
+        processEventFunc(event);
+      }
     }
     if (m_quitting) {
       break;
     }
   }
 
+  if (!m_quitting) {
+    processMeshLoadingEvent(meshLoadingEventArray);
+  }
+
 
 //  emit messageGenerated(ZWidgetMessage("3D Body view updated."));
   std::cout << "====Processing done====" << std::endl;
 }
 
+bool ZFlyEmBody3dDoc::isMeshLoadingEvent(const ZFlyEmBodyEvent &event) const
+{
+  flyem::EBodyType bodyType = event.getBodyConfig().getBodyType();
+  if (bodyType == flyem::EBodyType::DEFAULT) {
+    bodyType = getBodyType();
+  }
+
+  if (bodyType == flyem::EBodyType::MESH) {
+    return event.getAction() == ZFlyEmBodyEvent::ACTION_ADD ||
+        (event.getAction() == ZFlyEmBodyEvent::ACTION_UPDATE &&
+         event.updating(ZFlyEmBodyEvent::UPDATE_MULTIRES));
+  }
+
+  return false;
+}
+
+bool ZFlyEmBody3dDoc::hasPrecedingEvent(int priority) const
+{
+  QMutexLocker locker(&m_eventQueueMutex);
+
+  for (const ZFlyEmBodyEvent &event : m_eventQueue) {
+    if (event.getPriority() < priority) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ZFlyEmBody3dDoc::setMeshLoadingThreadCount(int n)
+{
+  m_meshLoadingPool.setMaxThreadCount(std::max(1, n));
+}
+
+int ZFlyEmBody3dDoc::getMeshLoadingThreadCount() const
+{
+  return m_meshLoadingPool.maxThreadCount();
+}
+
+void ZFlyEmBody3dDoc::processMeshLoadingEvent(
+    std::vector<ZFlyEmBodyEvent> eventArray)
+{
+  if (eventArray.empty()) {
+    return;
+  }
+
+  std::stable_sort(eventArray.begin(), eventArray.end(),
+                   ZFlyEmBodyEvent::ComparePriority());
+
+  std::vector<ZFlyEmBodyConfig> configArray;
+  for (const ZFlyEmBodyEvent &event : eventArray) {
+    configArray.push_back(event.getBodyConfig());
+  }
+  std::vector<std::vector<ZMesh*> > meshArray(eventArray.size());
+
+  //Shared by the loading threads and the committing (current) thread
+  QMutex taskMutex;
+  QWaitCondition taskCondition;
+  size_t nextIndex = 0;
+  QQueue<size_t> readyQueue;
+  bool stopping = false;
+
+  int threadCount = std::min(getMeshLoadingThreadCount(), int(eventArray.size()));
+  int runningCount = threadCount;
+
+  ZDvidTarget target = getWorkDvidReader().getDvidTarget();
+  auto loadFunc = [&]() {
+    ZDvidReader reader;
+    reader.setVerbose(false);
+    if (reader.openRaw(target)) {
+      forever {
+        QMutexLocker locker(&taskMutex);
+        if (stopping || m_quitting || nextIndex >= eventArray.size()) {
+          break;
+        }
+        size_t index = nextIndex++;
+        locker.unlock();
+
+        notifyBodyUpdate(configArray[index].getBodyId(),
+                         configArray[index].getDsLevel());
+        meshArray[index] = makeBodyMeshModels(reader, configArray[index]);
+
+        locker.relock();
+        readyQueue.enqueue(index);
+        taskCondition.wakeAll();
+      }
+    }
+
+    QMutexLocker locker(&taskMutex);
+    --runningCount;
+    taskCondition.wakeAll();
+  };
+
+  std::vector<QFuture<void> > futureArray;
+  for (int i = 0; i < threadCount; ++i) {
+    futureArray.push_back(QtConcurrent::run(&m_meshLoadingPool, loadFunc));
+  }
+
+  //Commit loaded bodies one by one so that they show up progressively
+  QMutexLocker locker(&taskMutex);
+  forever {
+    while (readyQueue.isEmpty() && runningCount > 0) {
+      taskCondition.wait(&taskMutex);
+    }
+    if (readyQueue.isEmpty()) {
+      break;
+    }
+
+    size_t index = readyQueue.dequeue();
+    bool checkingPriority = !stopping && nextIndex < eventArray.size();
+    int pendingPriority = checkingPriority ?
+          eventArray[nextIndex].getPriority() : 0;
+    locker.unlock();
+
+    if (m_quitting) {
+      for (ZMesh *mesh : meshArray[index]) {
+        delete mesh;
+      }
+    } else {
+      processEventFunc(eventArray[index], &meshArray[index]);
+    }
+
+    bool preempted = checkingPriority && hasPrecedingEvent(pendingPriority);
+
+    locker.relock();
+    if (preempted) {
+      stopping = true;
+    }
+  }
+  locker.unlock();
+
+  for (QFuture<void> &future : futureArray) {
+    future.waitForFinished();
+  }
+
+  if (m_quitting) {
+    return;
+  }
+
+  if (stopping) {
+    //Put back unstarted events, which will be merged with the new events.
+    //They are turned into multi-resolution updates because their bodies have
+    //been registered.
+    QMutexLocker queueLocker(&m_eventQueueMutex);
+    for (size_t i = eventArray.size(); i > nextIndex; --i) {
+      ZFlyEmBodyEvent event = eventArray[i - 1];
+      event.setAction(ZFlyEmBodyEvent::ACTION_UPDATE);
+      event.addUpdateFlag(ZFlyEmBodyEvent::UPDATE_MULTIRES);
+      m_eventQueue.prepend(event);
+    }
+  } else {
+    //No loading thread could connect to the server
+    for (size_t i = nextIndex; i < eventArray.size() && !m_quitting; ++i) {
+      processEventFunc(eventArray[i]);
+    }
+  }
+}
+
 flyem::EBodyLabelType ZFlyEmBody3dDoc::getBodyLabelType(uint64_t bodyId) const
 {
   if (getDvidTarget().hasSupervoxel() &&
@@ -1030,8 +1309,6 @@ uint64_t ZFlyEmBody3dDoc::getSelectedSingleNormalBodyId() const
 
 uint64_t ZFlyEmBody3dDoc::getSingleBody() const
 {
-  QMutexLocker locker(&m_BodySetMutex);
-
   return getBodyManager().getSingleBodyId();
 /*
   uint64_t bodyId = 0;
@@ -1730,13 +2007,19 @@ void ZFlyEmBody3dDoc::notifyBodyUpdated(uint64_t bodyId, int resLevel)
 
 void ZFlyEmBody3dDoc::addBodyMeshFunc(ZFlyEmBodyConfig &config)
 {
-  uint64_t bodyId = config.getBodyId();
-
-  notifyBodyUpdate(bodyId, config.getDsLevel());
+  notifyBodyUpdate(config.getBodyId(), config.getDsLevel());
 
 //  std::map<uint64_t, ZMesh*> meshes;
   std::vector<ZMesh *> meshes = makeBodyMeshModels(config);
 
+  addBodyMeshFunc(config, meshes);
+}
+
+void ZFlyEmBody3dDoc::addBodyMeshFunc(
+    ZFlyEmBodyConfig &config, const std::vector<ZMesh*> &meshes)
+{
+  uint64_t bodyId = config.getBodyId();
+
 //  bool loaded =
 //      !(getObjectGroup().findSameClass(
 //          ZStackObject::TYPE_SWC,
@@ -2032,9 +2315,11 @@ void ZFlyEmBody3dDoc::addTodo(bool on)
 
 void ZFlyEmBody3dDoc::cacheObject(ZStackObject *obj)
 {
-  m_objCache.add(obj, true);
-  if (m_objCache.size() > m_objCacheCapacity) {
-    m_objCache.removeFirstObject(true);
+  if (obj != NULL) {
+    QMutexLocker locker(&m_garbageMutex);
+    if (!cacheObjectUnsync(obj)) {
+      delete obj;
+    }
   }
 }
 
@@ -2751,14 +3036,19 @@ ZSwcTree* ZFlyEmBody3dDoc::recoverFullBodyFromGarbage(uint64_t bodyId, int resLe
   return tree;
 }
 
-ZMesh* ZFlyEmBody3dDoc::recoverMeshFromGarbage(uint64_t bodyId, int resLevel)
+ZMesh* ZFlyEmBody3dDoc::recoverMeshFromGarbage(
+    uint64_t bodyId, int resLevel, flyem::EBodyLabelType labelType)
 {
   ZMesh *mesh = NULL;
 
   for (int zoom = 0; zoom <= resLevel; ++zoom) {
-    mesh = recoverFromGarbage<ZMesh>(
-          ZStackObjectSourceFactory::MakeFlyEmBodySource(
-            bodyId, zoom, flyem::EBodyType::MESH));
+    mesh = m_objCache.take<ZMesh>(
+          makeObjectCacheKey(bodyId, zoom, labelType));
+    if (mesh == NULL) {
+      mesh = recoverFromGarbage<ZMesh>(
+            ZStackObjectSourceFactory::MakeFlyEmBodySource(
+              bodyId, zoom, flyem::EBodyType::MESH));
+    }
     if (mesh != NULL) {
       break;
     }
@@ -2961,7 +3251,9 @@ ZSwcTree* ZFlyEmBody3dDoc::makeBodyModel(
       if (bodyType == flyem::EBodyType::SKELETON) {
         tree = reader.readSwc(bodyId);
       } else if (isCoarseLevel(zoom)) {
-        ZObject3dScan obj = reader.readCoarseBody(bodyId);
+        ZObject3dScan obj;
+        readBodyObject(
+              reader, bodyId, zoom, flyem::EBodyLabelType::BODY, &obj);
         if (m_quitting) {
           return NULL;
         }
@@ -2988,7 +3280,8 @@ ZSwcTree* ZFlyEmBody3dDoc::makeBodyModel(
 
         if (cachedBody == NULL) {
           ZObject3dScan obj;
-          reader.readMultiscaleBody(bodyId, zoom, true, &obj);
+          readBodyObject(
+                reader, bodyId, zoom, flyem::EBodyLabelType::BODY, &obj);
           if (m_quitting) {
             return NULL;
           }
@@ -3100,9 +3393,12 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::getTarCachedMeshes(uint64_t bodyId)
   if (!meshIds.isEmpty()) {
 //      auto& meshIds = it->second;
 //    std::vector<ZMesh *> recoveredMeshes;
+    flyem::EBodyLabelType labelType =
+        ZFlyEmBodyManager::encodingSupervoxelTar(bodyId) ?
+          flyem::EBodyLabelType::SUPERVOXEL : flyem::EBodyLabelType::BODY;
 
     for (uint64_t meshId : meshIds) {
-      if (ZMesh *mesh = recoverMeshFromGarbage(meshId, 0)) {
+      if (ZMesh *mesh = recoverMeshFromGarbage(meshId, 0, labelType)) {
         recoveredMeshes.push_back(mesh);
       }
     }
@@ -3273,8 +3569,8 @@ ZMesh *ZFlyEmBody3dDoc::readMesh(
     if (!loaded) { //Now make mesh from sparse vol
       ZObject3dScan obj;
       if (isCoarseLevel(zoom) && !config.isHybrid()){
-        reader.readCoarseBody(config.getDecodedBodyId(),
-              config.getLabelType(), &obj);
+        readBodyObject(reader, config.getDecodedBodyId(), zoom,
+                       config.getLabelType(), &obj);
         obj.setDsIntv(getDvidInfo().getBlockSize() - 1);
         mesh = ZMeshFactory::MakeMesh(obj);
       } else {
@@ -3408,6 +3704,12 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeTarMeshModels(
 
 std::vector<ZMesh*> ZFlyEmBody3dDoc::makeBodyMeshModels(
     ZFlyEmBodyConfig &config)
+{
+  return makeBodyMeshModels(getWorkDvidReader(), config);
+}
+
+std::vector<ZMesh*> ZFlyEmBody3dDoc::makeBodyMeshModels(
+    const ZDvidReader &reader, ZFlyEmBodyConfig &config)
 {
   std::vector<ZMesh*> result;
 
@@ -3420,7 +3722,7 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeBodyMeshModels(
   if (result.empty()) {
     int t = m_objectTime.elapsed();
     if (config.isTar()) {
-      result = makeTarMeshModels(config.getBodyId(), t);
+      result = makeTarMeshModels(reader, config.getBodyId(), t);
     } else {
       ZMesh *mesh = NULL;
 
@@ -3432,7 +3734,7 @@ std::vector<ZMesh*> ZFlyEmBody3dDoc::makeBodyMeshModels(
         mesh = dynamic_cast<ZMesh*>(obj);
       }
       if (mesh == NULL) {
-        mesh = readMesh(config, &zoom);
+        mesh = readMesh(reader, config, &zoom);
         if (mesh != NULL) {
           mesh->setLabel(config.getBodyId());
           if (IsOverSize(mesh) && zoom <= 2) {
@@ -4284,6 +4586,20 @@ void ZFlyEmBody3dDoc::dumpGarbageUnsync(ZStackObject *obj, bool recycable)
     }
   }
 
+  if (obj->hasRole(ZStackObjectRole::ROLE_SUPERVOXEL)) {
+    getBodyManager().eraseSupervoxel(obj->getLabel());
+  }
+
+  //Meshes are kept in the object cache, which is limited by memory usage
+  //instead of lifetime.
+  if (recycable && obj->getType() == ZStackObject::TYPE_MESH) {
+    if (cacheObjectUnsync(obj)) {
+      ZOUT(LTRACE(), 5) << "Mesh cached" << obj->getSource();
+      m_garbageJustDumped = true;
+      return;
+    }
+  }
+
   m_garbageMap[obj].setTimeStamp(m_objectTime.elapsed());
   m_garbageMap[obj].setRecycable(recycable);
 
@@ -4297,10 +4613,6 @@ void ZFlyEmBody3dDoc::dumpGarbageUnsync(ZStackObject *obj, bool recycable)
 //    }
 //  }
 
-  if (obj->hasRole(ZStackObjectRole::ROLE_SUPERVOXEL)) {
-    getBodyManager().eraseSupervoxel(obj->getLabel());
-  }
-
   ZOUT(LTRACE(), 5) << obj << "dumped" << obj->getSource();
 
   m_garbageJustDumped = true;
@@ -4314,6 +4626,9 @@ void ZFlyEmBody3dDoc::diagnose() const
 
   QList<ZMesh*> meshList = ZStackDocProxy::GetGeneralMeshList(this);
   LDEBUG() << "#General meshes" << meshList.size();
+  LDEBUG() << "Object cache:" << m_objCache.size() << "objects,"
+           << m_objCache.getByteCount() << "/" << m_objCache.getByteBudget()
+           << "bytes;" << m_objCache.getStat().toString().c_str();
 
   if (getDataDocument() != NULL) {
     getDataDocument()->diagnose();
@@ -4507,6 +4822,8 @@ void ZFlyEmBody3dDoc::addBodyChangeEvent(
   }
   */
 
+  int addingStart = m_eventQueue.size();
+
   //Add new bodies
   foreach (uint64_t bodyId, addedBodySet) {
     if (!getBodyManager().isSupervoxel(bodyId)) {
@@ -4558,6 +4875,22 @@ void ZFlyEmBody3dDoc::addBodyChangeEvent(
     }
   }
 
+  //Adding multiple bodies at once is a bulk load, which yields to interactive
+  //events coming later.
+  int addingCount = 0;
+  for (int i = addingStart; i < m_eventQueue.size(); ++i) {
+    if (m_eventQueue[i].getAction() == ZFlyEmBodyEvent::ACTION_ADD) {
+      ++addingCount;
+    }
+  }
+  if (addingCount > 1) {
+    for (int i = addingStart; i < m_eventQueue.size(); ++i) {
+      if (m_eventQueue[i].getAction() == ZFlyEmBodyEvent::ACTION_ADD) {
+        m_eventQueue[i].setPriority(ZFlyEmBodyEvent::PRIORITY_BULK);
+      }
+    }
+  }
+
 
 
 #if 0
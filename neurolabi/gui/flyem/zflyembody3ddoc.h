@@ -10,6 +10,7 @@
 #include <QColor>
 #include <QList>
 #include <QTime>
+#include <QThreadPool>
 
 #ifdef _DEBUG_
 #include "zqslog.h"
@@ -23,6 +24,7 @@
 #include "zthreadfuturemap.h"
 #include "zflyembodyevent.h"
 #include "zflyembodymanager.h"
+#include "zflyembodyobjectcache.h"
 #include "protocols/protocoltaskconfig.h"
 
 class ZFlyEmProofDoc;
@@ -174,6 +176,16 @@ public:
   void processEventFunc();
   void cancelEventThread();
 
+  /*!
+   * \brief Set the number of threads for loading body meshes
+   *
+   * Bodies of mesh-loading events are fetched and meshed by a pool of at most
+   * \a n threads, each with its own DVID connection, and then added to the
+   * document one by one as soon as they are loaded.
+   */
+  void setMeshLoadingThreadCount(int n);
+  int getMeshLoadingThreadCount() const;
+
   void setTodoItemSelected(ZFlyEmToDoItem *item, bool select);
 //  void setTodoVisible(ZFlyEmToDoItem::EToDoAction action, bool visible);
 
@@ -334,6 +346,21 @@ public:
 
   bool isSupervoxel(uint64_t bodyId);
 
+  /*!
+   * \brief Set the memory budget of the body object cache
+   *
+   * Removed meshes and sparse body objects are kept in the cache until the
+   * total size exceeds \a byteCount, and then the least recently used ones are
+   * deleted.
+   */
+  void setObjectCacheByteBudget(size_t byteCount);
+  size_t getObjectCacheByteBudget() const;
+
+  /*!
+   * \brief Hit/miss/eviction counters of the body object cache
+   */
+  ZFlyEmBodyObjectCache::Stat getObjectCacheStat() const;
+
   void diagnose() const override;
 
   ZStackDoc3dHelper* getHelper() const;
@@ -422,6 +449,8 @@ private:
 
   std::vector<ZMesh*> getCachedMeshes(uint64_t bodyId, int zoom);
   std::vector<ZMesh *> makeBodyMeshModels(ZFlyEmBodyConfig &config);
+  std::vector<ZMesh *> makeBodyMeshModels(
+      const ZDvidReader &reader, ZFlyEmBodyConfig &config);
   std::vector<ZMesh*> makeTarMeshModels(uint64_t bodyId, int t);
   std::vector<ZMesh*> makeTarMeshModels(
       const ZDvidReader &reader, uint64_t bodyId, int t);
@@ -443,6 +472,8 @@ private:
 
   void addBodyFunc(ZFlyEmBodyConfig &config);
   void addBodyMeshFunc(ZFlyEmBodyConfig &config);
+  void addBodyMeshFunc(
+      ZFlyEmBodyConfig &config, const std::vector<ZMesh*> &meshes);
 //  void addBodyFunc(uint64_t bodyId, const QColor &color, int resLevel);
 //  void addBodyMeshFunc(uint64_t bodyId, const QColor &color, int resLevel);
 
@@ -514,15 +545,65 @@ private slots:
 
 private:
   void processEventFunc(const ZFlyEmBodyEvent &event);
+
+  /*!
+   * \brief Process an event with meshes loaded in advance
+   *
+   * \a loadedMeshes are used instead of loading the body of \a event if it is
+   * not NULL.
+   */
+  void processEventFunc(
+      const ZFlyEmBodyEvent &event, const std::vector<ZMesh*> *loadedMeshes);
+
+  bool isMeshLoadingEvent(const ZFlyEmBodyEvent &event) const;
+
+  /*!
+   * \brief Process mesh-loading events in a pipeline
+   *
+   * The bodies are loaded concurrently in the order of event priority and
+   * committed to the document in the calling thread as soon as each of them
+   * is ready. The loading stops early if a more urgent event is added to the
+   * event queue, and the events that have not been started are put back to
+   * the queue.
+   */
+  void processMeshLoadingEvent(std::vector<ZFlyEmBodyEvent> eventArray);
+
+  /*!
+   * \brief Check if the event queue has an event more urgent than \a priority.
+   */
+  bool hasPrecedingEvent(int priority) const;
   ZSwcTree* recoverFullBodyFromGarbage(
       uint64_t bodyId, int resLevel);
-  ZMesh* recoverMeshFromGarbage(uint64_t bodyId, int resLevel);
+  ZMesh* recoverMeshFromGarbage(
+      uint64_t bodyId, int resLevel,
+      flyem::EBodyLabelType labelType = flyem::EBodyLabelType::BODY);
 
   void removeDiffBody();
 
   ZStackObject* takeObjectFromCache(
       ZStackObject::EType type, const std::string &source);
 
+  /*!
+   * \brief Make the key of an object in the body object cache
+   *
+   * The mutation ID of the key is the last update stamp of \a bodyId.
+   */
+  ZFlyEmBodyObjectCache::Key makeObjectCacheKey(
+      uint64_t bodyId, int zoom, flyem::EBodyLabelType labelType);
+  ZFlyEmBodyObjectCache::Key makeObjectCacheKeyUnsync(
+      uint64_t bodyId, int zoom, flyem::EBodyLabelType labelType) const;
+
+  /*!
+   * \brief Read a sparse body object through the object cache
+   *
+   * It reads the coarse body if \a zoom is the coarse level, or the body at
+   * \a zoom otherwise.
+   */
+  void readBodyObject(const ZDvidReader &reader, uint64_t bodyId, int zoom,
+                      flyem::EBodyLabelType labelType, ZObject3dScan *obj);
+
+  bool cacheObjectUnsync(ZStackObject *obj);
+
   void notifyBodyUpdate(uint64_t bodyId, int resLevel);
   void notifyBodyUpdated(uint64_t bodyId, int resLevel);
 
@@ -555,6 +636,7 @@ private:
   mutable QMutex m_protectedBodySetMutex;
 
   bool m_quitting = false;
+  QThreadPool m_meshLoadingPool;
   bool m_showingSynapse = true;
   bool m_showingTodo = true;
   bool m_nodeSeeding = false;
@@ -585,8 +667,7 @@ private:
 
 //  QList<ZStackObject*> m_garbageList;
   QMap<ZStackObject*, ObjectStatus> m_garbageMap;
-  ZStackObjectGroup m_objCache;
-  int m_objCacheCapacity;
+  ZFlyEmBodyObjectCache m_objCache;
   QMap<uint64_t, int> m_bodyUpdateMap;
 
   ZFlyEmBodySplitter *m_splitter;
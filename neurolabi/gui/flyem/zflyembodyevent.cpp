@@ -1,5 +1,7 @@
 #include "zflyembodyevent.h"
 
+#include <algorithm>
+
 const ZFlyEmBodyEvent::TUpdateFlag
 ZFlyEmBodyEvent::UPDATE_NULL = 0;
 
@@ -18,6 +20,9 @@ ZFlyEmBodyEvent::UPDATE_MULTIRES = 8;
 const ZFlyEmBodyEvent::TUpdateFlag
 ZFlyEmBodyEvent::UPDATE_SEGMENTATION = 16;
 
+const int ZFlyEmBodyEvent::PRIORITY_INTERACTIVE = 0;
+const int ZFlyEmBodyEvent::PRIORITY_BULK = 1;
+
 ZFlyEmBodyEvent::ZFlyEmBodyEvent()
 {
 
@@ -79,6 +84,9 @@ void ZFlyEmBodyEvent::mergeEvent(
     return;
   }
 
+  //The merged event is as urgent as the most urgent one
+  int priority = std::min(getPriority(), event.getPriority());
+
   switch (direction) {
   case neutube::EBiDirection::FORWARD: //event comes first
     switch (getAction()) {
@@ -125,6 +133,8 @@ void ZFlyEmBodyEvent::mergeEvent(
   }
     break;
   }
+
+  setPriority(priority);
 }
 
 void ZFlyEmBodyEvent::setRange(const ZIntCuboid &range)
@@ -172,7 +182,9 @@ ZFlyEmBodyEvent ZFlyEmBodyEvent::makeHighResEvent(
 {
   if (!isOneTime()) {
     if (getAction() == ACTION_ADD || getAction() == ACTION_UPDATE) {
-      return MakeHighResEvent(config, minDsLevel);
+      ZFlyEmBodyEvent event = MakeHighResEvent(config, minDsLevel);
+      event.setPriority(getPriority());
+      return event;
     }
   }
 
@@ -77,6 +77,7 @@ public:
   void print() const;
 
   int getPriority() const { return m_priority; }
+  void setPriority(int priority) { m_priority = priority; }
 
   ZFlyEmBodyConfig getBodyConfig() const;
   void setBodyConfig(const ZFlyEmBodyConfig &config);
@@ -95,6 +96,9 @@ public:
   static const TUpdateFlag UPDATE_MULTIRES;
   static const TUpdateFlag UPDATE_SEGMENTATION;
 
+  static const int PRIORITY_INTERACTIVE;
+  static const int PRIORITY_BULK;
+
 private:
   EAction m_action = ACTION_NULL;
 
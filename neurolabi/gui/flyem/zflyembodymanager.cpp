@@ -1,11 +1,12 @@
 #include "zflyembodymanager.h"
 
 #include <iostream>
+#include <algorithm>
 
 /*
  * Impelementation details:
  *
- * The body set mapped from key 0 in m_bodyMap is treated as a set of orphan
+ * The body set mapped from key 0 in the body map is treated as a set of orphan
  * supervoxels, which are supervoxels that have unknown parents. An orphan
  * supervoxel is decoded in the manager, but always encoded when returned from an
  * API unless there is an option for specifying encoding or not.
@@ -30,20 +31,218 @@
  *   A supervoxel may also have the same ID as a normal body. This can cause
  *   confusion while erasing an ID. Therefore the function erase() has been
  *   replaced by more explicit eraseSupervoxel().
+ *
+ * Concurrency:
+ *   The registry is split into shards by the hash of the key. The shards form
+ *   a trie, in which each level takes 4 more bits of the hash, and a leaf is
+ *   split when it gets full. A snapshot holds a shared pointer to the root.
+ *   Shards are never modified once the snapshot is published. An update
+ *   copies the path from the root to each leaf it writes to, which is a few
+ *   small shards, and publishes the new snapshot with std::atomic_store(). A
+ *   reader keeps the snapshot it loads alive until it is done, so it never
+ *   waits for the writer. The parents of each mapped ID are indexed in
+ *   parentMap, which makes getAggloId() and isSupervoxel() constant time.
  */
 
-ZFlyEmBodyManager::ZFlyEmBodyManager()
+ZFlyEmBodyManager::ZFlyEmBodyManager() :
+  m_batchDepth(0), m_writeMutex(QMutex::Recursive)
+{
+  std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+  snapshot->root = std::make_shared<Shard>();
+  m_snapshot = snapshot;
+}
+
+size_t ZFlyEmBodyManager::Shard::getEntryCount() const
+{
+  return bodyMap.size() + parentMap.size() + bodyConfigMap.size() +
+      todoLoaded.size() + synapseLoaded.size();
+}
+
+uint64_t ZFlyEmBodyManager::GetKeyHash(uint64_t id)
+{
+  //Fibonacci hashing, which spreads consecutive IDs over the shards
+  return id * uint64_t(0x9E3779B97F4A7C15);
+}
+
+const ZFlyEmBodyManager::Shard& ZFlyEmBodyManager::GetShard(
+    const Snapshot &snapshot, uint64_t id)
+{
+  uint64_t hash = GetKeyHash(id);
+  const Shard *shard = snapshot.root.get();
+  for (int shift = 60; !shard->isLeaf(); shift -= 4) {
+    shard = shard->childArray[(hash >> shift) & (SHARD_FANOUT - 1)].get();
+  }
+
+  return *shard;
+}
+
+std::vector<const ZFlyEmBodyManager::Shard*>
+ZFlyEmBodyManager::GetLeafArray(const Snapshot &snapshot)
+{
+  std::vector<const Shard*> leafArray;
+  std::vector<const Shard*> shardStack{snapshot.root.get()};
+  while (!shardStack.empty()) {
+    const Shard *shard = shardStack.back();
+    shardStack.pop_back();
+    if (shard->isLeaf()) {
+      leafArray.push_back(shard);
+    } else {
+      for (const std::shared_ptr<Shard> &child : shard->childArray) {
+        shardStack.push_back(child.get());
+      }
+    }
+  }
+
+  return leafArray;
+}
+
+std::shared_ptr<const ZFlyEmBodyManager::Snapshot>
+ZFlyEmBodyManager::getSnapshot() const
+{
+  if (m_batchDepth > 0 && m_batchThread == std::this_thread::get_id()) {
+    return m_workingSnapshot;
+  }
+
+  return std::atomic_load(&m_snapshot);
+}
+
+void ZFlyEmBodyManager::beginBatch()
+{
+  m_writeMutex.lock();
+  if (m_batchDepth == 0) {
+    m_workingSnapshot = std::make_shared<Snapshot>(*m_snapshot);
+    m_copiedShardSet.clear();
+    m_batchThread = std::this_thread::get_id();
+  }
+  ++m_batchDepth;
+}
+
+void ZFlyEmBodyManager::endBatch()
+{
+  if (--m_batchDepth == 0) {
+    std::atomic_store(&m_snapshot,
+                      std::shared_ptr<const Snapshot>(m_workingSnapshot));
+    m_workingSnapshot.reset();
+    m_batchThread = std::thread::id();
+  }
+  m_writeMutex.unlock();
+}
+
+void ZFlyEmBodyManager::makeWritable(std::shared_ptr<Shard> &shard)
 {
+  if (m_copiedShardSet.count(shard.get()) == 0) { //Copy on the first write
+    shard = std::make_shared<Shard>(*shard);
+    m_copiedShardSet.insert(shard.get());
+  }
+}
+
+void ZFlyEmBodyManager::splitShard(Shard &shard, int shift)
+{
+  shard.childArray.resize(SHARD_FANOUT);
+  for (std::shared_ptr<Shard> &child : shard.childArray) {
+    child = std::make_shared<Shard>();
+    m_copiedShardSet.insert(child.get());
+  }
+
+  auto getChild = [&](uint64_t id) -> Shard& {
+    return *shard.childArray[(GetKeyHash(id) >> shift) & (SHARD_FANOUT - 1)];
+  };
+
+  for (auto iter = shard.bodyMap.begin(); iter != shard.bodyMap.end(); ++iter) {
+    getChild(iter.key()).bodyMap.insert(iter.key(), iter.value());
+  }
+  for (auto iter = shard.parentMap.begin(); iter != shard.parentMap.end();
+       ++iter) {
+    getChild(iter.key()).parentMap.insert(iter.key(), iter.value());
+  }
+  for (auto iter = shard.bodyConfigMap.begin();
+       iter != shard.bodyConfigMap.end(); ++iter) {
+    getChild(iter.key()).bodyConfigMap.insert(iter.key(), iter.value());
+  }
+  for (uint64_t id : shard.todoLoaded) {
+    getChild(id).todoLoaded.insert(id);
+  }
+  for (uint64_t id : shard.synapseLoaded) {
+    getChild(id).synapseLoaded.insert(id);
+  }
+
+  shard.bodyMap.clear();
+  shard.parentMap.clear();
+  shard.bodyConfigMap.clear();
+  shard.todoLoaded.clear();
+  shard.synapseLoaded.clear();
+}
+
+ZFlyEmBodyManager::Shard& ZFlyEmBodyManager::getWritableShard(uint64_t id)
+{
+  uint64_t hash = GetKeyHash(id);
+  std::shared_ptr<Shard> *shard = &m_workingSnapshot->root;
+  for (int shift = 60; ; shift -= 4) {
+    makeWritable(*shard);
+    if ((*shard)->isLeaf()) {
+      //A leaf at the last level keeps all the keys with the same hash
+      if (shift < 0 || (*shard)->getEntryCount() < SHARD_CAPACITY) {
+        break;
+      }
+      splitShard(**shard, shift);
+    }
+    shard = &(*shard)->childArray[(hash >> shift) & (SHARD_FANOUT - 1)];
+  }
+
+  return **shard;
 }
 
 bool ZFlyEmBodyManager::isEmpty() const
 {
-  return m_bodyMap.isEmpty();
+  std::shared_ptr<const Snapshot> snapshot = getSnapshot();
+  for (const Shard *shard : GetLeafArray(*snapshot)) {
+    if (!shard->bodyMap.isEmpty()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ZFlyEmBodyManager::linkParentUnsync(uint64_t id, uint64_t parentId)
+{
+  getWritableShard(id).parentMap[id].insert(parentId);
+}
+
+void ZFlyEmBodyManager::unlinkParentUnsync(uint64_t id, uint64_t parentId)
+{
+  QHash<uint64_t, QSet<uint64_t>> &parentMap = getWritableShard(id).parentMap;
+  auto iter = parentMap.find(id);
+  if (iter != parentMap.end()) {
+    iter.value().remove(parentId);
+    if (iter.value().isEmpty()) {
+      parentMap.erase(iter);
+    }
+  }
+}
+
+void ZFlyEmBodyManager::registerBodyUnsync(
+    uint64_t id, const QSet<uint64_t> &comp)
+{
+  Shard &shard = getWritableShard(id);
+  auto iter = shard.bodyMap.find(id);
+  if (iter != shard.bodyMap.end()) {
+    for (uint64_t subId : iter.value()) {
+      unlinkParentUnsync(subId, id);
+    }
+  }
+
+  shard.bodyMap[id] = comp;
+  for (uint64_t subId : comp) {
+    linkParentUnsync(subId, id);
+  }
 }
 
 void ZFlyEmBodyManager::registerBody(uint64_t id, const QSet<uint64_t> &comp)
 {
-  m_bodyMap[decode(id)] = comp;
+  beginBatch();
+  registerBodyUnsync(decode(id), comp);
+  endBatch();
 
 #ifdef _DEBUG_2
   print();
@@ -56,50 +255,86 @@ void ZFlyEmBodyManager::registerBody(uint64_t id)
     registerSupervoxel(id);
   } else {
     id = decode(id);
-    if (!contains(id)) {
-      registerBody(id, QSet<uint64_t>());
+    beginBatch();
+    if (!ContainsBody(*m_workingSnapshot, id)) {
+      registerBodyUnsync(id, QSet<uint64_t>());
     }
+    endBatch();
   }
 }
 
 void ZFlyEmBodyManager::registerBody(uint64_t aggloId, uint64_t bodyId)
 {
   uint64_t decodedAggloId = decode(aggloId);
+  uint64_t decodedBodyId = decode(bodyId);
 
-  m_bodyMap[decodedAggloId].insert(decode(bodyId));
+  beginBatch();
+  getWritableShard(decodedAggloId).bodyMap[decodedAggloId].insert(
+        decodedBodyId);
+  linkParentUnsync(decodedBodyId, decodedAggloId);
+  endBatch();
 }
 
-void ZFlyEmBodyManager::registerSupervoxel(uint64_t id)
+void ZFlyEmBodyManager::registerSupervoxelUnsync(uint64_t id)
 {
   id = decode(id);
-  if (!m_bodyMap.contains(0)) {
-    m_bodyMap[0] = QSet<uint64_t>();
-  }
-  m_bodyMap[0].insert(id);
+  getWritableShard(0).bodyMap[0].insert(id);
+  linkParentUnsync(id, 0);
 }
 
-void ZFlyEmBodyManager::deregisterSupervoxel(uint64_t id)
+void ZFlyEmBodyManager::registerSupervoxel(uint64_t id)
+{
+  beginBatch();
+  registerSupervoxelUnsync(id);
+  endBatch();
+}
+
+void ZFlyEmBodyManager::deregisterSupervoxelUnsync(uint64_t id)
 {
   uint64_t bodyId = decode(id);
-  if (m_bodyMap.contains(0)) {
-    m_bodyMap[0].remove(bodyId);
-    if (m_bodyMap[0].isEmpty()) {
-      m_bodyMap.remove(0);
+  if (GetShard(*m_workingSnapshot, 0).bodyMap.contains(0)) {
+    QHash<uint64_t, QSet<uint64_t>> &bodyMap = getWritableShard(0).bodyMap;
+    if (bodyMap[0].remove(bodyId)) {
+      unlinkParentUnsync(bodyId, 0);
+    }
+    if (bodyMap[0].isEmpty()) {
+      bodyMap.remove(0);
     }
   }
 }
 
+void ZFlyEmBodyManager::deregisterSupervoxel(uint64_t id)
+{
+  beginBatch();
+  deregisterSupervoxelUnsync(id);
+  endBatch();
+}
+
 void ZFlyEmBodyManager::deregisterBody(uint64_t id)
 {
+  beginBatch();
   if (encodingSupervoxel(id)) {
-    deregisterSupervoxel(id);
+    deregisterSupervoxelUnsync(id);
   } else {
     uint64_t bodyId = decode(id);
-    m_bodyMap.remove(bodyId);
-    m_todoLoaded.remove(bodyId);
-    m_synapseLoaded.remove(bodyId);
-    m_bodyConfigMap.remove(bodyId);
+    Shard &shard = getWritableShard(bodyId);
+    auto iter = shard.bodyMap.find(bodyId);
+    if (iter != shard.bodyMap.end()) {
+      for (uint64_t subId : iter.value()) {
+        unlinkParentUnsync(subId, bodyId);
+      }
+      shard.bodyMap.erase(iter);
+    }
+    shard.todoLoaded.remove(bodyId);
+    shard.synapseLoaded.remove(bodyId);
+    shard.bodyConfigMap.remove(bodyId);
   }
+  endBatch();
+}
+
+bool ZFlyEmBodyManager::ContainsBody(const Snapshot &snapshot, uint64_t id)
+{
+  return GetShard(snapshot, id).bodyMap.contains(id);
 }
 
 bool ZFlyEmBodyManager::contains(uint64_t id) const
@@ -107,17 +342,14 @@ bool ZFlyEmBodyManager::contains(uint64_t id) const
   if (encodingSupervoxel(id)) {
     return isOrphanSupervoxel(id);
   }
-  return m_bodyMap.contains(decode(id));
+  return ContainsBody(*getSnapshot(), decode(id));
 }
 
 bool ZFlyEmBodyManager::hasMapping(uint64_t id) const
 {
   id = decode(id);
-  if (m_bodyMap.contains(id)) {
-    return !m_bodyMap[id].isEmpty();
-  }
 
-  return false;
+  return !GetShard(*getSnapshot(), id).bodyMap.value(id).isEmpty();
 }
 
 uint64_t ZFlyEmBodyManager::getAggloId(uint64_t bodyId) const
@@ -127,11 +359,11 @@ uint64_t ZFlyEmBodyManager::getAggloId(uint64_t bodyId) const
   }
 
   bodyId = decode(bodyId);
-  for (QMap<uint64_t, QSet<uint64_t> >::const_iterator iter = m_bodyMap.begin();
-       iter != m_bodyMap.end(); ++iter) {
-    if (iter.value().contains(bodyId)) {
-      return iter.key();
-    }
+  QSet<uint64_t> parentSet =
+      GetShard(*getSnapshot(), bodyId).parentMap.value(bodyId);
+  if (!parentSet.isEmpty()) {
+    //The smallest one for a supervoxel in multiple mapped sets
+    return *std::min_element(parentSet.begin(), parentSet.end());
   }
 
   return bodyId;
@@ -140,7 +372,8 @@ uint64_t ZFlyEmBodyManager::getAggloId(uint64_t bodyId) const
 bool ZFlyEmBodyManager::isOrphanSupervoxel(uint64_t bodyId) const
 {
   if (couldBeSupervoxel(bodyId)) {
-    return m_bodyMap.value(0).contains(decode(bodyId));
+    bodyId = decode(bodyId);
+    return GetShard(*getSnapshot(), bodyId).parentMap.value(bodyId).contains(0);
   }
 
   return false;
@@ -150,12 +383,7 @@ bool ZFlyEmBodyManager::isSupervoxel(uint64_t bodyId) const
 {
   if (couldBeSupervoxel(bodyId)) {
     bodyId = decode(bodyId);
-    for (QMap<uint64_t, QSet<uint64_t> >::const_iterator iter = m_bodyMap.begin();
-         iter != m_bodyMap.end(); ++iter) {
-      if (iter.value().contains(bodyId)) {
-        return true;
-      }
-    }
+    return GetShard(*getSnapshot(), bodyId).parentMap.contains(bodyId);
   }
 
   return false;
@@ -163,12 +391,22 @@ bool ZFlyEmBodyManager::isSupervoxel(uint64_t bodyId) const
 
 QSet<uint64_t> ZFlyEmBodyManager::getMappedSet(uint64_t bodyId) const
 {
-  return m_bodyMap.value(decode(bodyId));
+  bodyId = decode(bodyId);
+
+  return GetShard(*getSnapshot(), bodyId).bodyMap.value(bodyId);
 }
 
 QSet<uint64_t> ZFlyEmBodyManager::getNormalBodySet() const
 {
-  QSet<uint64_t> bodySet = QSet<uint64_t>::fromList(m_bodyMap.keys());
+  QSet<uint64_t> bodySet;
+
+  std::shared_ptr<const Snapshot> snapshot = getSnapshot();
+  for (const Shard *shard : GetLeafArray(*snapshot)) {
+    for (auto iter = shard->bodyMap.begin(); iter != shard->bodyMap.end();
+         ++iter) {
+      bodySet.insert(iter.key());
+    }
+  }
   bodySet.remove(0);
 
   return bodySet;
@@ -178,11 +416,14 @@ QSet<uint64_t> ZFlyEmBodyManager::getUnmappedBodySet() const
 {
   QSet<uint64_t> bodySet;
 
-  for (QMap<uint64_t, QSet<uint64_t> >::const_iterator iter = m_bodyMap.begin();
-       iter != m_bodyMap.end(); ++iter) {
-    if (iter.key() > 0) {
-      if (iter.value().empty()) {
-        bodySet.insert(iter.key());
+  std::shared_ptr<const Snapshot> snapshot = getSnapshot();
+  for (const Shard *shard : GetLeafArray(*snapshot)) {
+    for (auto iter = shard->bodyMap.begin(); iter != shard->bodyMap.end();
+         ++iter) {
+      if (iter.key() > 0) {
+        if (iter.value().empty()) {
+          bodySet.insert(iter.key());
+        }
       }
     }
   }
@@ -190,37 +431,48 @@ QSet<uint64_t> ZFlyEmBodyManager::getUnmappedBodySet() const
   return bodySet;
 }
 
+QSet<uint64_t> ZFlyEmBodyManager::GetOrphanSupervoxelSet(
+    const Snapshot &snapshot)
+{
+  return GetShard(snapshot, 0).bodyMap.value(0);
+}
+
 QSet<uint64_t> ZFlyEmBodyManager::getOrphanSupervoxelSet(
     bool resultEncoded) const
 {
+  QSet<uint64_t> svSet = GetOrphanSupervoxelSet(*getSnapshot());
   if (resultEncoded) {
     QSet<uint64_t> bodySet;
-    for (uint64_t bodyId : m_bodyMap.value(0)) {
+    for (uint64_t bodyId : svSet) {
       bodySet.insert(EncodeSupervoxel(bodyId));
     }
     return bodySet;
   }
 
-  return m_bodyMap.value(0);
+  return svSet;
 }
 
 uint64_t ZFlyEmBodyManager::getSingleBodyId() const
 {
   uint64_t bodyId = 0;
 
+  std::shared_ptr<const Snapshot> snapshot = getSnapshot();
+
   QSet<uint64_t> bodySet;
-  for (QMap<uint64_t, QSet<uint64_t> >::const_iterator iter = m_bodyMap.begin();
-       iter != m_bodyMap.end(); ++iter) {
-    if (iter.key() > 0) {
-      if (iter.value().empty()) {
-        bodySet.insert(iter.key());
-      } else {
-        return 0; //Mapped body considered as multiple bodies
+  for (const Shard *shard : GetLeafArray(*snapshot)) {
+    for (auto iter = shard->bodyMap.begin(); iter != shard->bodyMap.end();
+         ++iter) {
+      if (iter.key() > 0) {
+        if (iter.value().empty()) {
+          bodySet.insert(iter.key());
+        } else {
+          return 0; //Mapped body considered as multiple bodies
+        }
       }
     }
   }
 
-  QSet<uint64_t> svSet = getOrphanSupervoxelSet(false);
+  QSet<uint64_t> svSet = GetOrphanSupervoxelSet(*snapshot);
   if (bodySet.size() + svSet.size() == 1) {
     if (bodySet.isEmpty()) {
       bodyId = EncodeSupervoxel(*svSet.begin());
@@ -235,35 +487,38 @@ uint64_t ZFlyEmBodyManager::getSingleBodyId() const
 void ZFlyEmBodyManager::setTodoLoaded(uint64_t bodyId)
 {
   bodyId = decode(bodyId);
-  m_todoLoaded.insert(bodyId);
+  beginBatch();
+  getWritableShard(bodyId).todoLoaded.insert(bodyId);
+  endBatch();
 }
 
 void ZFlyEmBodyManager::setSynapseLoaded(uint64_t bodyId)
 {
-  bodyId = decode(bodyId);
-  m_synapseLoaded.insert(bodyId);
+  setSynapseLoaded(bodyId, true);
 }
 
 void ZFlyEmBodyManager::setSynapseLoaded(uint64_t bodyId, bool on)
 {
   bodyId = decode(bodyId);
+  beginBatch();
   if (on) {
-    m_synapseLoaded.insert(bodyId);
+    getWritableShard(bodyId).synapseLoaded.insert(bodyId);
   } else {
-    m_synapseLoaded.remove(bodyId);
+    getWritableShard(bodyId).synapseLoaded.remove(bodyId);
   }
+  endBatch();
 }
 
 bool ZFlyEmBodyManager::isTodoLoaded(uint64_t bodyId) const
 {
   bodyId = decode(bodyId);
-  return m_todoLoaded.contains(bodyId);
+  return GetShard(*getSnapshot(), bodyId).todoLoaded.contains(bodyId);
 }
 
 bool ZFlyEmBodyManager::isSynapseLoaded(uint64_t bodyId) const
 {
   bodyId = decode(bodyId);
-  return m_synapseLoaded.contains(bodyId);
+  return GetShard(*getSnapshot(), bodyId).synapseLoaded.contains(bodyId);
 }
 
 void ZFlyEmBodyManager::addBodyConfig(const ZFlyEmBodyConfig &config)
@@ -271,18 +526,18 @@ void ZFlyEmBodyManager::addBodyConfig(const ZFlyEmBodyConfig &config)
   uint64_t bodyId = decode(config.getBodyId());
 
   if (bodyId > 0) {
-    m_bodyConfigMap[bodyId] = config;
+    beginBatch();
+    getWritableShard(bodyId).bodyConfigMap[bodyId] = config;
+    endBatch();
   }
 }
 
 ZFlyEmBodyConfig ZFlyEmBodyManager::getBodyConfig(uint64_t bodyId) const
 {
   bodyId = decode(bodyId);
-  if (m_bodyConfigMap.contains(bodyId)) {
-    return m_bodyConfigMap[bodyId];
-  }
 
-  return ZFlyEmBodyConfig();
+  return GetShard(*getSnapshot(), bodyId).bodyConfigMap.value(
+        bodyId, ZFlyEmBodyConfig());
 }
 
 QSet<uint64_t> ZFlyEmBodyManager::getSupervoxelToAdd(
@@ -345,27 +600,41 @@ void ZFlyEmBodyManager::erase(uint64_t bodyId)
 
 void ZFlyEmBodyManager::eraseSupervoxel(uint64_t bodyId)
 {
-  for (QMap<uint64_t, QSet<uint64_t> >::iterator iter = m_bodyMap.begin();
-       iter != m_bodyMap.end(); ++iter) {
-    if (iter.value().remove(bodyId)) {
-      break;
-    }
+  beginBatch();
+  QSet<uint64_t> parentSet =
+      GetShard(*m_workingSnapshot, bodyId).parentMap.value(bodyId);
+  if (!parentSet.isEmpty()) {
+    //Erase from the mapped set with the smallest key
+    uint64_t parentId = *std::min_element(parentSet.begin(), parentSet.end());
+    getWritableShard(parentId).bodyMap[parentId].remove(bodyId);
+    unlinkParentUnsync(bodyId, parentId);
   }
+  endBatch();
 }
 
 void ZFlyEmBodyManager::clear()
 {
-  m_bodyMap.clear();
-  m_bodyConfigMap.clear();
-  m_todoLoaded.clear();
-  m_synapseLoaded.clear();
+  beginBatch();
+  m_workingSnapshot->root = std::make_shared<Shard>();
+  m_copiedShardSet.insert(m_workingSnapshot->root.get());
+  endBatch();
 }
 
 void ZFlyEmBodyManager::print() const
 {
-  std::cout << "Body manager: " << m_bodyMap.size() << std::endl;
-  for (auto iter = m_bodyMap.begin(); iter != m_bodyMap.end(); ++iter) {
-    std::cout << iter.key() << ": " << iter.value().size() << std::endl;
+  std::shared_ptr<const Snapshot> snapshot = getSnapshot();
+
+  size_t bodyCount = 0;
+  for (const Shard *shard : GetLeafArray(*snapshot)) {
+    bodyCount += shard->bodyMap.size();
+  }
+
+  std::cout << "Body manager: " << bodyCount << std::endl;
+  for (const Shard *shard : GetLeafArray(*snapshot)) {
+    for (auto iter = shard->bodyMap.begin(); iter != shard->bodyMap.end();
+         ++iter) {
+      std::cout << iter.key() << ": " << iter.value().size() << std::endl;
+    }
   }
 }
 
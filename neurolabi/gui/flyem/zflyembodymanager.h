@@ -1,8 +1,16 @@
 #ifndef ZFLYEMBODYMANAGER_H
 #define ZFLYEMBODYMANAGER_H
 
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
 #include <QSet>
 #include <QMap>
+#include <QHash>
+#include <QMutex>
 
 #include "zflyembodyconfig.h"
 
@@ -15,6 +23,13 @@
  * supervoxels. Therefore, the entry of each body is stored as a mapping from
  * a normal body ID, which is always decoded, to a set of supervoxel IDs. Mapping
  * to an empty set means the body is registered as a normal body.
+ *
+ * The manager is thread safe. Reading functions do not lock: they read an
+ * immutable snapshot of the registry, which is replaced as a whole by the
+ * writer. Updates are serialized, and each update copies only the small
+ * shards holding the keys it touches, so its cost depends on those keys
+ * rather than the size of the registry. Use beginBatch() and endBatch() to
+ * apply many updates as one snapshot, e.g. when loading thousands of bodies.
  */
 class ZFlyEmBodyManager
 {
@@ -23,6 +38,18 @@ public:
 
   bool isEmpty() const;
 
+  /*!
+   * \brief Start a batch of updates
+   *
+   * The updates until the matching endBatch() are published to other threads
+   * at once. Reading functions called from the updating thread see the
+   * updates immediately. Batches can be nested, and a batch must end in the
+   * thread where it begins. Updates from other threads wait until the batch
+   * ends.
+   */
+  void beginBatch();
+  void endBatch();
+
   /*!
    * \brief Register a body
    *
@@ -164,11 +191,60 @@ private:
   static bool couldBeSupervoxel(uint64_t bodyId);
 
 private:
-  QMap<uint64_t, QSet<uint64_t>> m_bodyMap;
-  QMap<uint64_t, ZFlyEmBodyConfig> m_bodyConfigMap; //Hints for body update
-  QSet<uint64_t> m_todoLoaded;
-  QSet<uint64_t> m_synapseLoaded;
+  /*!
+   * The shards form a trie on the hash of the key. A leaf shard holds the
+   * entries of its keys, and it is split into SHARD_FANOUT children by the
+   * next bits of the hash once it has SHARD_CAPACITY entries. An entry is
+   * stored in the shard of its key, so a body and its mapped IDs are usually
+   * in different shards.
+   */
+  struct Shard {
+    QHash<uint64_t, QSet<uint64_t>> bodyMap;
+    QHash<uint64_t, QSet<uint64_t>> parentMap; //mapped ID -> bodies
+    QHash<uint64_t, ZFlyEmBodyConfig> bodyConfigMap; //Hints for body update
+    QSet<uint64_t> todoLoaded;
+    QSet<uint64_t> synapseLoaded;
+    std::vector<std::shared_ptr<Shard>> childArray; //Empty for a leaf
+
+    bool isLeaf() const { return childArray.empty(); }
+    size_t getEntryCount() const;
+  };
+
+  static const size_t SHARD_FANOUT = 16;
+  static const size_t SHARD_CAPACITY = 32;
+
+  struct Snapshot {
+    std::shared_ptr<Shard> root;
+  };
+
+  static uint64_t GetKeyHash(uint64_t id);
+  static const Shard& GetShard(const Snapshot &snapshot, uint64_t id);
+  static std::vector<const Shard*> GetLeafArray(const Snapshot &snapshot);
+  static bool ContainsBody(const Snapshot &snapshot, uint64_t id);
+  static QSet<uint64_t> GetOrphanSupervoxelSet(const Snapshot &snapshot);
+
+  std::shared_ptr<const Snapshot> getSnapshot() const;
+
+  //Functions for updating. They must be called between beginBatch() and
+  //endBatch().
+  Shard& getWritableShard(uint64_t id);
+  void makeWritable(std::shared_ptr<Shard> &shard);
+  void splitShard(Shard &shard, int shift);
+  void registerBodyUnsync(uint64_t id, const QSet<uint64_t> &comp);
+  void registerSupervoxelUnsync(uint64_t id);
+  void deregisterSupervoxelUnsync(uint64_t id);
+  void linkParentUnsync(uint64_t id, uint64_t parentId);
+  void unlinkParentUnsync(uint64_t id, uint64_t parentId);
 
+private:
+  std::shared_ptr<const Snapshot> m_snapshot; //Accessed atomically
+
+  //The snapshot being updated, which is only accessed in the updating thread
+  std::shared_ptr<Snapshot> m_workingSnapshot;
+  std::unordered_set<const Shard*> m_copiedShardSet; //Copied in the batch
+  std::atomic<int> m_batchDepth;
+  std::atomic<std::thread::id> m_batchThread;
+  QMutex m_writeMutex;
 };
 
 #endif // ZFLYEMBODYMANAGER_H
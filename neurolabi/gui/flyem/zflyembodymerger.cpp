@@ -1,5 +1,6 @@
 #include "zflyembodymerger.h"
 #include <iostream>
+#include <algorithm>
 #include <QList>
 #include <QDebug>
 
@@ -16,7 +17,12 @@ ZFlyEmBodyMerger::ZFlyEmBodyMerger()
 
 uint64_t ZFlyEmBodyMerger::getFinalLabel(uint64_t label) const
 {
-  return mapLabel(m_mapList, label);
+  int node = m_nodeIndex.value(label, -1);
+  if (node >= 0) {
+    return m_rootFinalLabel[findRoot(node)];
+  }
+
+  return label;
 }
 
 std::set<uint64_t> ZFlyEmBodyMerger::getFinalLabel(
@@ -47,16 +53,8 @@ ZFlyEmBodyMerger::TLabelMap ZFlyEmBodyMerger::getFinalMap() const
   }
 #endif
 
-//  std::cout << "Body merger:" << std::endl;
-  for (TLabelMapList::const_iterator iter = m_mapList.begin();
-       iter != m_mapList.end(); ++iter) {
-    const TLabelMap &currentLabelMap = *iter;
-    for (TLabelMap::const_iterator mapIter = currentLabelMap.begin();
-         mapIter != currentLabelMap.end(); ++mapIter) {
-      if (!labelMap.contains(mapIter.key())) {
-        labelMap[mapIter.key()] = getFinalLabel(mapIter.key());
-      }
-    }
+  for (size_t node = 0; node < m_nodeLabel.size(); ++node) {
+    labelMap[m_nodeLabel[node]] = m_rootFinalLabel[findRoot(node)];
   }
 
   return labelMap;
@@ -95,6 +93,124 @@ void ZFlyEmBodyMerger::pushMap(const TLabelMap &map)
 {
   if (!map.isEmpty()) {
     m_mapList.append(map);
+    updateIndex(map);
+  }
+}
+
+void ZFlyEmBodyMerger::setMapList(const TLabelMapList &mapList)
+{
+  m_mapList = mapList;
+  rebuildIndex();
+}
+
+int ZFlyEmBodyMerger::addNode(uint64_t label)
+{
+  int node = m_nodeLabel.size();
+  m_nodeIndex[label] = node;
+  m_nodeLabel.push_back(label);
+  m_parent.push_back(node);
+  m_rootFinalLabel.push_back(label);
+  m_rootMember.push_back(std::vector<int>(1, node));
+
+  return node;
+}
+
+int ZFlyEmBodyMerger::findRoot(int node) const
+{
+  while (m_parent[node] != node) {
+    node = m_parent[node];
+  }
+
+  return node;
+}
+
+int ZFlyEmBodyMerger::getFinalRoot(uint64_t finalLabel) const
+{
+  return m_finalRoot.value(finalLabel, -1);
+}
+
+void ZFlyEmBodyMerger::unite(int root1, int root2, uint64_t finalLabel)
+{
+  if (root1 != root2) {
+    //The smaller set is attached to the larger one. All of its members are
+    //linked to the new root directly, so each node is at most one step away
+    //from its root and a member is relinked O(log n) times in total.
+    if (m_rootMember[root1].size() < m_rootMember[root2].size()) {
+      std::swap(root1, root2);
+    }
+    std::vector<int> &member = m_rootMember[root1];
+    std::vector<int> &absorbed = m_rootMember[root2];
+    for (int node : absorbed) {
+      m_parent[node] = root1;
+    }
+    member.insert(member.end(), absorbed.begin(), absorbed.end());
+    std::vector<int>().swap(absorbed);
+  }
+
+  m_rootFinalLabel[root1] = finalLabel;
+  m_finalRoot[finalLabel] = root1;
+}
+
+void ZFlyEmBodyMerger::updateIndex(const TLabelMap &labelMap)
+{
+  //All pairs in a map are applied at the same time, i.e. a final label
+  //mapped by the map is not mapped again by another pair of the same map.
+  std::vector<std::pair<int, uint64_t> > moveArray;
+  for (TLabelMap::const_iterator iter = labelMap.begin();
+       iter != labelMap.end(); ++iter) {
+    uint64_t key = iter.key();
+    m_valueSet.insert(iter.value());
+
+    if (!m_nodeIndex.contains(key)) {
+      //An unmapped label belongs to the set of which it is the final label
+      int node = addNode(key);
+      int root = getFinalRoot(key);
+      if (root >= 0) {
+        unite(root, node, key);
+      } else {
+        m_finalRoot[key] = node;
+      }
+    }
+
+    //No root means the key has been mapped to another label
+    int root = getFinalRoot(key);
+    if (root >= 0) {
+      moveArray.push_back(std::make_pair(root, iter.value()));
+    }
+  }
+
+  for (const auto &move : moveArray) {
+    m_finalRoot.remove(m_rootFinalLabel[move.first]);
+  }
+
+  for (const auto &move : moveArray) {
+    int root = getFinalRoot(move.second);
+    if (root >= 0) {
+      unite(root, move.first, move.second);
+    } else {
+      m_rootFinalLabel[move.first] = move.second;
+      m_finalRoot[move.second] = move.first;
+    }
+  }
+}
+
+void ZFlyEmBodyMerger::clearIndex()
+{
+  m_nodeIndex.clear();
+  m_nodeLabel.clear();
+  m_parent.clear();
+  m_rootFinalLabel.clear();
+  m_rootMember.clear();
+  m_finalRoot.clear();
+  m_valueSet.clear();
+}
+
+void ZFlyEmBodyMerger::rebuildIndex()
+{
+  clearIndex();
+  for (TLabelMapList::const_iterator iter = m_mapList.begin();
+       iter != m_mapList.end(); ++iter) {
+    updateIndex(*iter);
   }
 }
 
@@ -141,6 +257,8 @@ void ZFlyEmBodyMerger::unmerge(uint64_t bodyId)
       }
     }
   }
+
+  rebuildIndex();
 }
 
 ZFlyEmBodyMerger::TLabelMap ZFlyEmBodyMerger::undo()
@@ -149,6 +267,7 @@ ZFlyEmBodyMerger::TLabelMap ZFlyEmBodyMerger::undo()
   if (!m_mapList.isEmpty()) {
     labelMap = m_mapList.takeLast();
     m_undoneMapStack.push(labelMap);
+    rebuildIndex();
   }
 
   return labelMap;
@@ -181,24 +300,12 @@ void ZFlyEmBodyMerger::clear()
 {
   m_mapList.clear();
   m_undoneMapStack.clear();
+  clearIndex();
 }
 
 bool ZFlyEmBodyMerger::isMerged(uint64_t label) const
 {
-  QSet<uint64_t> labelSet;
-  for (TLabelMapList::const_iterator iter = m_mapList.begin();
-       iter != m_mapList.end(); ++iter) {
-    const TLabelMap &currentLabelMap = *iter;
-//    std::cout << "--" << index << "--" << std::endl;
-    for (TLabelMap::const_iterator mapIter = currentLabelMap.begin();
-         mapIter != currentLabelMap.end(); ++mapIter) {
-      labelSet.insert(mapIter.key());
-      labelSet.insert(mapIter.value());
-//      std::cout << mapIter.key() << " -> " << mapIter.value() << std::endl;
-    }
-  }
-
-  return labelSet.contains(label);
+  return m_nodeIndex.contains(label) || m_valueSet.contains(label);
 }
 
 //ZJsonObject ZFlyEmBodyMerger::toJsonObject() const
@@ -249,7 +356,19 @@ void ZFlyEmBodyMerger::decodeJsonString(const std::string &str)
 
 QList<uint64_t> ZFlyEmBodyMerger::getOriginalLabelList(uint64_t finalLabel) const
 {
-  QList<uint64_t> list = getFinalMap().keys(finalLabel);
+  QList<uint64_t> list;
+
+  int root = getFinalRoot(finalLabel);
+  if (root >= 0) {
+    std::vector<uint64_t> labelArray;
+    for (int node : m_rootMember[root]) {
+      labelArray.push_back(m_nodeLabel[node]);
+    }
+    std::sort(labelArray.begin(), labelArray.end());
+    for (uint64_t label : labelArray) {
+      list.append(label);
+    }
+  }
   list.append(finalLabel);
 
   ZOUT(LTRACE(), 5) << list;
@@ -261,14 +380,14 @@ QSet<uint64_t> ZFlyEmBodyMerger::getOriginalLabelSet(uint64_t finalLabel) const
 {
   QSet<uint64_t> labelSet;
 
-  QList<uint64_t> labelList = getOriginalLabelList(finalLabel);
-
-  for (QList<uint64_t>::const_iterator iter = labelList.begin();
-       iter != labelList.end(); ++iter) {
-    uint64_t label = *iter;
-    labelSet.insert(label);
+  int root = getFinalRoot(finalLabel);
+  if (root >= 0) {
+    labelSet.reserve(m_rootMember[root].size() + 1);
+    for (int node : m_rootMember[root]) {
+      labelSet.insert(m_nodeLabel[node]);
+    }
   }
-//  labelSet.fromList(getOriginalLabelList(finalLabel));
+  labelSet.insert(finalLabel);
 
   ZOUT(LTRACE(), 5) << labelSet;
 
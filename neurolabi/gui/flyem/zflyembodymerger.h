@@ -7,7 +7,9 @@
 #include <QList>
 #include <QStack>
 #include <QSet>
+#include <QHash>
 #include <set>
+#include <vector>
 
 #include "tz_stdint.h"
 
@@ -18,6 +20,12 @@ class ZJsonArray;
  * \brief The ZFlyEmBodyMerger class
  *
  * label 0 is treated as null.
+ *
+ * The merging history is a list of label maps applied in order. Besides the
+ * history, the merger keeps a union-find index of all mapped labels, in which
+ * each set is the group of labels sharing the same final label. The index is
+ * updated incrementally by pushMap() and rebuilt from the history by
+ * operations that rewrite the history, such as undo() and unmerge().
  */
 class ZFlyEmBodyMerger
 {
@@ -40,9 +48,7 @@ public:
     return m_mapList;
   }
 
-  void setMapList(const TLabelMapList &mapList) {
-    m_mapList = mapList;
-  }
+  void setMapList(const TLabelMapList &mapList);
 
   void unmerge(uint64_t bodyId);
 
@@ -77,9 +83,27 @@ private:
   static uint64_t mapLabel(const TLabelMap &labelMap, uint64_t label);
   static uint64_t mapLabel(const TLabelMapList &labelMap, uint64_t label);
 
+  void rebuildIndex();
+  void updateIndex(const TLabelMap &labelMap);
+  void clearIndex();
+
+  int addNode(uint64_t label);
+  int findRoot(int node) const;
+  int getFinalRoot(uint64_t finalLabel) const;
+  void unite(int root1, int root2, uint64_t finalLabel);
+
 private:
   TLabelMapList m_mapList;
   TLabelMapStack m_undoneMapStack;
+
+  /* Union-find index. A node is created for every key in the history. */
+  QHash<uint64_t, int> m_nodeIndex; //label -> node
+  std::vector<uint64_t> m_nodeLabel;
+  std::vector<int> m_parent;
+  std::vector<uint64_t> m_rootFinalLabel; //only valid for roots
+  std::vector<std::vector<int> > m_rootMember; //only valid for roots
+  QHash<uint64_t, int> m_finalRoot; //final label -> root
+  QSet<uint64_t> m_valueSet; //all values in the history
 };
 
 template <typename InputIterator>
@@ -0,0 +1,228 @@
+#include "zflyembodyobjectcache.h"
+
+#include <sstream>
+#include <iterator>
+
+#include "zmesh.h"
+#include "zobject3dscan.h"
+
+bool ZFlyEmBodyObjectCache::Key::operator< (const Key &key) const
+{
+  if (bodyId != key.bodyId) {
+    return bodyId < key.bodyId;
+  }
+
+  if (level != key.level) {
+    return level < key.level;
+  }
+
+  if (labelType != key.labelType) {
+    return labelType < key.labelType;
+  }
+
+  return mutationId < key.mutationId;
+}
+
+bool ZFlyEmBodyObjectCache::Key::operator== (const Key &key) const
+{
+  return bodyId == key.bodyId && level == key.level &&
+      labelType == key.labelType && mutationId == key.mutationId;
+}
+
+std::string ZFlyEmBodyObjectCache::Stat::toString() const
+{
+  std::ostringstream stream;
+  stream << "hit: " << hitCount << "; miss: " << missCount
+         << "; eviction: " << evictionCount
+         << " (" << evictedByteCount << " bytes)";
+
+  return stream.str();
+}
+
+ZFlyEmBodyObjectCache::ZFlyEmBodyObjectCache()
+{
+  m_byteBudget = size_t(512) * 1024 * 1024;
+}
+
+ZFlyEmBodyObjectCache::~ZFlyEmBodyObjectCache()
+{
+  clear();
+}
+
+void ZFlyEmBodyObjectCache::setByteBudget(size_t byteCount)
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_byteBudget = byteCount;
+  evictUnsync();
+}
+
+size_t ZFlyEmBodyObjectCache::getByteBudget() const
+{
+  QMutexLocker locker(&m_mutex);
+
+  return m_byteBudget;
+}
+
+size_t ZFlyEmBodyObjectCache::getByteCount() const
+{
+  QMutexLocker locker(&m_mutex);
+
+  return m_byteCount;
+}
+
+size_t ZFlyEmBodyObjectCache::size() const
+{
+  QMutexLocker locker(&m_mutex);
+
+  return m_entryList.size();
+}
+
+void ZFlyEmBodyObjectCache::removeUnsync(TEntryList::iterator iter)
+{
+  m_byteCount -= iter->byteCount;
+  m_entryMap.erase(iter->key);
+  m_entryList.erase(iter);
+}
+
+void ZFlyEmBodyObjectCache::evictUnsync()
+{
+  while (m_byteCount > m_byteBudget && !m_entryList.empty()) {
+    TEntryList::iterator iter = std::prev(m_entryList.end());
+    ++m_stat.evictionCount;
+    m_stat.evictedByteCount += iter->byteCount;
+    delete iter->obj;
+    removeUnsync(iter);
+  }
+}
+
+void ZFlyEmBodyObjectCache::add(const Key &key, ZStackObject *obj)
+{
+  if (obj == NULL) {
+    return;
+  }
+
+  QMutexLocker locker(&m_mutex);
+
+  TEntryKey entryKey(obj->getType(), key);
+  auto mapIter = m_entryMap.find(entryKey);
+  if (mapIter != m_entryMap.end()) {
+    TEntryList::iterator iter = mapIter->second;
+    if (iter->obj != obj) {
+      delete iter->obj;
+    }
+    removeUnsync(iter);
+  }
+
+  Entry entry;
+  entry.key = entryKey;
+  entry.obj = obj;
+  entry.byteCount = EstimateByteCount(obj);
+
+  //Do not flush the whole cache for an object that can never fit
+  if (entry.byteCount > m_byteBudget) {
+    ++m_stat.evictionCount;
+    m_stat.evictedByteCount += entry.byteCount;
+    delete obj;
+    return;
+  }
+
+  m_entryList.push_front(entry);
+  m_entryMap[entryKey] = m_entryList.begin();
+  m_byteCount += entry.byteCount;
+
+  evictUnsync();
+}
+
+ZStackObject* ZFlyEmBodyObjectCache::findUnsync(
+    ZStackObject::EType type, const Key &key)
+{
+  auto mapIter = m_entryMap.find(TEntryKey(type, key));
+  if (mapIter == m_entryMap.end()) {
+    ++m_stat.missCount;
+    return NULL;
+  }
+
+  ++m_stat.hitCount;
+  m_entryList.splice(m_entryList.begin(), m_entryList, mapIter->second);
+
+  return mapIter->second->obj;
+}
+
+ZStackObject* ZFlyEmBodyObjectCache::take(
+    ZStackObject::EType type, const Key &key)
+{
+  QMutexLocker locker(&m_mutex);
+
+  ZStackObject *obj = findUnsync(type, key);
+  if (obj != NULL) {
+    removeUnsync(m_entryList.begin());
+  }
+
+  return obj;
+}
+
+void ZFlyEmBodyObjectCache::removeBody(uint64_t bodyId)
+{
+  QMutexLocker locker(&m_mutex);
+
+  for (TEntryList::iterator iter = m_entryList.begin();
+       iter != m_entryList.end();) {
+    TEntryList::iterator current = iter++;
+    if (current->key.second.bodyId == bodyId) {
+      delete current->obj;
+      removeUnsync(current);
+    }
+  }
+}
+
+void ZFlyEmBodyObjectCache::clear()
+{
+  QMutexLocker locker(&m_mutex);
+
+  for (Entry &entry : m_entryList) {
+    delete entry.obj;
+  }
+  m_entryList.clear();
+  m_entryMap.clear();
+  m_byteCount = 0;
+}
+
+ZFlyEmBodyObjectCache::Stat ZFlyEmBodyObjectCache::getStat() const
+{
+  QMutexLocker locker(&m_mutex);
+
+  return m_stat;
+}
+
+void ZFlyEmBodyObjectCache::resetStat()
+{
+  QMutexLocker locker(&m_mutex);
+
+  m_stat = Stat();
+}
+
+size_t ZFlyEmBodyObjectCache::EstimateByteCount(const ZStackObject *obj)
+{
+  size_t byteCount = 0;
+
+  if (const ZMesh *mesh = dynamic_cast<const ZMesh*>(obj)) {
+    byteCount = sizeof(ZMesh) +
+        mesh->vertices().capacity() * sizeof(glm::vec3) +
+        mesh->normals().capacity() * sizeof(glm::vec3) +
+        mesh->colors().capacity() * sizeof(glm::vec4) +
+        mesh->indices().capacity() * sizeof(GLuint) +
+        mesh->textureCoordinates1D().capacity() * sizeof(float) +
+        mesh->textureCoordinates2D().capacity() * sizeof(glm::vec2) +
+        mesh->textureCoordinates3D().capacity() * sizeof(glm::vec3);
+  } else if (const ZObject3dScan *sobj =
+             dynamic_cast<const ZObject3dScan*>(obj)) {
+    byteCount = sizeof(ZObject3dScan) +
+        sobj->getStripeNumber() * sizeof(ZObject3dStripe) +
+        sobj->getSegmentNumber() * 2 * sizeof(int);
+  } else if (obj != NULL) {
+    byteCount = sizeof(ZStackObject);
+  }
+
+  return byteCount;
+}
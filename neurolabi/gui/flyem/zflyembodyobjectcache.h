@@ -0,0 +1,181 @@
+#ifndef ZFLYEMBODYOBJECTCACHE_H
+#define ZFLYEMBODYOBJECTCACHE_H
+
+#include <list>
+#include <map>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "neutube_def.h"
+#include "zstackobject.h"
+
+/*!
+ * \brief The class of caching body objects within a byte budget
+ *
+ * The cache owns the body objects (meshes and sparse objects) that have been
+ * removed from a body document, so that they can be taken back without
+ * reading or computing them again. Each object is accounted by its estimated
+ * memory usage, and the least recently used objects are deleted when the total
+ * size exceeds the byte budget.
+ *
+ * An entry is identified by the object type and a key of (body ID, level,
+ * label type, mutation ID). A lookup with a different mutation ID misses, which
+ * keeps stale objects from being recovered after the body is modified.
+ *
+ * All functions are thread safe.
+ *
+ * Usage:
+ *   ZFlyEmBodyObjectCache cache;
+ *   cache.setByteBudget(1024 * 1024 * 1024);
+ *   cache.add(key, mesh);
+ *   ZMesh *mesh = cache.take<ZMesh>(key);
+ */
+class ZFlyEmBodyObjectCache
+{
+public:
+  ZFlyEmBodyObjectCache();
+  ~ZFlyEmBodyObjectCache();
+
+  struct Key {
+    Key() {}
+    Key(uint64_t bodyId, int level, flyem::EBodyLabelType labelType,
+        int64_t mutationId) :
+      bodyId(bodyId), level(level), labelType(labelType),
+      mutationId(mutationId) {}
+
+    bool operator< (const Key &key) const;
+    bool operator== (const Key &key) const;
+
+    uint64_t bodyId = 0;
+    int level = 0;
+    flyem::EBodyLabelType labelType = flyem::EBodyLabelType::BODY;
+    int64_t mutationId = 0;
+  };
+
+  struct Stat {
+    size_t hitCount = 0;
+    size_t missCount = 0;
+    size_t evictionCount = 0;
+    size_t evictedByteCount = 0;
+
+    std::string toString() const;
+  };
+
+  /*!
+   * \brief Set the byte budget
+   *
+   * Least recently used objects are deleted immediately if the current size
+   * exceeds \a byteCount.
+   */
+  void setByteBudget(size_t byteCount);
+  size_t getByteBudget() const;
+
+  /*!
+   * \brief Total estimated size of the cached objects
+   */
+  size_t getByteCount() const;
+
+  /*!
+   * \brief Number of cached objects
+   */
+  size_t size() const;
+
+  /*!
+   * \brief Add an object to the cache
+   *
+   * The cache takes the ownership of \a obj. An existing object with the same
+   * type and key is deleted. \a obj is deleted immediately if it is larger
+   * than the byte budget. Nothing is done if \a obj is NULL.
+   */
+  void add(const Key &key, ZStackObject *obj);
+
+  /*!
+   * \brief Take an object from the cache
+   *
+   * The caller is responsible for deleting the returned object.
+   *
+   * \return NULL if there is no object of \a type with \a key.
+   */
+  ZStackObject* take(ZStackObject::EType type, const Key &key);
+
+  template <typename T>
+  T* take(const Key &key);
+
+  /*!
+   * \brief Copy the cached object to \a obj
+   *
+   * The cached object is kept and becomes the most recently used one.
+   *
+   * \return false if there is no object of type T with \a key.
+   */
+  template <typename T>
+  bool copyTo(const Key &key, T *obj);
+
+  /*!
+   * \brief Remove all objects of a body.
+   */
+  void removeBody(uint64_t bodyId);
+
+  void clear();
+
+  Stat getStat() const;
+  void resetStat();
+
+  /*!
+   * \brief Estimate the memory usage of an object in bytes
+   *
+   * Only meshes and sparse objects are estimated from their data. Other objects
+   * are counted as the size of their class.
+   */
+  static size_t EstimateByteCount(const ZStackObject *obj);
+
+private:
+  typedef std::pair<ZStackObject::EType, Key> TEntryKey;
+
+  struct Entry {
+    TEntryKey key;
+    ZStackObject *obj = NULL;
+    size_t byteCount = 0;
+  };
+
+  typedef std::list<Entry> TEntryList;
+
+  ZStackObject* findUnsync(ZStackObject::EType type, const Key &key);
+  void removeUnsync(TEntryList::iterator iter);
+  void evictUnsync();
+
+private:
+  //From the most recently used to the least recently used
+  TEntryList m_entryList;
+  std::map<TEntryKey, TEntryList::iterator> m_entryMap;
+  size_t m_byteBudget;
+  size_t m_byteCount = 0;
+  Stat m_stat;
+  mutable QMutex m_mutex;
+};
+
+template <typename T>
+T* ZFlyEmBodyObjectCache::take(const Key &key)
+{
+  return dynamic_cast<T*>(take(T::GetType(), key));
+}
+
+template <typename T>
+bool ZFlyEmBodyObjectCache::copyTo(const Key &key, T *obj)
+{
+  QMutexLocker locker(&m_mutex);
+
+  T *cached = dynamic_cast<T*>(findUnsync(T::GetType(), key));
+  if (cached != NULL && obj != NULL) {
+    *obj = *cached;
+    return true;
+  }
+
+  return false;
+}
+
+#endif // ZFLYEMBODYOBJECTCACHE_H
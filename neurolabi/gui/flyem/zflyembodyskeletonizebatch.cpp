@@ -0,0 +1,366 @@
+#include "zflyembodyskeletonizebatch.h"
+
+#include <cmath>
+#include <atomic>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include "QsLog.h"
+#include "zswctree.h"
+#include "zobject3dscan.h"
+#include "zstackskeletonizer.h"
+#include "zflyemutilities.h"
+#include "dvid/zdvidreader.h"
+#include "dvid/zdvidwriter.h"
+#include "misc/miscutility.h"
+#include "geometry/zgeometry.h"
+
+std::string ZFlyEmBodySkeletonizeBatch::Stat::toString() const
+{
+  std::ostringstream stream;
+  stream << "skipped: " << skippedCount << "; reused: " << reusedCount
+         << "; skeletonized: " << skeletonizedCount
+         << "; failed: " << failedCount;
+
+  return stream.str();
+}
+
+ZFlyEmBodySkeletonizeBatch::ZFlyEmBodySkeletonizeBatch()
+{
+}
+
+void ZFlyEmBodySkeletonizeBatch::setDvidTarget(const ZDvidTarget &target)
+{
+  m_dvidTarget = target;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setBodyDvidTarget(const ZDvidTarget &target)
+{
+  m_bodyDvidTarget = target;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setOutputDir(const QString &dirPath)
+{
+  m_outputDir = dirPath;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setSkeletonizeConfig(
+    const ZJsonObject &config)
+{
+  m_config = config;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setDownsampleInterval(
+    int xintv, int yintv, int zintv)
+{
+  m_intv[0] = xintv;
+  m_intv[1] = yintv;
+  m_intv[2] = zintv;
+  m_intvSpecified = true;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setForceUpdate(bool on)
+{
+  m_forceUpdate = on;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setWorkerCount(int n)
+{
+  m_workerCount = n;
+}
+
+int ZFlyEmBodySkeletonizeBatch::getWorkerCount() const
+{
+  if (m_workerCount <= 0) {
+    return std::max(1, QThread::idealThreadCount());
+  }
+
+  return m_workerCount;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setPrefetchCount(int n)
+{
+  m_prefetchCount = std::max(1, n);
+}
+
+void ZFlyEmBodySkeletonizeBatch::setCheckpointPath(const std::string &path)
+{
+  m_checkpointPath = path;
+}
+
+void ZFlyEmBodySkeletonizeBatch::setResultFunc(
+    const std::function<void (uint64_t, const ZSwcTree *)> &func)
+{
+  m_resultFunc = func;
+}
+
+ZFlyEmBodySkeletonizeBatch::Stat ZFlyEmBodySkeletonizeBatch::getStat() const
+{
+  return m_stat;
+}
+
+ZFlyEmBodySkeletonizeBatch::TCheckpoint
+ZFlyEmBodySkeletonizeBatch::LoadCheckpoint(const std::string &path)
+{
+  TCheckpoint checkpoint;
+
+  std::ifstream stream(path.c_str());
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::istringstream lineStream(line);
+    uint64_t bodyId = 0;
+    if (lineStream >> bodyId) {
+      int64_t mutationId = 0;
+      if (!(lineStream >> mutationId)) {
+        mutationId = 0;
+      }
+      checkpoint[bodyId] = mutationId;
+    }
+  }
+
+  return checkpoint;
+}
+
+void ZFlyEmBodySkeletonizeBatch::AppendCheckpoint(
+    std::ostream &stream, uint64_t bodyId, int64_t mutationId)
+{
+  stream << bodyId << " " << mutationId << std::endl;
+}
+
+bool ZFlyEmBodySkeletonizeBatch::IsDone(
+    const TCheckpoint &checkpoint, uint64_t bodyId, int64_t mutationId)
+{
+  TCheckpoint::const_iterator iter = checkpoint.find(bodyId);
+
+  return (iter != checkpoint.end()) && (iter->second == mutationId);
+}
+
+void ZFlyEmBodySkeletonizeBatch::readBody(
+    const std::vector<uint64_t> &bodyIdArray, const TCheckpoint &checkpoint,
+    TJobQueue *queue)
+{
+  ZDvidReader reader;
+  reader.setVerbose(false);
+  ZDvidReader bodyReader;
+  bodyReader.setVerbose(false);
+
+  if (reader.openRaw(m_dvidTarget) &&
+      bodyReader.openRaw(m_bodyDvidTarget.isValid() ?
+                           m_bodyDvidTarget : m_dvidTarget)) {
+    for (uint64_t bodyId : bodyIdArray) {
+      Job job;
+      job.bodyId = bodyId;
+      job.mutationId = bodyReader.readBodyMutationId(bodyId);
+
+      if (IsDone(checkpoint, bodyId, job.mutationId)) {
+        job.done = true;
+      } else if (!m_forceUpdate || job.mutationId > 0) {
+        if (m_outputDir.isEmpty()) {
+          job.tree = reader.readSwc(bodyId);
+        } else {
+          QFileInfo fileInfo(
+                QDir(m_outputDir).absoluteFilePath(QString("%1.swc").arg(bodyId)));
+          if (fileInfo.exists()) {
+            job.tree = new ZSwcTree;
+            job.tree->load(fileInfo.absoluteFilePath().toStdString());
+          }
+        }
+      }
+
+      if (job.tree != NULL && job.mutationId > 0) {
+        if (flyem::GetMutationId(job.tree) != job.mutationId) {
+          delete job.tree;
+          job.tree = NULL;
+        }
+      }
+
+      if (job.tree != NULL) {
+        job.reused = true;
+      } else if (!job.done) {
+        int zoom = 0;
+        if (bodyReader.getDvidTarget().hasMultiscaleSegmentation()) {
+          const int blockCount = bodyReader.readBodyBlockCount(bodyId);
+          constexpr int maxBlockCount = 3000;
+          int scale = std::ceil(
+                misc::GetExpansionScale(blockCount, maxBlockCount));
+          zoom = std::min(2, zgeom::GetZoomLevel(int(std::ceil(scale))));
+          zoom = std::min(zoom, bodyReader.getDvidTarget().getMaxLabelZoom());
+        }
+
+        job.obj = new ZObject3dScan;
+        bodyReader.readMultiscaleBody(bodyId, zoom, true, job.obj);
+      }
+
+      if (!queue->push(job)) {
+        delete job.obj;
+        delete job.tree;
+        break;
+      }
+    }
+  } else {
+    LWARN() << "Failed to open DVID for reading bodies";
+  }
+
+  queue->close();
+}
+
+bool ZFlyEmBodySkeletonizeBatch::writeSkeleton(
+    ZDvidWriter &writer, uint64_t bodyId, ZSwcTree *tree)
+{
+  if (m_outputDir.isEmpty()) {
+    writer.writeSwc(bodyId, tree);
+    return writer.isStatusOk();
+  }
+
+  std::string filePath = QDir(m_outputDir).absoluteFilePath(
+        QString("%1.swc").arg(bodyId)).toStdString();
+  tree->save(filePath);
+
+  return QFileInfo(filePath.c_str()).exists();
+}
+
+bool ZFlyEmBodySkeletonizeBatch::run(const std::vector<uint64_t> &bodyIdArray)
+{
+  m_stat = Stat();
+
+  ZDvidWriter writer;
+  if (m_outputDir.isEmpty()) {
+    if (!writer.open(m_dvidTarget)) {
+      LWARN() << "Failed to open DVID for writing skeletons";
+      return false;
+    }
+  } else if (!QDir().mkpath(m_outputDir)) {
+    LWARN() << "Failed to create" << m_outputDir;
+    return false;
+  }
+
+  //A checkpointed body is still passed to the reader, which checks if the
+  //body has been modified since the checkpoint.
+  TCheckpoint checkpoint;
+  if (!m_checkpointPath.empty()) {
+    checkpoint = LoadCheckpoint(m_checkpointPath);
+    if (!checkpoint.empty()) {
+      LINFO() << "Resuming from" << m_checkpointPath << ":"
+              << checkpoint.size() << "bodies in the checkpoint";
+    }
+  }
+
+  std::ofstream checkpointStream;
+  if (!m_checkpointPath.empty()) {
+    checkpointStream.open(m_checkpointPath.c_str(), std::ios_base::app);
+    if (!checkpointStream.good()) {
+      LWARN() << "Failed to open checkpoint" << m_checkpointPath;
+      return false;
+    }
+  }
+
+  if (bodyIdArray.empty()) {
+    return true;
+  }
+
+  int workerCount = getWorkerCount();
+
+  //The skeletonizers are configured here because the configuration object is
+  //not safe to share between threads.
+  std::vector<std::unique_ptr<ZStackSkeletonizer>> skeletonizerArray;
+  for (int i = 0; i < workerCount; ++i) {
+    skeletonizerArray.emplace_back(new ZStackSkeletonizer);
+    if (!m_config.isEmpty()) {
+      skeletonizerArray.back()->configure(m_config);
+    }
+    if (m_intvSpecified) {
+      skeletonizerArray.back()->setDownsampleInterval(
+            m_intv[0], m_intv[1], m_intv[2]);
+    }
+  }
+
+  TJobQueue readQueue(m_prefetchCount);
+  TJobQueue writeQueue(m_prefetchCount + workerCount);
+
+  m_threadPool.setMaxThreadCount(workerCount + 1);
+
+  std::vector<QFuture<void> > futureArray;
+  futureArray.push_back(QtConcurrent::run(&m_threadPool, [&]() {
+    readBody(bodyIdArray, checkpoint, &readQueue);
+  }));
+
+  std::atomic<int> runningWorkerCount(workerCount);
+  for (int i = 0; i < workerCount; ++i) {
+    ZStackSkeletonizer *skeletonizer = skeletonizerArray[i].get();
+    futureArray.push_back(QtConcurrent::run(&m_threadPool, [&, skeletonizer]() {
+      Job job;
+      while (readQueue.pop(&job)) {
+        if (job.obj != NULL) {
+          job.tree = skeletonizer->makeSkeleton(*job.obj);
+          delete job.obj;
+          job.obj = NULL;
+          if (job.tree != NULL && job.mutationId > 0) {
+            flyem::SetMutationId(job.tree, job.mutationId);
+          }
+        }
+        if (!writeQueue.push(job)) {
+          delete job.tree;
+        }
+      }
+      if (--runningWorkerCount == 0) {
+        writeQueue.close();
+      }
+    }));
+  }
+
+  size_t count = 0;
+  Job job;
+  while (writeQueue.pop(&job)) {
+    ++count;
+
+    if (job.done) {
+      ++m_stat.skippedCount;
+      continue;
+    }
+
+    bool available = (job.tree != NULL);
+    if (job.reused) {
+      ++m_stat.reusedCount;
+    } else if (available) {
+      available = writeSkeleton(writer, job.bodyId, job.tree);
+      if (available) {
+        ++m_stat.skeletonizedCount;
+      } else {
+        LWARN() << "Failed to write the skeleton of" << job.bodyId;
+      }
+    } else {
+      LWARN() << "Skeletonization failed for" << job.bodyId;
+    }
+
+    if (available) {
+      if (m_resultFunc) {
+        m_resultFunc(job.bodyId, job.tree);
+      }
+      if (checkpointStream.is_open()) {
+        AppendCheckpoint(checkpointStream, job.bodyId, job.mutationId);
+      }
+    } else {
+      ++m_stat.failedCount;
+    }
+
+    delete job.tree;
+
+    LINFO() << ">>>>>>>>skeletonized>>>>>>>>>>" << count << " / "
+            << bodyIdArray.size();
+  }
+
+  for (QFuture<void> &future : futureArray) {
+    future.waitForFinished();
+  }
+
+  LINFO() << "Skeletonization done:" << m_stat.toString();
+
+  return true;
+}
@@ -0,0 +1,175 @@
+#ifndef ZFLYEMBODYSKELETONIZEBATCH_H
+#define ZFLYEMBODYSKELETONIZEBATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <functional>
+
+#include <QString>
+#include <QThreadPool>
+
+#include "dvid/zdvidtarget.h"
+#include "zjsonobject.h"
+#include "concurrent/zboundedqueue.h"
+
+class ZSwcTree;
+class ZObject3dScan;
+class ZDvidWriter;
+
+/*!
+ * \brief The class of skeletonizing a batch of DVID bodies
+ *
+ * The bodies go through a pipeline of three stages, which run concurrently:
+ *   1. A reader thread reads the bodies into a prefetch queue. A body whose
+ *      skeleton exists with the current mutation ID is passed on as it is.
+ *   2. A pool of workers, each of which has its own skeletonizer, turns the
+ *      bodies into skeletons.
+ *   3. The calling thread writes the skeletons to DVID or SWC files.
+ *
+ * The ID of each body whose skeleton is available is appended to the
+ * checkpoint file if there is one, together with the mutation ID of the body.
+ * When the batch is run again, a body in the checkpoint is skipped without
+ * reading its skeleton or object if its mutation ID is still the same, so an
+ * interrupted run can be resumed with the same checkpoint file. A body
+ * modified since then is processed again. Delete the file to start over.
+ *
+ * Usage:
+ *   ZFlyEmBodySkeletonizeBatch batch;
+ *   batch.setDvidTarget(target);
+ *   batch.setWorkerCount(4);
+ *   batch.setCheckpointPath("skeletonize.checkpoint");
+ *   batch.run(bodyIdArray);
+ */
+class ZFlyEmBodySkeletonizeBatch
+{
+public:
+  ZFlyEmBodySkeletonizeBatch();
+
+  struct Stat {
+    size_t skippedCount = 0; //done in a previous run
+    size_t reusedCount = 0; //existing skeletons
+    size_t skeletonizedCount = 0;
+    size_t failedCount = 0;
+
+    std::string toString() const;
+  };
+
+  /*!
+   * \brief Set the target where skeletons are read and written.
+   *
+   * It is also used for reading bodies if no body target is set.
+   */
+  void setDvidTarget(const ZDvidTarget &target);
+
+  /*!
+   * \brief Set the target for reading bodies, such as a mirror server.
+   */
+  void setBodyDvidTarget(const ZDvidTarget &target);
+
+  /*!
+   * \brief Save skeletons as <body ID>.swc in \a dirPath instead of DVID.
+   */
+  void setOutputDir(const QString &dirPath);
+
+  void setSkeletonizeConfig(const ZJsonObject &config);
+  void setDownsampleInterval(int xintv, int yintv, int zintv);
+
+  /*!
+   * \brief Skeletonize bodies even if their skeletons exist.
+   *
+   * An existing skeleton is still used if the body mutation ID is available
+   * and matches the skeleton.
+   */
+  void setForceUpdate(bool on);
+
+  /*!
+   * \brief Set the number of skeletonizing workers.
+   *
+   * \a n <= 0 means QThread::idealThreadCount().
+   */
+  void setWorkerCount(int n);
+
+  /*!
+   * \brief Set the maximum number of bodies waiting for skeletonization.
+   */
+  void setPrefetchCount(int n);
+
+  void setCheckpointPath(const std::string &path);
+
+  /*!
+   * \brief Set the function called for each available skeleton.
+   *
+   * It is called in the calling thread of run().
+   */
+  void setResultFunc(
+      const std::function<void(uint64_t, const ZSwcTree*)> &func);
+
+  /*!
+   * \brief Skeletonize bodies in the order of \a bodyIdArray.
+   *
+   * \return false if the output cannot be set up.
+   */
+  bool run(const std::vector<uint64_t> &bodyIdArray);
+
+  Stat getStat() const;
+
+  //Body ID -> mutation ID of the body when its skeleton was made
+  typedef std::map<uint64_t, int64_t> TCheckpoint;
+
+  /*!
+   * \brief Load a checkpoint file.
+   *
+   * Each line of the file is a body ID followed by its mutation ID. A line
+   * without a mutation ID, as written by an older version, gets 0, which
+   * means unknown. It returns an empty checkpoint if the file does not exist.
+   */
+  static TCheckpoint LoadCheckpoint(const std::string &path);
+
+  static void AppendCheckpoint(
+      std::ostream &stream, uint64_t bodyId, int64_t mutationId);
+
+  /*!
+   * \brief Check if a body is done according to a checkpoint.
+   *
+   * \return true iff \a bodyId is in \a checkpoint with \a mutationId.
+   */
+  static bool IsDone(
+      const TCheckpoint &checkpoint, uint64_t bodyId, int64_t mutationId);
+
+private:
+  struct Job {
+    uint64_t bodyId = 0;
+    int64_t mutationId = 0;
+    ZObject3dScan *obj = NULL;
+    ZSwcTree *tree = NULL;
+    bool reused = false;
+    bool done = false; //done in a previous run
+  };
+
+  typedef ZBoundedQueue<Job> TJobQueue;
+
+  int getWorkerCount() const;
+  void readBody(const std::vector<uint64_t> &bodyIdArray,
+                const TCheckpoint &checkpoint, TJobQueue *queue);
+  bool writeSkeleton(ZDvidWriter &writer, uint64_t bodyId, ZSwcTree *tree);
+
+private:
+  ZDvidTarget m_dvidTarget;
+  ZDvidTarget m_bodyDvidTarget;
+  QString m_outputDir;
+  ZJsonObject m_config;
+  int m_intv[3] = {0, 0, 0};
+  bool m_intvSpecified = false;
+  bool m_forceUpdate = false;
+  int m_workerCount = 1;
+  int m_prefetchCount = 2;
+  std::string m_checkpointPath;
+  std::function<void(uint64_t, const ZSwcTree*)> m_resultFunc;
+  Stat m_stat;
+  QThreadPool m_threadPool;
+};
+
+#endif // ZFLYEMBODYSKELETONIZEBATCH_H
@@ -56,6 +56,7 @@
 #include "zflyemroutinechecktask.h"
 #include "dvid/zdviddataslicehelper.h"
 #include "zarray.h"
+#include "zstack.hxx"
 #include "zflyembodymanager.h"
 #include "zmesh.h"
 
@@ -193,6 +194,7 @@ void ZFlyEmProofDoc::scheduleRoutineCheck()
 {
   if (m_routineCheck) {
     ZFlyEmRoutineCheckTask *task = new ZFlyEmRoutineCheckTask;
+    task->setKey("routine check");
     task->setDoc(this);
     addTask(task);
   }
@@ -2123,16 +2125,18 @@ void ZFlyEmProofDoc::prepareDvidLabelSlice(
     const ZStackViewParam &viewParam, int zoom, int centerCutX, int centerCutY,
     bool usingCenterCut)
 {
-  if (!m_workWriter.good()) {
-    m_workWriter.open(getDvidTarget());
+  ZDvidWriter &workWriter =
+      m_workWriter[neutube::EnumValue(viewParam.getSliceAxis())];
+  if (!workWriter.good()) {
+    workWriter.open(getDvidTarget());
   }
 
   ZArray *array = NULL;
 
-  if (m_workWriter.good()) {
+  if (workWriter.good()) {
     if (viewParam.getSliceAxis() == neutube::EAxis::ARB) {
       ZArbSliceViewParam svp = viewParam.getSliceViewParam();
-      array = m_workWriter.getDvidReader().readLabels64Lowtis(
+      array = workWriter.getDvidReader().readLabels64Lowtis(
             svp.getCenter(), svp.getPlaneV1(), svp.getPlaneV2(),
             svp.getWidth(), svp.getHeight(),
             zoom, centerCutX, centerCutY, usingCenterCut);
@@ -2140,7 +2144,7 @@ void ZFlyEmProofDoc::prepareDvidLabelSlice(
       ZIntCuboid box = ZDvidDataSliceHelper::GetBoundBox(
             viewParam.getViewPort(), viewParam.getZ());
 
-      array = m_workWriter.getDvidReader().readLabels64Lowtis(
+      array = workWriter.getDvidReader().readLabels64Lowtis(
             box.getFirstCorner().getX(), box.getFirstCorner().getY(),
             box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
             zoom, centerCutX, centerCutY, usingCenterCut);
@@ -2157,16 +2161,18 @@ void ZFlyEmProofDoc::prepareDvidGraySlice(
     const ZStackViewParam &viewParam, int zoom, int centerCutX, int centerCutY,
     bool usingCenterCut)
 {
-  if (!m_grayscaleWorkReader.good()) {
-    m_grayscaleWorkReader.open(getDvidTarget().getGrayScaleTarget());
+  ZDvidReader &workReader =
+      m_grayscaleWorkReader[neutube::EnumValue(viewParam.getSliceAxis())];
+  if (!workReader.good()) {
+    workReader.open(getDvidTarget().getGrayScaleTarget());
   }
 
   ZStack *array = NULL;
 
-  if (m_grayscaleWorkReader.good()) {
+  if (workReader.good()) {
     if (viewParam.getSliceAxis() == neutube::EAxis::ARB) {
       ZArbSliceViewParam svp = viewParam.getSliceViewParam();
-      array = m_grayscaleWorkReader.readGrayScaleLowtis(
+      array = workReader.readGrayScaleLowtis(
             svp.getCenter(), svp.getPlaneV1(), svp.getPlaneV2(),
             svp.getWidth(), svp.getHeight(),
             zoom, centerCutX, centerCutY, usingCenterCut);
@@ -2174,7 +2180,7 @@ void ZFlyEmProofDoc::prepareDvidGraySlice(
       ZIntCuboid box = ZDvidDataSliceHelper::GetBoundBox(
             viewParam.getViewPort(), viewParam.getZ());
 
-      array = m_grayscaleWorkReader.readGrayScaleLowtis(
+      array = workReader.readGrayScaleLowtis(
             box.getFirstCorner().getX(), box.getFirstCorner().getY(),
             box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
             zoom, centerCutX, centerCutY, usingCenterCut);
@@ -2187,6 +2193,62 @@ void ZFlyEmProofDoc::prepareDvidGraySlice(
   }
 }
 
+void ZFlyEmProofDoc::prefetchDvidLabelSlice(
+    ZDvidSliceCache<ZArray> *cache, uint64_t cacheVersion,
+    const QRect &viewPort, const std::vector<int> &sliceArray,
+    int zoom, int centerCutX, int centerCutY, bool usingCenterCut)
+{
+  if (!m_labelPrefetchReader.good()) {
+    m_labelPrefetchReader.open(getDvidTarget());
+  }
+
+  if (m_labelPrefetchReader.good()) {
+    for (int z : sliceArray) {
+      ZDvidSliceCache<ZArray>::Key key(
+            neutube::EAxis::Z, z, zoom, viewPort, centerCutX, centerCutY,
+            usingCenterCut);
+      if (!cache->contains(key)) {
+        ZIntCuboid box = ZDvidDataSliceHelper::GetBoundBox(viewPort, z);
+        ZArray *array = m_labelPrefetchReader.readLabels64Lowtis(
+              box.getFirstCorner().getX(), box.getFirstCorner().getY(),
+              box.getFirstCorner().getZ(), box.getWidth(), box.getHeight(),
+              zoom, centerCutX, centerCutY, usingCenterCut);
+        if (array != NULL) {
+          cache->add(key, array, array->getByteNumber(), cacheVersion);
+        }
+      }
+    }
+  }
+}
+
+void ZFlyEmProofDoc::prefetchDvidGraySlice(
+    ZDvidSliceCache<ZStack> *cache, uint64_t cacheVersion,
+    const QRect &viewPort, const std::vector<int> &sliceArray,
+    int zoom, int centerCutX, int centerCutY, bool usingCenterCut)
+{
+  if (!m_grayscalePrefetchReader.good()) {
+    m_grayscalePrefetchReader.open(getDvidTarget().getGrayScaleTarget());
+  }
+
+  if (m_grayscalePrefetchReader.good()) {
+    bool hasLowresRegion = ZDvidGraySlice::HasLowresRegion(
+          viewPort, zoom, centerCutX, centerCutY);
+    for (int z : sliceArray) {
+      ZDvidSliceCache<ZStack>::Key key(
+            neutube::EAxis::Z, z, zoom, viewPort, centerCutX, centerCutY,
+            usingCenterCut);
+      if (!cache->contains(key)) {
+        ZStack *stack = ZDvidGraySlice::ReadStack(
+              m_grayscalePrefetchReader, viewPort, z, zoom,
+              centerCutX, centerCutY, hasLowresRegion);
+        if (stack != NULL) {
+          cache->add(key, stack, stack->getByteNumber(), cacheVersion);
+        }
+      }
+    }
+  }
+}
+
 /*
 void ZFlyEmProofDoc::downloadBodyMask()
 {
@@ -2316,7 +2378,7 @@ void ZFlyEmProofDoc::updateDvidLabelSlice(neutube::EAxis axis)
        ++iter) {
     ZDvidLabelSlice *obj = dynamic_cast<ZDvidLabelSlice*>(*iter);
     if (obj->getSliceAxis() == axis) {
-//      obj->clearCache();
+      obj->clearCache();
       obj->forceUpdate(false);
       processObjectModified(obj);
     }
@@ -2447,7 +2509,7 @@ void ZFlyEmProofDoc::updateDvidLabelObject(neutube::EAxis axis)
   beginObjectModifiedMode(ZStackDoc::OBJECT_MODIFIED_CACHE);
   ZDvidLabelSlice *labelSlice = getDvidLabelSlice(axis);
   if (labelSlice != NULL) {
-//    labelSlice->clearCache();
+    labelSlice->clearCache();
     labelSlice->forceUpdate(false);
   }
 
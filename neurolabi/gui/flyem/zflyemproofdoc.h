@@ -21,6 +21,7 @@
 #include "dvid/zdvidversiondag.h"
 #include "zflyembodymergeproject.h"
 #include "flyem/zflyembodycoloroption.h"
+#include "dvid/zdvidslicecache.h"
 
 class ZDvidSparseStack;
 class ZFlyEmSupervisor;
@@ -32,6 +33,7 @@ class ZSlicedPuncta;
 class ZFlyEmSequencerColorScheme;
 class ZFlyEmSynapseAnnotationDialog;
 class ZStackArray;
+class ZArray;
 
 
 class ZFlyEmProofDoc : public ZStackDoc
@@ -433,6 +435,22 @@ public:
   void prepareDvidGraySlice(const ZStackViewParam &viewParam,
       int zoom, int centerCutX, int centerCutY, bool usingCenterCut);
 
+  /*!
+   * \brief Read Z slices into a slice cache.
+   *
+   * Slices that are already in \a cache are skipped. The slices are discarded
+   * if \a cache has been cleared since \a cacheVersion. It reads DVID with its
+   * own reader, so it can run along with the slice updates.
+   */
+  void prefetchDvidLabelSlice(
+      ZDvidSliceCache<ZArray> *cache, uint64_t cacheVersion,
+      const QRect &viewPort, const std::vector<int> &sliceArray,
+      int zoom, int centerCutX, int centerCutY, bool usingCenterCut);
+  void prefetchDvidGraySlice(
+      ZDvidSliceCache<ZStack> *cache, uint64_t cacheVersion,
+      const QRect &viewPort, const std::vector<int> &sliceArray,
+      int zoom, int centerCutX, int centerCutY, bool usingCenterCut);
+
   ZWidgetMessage getAnnotationFailureMessage(uint64_t bodyId) const;
 
   void downloadTodo(const std::vector<ZIntPoint> &ptArray);
@@ -664,8 +682,12 @@ protected:
   ZDvidWriter m_dvidWriter;
   ZFlyEmSupervisor *m_supervisor;
 
-  ZDvidWriter m_workWriter;
-  ZDvidReader m_grayscaleWorkReader;
+  //One per slice axis (indexed by neutube::EAxis) because the high-res
+  //slice tasks of different axes can run concurrently
+  ZDvidWriter m_workWriter[4];
+  ZDvidReader m_grayscaleWorkReader[4];
+  ZDvidReader m_labelPrefetchReader;
+  ZDvidReader m_grayscalePrefetchReader;
 
   ZFlyEmBodyMergeProject *m_mergeProject;
 
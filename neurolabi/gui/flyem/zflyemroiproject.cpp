@@ -16,6 +16,7 @@
 #include "dvid/zdvidreader.h"
 #include "swctreenode.h"
 #include "zobject3dscan.h"
+#include "zroiindex.h"
 #include "zstroke2d.h"
 #include "zstackfactory.h"
 #include "zstring.h"
@@ -1242,6 +1243,24 @@ double ZFlyEmRoiProject::estimateRoiVolume(char unit) const
   return totalVolume * res.voxelSize();
 }
 
+size_t ZFlyEmRoiProject::countSynapse(int xIntv, int yIntv, int zIntv) const
+{
+  if (m_puncta.empty()) {
+    return 0;
+  }
+
+  ZRoiIndex roiIndex(getRoiObject(xIntv, yIntv, zIntv),
+                     ZIntPoint(xIntv + 1, yIntv + 1, zIntv + 1));
+
+  std::vector<ZIntPoint> ptArray;
+  ptArray.reserve(m_puncta.size());
+  for (const ZPunctum *punctum : m_puncta) {
+    ptArray.push_back(punctum->getCenter().toIntPoint());
+  }
+
+  return roiIndex.countContained(ptArray);
+}
+
 void ZFlyEmRoiProject::setDsIntv(int xintv, int yintv, int zintv)
 {
   m_currentDsIntv.set(xintv, yintv, zintv);
@@ -155,6 +155,14 @@ public:
 
   double estimateRoiVolume(char unit = 'p') const;
 
+  /*!
+   * \brief Count the loaded synapses in the ROI
+   *
+   * The ROI is rasterized with the downsampling intervals
+   * (\a xIntv, \a yIntv, \a zIntv) before counting.
+   */
+  size_t countSynapse(int xIntv, int yIntv, int zIntv) const;
+
   void setDsIntv(int xintv, int yintv, int zintv);
 
   void setSynapseVisible(bool isVisible);
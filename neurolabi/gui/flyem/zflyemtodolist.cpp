@@ -57,16 +57,9 @@ ZIntCuboid ZFlyEmToDoList::update(const ZIntCuboid &box)
   }
 
   if (!dataBox.isEmpty()) {
-    ZDvidUrl dvidUrl(m_dvidTarget);
-    ZJsonArray obj = m_reader.readJsonArray(dvidUrl.getTodoListUrl(dataBox));
-
-    for (size_t i = 0; i < obj.size(); ++i) {
-      ZJsonObject itemJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
-      if (itemJson.hasKey("Pos")) {
-        ZFlyEmToDoItem item;
-        item.loadJsonObject(itemJson, flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON);
-        addItem(item, DATA_LOCAL);
-      }
+    std::vector<ZFlyEmToDoItem> itemArray = m_reader.readToDoItem(dataBox);
+    for (const ZFlyEmToDoItem &item : itemArray) {
+      addItem(item, DATA_LOCAL);
     }
   }
 
@@ -0,0 +1,149 @@
+#include "zlabelremapper.h"
+
+#include <algorithm>
+#include <QThread>
+#include <QtConcurrentRun>
+
+namespace {
+
+/*
+ * Append the first label of each run in [begin, end) to labelArray and make
+ * labelArray sorted and unique.
+ */
+void CollectRunLabel(const uint64_t *begin, const uint64_t *end,
+                     std::vector<uint64_t> *labelArray)
+{
+  if (begin < end) {
+    uint64_t prev = *begin;
+    labelArray->push_back(prev);
+    for (const uint64_t *p = begin + 1; p < end; ++p) {
+      if (*p != prev) {
+        prev = *p;
+        labelArray->push_back(prev);
+      }
+    }
+  }
+
+  std::sort(labelArray->begin(), labelArray->end());
+  labelArray->erase(std::unique(labelArray->begin(), labelArray->end()),
+                    labelArray->end());
+}
+
+void ApplyLabelMap(const uint64_t *begin, const uint64_t *end, uint64_t *dst,
+                   const std::vector<uint64_t> &labelArray,
+                   const std::vector<uint64_t> &mappedArray)
+{
+  if (begin < end) {
+    uint64_t prev = 0;
+    uint64_t mapped = 0;
+    bool cached = false;
+    for (const uint64_t *p = begin; p < end; ++p, ++dst) {
+      uint64_t label = *p;
+      if (!cached || label != prev) {
+        size_t index = std::lower_bound(
+              labelArray.begin(), labelArray.end(), label) - labelArray.begin();
+        mapped = mappedArray[index];
+        prev = label;
+        cached = true;
+      }
+      *dst = mapped;
+    }
+  }
+}
+
+}
+
+ZLabelRemapper::ZLabelRemapper()
+{
+  m_threadCount = std::max(1, QThread::idealThreadCount());
+  m_minParallelSize = 512 * 512;
+}
+
+int ZLabelRemapper::getBlockNumber(size_t n) const
+{
+  if (n < m_minParallelSize || m_threadCount <= 1) {
+    return 1;
+  }
+
+  return int(std::min(size_t(m_threadCount), n / (m_minParallelSize / 4) + 1));
+}
+
+void ZLabelRemapper::collectLabel(
+    const uint64_t *src, size_t n, int blockNumber)
+{
+  m_labelArray.clear();
+
+  if (blockNumber <= 1) {
+    CollectRunLabel(src, src + n, &m_labelArray);
+  } else {
+    //Blocks run in the global thread pool; the calling thread takes the last
+    std::vector<std::vector<uint64_t> > blockLabelArray(blockNumber);
+    std::vector<QFuture<void> > futureArray;
+    size_t blockSize = (n + blockNumber - 1) / blockNumber;
+    for (int i = 0; i < blockNumber; ++i) {
+      const uint64_t *begin = src + std::min(n, i * blockSize);
+      const uint64_t *end = src + std::min(n, (i + 1) * blockSize);
+      std::vector<uint64_t> *labelArray = &(blockLabelArray[i]);
+      if (i + 1 < blockNumber) {
+        futureArray.push_back(QtConcurrent::run([=]() {
+          CollectRunLabel(begin, end, labelArray);
+        }));
+      } else {
+        CollectRunLabel(begin, end, labelArray);
+      }
+    }
+    for (QFuture<void> &future : futureArray) {
+      future.waitForFinished();
+    }
+
+    for (const std::vector<uint64_t> &labelArray : blockLabelArray) {
+      m_labelArray.insert(
+            m_labelArray.end(), labelArray.begin(), labelArray.end());
+    }
+    std::sort(m_labelArray.begin(), m_labelArray.end());
+    m_labelArray.erase(std::unique(m_labelArray.begin(), m_labelArray.end()),
+                       m_labelArray.end());
+  }
+}
+
+void ZLabelRemapper::applyMap(
+    const uint64_t *src, size_t n, uint64_t *dst, int blockNumber) const
+{
+  if (blockNumber <= 1) {
+    ApplyLabelMap(src, src + n, dst, m_labelArray, m_mappedArray);
+  } else {
+    std::vector<QFuture<void> > futureArray;
+    size_t blockSize = (n + blockNumber - 1) / blockNumber;
+    for (int i = 0; i < blockNumber; ++i) {
+      size_t start = std::min(n, i * blockSize);
+      size_t end = std::min(n, (i + 1) * blockSize);
+      if (i + 1 < blockNumber) {
+        futureArray.push_back(QtConcurrent::run([=]() {
+          ApplyLabelMap(src + start, src + end, dst + start,
+                        m_labelArray, m_mappedArray);
+        }));
+      } else {
+        ApplyLabelMap(src + start, src + end, dst + start,
+                      m_labelArray, m_mappedArray);
+      }
+    }
+    for (QFuture<void> &future : futureArray) {
+      future.waitForFinished();
+    }
+  }
+}
+
+void ZLabelRemapper::remap(
+    const uint64_t *src, size_t n, uint64_t *dst, const TResolver &resolve)
+{
+  int blockNumber = getBlockNumber(n);
+
+  collectLabel(src, n, blockNumber);
+
+  m_mappedArray.resize(m_labelArray.size());
+  for (size_t i = 0; i < m_labelArray.size(); ++i) {
+    m_mappedArray[i] = resolve(m_labelArray[i]);
+  }
+
+  applyMap(src, n, dst, blockNumber);
+}
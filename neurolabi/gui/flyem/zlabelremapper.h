@@ -0,0 +1,72 @@
+#ifndef ZLABELREMAPPER_H
+#define ZLABELREMAPPER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+/*!
+ * \brief The class of remapping a label array
+ *
+ * A label field usually has only a few hundred distinct labels even when it
+ * has millions of pixels. Instead of looking up the mapping tables for every
+ * pixel, the remapper collects the distinct labels first, resolves each of
+ * them once and then writes the output through a sorted lookup table. Runs of
+ * equal labels are resolved only once in both passes. Large arrays are
+ * split into contiguous blocks, which are processed in the global thread pool
+ * (QThreadPool) and the calling thread.
+ *
+ * Usage:
+ *   ZLabelRemapper remapper;
+ *   remapper.remap(src, n, dst, [](uint64_t label) { return label + 1; });
+ */
+class ZLabelRemapper
+{
+public:
+  ZLabelRemapper();
+
+  typedef std::function<uint64_t(uint64_t)> TResolver;
+
+  /*!
+   * \brief Map src[i] to dst[i] = resolve(src[i]) for i in [0, n).
+   *
+   * \a resolve is called once for each distinct label in the calling thread.
+   * \a src and \a dst can be the same array.
+   */
+  void remap(const uint64_t *src, size_t n, uint64_t *dst,
+             const TResolver &resolve);
+
+  /*!
+   * \brief Set the maximum number of threads
+   *
+   * Only arrays with at least getMinParallelSize() elements are processed in
+   * parallel.
+   */
+  void setThreadCount(int n) { m_threadCount = n; }
+  int getThreadCount() const { return m_threadCount; }
+
+  void setMinParallelSize(size_t n) { m_minParallelSize = n; }
+  size_t getMinParallelSize() const { return m_minParallelSize; }
+
+  /*!
+   * \brief Sorted distinct labels found in the last remapping.
+   */
+  const std::vector<uint64_t>& getLabelArray() const {
+    return m_labelArray;
+  }
+
+private:
+  void collectLabel(const uint64_t *src, size_t n, int blockNumber);
+  void applyMap(const uint64_t *src, size_t n, uint64_t *dst,
+                int blockNumber) const;
+  int getBlockNumber(size_t n) const;
+
+private:
+  int m_threadCount;
+  size_t m_minParallelSize;
+  std::vector<uint64_t> m_labelArray;
+  std::vector<uint64_t> m_mappedArray;
+};
+
+#endif // ZLABELREMAPPER_H
@@ -3,6 +3,8 @@
 #include <QElapsedTimer>
 
 #include "imgproc/zstackwatershed.h"
+#include "imgproc/zsparsestackwatershed.h"
+#include "imgproc/zstackparallelwatershed.h"
 #include "zstack.hxx"
 #include "zobject3d.h"
 #include "zstroke2d.h"
@@ -138,6 +140,8 @@ void ZStackWatershedContainer::clearSource()
 void ZStackWatershedContainer::clearResult()
 {
   m_result.clear();
+  delete m_sparseResult;
+  m_sparseResult = NULL;
 }
 
 ZIntPoint ZStackWatershedContainer::getSourceDsIntv()
@@ -215,7 +219,7 @@ bool ZStackWatershedContainer::isDeprecated(EComponent component) const
   case COMP_WORKSPACE:
     return m_workspace == NULL;
   case COMP_RESULT:
-    return m_result.empty();
+    return m_result.empty() && m_sparseResult == NULL;
   }
 
   return false;
@@ -645,6 +649,10 @@ Stack* ZStackWatershedContainer::getSource()
 
 bool ZStackWatershedContainer::hasResult() const
 {
+  if (m_sparseResult != NULL) {
+    return true;
+  }
+
   for (const auto &result : m_result) {
     if (result) {
       return true;
@@ -673,7 +681,8 @@ void ZStackWatershedContainer::refineBorder()
       //bigger than that of the source
       ZStackArray currentResult = m_result;
       for (const ZStackPtr &result : currentResult) {
-        if (result->getDsIntv() == lastDsIntv) {
+        //Border seeds are made from 8-bit labels only
+        if (result->getDsIntv() == lastDsIntv && result->kind() == GREY) {
           refineBorder(result);
         }
       }
@@ -705,6 +714,7 @@ void ZStackWatershedContainer::refineBorder(const ZStackPtr &stack)
 //          container.useSeedRange(true);
     container.setRangeHint(RANGE_SEED_BOUND);
     container.setRefiningBorder(false);
+    container.setComputingParallel(m_computingParallel, m_threadCount);
 
     std::vector<ZObject3d*> newSeeds = MakeBorderSeed(
           *stack, *boundaryStack, subbound.getBoundBox());
@@ -760,7 +770,9 @@ void ZStackWatershedContainer::run()
   timer.start();
 
   //Todo: unified processing for dense and sparse stacks
-  if(m_stack && m_stack->hasData() && m_scale > 1){//for normal stack
+  if (m_spStack != NULL && m_computingSparse) {
+    runSparse();
+  } else if(m_stack && m_stack->hasData() && m_scale > 1){//for normal stack
     ZStackMultiScaleWatershed watershed;
     ZStackPtr stack(watershed.run(getSourceStack(),
                                   m_seedArray,m_scale,m_algorithm,m_dsMethod));
@@ -769,7 +781,9 @@ void ZStackWatershedContainer::run()
   } else {
     Stack *source = getSource();
     if (source != NULL) {
-      updateSeedMask();
+      if (!m_computingParallel) {
+        updateSeedMask();
+      }
 
 #ifdef _DEBUG_2
       exportMask(GET_TEST_DATA_DIR + "/test.tif");
@@ -780,13 +794,17 @@ void ZStackWatershedContainer::run()
 #endif
 
       if (m_result.empty()) {
-        getWorkspace()->conn=6;
-        Stack *out = C_Stack::watershed(source, getWorkspace());
-        ZStackPtr stack = ZStackPtr::Make();
-        stack->consume(out);
-        stack->setOffset(getSourceOffset());
-        stack->setDsIntv(getSourceStack()->getDsIntv());
-        m_result.push_back(stack);
+        if (m_computingParallel) {
+          runParallel();
+        } else {
+          getWorkspace()->conn=6;
+          Stack *out = C_Stack::watershed(source, getWorkspace());
+          ZStackPtr stack = ZStackPtr::Make();
+          stack->consume(out);
+          stack->setOffset(getSourceOffset());
+          stack->setDsIntv(getSourceStack()->getDsIntv());
+          m_result.push_back(stack);
+        }
       }
 
       std::cout << "Downsampling interval: "
@@ -803,8 +821,53 @@ void ZStackWatershedContainer::run()
   std::cout << "Watershed time: " << timer.elapsed() << "ms" << std::endl;
 }
 
+void ZStackWatershedContainer::runSparse()
+{
+  //Only the blocks overlapping with the range are needed
+  m_spStack->cacheStackSourceInBox(getRange());
+
+  ZSparseStackWatershed watershed;
+  watershed.setRange(getRange());
+  watershed.setFloodingZero(m_floodingZero);
+  watershed.setSeedDsIntv(getOriginalDsIntv());
+  m_sparseResult = watershed.run(*m_spStack, m_seedArray);
+
+  std::cout << "Sparse watershed voxel count: " << watershed.getVoxelNumber()
+            << std::endl;
+}
+
+void ZStackWatershedContainer::runParallel()
+{
+  ZStackParallelWatershed watershed;
+  if (m_threadCount > 0) {
+    watershed.setThreadCount(m_threadCount);
+  }
+  watershed.setFloodingZero(m_floodingZero);
+  watershed.setSignal(getSource());
+  watershed.addSeed(m_seedArray, getSourceOffset(), getSourceDsIntv());
+
+  if (watershed.run()) {
+    ZStackPtr stack(watershed.makeLabelStack());
+    if (stack) {
+      stack->setOffset(getSourceOffset());
+      stack->setDsIntv(getSourceStack()->getDsIntv());
+      m_result.push_back(stack);
+    } else {
+      ZOUT(LWARN(), 5) << "Too many seeds for parallel watershed:"
+                       << watershed.getMaxLabel();
+    }
+
+    std::cout << "Parallel watershed boundary passes: "
+              << watershed.getReconcilePassNumber() << std::endl;
+  }
+}
+
 bool ZStackWatershedContainer::computationDowsampled()
 {
+  if (m_sparseResult != NULL) {
+    return !getOriginalDsIntv().isZero();
+  }
+
   return !getSourceDsIntv().isZero();
 }
 
@@ -1295,14 +1358,32 @@ ZObject3dScanArray* ZStackWatershedContainer::makeSplitResult(uint64_t minLabel,
     result->clearAll();
   }
 
-  if (m_result.empty()) {
+  if (m_result.empty() && m_sparseResult == NULL) {
     return result;
   }
 
   //Extract labeled regions
-  //m_result will be sorted from low res to high res
-  ZObject3dScanArray *objArray =
-      ZObject3dFactory::MakeObject3dScanArray(m_result);
+  ZObject3dScanArray *objArray = NULL;
+  //Most and least downsampling
+  ZIntPoint firstDsIntv;
+  ZIntPoint lastDsIntv;
+  if (m_sparseResult != NULL) {
+    objArray = new ZObject3dScanArray;
+    ZIntPoint dsIntv = getOriginalDsIntv();
+    for (const ZObject3dScan *obj : *m_sparseResult) {
+      ZObject3dScan *newObj = new ZObject3dScan(*obj);
+      newObj->upSample(dsIntv);
+      newObj->setDsIntv(0);
+      objArray->append(newObj);
+    }
+    firstDsIntv = dsIntv;
+    lastDsIntv = dsIntv;
+  } else {
+    //m_result will be sorted from low res to high res
+    objArray = ZObject3dFactory::MakeObject3dScanArray(m_result);
+    firstDsIntv = m_result.front()->getDsIntv();
+    lastDsIntv = m_result.back()->getDsIntv();
+  }
 
   //For sparse stack only for the current version
   if (m_spStack != NULL) {
@@ -1313,7 +1394,6 @@ ZObject3dScanArray* ZStackWatershedContainer::makeSplitResult(uint64_t minLabel,
 
 //    ZIntPoint sourceDsIntv = getSourceStack()->getDsIntv();
     ZIntPoint orgDsIntv = getOriginalDsIntv();
-    ZIntPoint lastDsIntv = m_result.back()->getDsIntv();
     bool adopting = true; //Flag for re-assigning fragments
     if (lastDsIntv == orgDsIntv) {
       adopting = false;
@@ -1343,8 +1423,6 @@ ZObject3dScanArray* ZStackWatershedContainer::makeSplitResult(uint64_t minLabel,
       }
     }
 
-    //Most downsampling
-    ZIntPoint dsIntv = m_result.front()->getDsIntv();
     for (ZObject3dScanArray::iterator iter = objArray->begin();
          iter != objArray->end(); ++iter) {
       ZObject3dScan &obj = **iter;
@@ -1352,7 +1430,7 @@ ZObject3dScanArray* ZStackWatershedContainer::makeSplitResult(uint64_t minLabel,
         std::cout << "Processing label " << obj.getLabel() << std::endl;
 
 //        if (!dsIntv.isZero()) { //Process downsampled regions
-        if (dsIntv != orgDsIntv) {
+        if (firstDsIntv != orgDsIntv) {
           ZObject3dScan *currentBody =
               processSplitResult(obj, remainBody, adopting);
           result->append(currentBody);
@@ -193,6 +193,38 @@ public:
     m_preservingGap = on;
   }
 
+  /*!
+   * \brief Turn on/off computing in the sparse domain
+   *
+   * When it is on and the container has a sparse stack, the watershed runs
+   * only on the voxels of the object mask within the range (see
+   * ZSparseStackWatershed), without making a dense stack of the range. The
+   * computation is always done in the resolution of the sparse stack, so
+   * maximal volume, gap preserving and border refinement have no effect.
+   */
+  void setComputingSparse(bool on) {
+    m_computingSparse = on;
+  }
+  bool computingSparse() const {
+    return m_computingSparse;
+  }
+
+  /*!
+   * \brief Turn on/off computing with ZStackParallelWatershed
+   *
+   * When it is on, the dense stack is flooded in blocks by \a threadCount
+   * threads (0 for the number of cores), and seed labels are not limited to
+   * 8 bits. A result with labels larger than 255 is a GREY16 stack, which
+   * cannot hold labels larger than 65535, and its border is not refined.
+   */
+  void setComputingParallel(bool on, int threadCount = 0) {
+    m_computingParallel = on;
+    m_threadCount = threadCount;
+  }
+  bool computingParallel() const {
+    return m_computingParallel;
+  }
+
   void test();
   static bool Test();
 
@@ -265,11 +297,14 @@ private:
   ZGraphPtr buildSeedGraph(double maxDist) const;
 
   void refineBorder(const ZStackPtr &stack);
+  void runSparse();
+  void runParallel();
 
 private:
   ZStack *m_stack = NULL;
   ZSparseStack *m_spStack = NULL;
   ZStackArray m_result;
+  ZObject3dScanArray *m_sparseResult = NULL; //Result of sparse computation
   Stack_Watershed_Workspace *m_workspace = NULL;
 //  ZIntPoint m_sourceOffset;
   ZIntCuboid m_range;
@@ -283,6 +318,9 @@ private:
   bool m_refiningBorder = true;
   bool m_preservingGap = false; //Preserve gaps while downsampling
   bool m_ccaPost = true; //connected component analysis as post-processing
+  bool m_computingSparse = false;
+  bool m_computingParallel = false;
+  int m_threadCount = 0; //Number of threads for parallel computing
   int m_scale;
   size_t m_minIsolationSize = 50;
   size_t m_maxStackVolume = neutube::HALFGIGA;
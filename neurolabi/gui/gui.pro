@@ -756,10 +756,13 @@ HEADERS += mainwindow.h \
     dialogs/zflyemskeletonupdatedialog.h \
     dialogs/zdvidadvanceddialog.h \
     dvid/zdvidroi.h \
+    zroiindex.h \
+    dvid/zdvidannotationdecoder.h \
     widgets/zdvidsourcewidget.h \
     z3dmainwindow.h \
     dvid/zdvidgrayscale.h \
     zscrollslicestrategy.h \
+    zslicescrollmotion.h \
     dvid/zdvidgrayslicescrollstrategy.h \
     zviewproj.h \
     dialogs/zflyemgrayscaledialog.h \
@@ -863,6 +866,7 @@ HEADERS += mainwindow.h \
     znetbufferreader.h \
     zstackviewhelper.h \
     dvid/zdviddataslicehelper.h \
+    dvid/zdvidslicecache.h \
     flyem/zflyemproofmvccontroller.h \
     flyem/zmainwindowcontroller.h \
     zstackdocnullmenufactory.h \
@@ -882,14 +886,20 @@ HEADERS += mainwindow.h \
     concurrent/zworkthread.h \
     concurrent/zworker.h \
     concurrent/ztaskqueue.h \
+    concurrent/ztaskscheduler.h \
     flyem/zflyemroutinechecktask.h \
     flyem/zdvidlabelslicehighrestask.h \
     flyem/zdvidgrayslicehighrestask.h \
+    flyem/zdvidgraysliceprefetchtask.h \
+    flyem/zdvidlabelsliceprefetchtask.h \
     flyem/zdviddataslicetask.h \
     dvid/zdvidbodyhelper.h \
     flyem/zflyembodyevent.h \
     flyem/zflyembodyconfig.h \
     flyem/zflyembodymanager.h \
+    flyem/zflyembodyobjectcache.h \
+    flyem/zflyembodyskeletonizebatch.h \
+    concurrent/zboundedqueue.h \
     z3dwindowcontroller.h \
     z3d2dslicerenderer.h \
     z3d2dslicefilter.h \
@@ -905,6 +915,7 @@ HEADERS += mainwindow.h \
     flyem/zflyembodyenv.h \
     protocols/taskprotocoltaskfactory.h \
     dvid/zdvidblockstream.h \
+    dvid/zdvidgrayscaleblockfetcher.h \
     core/memorystream.h \
     imgproc/zstackmultiscalewatershed.h
 
@@ -1450,10 +1461,13 @@ SOURCES += main.cpp \
     dialogs/zflyemskeletonupdatedialog.cpp \
     dialogs/zdvidadvanceddialog.cpp \
     dvid/zdvidroi.cpp \
+    zroiindex.cpp \
+    dvid/zdvidannotationdecoder.cpp \
     widgets/zdvidsourcewidget.cpp \
     z3dmainwindow.cpp \
     dvid/zdvidgrayscale.cpp \
     zscrollslicestrategy.cpp \
+    zslicescrollmotion.cpp \
     dvid/zdvidgrayslicescrollstrategy.cpp \
     zviewproj.cpp \
     dialogs/zflyemgrayscaledialog.cpp \
@@ -1574,14 +1588,19 @@ SOURCES += main.cpp \
     concurrent/zworkthread.cpp \
     concurrent/zworker.cpp \
     concurrent/ztaskqueue.cpp \
+    concurrent/ztaskscheduler.cpp \
     flyem/zflyemroutinechecktask.cpp \
     flyem/zdvidlabelslicehighrestask.cpp \
     flyem/zdvidgrayslicehighrestask.cpp \
+    flyem/zdvidgraysliceprefetchtask.cpp \
+    flyem/zdvidlabelsliceprefetchtask.cpp \
     flyem/zdviddataslicetask.cpp \
     dvid/zdvidbodyhelper.cpp \
     flyem/zflyembodyevent.cpp \
     flyem/zflyembodyconfig.cpp \
     flyem/zflyembodymanager.cpp \
+    flyem/zflyembodyobjectcache.cpp \
+    flyem/zflyembodyskeletonizebatch.cpp \
     z3dwindowcontroller.cpp \
     z3d2dslicerenderer.cpp \
     z3d2dslicefilter.cpp \
@@ -1597,6 +1616,7 @@ SOURCES += main.cpp \
     flyem/zflyembodyenv.cpp \
     protocols/taskprotocoltaskfactory.cpp \
     dvid/zdvidblockstream.cpp \
+    dvid/zdvidgrayscaleblockfetcher.cpp \
     core/memorystream.cpp \
     imgproc/zstackmultiscalewatershed.cpp
 
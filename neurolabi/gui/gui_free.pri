@@ -96,6 +96,7 @@ HEADERS += $${PWD}/zstack.hxx \
    $${PWD}/flyem/zflyemneuron.h \
    $${PWD}/zswctypetrunkanalyzer.h \
    $${PWD}/zobject3dscan.h \
+   $${PWD}/zobject3dflatscan.h \
    $${PWD}/zswclayershollfeatureanalyzer.h \
    $${PWD}/zswclayertrunkanalyzer.h \
    $${PWD}/zlogmessagereporter.h \
@@ -226,11 +227,14 @@ HEADERS += $${PWD}/zstack.hxx \
    $${PWD}/swc/zswcradiusestimator.h \
    $${PWD}/zswctreenodeselector.h \
    $${PWD}/swc/zswcsignalfitter.h \
+   $${PWD}/swc/zswcnodeindex.h \
    $${PWD}/zneurontracerconfig.h \
    $${PWD}/zobject3dscan.hpp \
    $${PWD}/dvid/zdviddef.h \
    $${PWD}/zswcutil.h \
    $${PWD}/dvid/zdvidnode.h \
+   $${PWD}/dvid/zdvidsparsevoldecoder.h \
+   $${PWD}/flyem/zlabelremapper.h \
    $$PWD/zstackwriter.h \
    $$PWD/zswcdirectionfeatureanalyzer.h \
     $$PWD/geometry/zplane.h \
@@ -328,6 +332,7 @@ SOURCES += $${PWD}/zstack.cxx \
    $${PWD}/flyem/zflyemneuron.cpp \
    $${PWD}/zswctypetrunkanalyzer.cpp \
    $${PWD}/zobject3dscan.cpp \
+   $${PWD}/zobject3dflatscan.cpp \
    $${PWD}/zswclayershollfeatureanalyzer.cpp \
    $${PWD}/zswclayertrunkanalyzer.cpp \
    $${PWD}/zstackgraph.cpp \
@@ -445,9 +450,12 @@ SOURCES += $${PWD}/zstack.cxx \
    $${PWD}/swc/zswcradiusestimator.cpp \
    $${PWD}/zswctreenodeselector.cpp \
    $${PWD}/swc/zswcsignalfitter.cpp \
+   $${PWD}/swc/zswcnodeindex.cpp \
    $${PWD}/zneurontracerconfig.cpp \
    $${PWD}/zswcutil.cpp \
    $${PWD}/dvid/zdvidnode.cpp \
+   $${PWD}/dvid/zdvidsparsevoldecoder.cpp \
+   $${PWD}/flyem/zlabelremapper.cpp \
    $$PWD/zstackwriter.cpp \
    $$PWD/zswcdirectionfeatureanalyzer.cpp \
     $$PWD/geometry/zplane.cpp \
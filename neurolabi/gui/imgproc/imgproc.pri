@@ -3,13 +3,19 @@ HEADERS += $${PWD}/zstackprocessor.h \
    $${PWD}/zstackwatershed.h \
     $$PWD/zstackgradient.h \
     $$PWD/zdownsamplefilter.h \
-    $$PWD/zstackprinter.h
+    $$PWD/zstackprinter.h \
+    $$PWD/zlabelcolorizer.h \
+    $$PWD/zsparsestackwatershed.h \
+    $$PWD/zstackparallelwatershed.h
 
 SOURCES += $${PWD}/zstackprocessor.cpp \
    $${PWD}/zstackwatershed.cpp \
     $$PWD/zstackgradient.cpp \
     $$PWD/zdownsamplefilter.cpp \
-    $$PWD/zstackprinter.cpp
+    $$PWD/zstackprinter.cpp \
+    $$PWD/zlabelcolorizer.cpp \
+    $$PWD/zsparsestackwatershed.cpp \
+    $$PWD/zstackparallelwatershed.cpp
 
 contains(DEFINES, _ENABLE_SURFRECON_) {
   HEADERS +=  \
@@ -0,0 +1,197 @@
+#include "zlabelcolorizer.h"
+
+#include <algorithm>
+
+#include "neutube_def.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define _ZLABELCOLORIZER_AVX2_
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+#ifdef _ZLABELCOLORIZER_AVX2_
+/*
+ * Colorize labels with a power-of-two color table, 4 labels per iteration.
+ * The 64-bit comparison masks are packed into 32-bit lanes to blend the
+ * background and selection colors into the gathered colors.
+ */
+__attribute__((target("avx2")))
+void ColorizeMaskedAvx2(
+    const uint64_t *labelArray, size_t n, uint32_t *out,
+    const uint32_t *colorTable, uint64_t colorMask,
+    uint32_t bgColor, uint32_t selColor)
+{
+  const __m256i maskv = _mm256_set1_epi64x((long long) colorMask);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i selLabel =
+      _mm256_set1_epi64x((long long) flyem::LABEL_ID_SELECTION);
+  const __m256i packIndex = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  const __m128i bg = _mm_set1_epi32((int) bgColor);
+  const __m128i sel = _mm_set1_epi32((int) selColor);
+  const int *table = (const int*) colorTable;
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i*) (labelArray + i));
+    __m128i color = _mm256_i64gather_epi32(
+          table, _mm256_and_si256(v, maskv), 4);
+    __m128i bgMask = _mm256_castsi256_si128(
+          _mm256_permutevar8x32_epi32(_mm256_cmpeq_epi64(v, zero), packIndex));
+    __m128i selMask = _mm256_castsi256_si128(
+          _mm256_permutevar8x32_epi32(
+            _mm256_cmpeq_epi64(v, selLabel), packIndex));
+    color = _mm_blendv_epi8(color, bg, bgMask);
+    color = _mm_blendv_epi8(color, sel, selMask);
+    _mm_storeu_si128((__m128i*) (out + i), color);
+  }
+
+  for (; i < n; ++i) {
+    uint64_t v = labelArray[i];
+    if (v == 0) {
+      out[i] = bgColor;
+    } else if (v == flyem::LABEL_ID_SELECTION) {
+      out[i] = selColor;
+    } else {
+      out[i] = colorTable[v & colorMask];
+    }
+  }
+}
+#endif
+
+}
+
+ZLabelColorizer::ZLabelColorizer()
+{
+}
+
+ZLabelColorizer::ZLabelColorizer(
+    const int *colorTable, size_t colorCount, uint32_t bgColor,
+    uint32_t selColor) : m_bgColor(bgColor), m_selColor(selColor)
+{
+  setColorTable(colorTable, colorCount);
+}
+
+void ZLabelColorizer::setColorTable(const int *colorTable, size_t colorCount)
+{
+  m_colorTable.assign((const uint32_t*) colorTable,
+                      (const uint32_t*) colorTable + colorCount);
+  m_isPowerOfTwo = (colorCount > 0) && ((colorCount & (colorCount - 1)) == 0);
+  m_colorMask = m_isPowerOfTwo ? colorCount - 1 : 0;
+}
+
+bool ZLabelColorizer::IsAvx2Supported()
+{
+#ifdef _ZLABELCOLORIZER_AVX2_
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+bool ZLabelColorizer::usingSimd() const
+{
+  return m_usingSimd && m_isPowerOfTwo && IsAvx2Supported();
+}
+
+void ZLabelColorizer::colorizeScalar(
+    const uint64_t *labelArray, size_t n, uint32_t *out) const
+{
+  const uint32_t *colorTable = &(m_colorTable[0]);
+  const uint64_t selLabel = flyem::LABEL_ID_SELECTION;
+
+  if (m_isPowerOfTwo) {
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t v = labelArray[i];
+      uint32_t color = colorTable[v & m_colorMask];
+      color = (v == 0) ? m_bgColor : color;
+      out[i] = (v == selLabel) ? m_selColor : color;
+    }
+  } else {
+    const uint32_t colorCount = m_colorTable.size();
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t v = labelArray[i];
+      if (v == 0) {
+        out[i] = m_bgColor;
+      } else if (v == selLabel) {
+        out[i] = m_selColor;
+      } else if (v <= UINT32_MAX) { //32-bit division is much cheaper
+        out[i] = colorTable[uint32_t(v) % colorCount];
+      } else {
+        out[i] = colorTable[v % colorCount];
+      }
+    }
+  }
+}
+
+void ZLabelColorizer::colorize(
+    const uint64_t *labelArray, size_t n, uint32_t *out) const
+{
+  if (isEmpty()) {
+    return;
+  }
+
+#ifdef _ZLABELCOLORIZER_AVX2_
+  if (usingSimd()) {
+    ColorizeMaskedAvx2(labelArray, n, out, &(m_colorTable[0]), m_colorMask,
+                       m_bgColor, m_selColor);
+    return;
+  }
+#endif
+
+  colorizeScalar(labelArray, n, out);
+}
+
+void ZLabelColorizer::colorize(
+    const uint64_t *data, int width, int height,
+    uint8_t *out, size_t bytesPerLine) const
+{
+  if (isEmpty()) {
+    return;
+  }
+
+  if (bytesPerLine == width * sizeof(uint32_t)) {
+    colorize(data, size_t(width) * height, (uint32_t*) out);
+  } else {
+    for (int j = 0; j < height; ++j) {
+      colorize(data, width, (uint32_t*) (out + j * bytesPerLine));
+      data += width;
+    }
+  }
+}
+
+void ZLabelColorizer::colorizeTranspose(
+    const uint64_t *data, int width, int height,
+    uint8_t *out, size_t bytesPerLine) const
+{
+  if (isEmpty()) {
+    return;
+  }
+
+  //Each tile is colorized column by column (contiguous in data) into a
+  //buffer, which is then written out row by row. The buffer stride is padded
+  //to avoid cache set conflicts of power-of-two strides.
+  const int tileSize = 128;
+  const int tileStride = tileSize + 1;
+  std::vector<uint32_t> tile(tileStride * tileSize);
+
+  for (int j0 = 0; j0 < height; j0 += tileSize) {
+    int tileHeight = std::min(tileSize, height - j0);
+    for (int i0 = 0; i0 < width; i0 += tileSize) {
+      int tileWidth = std::min(tileSize, width - i0);
+      for (int di = 0; di < tileWidth; ++di) {
+        colorize(data + size_t(i0 + di) * height + j0, tileHeight,
+                 &(tile[di * tileStride]));
+      }
+      for (int dj = 0; dj < tileHeight; ++dj) {
+        uint32_t *outLine = (uint32_t*) (out + (j0 + dj) * bytesPerLine) + i0;
+        const uint32_t *tileColumn = &(tile[dj]);
+        for (int di = 0; di < tileWidth; ++di) {
+          outLine[di] = tileColumn[di * tileStride];
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef ZLABELCOLORIZER_H
+#define ZLABELCOLORIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+ * \brief The class of mapping a label field to ARGB colors
+ *
+ * A label v is painted as the background color if v is 0, as the selection
+ * color if v is flyem::LABEL_ID_SELECTION, or as colorTable[v % n]
+ * otherwise, where n is the size of the color table.
+ *
+ * When n is a power of two, the modulo becomes a mask and the labels are
+ * colorized with AVX2 gathers on CPUs that support it. Other cases fall back
+ * to a scalar loop.
+ */
+class ZLabelColorizer
+{
+public:
+  ZLabelColorizer();
+  ZLabelColorizer(const int *colorTable, size_t colorCount,
+                  uint32_t bgColor, uint32_t selColor);
+
+  void setColorTable(const int *colorTable, size_t colorCount);
+  void setBackgroundColor(uint32_t color) { m_bgColor = color; }
+  void setSelectionColor(uint32_t color) { m_selColor = color; }
+
+  bool isEmpty() const { return m_colorTable.empty(); }
+
+  /*!
+   * \brief Turn off SIMD kernels
+   *
+   * It is mainly for testing and benchmarking. SIMD kernels are still skipped
+   * when the CPU does not support them.
+   */
+  void setUsingSimd(bool on) { m_usingSimd = on; }
+  bool usingSimd() const;
+
+  /*!
+   * \brief Colorize \a n labels into \a out.
+   */
+  void colorize(const uint64_t *labelArray, size_t n, uint32_t *out) const;
+
+  /*!
+   * \brief Colorize a \a width x \a height label field
+   *
+   * \a data is stored row by row. Row j of the result starts at
+   * \a out + j * \a bytesPerLine.
+   */
+  void colorize(const uint64_t *data, int width, int height,
+                uint8_t *out, size_t bytesPerLine) const;
+
+  /*!
+   * \brief Colorize a transposed label field
+   *
+   * Pixel (i, j) of the result is from data[i * height + j], which is the
+   * layout of an X-axis slice. The field is processed in tiles so that both
+   * the reading and the writing stay in cache.
+   */
+  void colorizeTranspose(const uint64_t *data, int width, int height,
+                         uint8_t *out, size_t bytesPerLine) const;
+
+  static bool IsAvx2Supported();
+
+private:
+  void colorizeScalar(const uint64_t *labelArray, size_t n, uint32_t *out) const;
+
+private:
+  std::vector<uint32_t> m_colorTable;
+  uint64_t m_colorMask = 0; //colorCount - 1 if colorCount is a power of two
+  bool m_isPowerOfTwo = false;
+  uint32_t m_bgColor = 0;
+  uint32_t m_selColor = 0;
+  bool m_usingSimd = true;
+};
+
+#endif // ZLABELCOLORIZER_H
@@ -0,0 +1,325 @@
+#include "zsparsestackwatershed.h"
+
+#include <algorithm>
+#include <map>
+
+#include "tz_stack_watershed.h"
+#include "zsparsestack.h"
+#include "zobject3dscan.h"
+#include "zobject3dscanarray.h"
+#include "zobject3d.h"
+#include "zstack.hxx"
+#include "bigdata/zstackblockgrid.h"
+
+namespace {
+
+const int WATERSHED_MAX_LEVEL = 255;
+
+bool IsSeedLabel(uint8_t label)
+{
+  return label >= 1 && label <= STACK_WATERSHED_MAX_SEED;
+}
+
+}
+
+ZSparseStackWatershed::ZSparseStackWatershed()
+{
+}
+
+void ZSparseStackWatershed::clear()
+{
+  m_voxelNumber = 0;
+  m_stripeArray.clear();
+  m_segmentX0.clear();
+  m_segmentX1.clear();
+  m_segmentStripe.clear();
+  m_segmentVoxelStart.clear();
+  m_value.clear();
+  m_label.clear();
+}
+
+int ZSparseStackWatershed::findStripe(int y, int z) const
+{
+  auto iter = std::lower_bound(
+        m_stripeArray.begin(), m_stripeArray.end(), std::make_pair(z, y),
+        [](const Stripe &stripe, const std::pair<int, int> &key) {
+    return std::make_pair(stripe.z, stripe.y) < key; });
+  if (iter != m_stripeArray.end() && iter->y == y && iter->z == z) {
+    return int(iter - m_stripeArray.begin());
+  }
+
+  return -1;
+}
+
+int64_t ZSparseStackWatershed::findVoxelInStripe(int stripeIndex, int x) const
+{
+  if (stripeIndex >= 0) {
+    const Stripe &stripe = m_stripeArray[stripeIndex];
+    //First segment ending at or after x
+    auto begin = m_segmentX1.begin() + stripe.segmentStart;
+    auto end = m_segmentX1.begin() + stripe.segmentEnd;
+    auto iter = std::lower_bound(begin, end, x);
+    if (iter != end) {
+      size_t seg = iter - m_segmentX1.begin();
+      if (m_segmentX0[seg] <= x) {
+        return int64_t(m_segmentVoxelStart[seg] + x - m_segmentX0[seg]);
+      }
+    }
+  }
+
+  return -1;
+}
+
+int64_t ZSparseStackWatershed::findVoxel(int x, int y, int z) const
+{
+  return findVoxelInStripe(findStripe(y, z), x);
+}
+
+size_t ZSparseStackWatershed::findSegment(size_t voxelIndex) const
+{
+  return std::upper_bound(m_segmentVoxelStart.begin(),
+                          m_segmentVoxelStart.end(), voxelIndex) -
+      m_segmentVoxelStart.begin() - 1;
+}
+
+void ZSparseStackWatershed::buildDomain(const ZObject3dScan &obj)
+{
+  for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
+    const ZObject3dStripe &objStripe = obj.getStripe(i);
+    if (objStripe.getSegmentNumber() > 0) {
+      Stripe stripe;
+      stripe.y = objStripe.getY();
+      stripe.z = objStripe.getZ();
+      stripe.segmentStart = m_segmentX0.size();
+      for (int j = 0; j < objStripe.getSegmentNumber(); ++j) {
+        int x0 = objStripe.getSegmentStart(j);
+        int x1 = objStripe.getSegmentEnd(j);
+        m_segmentX0.push_back(x0);
+        m_segmentX1.push_back(x1);
+        m_segmentStripe.push_back(int(m_stripeArray.size()));
+        m_segmentVoxelStart.push_back(m_voxelNumber);
+        m_voxelNumber += x1 - x0 + 1;
+      }
+      stripe.segmentEnd = m_segmentX0.size();
+      m_stripeArray.push_back(stripe);
+    }
+  }
+
+  for (Stripe &stripe : m_stripeArray) {
+    stripe.neighbor[0] = findStripe(stripe.y - 1, stripe.z);
+    stripe.neighbor[1] = findStripe(stripe.y + 1, stripe.z);
+    stripe.neighbor[2] = findStripe(stripe.y, stripe.z - 1);
+    stripe.neighbor[3] = findStripe(stripe.y, stripe.z + 1);
+  }
+}
+
+void ZSparseStackWatershed::loadValue(const ZSparseStack &spStack)
+{
+  m_value.resize(m_voxelNumber);
+
+  //Same as filling a dense GREY stack with ZSparseStack::makeStack()
+  const ZStackBlockGrid *grid = spStack.getStackGrid();
+  if (grid == NULL || grid->isEmpty() || grid->getStackArray().empty()) {
+    std::fill(m_value.begin(), m_value.end(), WATERSHED_MAX_LEVEL);
+    return;
+  }
+
+  int baseValue = spStack.getBaseValue();
+  int blockWidth = grid->getBlockSize().getX();
+  for (size_t seg = 0; seg < m_segmentX0.size(); ++seg) {
+    const Stripe &stripe = m_stripeArray[m_segmentStripe[seg]];
+    uint8_t *valueArray = &(m_value[m_segmentVoxelStart[seg]]);
+    int x0 = m_segmentX0[seg];
+    int x1 = m_segmentX1[seg];
+    //Read the segment block by block
+    for (int x = x0; x <= x1; ) {
+      ZStackBlockGrid::Location location =
+          grid->getLocation(x, stripe.y, stripe.z);
+      const ZIntPoint &localPos = location.getLocalPosition();
+      ZStack *stack = grid->getStack(location.getBlockIndex());
+      int n = std::max(1, std::min(x1 - x + 1, blockWidth - localPos.getX()));
+      for (int k = 0; k < n; ++k) {
+        int v = baseValue;
+        if (stack != NULL) {
+          v += stack->getIntValueLocal(
+                localPos.getX() + k, localPos.getY(), localPos.getZ());
+        }
+        *(valueArray++) = uint8_t(std::min(std::max(v, 0), WATERSHED_MAX_LEVEL));
+      }
+      x += n;
+    }
+  }
+}
+
+void ZSparseStackWatershed::addSeed(const std::vector<ZObject3d *> &seedArray)
+{
+  m_label.assign(m_voxelNumber, 0);
+  if (!m_floodingZero) {
+    for (size_t i = 0; i < m_voxelNumber; ++i) {
+      if (m_value[i] == 0) {
+        m_label[i] = STACK_WATERSHED_BARRIER;
+      }
+    }
+  }
+
+  int sx = m_seedDsIntv.getX() + 1;
+  int sy = m_seedDsIntv.getY() + 1;
+  int sz = m_seedDsIntv.getZ() + 1;
+
+  for (const ZObject3d *seed : seedArray) {
+    if (seed != NULL) {
+      uint8_t label = seed->getLabel();
+      for (size_t i = 0; i < seed->size(); ++i) {
+        int64_t index = findVoxel(
+              seed->getX(i) / sx, seed->getY(i) / sy, seed->getZ(i) / sz);
+        if (index >= 0) {
+          uint8_t &v = m_label[index];
+          if (v != STACK_WATERSHED_BARRIER) {
+            if (v > 0) {
+              if (v != label) { //Seed conflict
+                v = 0;
+              }
+            } else {
+              v = label;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void ZSparseStackWatershed::flood()
+{
+  std::vector<int64_t> queueHead(WATERSHED_MAX_LEVEL + 1, -1);
+  std::vector<int64_t> queueTail(WATERSHED_MAX_LEVEL + 1, -1);
+  std::vector<int64_t> levelQueue(m_voxelNumber, -1);
+
+  auto enqueue = [&](int level, int64_t index) {
+    if (queueHead[level] < 0) {
+      queueHead[level] = index;
+    } else {
+      levelQueue[queueTail[level]] = index;
+    }
+    queueTail[level] = index;
+  };
+
+  auto dequeue = [&](int level) {
+    int64_t index = queueHead[level];
+    if (index >= 0) {
+      queueHead[level] = levelQueue[index];
+      if (queueHead[level] < 0) {
+        queueTail[level] = -1;
+      }
+    }
+    return index;
+  };
+
+  int waterLevel = WATERSHED_MAX_LEVEL;
+  for (size_t i = 0; i < m_voxelNumber; ++i) {
+    if (IsSeedLabel(m_label[i])) {
+      enqueue(std::min(int(m_value[i]), waterLevel), i);
+    }
+  }
+
+  //Neighbors are visited in the same order as Stack_Watershed()
+  int64_t neighborArray[6];
+  for (; waterLevel >= 0; --waterLevel) {
+    for (int64_t current = dequeue(waterLevel); current >= 0;
+         current = dequeue(waterLevel)) {
+      uint8_t basin = m_label[current];
+      size_t seg = findSegment(current);
+      const Stripe &stripe = m_stripeArray[m_segmentStripe[seg]];
+      int x = m_segmentX0[seg] + int(current - m_segmentVoxelStart[seg]);
+
+      //Segments of a stripe may touch each other if it is not canonized
+      neighborArray[0] = (x > m_segmentX0[seg]) ? current - 1 :
+          ((seg > stripe.segmentStart && m_segmentX1[seg - 1] == x - 1) ?
+             current - 1 : -1);
+      neighborArray[1] = (x < m_segmentX1[seg]) ? current + 1 :
+          ((seg + 1 < stripe.segmentEnd && m_segmentX0[seg + 1] == x + 1) ?
+             current + 1 : -1);
+      for (int j = 0; j < 4; ++j) {
+        neighborArray[j + 2] = findVoxelInStripe(stripe.neighbor[j], x);
+      }
+
+      for (int j = 0; j < 6; ++j) {
+        int64_t neighbor = neighborArray[j];
+        if (neighbor >= 0 && m_label[neighbor] == 0) {
+          enqueue(std::min(int(m_value[neighbor]), waterLevel), neighbor);
+          m_label[neighbor] = basin;
+        }
+      }
+    }
+  }
+}
+
+ZObject3dScanArray* ZSparseStackWatershed::makeResult() const
+{
+  std::map<uint8_t, ZObject3dScan*> objMap;
+
+  for (size_t seg = 0; seg < m_segmentX0.size(); ++seg) {
+    const Stripe &stripe = m_stripeArray[m_segmentStripe[seg]];
+    const uint8_t *labelArray = &(m_label[m_segmentVoxelStart[seg]]);
+    int x0 = m_segmentX0[seg];
+    int length = m_segmentX1[seg] - x0 + 1;
+    //Add runs of the same label
+    for (int start = 0; start < length; ) {
+      uint8_t label = labelArray[start];
+      int end = start + 1;
+      while (end < length && labelArray[end] == label) {
+        ++end;
+      }
+      if (IsSeedLabel(label)) {
+        ZObject3dScan *&labelObj = objMap[label];
+        if (labelObj == NULL) {
+          labelObj = new ZObject3dScan;
+          labelObj->setLabel(label);
+        }
+        labelObj->addSegment(
+              stripe.z, stripe.y, x0 + start, x0 + end - 1, false);
+      }
+      start = end;
+    }
+  }
+
+  ZObject3dScanArray *result = new ZObject3dScanArray;
+  for (auto &labelObj : objMap) {
+    labelObj.second->canonize();
+    result->append(labelObj.second);
+  }
+
+  return result;
+}
+
+ZObject3dScanArray* ZSparseStackWatershed::run(
+    const ZSparseStack &spStack, const std::vector<ZObject3d *> &seedArray)
+{
+  clear();
+
+  const ZObject3dScan *mask = spStack.getObjectMask();
+  if (mask == NULL || mask->isEmpty()) {
+    return new ZObject3dScanArray;
+  }
+
+  ZObject3dScan domainBuffer;
+  const ZObject3dScan *domain = mask;
+  if (!m_range.isEmpty() && !m_range.contains(mask->getBoundBox())) {
+    mask->subobject(m_range, NULL, &domainBuffer);
+    domain = &domainBuffer;
+  }
+  if (!domain->isCanonized()) {
+    if (domain != &domainBuffer) {
+      domainBuffer = *domain;
+      domain = &domainBuffer;
+    }
+    domainBuffer.canonize();
+  }
+
+  buildDomain(*domain);
+  loadValue(spStack);
+  addSeed(seedArray);
+  flood();
+
+  return makeResult();
+}
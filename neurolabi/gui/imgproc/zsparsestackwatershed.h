@@ -0,0 +1,120 @@
+#ifndef ZSPARSESTACKWATERSHED_H
+#define ZSPARSESTACKWATERSHED_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "zintcuboid.h"
+#include "zintpoint.h"
+
+class ZSparseStack;
+class ZObject3dScan;
+class ZObject3d;
+class ZObject3dScanArray;
+
+/*!
+ * \brief The class of running seeded watershed on a sparse stack
+ *
+ * Unlike ZStackWatershed, which floods a dense stack covering the bound box of
+ * the object, this class floods only the voxels in the object mask of a sparse
+ * stack. The voxels are indexed in the order of the stripes and segments of
+ * the mask, and the grayscale values are read from the blocks of the stack
+ * grid. The memory usage is therefore proportional to the volume of the object
+ * instead of the volume of its bound box.
+ *
+ * The flooding follows Stack_Watershed() with 6-connectivity: an unlabeled
+ * voxel is labeled by the first basin reaching it, and the basins are flooded
+ * from the highest level to the lowest. Zero-valued voxels are barriers unless
+ * flooding zero is turned on. Voxels outside the mask are never flooded.
+ *
+ * Usage:
+ *   ZSparseStackWatershed watershed;
+ *   watershed.setRange(range);
+ *   ZObject3dScanArray *result = watershed.run(spStack, seedArray);
+ */
+class ZSparseStackWatershed
+{
+public:
+  ZSparseStackWatershed();
+
+  /*!
+   * \brief Set the range of watershed
+   *
+   * Only the part of the object mask in \a range is flooded. An empty range
+   * means no constraint.
+   */
+  void setRange(const ZIntCuboid &range) { m_range = range; }
+
+  void setFloodingZero(bool on) { m_floodingZero = on; }
+
+  /*!
+   * \brief Set the downsampling interval of the seeds
+   *
+   * The seed coordinates will be divided by \a dsIntv + 1 to map them to
+   * the space of the sparse stack.
+   */
+  void setSeedDsIntv(const ZIntPoint &dsIntv) { m_seedDsIntv = dsIntv; }
+
+  /*!
+   * \brief Run seeded watershed
+   *
+   * The label of a seed is its label truncated to 8 bits. Only labels in
+   * [1, STACK_WATERSHED_MAX_SEED] are valid. A voxel covered by seeds of
+   * different labels is not a seed unless a later seed covers it again, which
+   * is the same as ZStackWatershed::AddSeed().
+   *
+   * The grayscale blocks needed by the computation must have been loaded into
+   * the stack grid of \a spStack (see ZSparseStack::cacheStackSource()).
+   *
+   * \return An array of labeled regions sorted by labels. The regions are in
+   * the space of \a spStack. The caller is responsible for deleting it.
+   */
+  ZObject3dScanArray* run(const ZSparseStack &spStack,
+                          const std::vector<ZObject3d*> &seedArray);
+
+  /*!
+   * \brief Number of voxels flooded by the last run.
+   */
+  size_t getVoxelNumber() const { return m_voxelNumber; }
+
+private:
+  void buildDomain(const ZObject3dScan &obj);
+  void loadValue(const ZSparseStack &spStack);
+  void addSeed(const std::vector<ZObject3d*> &seedArray);
+  void flood();
+  ZObject3dScanArray* makeResult() const;
+  void clear();
+
+  int64_t findVoxel(int x, int y, int z) const;
+  int64_t findVoxelInStripe(int stripeIndex, int x) const;
+  int findStripe(int y, int z) const;
+  size_t findSegment(size_t voxelIndex) const;
+
+private:
+  ZIntCuboid m_range;
+  bool m_floodingZero = false;
+  ZIntPoint m_seedDsIntv;
+  size_t m_voxelNumber = 0;
+
+  //Domain indexing
+  struct Stripe {
+    int y;
+    int z;
+    size_t segmentStart; //Index of the first segment
+    size_t segmentEnd; //Index after the last segment
+    int neighbor[4]; //Stripes of (y-1, y+1, z-1, z+1); -1 if none
+  };
+
+  std::vector<Stripe> m_stripeArray;
+  std::vector<int> m_segmentX0;
+  std::vector<int> m_segmentX1;
+  std::vector<int> m_segmentStripe;
+  std::vector<size_t> m_segmentVoxelStart; //First voxel of each segment
+
+  //Per-voxel buffers
+  std::vector<uint8_t> m_value;
+  std::vector<uint8_t> m_label;
+};
+
+#endif // ZSPARSESTACKWATERSHED_H
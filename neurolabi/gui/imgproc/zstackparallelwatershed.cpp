@@ -0,0 +1,518 @@
+#include "zstackparallelwatershed.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <limits>
+
+#include "tz_stack_neighborhood.h"
+#include "c_stack.h"
+#include "zstack.hxx"
+#include "zintpoint.h"
+#include "zobject3d.h"
+#include "zobject3dscan.h"
+#include "zobject3dscanarray.h"
+#include "zerror.h"
+
+namespace {
+
+const uint8_t NO_PARENT = 255;
+
+uint16_t NextDistance(uint16_t dist)
+{
+  return (dist < std::numeric_limits<uint16_t>::max()) ? dist + 1 : dist;
+}
+
+}
+
+ZStackParallelWatershed::ZStackParallelWatershed()
+{
+  m_threadCount = std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+void ZStackParallelWatershed::setSignal(const Stack *stack)
+{
+  m_signal = stack;
+  m_reconcilePassNumber = 0;
+  m_state.clear();
+  m_blockArray.clear();
+  m_planeLabel.clear();
+  m_planeState.clear();
+
+  if (stack != NULL) {
+    m_width = C_Stack::width(stack);
+    m_height = C_Stack::height(stack);
+    m_depth = C_Stack::depth(stack);
+    m_area = size_t(m_width) * m_height;
+    m_label.assign(m_area * m_depth, 0);
+  } else {
+    m_width = 0;
+    m_height = 0;
+    m_depth = 0;
+    m_area = 0;
+    m_label.clear();
+  }
+}
+
+void ZStackParallelWatershed::setConnectivity(int conn)
+{
+  if (conn == 6 || conn == 18 || conn == 26) {
+    m_conn = conn;
+  }
+}
+
+void ZStackParallelWatershed::addSeed(int x, int y, int z, uint32_t label)
+{
+  if (x >= 0 && x < m_width && y >= 0 && y < m_height &&
+      z >= 0 && z < m_depth) {
+    uint32_t &v = m_label[size_t(z) * m_area + size_t(y) * m_width + x];
+    if (v > 0) {
+      if (v != label) { //Seed conflict
+        v = 0;
+      }
+    } else {
+      v = label;
+    }
+  }
+}
+
+void ZStackParallelWatershed::addSeed(
+    const ZObject3d &seed, const ZIntPoint &offset, const ZIntPoint &dsIntv)
+{
+  uint32_t label = seed.getLabel();
+  int sx = dsIntv.getX() + 1;
+  int sy = dsIntv.getY() + 1;
+  int sz = dsIntv.getZ() + 1;
+
+  for (size_t i = 0; i < seed.size(); ++i) {
+    addSeed(seed.getX(i) / sx - offset.getX(),
+            seed.getY(i) / sy - offset.getY(),
+            seed.getZ(i) / sz - offset.getZ(), label);
+  }
+}
+
+void ZStackParallelWatershed::addSeed(
+    const std::vector<ZObject3d *> &seedArray, const ZIntPoint &offset,
+    const ZIntPoint &dsIntv)
+{
+  for (const ZObject3d *seed : seedArray) {
+    if (seed != NULL) {
+      addSeed(*seed, offset, dsIntv);
+    }
+  }
+}
+
+void ZStackParallelWatershed::addSeedMask(
+    const Stack *seed, int x0, int y0, int z0)
+{
+  if (seed == NULL || m_label.empty()) {
+    return;
+  }
+
+  int kind = C_Stack::kind(seed);
+  if (kind != GREY && kind != GREY16) {
+    return;
+  }
+
+  int seedWidth = C_Stack::width(seed);
+  int seedHeight = C_Stack::height(seed);
+  int seedDepth = C_Stack::depth(seed);
+
+  //Overlap in the seed space
+  int bx0 = std::max(0, -x0);
+  int by0 = std::max(0, -y0);
+  int bz0 = std::max(0, -z0);
+  int bx1 = std::min(seedWidth, m_width - x0);
+  int by1 = std::min(seedHeight, m_height - y0);
+  int bz1 = std::min(seedDepth, m_depth - z0);
+
+  for (int z = bz0; z < bz1; ++z) {
+    for (int y = by0; y < by1; ++y) {
+      size_t seedIndex = C_Stack::area(seed) * z + size_t(seedWidth) * y;
+      size_t index = m_area * (z + z0) + size_t(m_width) * (y + y0) + x0;
+      for (int x = bx0; x < bx1; ++x) {
+        uint32_t v = (kind == GREY) ? seed->array[seedIndex + x] :
+                                      C_Stack::guardedArray16(seed)[seedIndex + x];
+        if (v > 0) {
+          m_label[index + x] = v;
+        }
+      }
+    }
+  }
+}
+
+int ZStackParallelWatershed::getStartLevel() const
+{
+  return (C_Stack::kind(m_signal) == GREY) ? 255 : 65535;
+}
+
+uint32_t ZStackParallelWatershed::getMaxLabel() const
+{
+  if (m_label.empty()) {
+    return 0;
+  }
+
+  return *std::max_element(m_label.begin(), m_label.end());
+}
+
+std::vector<ZStackParallelWatershed::Block>
+ZStackParallelWatershed::makeBlockArray() const
+{
+  //Local indices of a block are 32-bit
+  size_t maxDepth = std::max(
+        size_t(1), size_t(std::numeric_limits<uint32_t>::max()) / m_area);
+  size_t depth = m_depth;
+  if (m_blockDepth > 0) {
+    depth = m_blockDepth;
+  }
+  depth = std::min(depth, maxDepth);
+
+  std::vector<Block> blockArray;
+  for (size_t z = 0; z < size_t(m_depth); z += depth) {
+    Block block;
+    block.z0 = int(z);
+    block.z1 = int(std::min(z + depth, size_t(m_depth)));
+    blockArray.push_back(block);
+  }
+
+  return blockArray;
+}
+
+int ZStackParallelWatershed::getEffectiveThreadCount(size_t blockNumber) const
+{
+  return int(std::max(size_t(1), std::min(size_t(m_threadCount), blockNumber)));
+}
+
+void ZStackParallelWatershed::makePlaneSnapshot()
+{
+  m_planeLabel.resize(m_blockArray.size() * 2 * m_area);
+  m_planeState.resize(m_planeLabel.size());
+
+  for (size_t i = 0; i < m_blockArray.size(); ++i) {
+    const Block &block = m_blockArray[i];
+    int sliceArray[2] = {block.z0, block.z1 - 1};
+    for (int j = 0; j < 2; ++j) {
+      size_t src = m_area * sliceArray[j];
+      size_t dst = m_area * (i * 2 + j);
+      std::copy(m_label.begin() + src, m_label.begin() + src + m_area,
+                m_planeLabel.begin() + dst);
+      std::copy(m_state.begin() + src, m_state.begin() + src + m_area,
+                m_planeState.begin() + dst);
+    }
+  }
+}
+
+template <typename T>
+bool ZStackParallelWatershed::floodBlock(
+    const T *signal, size_t blockIndex, int startLevel, bool reconciling)
+{
+  const Block &block = m_blockArray[blockIndex];
+  const int *dx = Stack_Neighbor_X_Offset(m_conn);
+  const int *dy = Stack_Neighbor_Y_Offset(m_conn);
+  const int *dz = Stack_Neighbor_Z_Offset(m_conn);
+  ptrdiff_t neighborOffset[26];
+  for (int j = 0; j < m_conn; ++j) {
+    neighborOffset[j] = ptrdiff_t(dz[j]) * ptrdiff_t(m_area) +
+        ptrdiff_t(dy[j]) * m_width + dx[j];
+  }
+
+  const size_t base = m_area * block.z0;
+  const size_t blockVolume = m_area * (block.z1 - block.z0);
+  //32-bit arithmetic for local indices
+  const uint32_t area = uint32_t(m_area);
+  const uint32_t width = uint32_t(m_width);
+  std::vector<std::vector<uint32_t> > queue(startLevel + 1);
+  bool changed = false;
+
+  int oppositeNeighbor[26];
+  for (int j = 0; j < m_conn; ++j) {
+    for (int k = 0; k < m_conn; ++k) {
+      if (dx[k] == -dx[j] && dy[k] == -dy[j] && dz[k] == -dz[j]) {
+        oppositeNeighbor[j] = k;
+      }
+    }
+  }
+
+  //A voxel is relabeled if it would be dequeued earlier by Stack_Watershed():
+  //at a higher level, or at the same level with fewer steps, or with the same
+  //steps from a higher entrance. It also follows the label of the voxel it
+  //was flooded from (\a parent is the direction from that voxel), so that
+  //each basin stays connected. Neither happens before reconciling because
+  //each level is flooded in the FIFO order.
+  auto update = [&](size_t index, uint32_t basin, int level, uint16_t dist,
+      uint16_t entry, uint8_t parent) {
+    FloodState &state = m_state[index];
+    if (m_label[index] == 0 || level > state.level ||
+        (level == state.level &&
+         (dist < state.dist || (dist == state.dist && entry > state.entry)))) {
+      m_label[index] = basin;
+      state.level = level;
+      state.dist = dist;
+      state.entry = entry;
+      state.parent = parent;
+      return true;
+    } else if (state.parent == parent && m_label[index] != basin) {
+      m_label[index] = basin;
+      return true;
+    }
+    return false;
+  };
+
+  if (reconciling) {
+    //Take labels from the neighboring blocks at the time of the snapshot
+    std::vector<uint32_t> inflowArray;
+    for (int face = 0; face < 2; ++face) {
+      int z = (face == 0) ? block.z0 : block.z1 - 1;
+      int faceDz = (face == 0) ? -1 : 1;
+      if (z + faceDz < 0 || z + faceDz >= m_depth) {
+        continue;
+      }
+      size_t planeStart = (face == 0) ?
+            m_area * ((blockIndex - 1) * 2 + 1) : m_area * (blockIndex + 1) * 2;
+      const uint32_t *planeLabel = &(m_planeLabel[planeStart]);
+      const FloodState *planeState = &(m_planeState[planeStart]);
+
+      for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+          size_t index = m_area * z + size_t(m_width) * y + x;
+          int value = signal[index];
+          if (value < m_minLevel || (value == 0 && !m_floodingZero)) {
+            continue;
+          }
+          for (int j = 0; j < m_conn; ++j) {
+            int nx = x + dx[j];
+            int ny = y + dy[j];
+            if (dz[j] != faceDz || nx < 0 || nx >= m_width ||
+                ny < 0 || ny >= m_height) {
+              continue;
+            }
+            size_t planeIndex = size_t(m_width) * ny + nx;
+            uint32_t basin = planeLabel[planeIndex];
+            const FloodState &basinState = planeState[planeIndex];
+            if (basin == 0 || basinState.level < m_minLevel) {
+              continue;
+            }
+            int level = std::min(value, int(basinState.level));
+            bool entering = (level < basinState.level);
+            if (update(index, basin, level,
+                       entering ? 0 : NextDistance(basinState.dist),
+                       entering ? basinState.level : basinState.entry,
+                       oppositeNeighbor[j])) {
+              inflowArray.push_back(uint32_t(index - base));
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+
+    std::stable_sort(inflowArray.begin(), inflowArray.end(),
+                     [&](uint32_t v1, uint32_t v2) {
+      const FloodState &s1 = m_state[base + v1];
+      const FloodState &s2 = m_state[base + v2];
+      return (s1.dist < s2.dist) ||
+          (s1.dist == s2.dist && s1.entry > s2.entry); });
+    for (uint32_t v : inflowArray) {
+      queue[m_state[base + v].level].push_back(v);
+    }
+  } else {
+    for (size_t i = 0; i < blockVolume; ++i) {
+      if (m_label[base + i] > 0) {
+        queue[m_state[base + i].level].push_back(uint32_t(i));
+      }
+    }
+  }
+
+  //Flood from the highest level as Stack_Watershed()
+  for (int waterLevel = startLevel; waterLevel >= m_minLevel; --waterLevel) {
+    std::vector<uint32_t> &bucket = queue[waterLevel];
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      uint32_t local = bucket[i];
+      size_t current = base + local;
+      const FloodState &state = m_state[current];
+      if (state.level != waterLevel) { //Outdated entry
+        continue;
+      }
+      uint32_t basin = m_label[current];
+      uint16_t nextDist = NextDistance(state.dist);
+      uint16_t entry = state.entry;
+      uint32_t z = local / area;
+      uint32_t sliceIndex = local - z * area;
+      int y = int(sliceIndex / width);
+      int x = int(sliceIndex) - y * m_width;
+      z += block.z0;
+      bool inner = (x > 0 && x < m_width - 1 && y > 0 && y < m_height - 1 &&
+                    int(z) > block.z0 && int(z) < block.z1 - 1);
+      for (int j = 0; j < m_conn; ++j) {
+        if (!inner) {
+          int nx = x + dx[j];
+          int ny = y + dy[j];
+          int nz = int(z) + dz[j];
+          if (nx < 0 || nx >= m_width || ny < 0 || ny >= m_height ||
+              nz < block.z0 || nz >= block.z1) {
+            continue;
+          }
+        }
+        size_t neighbor = current + neighborOffset[j];
+        int value = signal[neighbor];
+        if (value < m_minLevel || (value == 0 && !m_floodingZero)) {
+          continue;
+        }
+        int level = std::min(value, waterLevel);
+        bool entering = (level < waterLevel);
+        if (update(neighbor, basin, level, entering ? 0 : nextDist,
+                   entering ? waterLevel : entry, j)) {
+          queue[level].push_back(uint32_t(neighbor - base));
+          changed = true;
+        }
+      }
+    }
+    std::vector<uint32_t>().swap(bucket);
+  }
+
+  return changed;
+}
+
+template <typename T>
+void ZStackParallelWatershed::runT(const T *signal)
+{
+  int startLevel = getStartLevel();
+  size_t voxelNumber = m_label.size();
+
+  //Seeds are dequeued before any other voxels of the same level
+  FloodState initialState;
+  initialState.level = 0;
+  initialState.dist = 0;
+  initialState.entry = std::numeric_limits<uint16_t>::max();
+  initialState.parent = NO_PARENT;
+  m_state.assign(voxelNumber, initialState);
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    if (m_label[i] > 0) {
+      if (signal[i] == 0 && !m_floodingZero) { //No seed on barriers
+        m_label[i] = 0;
+      } else {
+        m_state[i].level = std::min(int(signal[i]), startLevel);
+      }
+    }
+  }
+
+  m_blockArray = makeBlockArray();
+
+  std::vector<char> changedArray(m_blockArray.size(), 0);
+  std::vector<char> activeArray(m_blockArray.size(), 1);
+  auto floodAll = [&](bool reconciling) {
+    std::atomic<size_t> blockIndex(0);
+    auto process = [&]() {
+      for (size_t i = blockIndex++; i < m_blockArray.size();
+           i = blockIndex++) {
+        changedArray[i] = activeArray[i] ?
+              floodBlock(signal, i, startLevel, reconciling) : 0;
+      }
+    };
+
+    int threadCount = getEffectiveThreadCount(m_blockArray.size());
+    if (threadCount > 1) {
+      std::vector<std::thread> threadArray;
+      for (int i = 0; i < threadCount; ++i) {
+        threadArray.emplace_back(process);
+      }
+      for (std::thread &t : threadArray) {
+        t.join();
+      }
+    } else {
+      process();
+    }
+  };
+
+  floodAll(false);
+
+  //Pass labels across block boundaries until nothing changes. Only the
+  //blocks next to a changed block can receive new labels.
+  m_reconcilePassNumber = 0;
+  if (m_blockArray.size() > 1) {
+    for (;;) {
+      bool changed = false;
+      for (size_t i = 0; i < m_blockArray.size(); ++i) {
+        activeArray[i] = (i > 0 && changedArray[i - 1]) ||
+            (i + 1 < m_blockArray.size() && changedArray[i + 1]) ||
+            m_reconcilePassNumber == 0;
+        changed = changed || activeArray[i];
+      }
+      if (!changed) {
+        break;
+      }
+      makePlaneSnapshot();
+      floodAll(true);
+      ++m_reconcilePassNumber;
+    }
+  }
+
+  m_planeLabel.clear();
+  m_planeState.clear();
+  m_state.clear();
+}
+
+bool ZStackParallelWatershed::run()
+{
+  if (m_signal == NULL || m_label.empty()) {
+    return false;
+  }
+
+  switch (C_Stack::kind(m_signal)) {
+  case GREY:
+    runT(C_Stack::array8(m_signal));
+    break;
+  case GREY16:
+    runT(C_Stack::guardedArray16(m_signal));
+    break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+ZStack* ZStackParallelWatershed::makeLabelStack() const
+{
+  if (m_signal == NULL || m_label.empty()) {
+    return NULL;
+  }
+
+  uint32_t maxLabel = getMaxLabel();
+  if (maxLabel > 65535) {
+    RECORD_WARNING_UNCOND("Watershed labels exceed 16 bits");
+    return NULL;
+  }
+
+  int kind = (maxLabel > 255) ? GREY16 : GREY;
+  Stack *out = C_Stack::make(kind, m_width, m_height, m_depth);
+  if (kind == GREY) {
+    std::copy(m_label.begin(), m_label.end(), C_Stack::array8(out));
+  } else {
+    std::copy(m_label.begin(), m_label.end(), C_Stack::guardedArray16(out));
+  }
+
+  ZStack *stack = new ZStack;
+  stack->consume(out);
+
+  return stack;
+}
+
+ZObject3dScanArray* ZStackParallelWatershed::makeLabelObjectArray() const
+{
+  if (m_signal == NULL || m_label.empty()) {
+    return NULL;
+  }
+
+  std::map<uint64_t, ZObject3dScan*> *bodySet =
+      ZObject3dScan::extractAllForegroundObject(
+        m_label.data(), m_width, m_height, m_depth, 0, 0, 0, 1, NULL);
+
+  ZObject3dScanArray *objArray = new ZObject3dScanArray;
+  for (const auto &body : *bodySet) {
+    objArray->append(body.second);
+  }
+  delete bodySet;
+
+  return objArray;
+}
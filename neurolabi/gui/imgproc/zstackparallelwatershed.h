@@ -0,0 +1,207 @@
+#ifndef ZSTACKPARALLELWATERSHED_H
+#define ZSTACKPARALLELWATERSHED_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "tz_image_lib_defs.h"
+
+class ZStack;
+class ZIntPoint;
+class ZObject3d;
+class ZObject3dScanArray;
+
+/*!
+ * \brief The class of running seeded watershed with wide labels in parallel
+ *
+ * It floods a GREY or GREY16 stack in the same way as Stack_Watershed(), but
+ * labels are 32-bit and voxels are indexed with size_t, so neither the number
+ * of seeds nor the size of the stack is limited by the 8-bit mask of the
+ * watershed workspace.
+ *
+ * The stack is partitioned into blocks of Z slices. Each block is flooded by
+ * its own priority queue, which runs concurrently with the other blocks, and
+ * then the blocks are reconciled by passing the labels across the block
+ * boundaries until no voxel can be reached at a higher level. The level of a
+ * voxel is the highest bottleneck value of the paths from the seeds to it,
+ * which is the same as the result of Stack_Watershed(). Basins meeting at the
+ * same level are separated by the number of steps from where the flooding
+ * entered the level, which approximates the queue order of Stack_Watershed().
+ * The result depends on the block depth but not on the number of threads.
+ * With a single block, the labels are exactly the same as those of
+ * Stack_Watershed().
+ *
+ * Usage:
+ *   ZStackParallelWatershed watershed;
+ *   watershed.setSignal(stack);
+ *   watershed.addSeed(seed, offset, dsIntv);
+ *   watershed.run();
+ *   ZStack *label = watershed.makeLabelStack();
+ */
+class ZStackParallelWatershed
+{
+public:
+  ZStackParallelWatershed();
+
+  /*!
+   * \brief Set the signal stack
+   *
+   * It clears all seeds and results. The stack is not owned by the object and
+   * must be alive until run() returns. Only GREY and GREY16 stacks are
+   * supported.
+   */
+  void setSignal(const Stack *stack);
+
+  /*!
+   * \brief Set the neighborhood connectivity (6, 18 or 26)
+   */
+  void setConnectivity(int conn);
+
+  /*!
+   * \brief Set the lowest level to flood
+   *
+   * Voxels with values lower than \a level are not flooded.
+   */
+  void setMinLevel(int level) { m_minLevel = level; }
+
+  /*!
+   * \brief Zero-valued voxels are barriers unless flooding zero is on.
+   */
+  void setFloodingZero(bool on) { m_floodingZero = on; }
+
+  void setThreadCount(int n) { m_threadCount = n; }
+  int getThreadCount() const { return m_threadCount; }
+
+  /*!
+   * \brief Set the number of slices of each block
+   *
+   * \a depth <= 0 means flooding the whole stack as one block.
+   */
+  void setBlockDepth(int depth) { m_blockDepth = depth; }
+
+  /*!
+   * \brief Add a seed voxel
+   *
+   * (\a x, \a y, \a z) is in the space of the signal stack. A voxel covered
+   * by seeds of different labels is not a seed unless a later seed covers it
+   * again, which is the same as ZStackWatershed::AddSeed(). Seeds out of the
+   * stack or on barriers are ignored.
+   */
+  void addSeed(int x, int y, int z, uint32_t label);
+
+  /*!
+   * \brief Add a seed object
+   *
+   * The coordinates of \a seed are divided by \a dsIntv + 1 and then
+   * subtracted by \a offset to map them to the signal stack.
+   */
+  void addSeed(const ZObject3d &seed, const ZIntPoint &offset,
+               const ZIntPoint &dsIntv);
+  void addSeed(const std::vector<ZObject3d*> &seedArray,
+               const ZIntPoint &offset, const ZIntPoint &dsIntv);
+
+  /*!
+   * \brief Add a seed mask
+   *
+   * Each non-zero voxel of the GREY or GREY16 stack \a seed, which starts at
+   * (\a x0, \a y0, \a z0) of the signal stack, overwrites the label of the
+   * corresponding voxel.
+   */
+  void addSeedMask(const Stack *seed, int x0, int y0, int z0);
+
+  /*!
+   * \brief Run watershed
+   *
+   * \return false iff there is no valid signal.
+   */
+  bool run();
+
+  /*!
+   * \brief Labels of the last run
+   *
+   * The array has the same size as the signal stack. 0 means unlabeled.
+   */
+  const std::vector<uint32_t>& getLabelArray() const { return m_label; }
+
+  uint32_t getMaxLabel() const;
+
+  /*!
+   * \brief Make a label stack from the last run
+   *
+   * The stack is GREY if all labels fit in 8 bits, or GREY16 otherwise.
+   * Labels larger than 65535 cannot be stored in a stack, so no stack is made
+   * for them; use getLabelArray() or makeLabelObjectArray() instead.
+   *
+   * \return NULL if there is no result or the labels do not fit in 16 bits.
+   * The caller is responsible for deleting the returned stack.
+   */
+  ZStack* makeLabelStack() const;
+
+  /*!
+   * \brief Make an object for each label of the last run
+   *
+   * It works for any label. Each object is labeled with its watershed label
+   * and its coordinates are relative to the first voxel of the signal stack.
+   *
+   * \return NULL if there is no result. The caller is responsible for
+   * deleting the returned array and its objects.
+   */
+  ZObject3dScanArray* makeLabelObjectArray() const;
+
+  /*!
+   * \brief Number of passes of reconciling block boundaries in the last run.
+   */
+  int getReconcilePassNumber() const { return m_reconcilePassNumber; }
+
+private:
+  struct Block {
+    int z0;
+    int z1; //Slice after the block
+  };
+
+  struct FloodState {
+    uint16_t level; //Flooding level of a labeled voxel
+    //Number of steps from the voxel where the flooding entered the level
+    uint16_t dist;
+    uint16_t entry; //Level of the voxel where the flooding entered the level
+    uint8_t parent; //Neighbor direction from the voxel flooding this one
+  };
+
+  template <typename T>
+  void runT(const T *signal);
+
+  template <typename T>
+  bool floodBlock(const T *signal, size_t blockIndex, int startLevel,
+                  bool reconciling);
+
+  int getStartLevel() const;
+  std::vector<Block> makeBlockArray() const;
+  void makePlaneSnapshot();
+  int getEffectiveThreadCount(size_t blockNumber) const;
+
+private:
+  const Stack *m_signal = NULL;
+  int m_conn = 6;
+  int m_minLevel = 0;
+  bool m_floodingZero = false;
+  int m_threadCount = 1;
+  int m_blockDepth = 32;
+  int m_reconcilePassNumber = 0;
+
+  int m_width = 0;
+  int m_height = 0;
+  int m_depth = 0;
+  size_t m_area = 0;
+
+  std::vector<uint32_t> m_label;
+  std::vector<FloodState> m_state;
+
+  std::vector<Block> m_blockArray;
+  //Flooding states of the first and last slices of each block, taken
+  //before each reconciling pass
+  std::vector<uint32_t> m_planeLabel;
+  std::vector<FloodState> m_planeState;
+};
+
+#endif // ZSTACKPARALLELWATERSHED_H
@@ -1,4 +1,10 @@
 #include "zstackprocessor.h"
+
+#include <vector>
+#include <algorithm>
+#include <QThread>
+#include <QtConcurrentRun>
+
 #include "zstack.hxx"
 #include "tz_stack_attribute.h"
 #include "tz_stack_bwmorph.h"
@@ -96,11 +102,12 @@ void ZStackProcessor::mexihatFilter(ZStack *stack, double sigma)
 {
   Stack *stackData = stack->c_stack();
 
-  Filter_3d *filter = Mexihat_Filter_3d(sigma);
+  Separable_Filter_3d filter;
+  Mexihat_Separable_Filter_3d(sigma, &filter);
 
-  Stack *filtered = Filter_Stack(stackData, filter);
-
-  Kill_FMatrix(filter);
+  //Stretched as Filter_Stack() does
+  Stack *filtered = StretchedSeparableFilter(
+        stackData, &filter, C_Stack::kind(stackData));
 
   stack->load(filtered, true);
 }
@@ -967,9 +974,166 @@ void ZStackProcessor::SubtractBackground(ZStack *stack, double minFr, int maxIte
 Stack* ZStackProcessor::GaussianSmooth(
     Stack *stack, double sx, double sy, double sz)
 {
-  Filter_3d *filter = Gaussian_Filter_3d(sx, sy, sz);
-  Stack *out = Filter_Stack(stack, filter);
-  Kill_FMatrix(filter);
+  Separable_Filter_3d filter;
+  Gaussian_Separable_Filter_3d(sx, sy, sz, &filter);
+
+  //Stretched as Filter_Stack() does
+  return StretchedSeparableFilter(stack, &filter, C_Stack::kind(stack));
+}
+
+Stack* ZStackProcessor::GaussianSmooth(Stack *stack, double sx, double sy)
+{
+  return GaussianSmooth(stack, sx, sy, 0.0);
+}
+
+Stack* ZStackProcessor::GaussianDerivative(
+    const Stack *stack, double sx, double sy, double sz, int ox, int oy, int oz)
+{
+  Separable_Filter_3d filter;
+  Gaussian_Derivative_Separable_Filter_3d(sx, sy, sz, ox, oy, oz, &filter);
+
+  return SeparableFilter(stack, &filter, FLOAT32);
+}
+
+void ZStackProcessor::RunInSlabs(
+    int length, int threadCount, const std::function<void(int, int)> &f)
+{
+  if (threadCount <= 0) {
+    threadCount = QThread::idealThreadCount();
+  }
+  int slabNumber = std::max(1, std::min(threadCount, length));
+  int slabLength = (length + slabNumber - 1) / slabNumber;
+
+  //The calling thread takes the last slab
+  std::vector<QFuture<void> > futureArray;
+  for (int i0 = 0; i0 + slabLength < length; i0 += slabLength) {
+    futureArray.push_back(QtConcurrent::run([=]() {
+      f(i0, i0 + slabLength);
+    }));
+  }
+
+  f(int(futureArray.size()) * slabLength, length);
+
+  for (QFuture<void> &future : futureArray) {
+    future.waitForFinished();
+  }
+}
+
+Stack* ZStackProcessor::SeparableFilter(
+    const Stack *stack, const Separable_Filter_3d *filter, int kind,
+    int threadCount)
+{
+  Stack *out = C_Stack::make(
+        kind, C_Stack::width(stack), C_Stack::height(stack),
+        C_Stack::depth(stack));
+
+  //Each slab allocates its own buffer
+  RunInSlabs(C_Stack::depth(stack), threadCount, [&](int z0, int z1) {
+    Filter_Stack_Separable_Slab(stack, filter, z0, z1, NULL, out);
+  });
+
+  return out;
+}
+
+typedef std::function<void(const float*, size_t, int)> PlaneFunction;
+
+static void CallPlaneFunction(const float *plane, size_t area, int z,
+                              void *data)
+{
+  (*static_cast<PlaneFunction*>(data))(plane, area, z);
+}
+
+template <typename T>
+static void ScaleFloatPlane(const float *plane, size_t area, float minValue,
+                            float maxDiff, float destMax, T *out)
+{
+  //Same arithmetic as Scale_Float_Stack()
+  for (size_t i = 0; i < area; ++i) {
+    out[i] = (T) (destMax * (plane[i] - minValue) / maxDiff);
+  }
+}
+
+Stack* ZStackProcessor::StretchedSeparableFilter(
+    const Stack *stack, const Separable_Filter_3d *filter, int kind,
+    int threadCount)
+{
+  int depth = C_Stack::depth(stack);
+  Stack *out = C_Stack::make(
+        kind, C_Stack::width(stack), C_Stack::height(stack), depth);
+  if (C_Stack::voxelNumber(stack) == 0) {
+    return out;
+  }
+
+  std::vector<float> planeMin(depth);
+  std::vector<float> planeMax(depth);
+  PlaneFunction updateRange = [&](const float *plane, size_t area, int z) {
+    std::pair<const float*, const float*> range =
+        std::minmax_element(plane, plane + area);
+    planeMin[z] = *range.first;
+    planeMax[z] = *range.second;
+  };
+  RunInSlabs(depth, threadCount, [&](int z0, int z1) {
+    Filter_Stack_Separable_Slab_Plane(
+          stack, filter, z0, z1, NULL, CallPlaneFunction, &updateRange);
+  });
+
+  float minValue = *std::min_element(planeMin.begin(), planeMin.end());
+  float maxDiff =
+      *std::max_element(planeMax.begin(), planeMax.end()) - minValue;
+  if (maxDiff == 0.0f) {
+    C_Stack::setZero(out);
+    return out;
+  }
+
+  PlaneFunction scale = [&](const float *plane, size_t area, int z) {
+    size_t offset = area * z;
+    switch (kind) {
+    case GREY:
+      ScaleFloatPlane(plane, area, minValue, maxDiff, (float) MAXGREY(GREY),
+                      C_Stack::array8(out) + offset);
+      break;
+    case GREY16:
+      ScaleFloatPlane(plane, area, minValue, maxDiff, (float) MAXGREY(GREY16),
+                      C_Stack::guardedArray16(out) + offset);
+      break;
+    case FLOAT32:
+      ScaleFloatPlane(plane, area, minValue, maxDiff, 1.0f,
+                      C_Stack::guardedArrayFloat32(out) + offset);
+      break;
+    default:
+      break;
+    }
+  };
+  RunInSlabs(depth, threadCount, [&](int z0, int z1) {
+    Filter_Stack_Separable_Slab_Plane(
+          stack, filter, z0, z1, NULL, CallPlaneFunction, &scale);
+  });
+
+  return out;
+}
+
+Stack* ZStackProcessor::BwdistSqr(
+    const Stack *stack, Stack *out, int pad, bool sliceWise, int threadCount)
+{
+  if (out == NULL) {
+    out = C_Stack::make(GREY16, C_Stack::width(stack), C_Stack::height(stack),
+                        C_Stack::depth(stack));
+  }
+
+  //Not worth threads for a small stack
+  if (C_Stack::voxelNumber(stack) < 1000000) {
+    threadCount = 1;
+  }
+
+  RunInSlabs(C_Stack::depth(stack), threadCount, [&](int z0, int z1) {
+    Stack_Bwdist_Sqr_Plane(stack, out, pad, z0, z1);
+  });
+
+  if (!sliceWise) {
+    RunInSlabs(C_Stack::height(stack), threadCount, [&](int y0, int y1) {
+      Stack_Bwdist_Sqr_Column(out, pad, y0, y1);
+    });
+  }
 
   return out;
 }
@@ -8,8 +8,11 @@
 
 #include "itkimagedefs.h"
 #include <string>
+#include <functional>
 
 #include "c_stack.h"
+#include "tz_stack.h"
+
 class ZStack;
 
 class ZStackProcessor
@@ -65,10 +68,61 @@ public:
       const std::string noiseModel = "POISSON", const float fidelityWeight = 0.1f);
 
   static void RemoveBranchPoint(Stack *stack, int nnbr);
+  /*!
+   * \brief Gaussian smoothing
+   *
+   * The result has the same kind as \a stack. Its intensities are stretched
+   * to the range of the kind, as Filter_Stack() does.
+   */
   static Stack* GaussianSmooth(Stack *stack, double sx, double sy, double sz);
   //Slicewise smoothing
   static Stack* GaussianSmooth(Stack *stack, double sx, double sy);
 
+  /*!
+   * \brief Derivative-of-Gaussian filtering
+   *
+   * \a ox, \a oy and \a oz are the derivative orders (0, 1 or 2) along each
+   * axis. The result is a FLOAT32 stack.
+   */
+  static Stack* GaussianDerivative(
+      const Stack *stack, double sx, double sy, double sz,
+      int ox, int oy, int oz);
+
+  /*!
+   * \brief Filter a stack with a separable filter
+   *
+   * The stack is split into z slabs, which are filtered in parallel by
+   * \a threadCount threads (the ideal thread count if it is not positive).
+   * Each thread has its own float buffer for a few planes only. The result is
+   * a new stack of \a kind. See Filter_Stack_Separable() for details.
+   */
+  static Stack* SeparableFilter(
+      const Stack *stack, const Separable_Filter_3d *filter, int kind,
+      int threadCount = 0);
+
+  /*!
+   * \brief Filter a stack with a separable filter and stretch the response
+   *
+   * The response is scaled to the range of \a kind (GREY, GREY16 or FLOAT32)
+   * as Scale_Float_Stack() does. The stack is filtered twice, once for the
+   * range of the response and once for the output, so that no full-size
+   * float volume is needed.
+   */
+  static Stack* StretchedSeparableFilter(
+      const Stack *stack, const Separable_Filter_3d *filter, int kind,
+      int threadCount = 0);
+
+  /*!
+   * \brief Squared distance transform with multiple threads
+   *
+   * It produces the same result as Stack_Bwdist_Sqr(). The planes and then
+   * the rows of \a stack are split among \a threadCount threads (the ideal
+   * thread count if it is not positive). A small stack is done in the calling
+   * thread.
+   */
+  static Stack* BwdistSqr(const Stack *stack, Stack *out, int pad,
+                          bool sliceWise, int threadCount = 0);
+
   static void ShrinkSkeleton(Stack *stack, int level);
 
   static ZStack* SeededWatershed(ZStack *signal, ZStack *label);
@@ -87,6 +141,12 @@ public:
 
 private:
   static void ShrinkSkeleton(Stack *stack);
+
+  /*!
+   * \brief Run \a f(i0, i1) on [0, \a length) split into \a threadCount slabs
+   */
+  static void RunInSlabs(int length, int threadCount,
+                         const std::function<void(int, int)> &f);
 };
 
 #endif // ZSTACKPROCESSOR_H
@@ -10,6 +10,7 @@
 #include "zobject3dscan.h"
 #include "zobject3d.h"
 #include "zstackarray.h"
+#include "zstackparallelwatershed.h"
 
 ZStackWatershed::ZStackWatershed() : m_floodingZero(false)
 {
@@ -243,6 +244,41 @@ ZStack *ZStackWatershed::run(
 }
 
 
+ZStack* ZStackWatershed::runParallel(
+    const Stack *source, const ZIntPoint &sourceOffset,
+    const std::vector<ZStack *> &seedMask) const
+{
+  ZStackParallelWatershed watershed;
+  if (m_threadCount > 0) {
+    watershed.setThreadCount(m_threadCount);
+  }
+  watershed.setFloodingZero(m_floodingZero);
+  watershed.setSignal(source);
+  for (const ZStack *seed : seedMask) {
+    if (seed != NULL) {
+      ZIntPoint seedOffset = seed->getOffset() - sourceOffset;
+      watershed.addSeedMask(seed->c_stack(), seedOffset.getX(),
+                            seedOffset.getY(), seedOffset.getZ());
+    }
+  }
+
+  std::cout << "Computing watershed in parallel ..." << std::endl;
+  ZStack *result = NULL;
+  if (watershed.run()) {
+    result = watershed.makeLabelStack();
+    if (result != NULL) {
+      result->setOffset(sourceOffset);
+    } else {
+      std::cout << "Too many seeds for a label stack: "
+                << watershed.getMaxLabel() << std::endl;
+    }
+    std::cout << "Boundary passes: " << watershed.getReconcilePassNumber()
+              << std::endl;
+  }
+
+  return result;
+}
+
 ZStack *ZStackWatershed::run(
     const ZStack *stack, const std::vector<ZStack *> &seedMask)
 {
@@ -269,6 +305,12 @@ ZStack *ZStackWatershed::run(
             &box, -stackBox.cb[0], -stackBox.cb[1], -stackBox.cb[2]);
       source = C_Stack::crop(stack->c_stack(), box, NULL);
 
+      if (m_computingParallel) {
+        result = runParallel(source, sourceOffset, seedMask);
+        C_Stack::kill(const_cast<Stack*>(source));
+        return result;
+      }
+
       Stack_Watershed_Workspace *ws = CreateWorkspace(source, m_floodingZero);
       ws->conn=6;
       AddSeed(ws, sourceOffset, seedMask);
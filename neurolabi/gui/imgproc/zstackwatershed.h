@@ -40,6 +40,18 @@ public:
     m_floodingZero = status;
   }
 
+  /*!
+   * \brief Turn on/off computing with ZStackParallelWatershed
+   *
+   * When it is on, the seed masks can be GREY16 and the result is a GREY16
+   * stack if there are labels larger than 255. The stack is flooded in blocks
+   * by \a threadCount threads (0 for the number of cores).
+   */
+  void setComputingParallel(bool on, int threadCount = 0) {
+    m_computingParallel = on;
+    m_threadCount = threadCount;
+  }
+
   static Stack_Watershed_Workspace* CreateWorkspace(
       const Stack *stack, bool floodingZero);
   static Stack_Watershed_Workspace* CreateWorkspace(
@@ -61,9 +73,15 @@ public:
   static void AddSeed(Stack_Watershed_Workspace *ws, const ZIntPoint &offset,
                       const ZIntPoint &dsIntv, const ZObject3d* seed);
 
+private:
+  ZStack* runParallel(const Stack *source, const ZIntPoint &sourceOffset,
+                      const std::vector<ZStack *> &seedMask) const;
+
 private:
   Cuboid_I m_range;
   bool m_floodingZero;
+  bool m_computingParallel = false;
+  int m_threadCount = 0;
 };
 
 #endif // ZSTACKWATERSHED_H
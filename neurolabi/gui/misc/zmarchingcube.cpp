@@ -1,15 +1,47 @@
 #include "zmarchingcube.h"
 
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <QtConcurrent>
+
 #include "ilastik/marching_cubes.h"
 #include "ilastik/laplacian_smoothing.h"
 #include "zmesh.h"
 #include "zstack.hxx"
+#include "zobject3dscan.h"
+#include "zintcuboid.h"
 
 ZMarchingCube::ZMarchingCube()
 {
 
 }
 
+void ZMarchingCube::setOffsetAdjust(bool on)
+{
+  m_offsetAdjust = on;
+}
+
+void ZMarchingCube::setSmooth(int smooth)
+{
+  m_smooth = smooth;
+}
+
+void ZMarchingCube::setResultHost(ZMesh *mesh)
+{
+  m_result = mesh;
+}
+
+void ZMarchingCube::setBlockSize(int size)
+{
+  m_blockSize = size;
+}
+
+void ZMarchingCube::setThreadCount(int n)
+{
+  m_threadCount = n;
+}
+
 namespace {
 
 ZMesh * ConvertMeshToZMesh(
@@ -66,6 +98,283 @@ ZMesh * ConvertMeshToZMesh(
   return out;
 }
 
+/*
+ * The volume of an object with a one-voxel margin, which is divided into
+ * bricks of cubes. Brick (bx, by, bz) has the cubes starting from
+ * (bx, by, bz) * blockSize, so it needs one more voxel than the number of
+ * its cubes along each axis.
+ */
+struct BrickGrid
+{
+  int x0 = 0; //World coordinates of voxel (0, 0, 0)
+  int y0 = 0;
+  int z0 = 0;
+  size_t width = 0;
+  size_t height = 0;
+  size_t depth = 0;
+  size_t blockSize = 0;
+  size_t bw = 0; //Number of bricks along each axis
+  size_t bh = 0;
+  size_t bd = 0;
+
+  BrickGrid(const ZIntCuboid &box, size_t size) {
+    x0 = box.getFirstCorner().getX() - 1;
+    y0 = box.getFirstCorner().getY() - 1;
+    z0 = box.getFirstCorner().getZ() - 1;
+    width = box.getWidth() + 2;
+    height = box.getHeight() + 2;
+    depth = box.getDepth() + 2;
+    blockSize = size;
+    bw = (width - 2) / blockSize + 1;
+    bh = (height - 2) / blockSize + 1;
+    bd = (depth - 2) / blockSize + 1;
+  }
+
+  size_t getBrickIndex(size_t bx, size_t by, size_t bz) const {
+    return (bz * bh + by) * bw + bx;
+  }
+
+  //Voxel range [start, end] of brick b along an axis of size dim
+  void getVoxelRange(size_t b, size_t dim, size_t *start, size_t *end) const {
+    *start = b * blockSize;
+    *end = std::min(*start + blockSize, dim - 1);
+  }
+
+  //First brick containing voxel v (v > 0)
+  size_t getFirstBrick(size_t v) const {
+    return (v - 1) / blockSize;
+  }
+
+  //Last brick containing voxel v
+  size_t getLastBrick(size_t v, size_t brickNumber) const {
+    return std::min(v / blockSize, brickNumber - 1);
+  }
+
+  /*
+   * Vertex ID of the mesh marched from the whole volume, which identifies a
+   * vertex shared by neighboring bricks.
+   */
+  uint64_t getVertexKey(size_t x, size_t y, size_t z, int axis) const {
+    return 3 * ((z * height + y) * width + x) + axis;
+  }
+};
+
+struct BrickMesh
+{
+  std::vector<uint64_t> vertexKey;
+  std::vector<size_t> faces;
+};
+
+std::vector<size_t> GetBrickList(
+    const ZObject3dScan &obj, const BrickGrid &grid)
+{
+  std::vector<size_t> brickList;
+  for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
+    const ZObject3dStripe &stripe = obj.getStripe(i);
+    size_t y = stripe.getY() - grid.y0;
+    size_t z = stripe.getZ() - grid.z0;
+    for (size_t bz = grid.getFirstBrick(z);
+         bz <= grid.getLastBrick(z, grid.bd); ++bz) {
+      for (size_t by = grid.getFirstBrick(y);
+           by <= grid.getLastBrick(y, grid.bh); ++by) {
+        for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+          size_t x0 = stripe.getSegmentStart(j) - grid.x0;
+          size_t x1 = stripe.getSegmentEnd(j) - grid.x0;
+          for (size_t bx = grid.getFirstBrick(x0);
+               bx <= grid.getLastBrick(x1, grid.bw); ++bx) {
+            brickList.push_back(grid.getBrickIndex(bx, by, bz));
+          }
+        }
+      }
+    }
+  }
+
+  std::sort(brickList.begin(), brickList.end());
+  brickList.erase(std::unique(brickList.begin(), brickList.end()),
+                  brickList.end());
+
+  return brickList;
+}
+
+/*
+ * Fill the voxels of a brick from a canonized object. zStart[k] is the index
+ * of the first stripe whose z is not less than grid.z0 + k.
+ */
+void FillBrick(const ZObject3dScan &obj, const std::vector<size_t> &zStart,
+               const BrickGrid &grid, size_t brickIndex,
+               std::vector<uint8_t> *buffer, size_t dim[3])
+{
+  size_t bx = brickIndex % grid.bw;
+  size_t by = (brickIndex / grid.bw) % grid.bh;
+  size_t bz = brickIndex / grid.bw / grid.bh;
+
+  size_t start[3], end[3];
+  grid.getVoxelRange(bx, grid.width, start, end);
+  grid.getVoxelRange(by, grid.height, start + 1, end + 1);
+  grid.getVoxelRange(bz, grid.depth, start + 2, end + 2);
+  for (int i = 0; i < 3; ++i) {
+    dim[i] = end[i] - start[i] + 1;
+  }
+
+  buffer->assign(dim[0] * dim[1] * dim[2], 0);
+
+  int minX = grid.x0 + start[0];
+  int maxX = grid.x0 + end[0];
+  int minY = grid.y0 + start[1];
+  int maxY = grid.y0 + end[1];
+  for (size_t k = start[2]; k <= end[2]; ++k) {
+    uint8_t *plane = &((*buffer)[(k - start[2]) * dim[0] * dim[1]]);
+    size_t stripeIndex = zStart[k];
+    size_t stripeEnd = zStart[k + 1];
+
+    //First stripe of the brick
+    size_t count = stripeEnd - stripeIndex;
+    while (count > 0) {
+      size_t step = count / 2;
+      if (obj.getStripe(stripeIndex + step).getY() < minY) {
+        stripeIndex += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+
+    for (; stripeIndex < stripeEnd; ++stripeIndex) {
+      const ZObject3dStripe &stripe = obj.getStripe(stripeIndex);
+      if (stripe.getY() > maxY) {
+        break;
+      }
+      uint8_t *row = plane + (stripe.getY() - minY) * dim[0];
+      for (int j = 0; j < stripe.getSegmentNumber(); ++j) {
+        int x0 = std::max(minX, stripe.getSegmentStart(j));
+        int x1 = std::min(maxX, stripe.getSegmentEnd(j));
+        if (x0 <= x1) {
+          std::fill(row + x0 - minX, row + x1 - minX + 1, 1);
+        }
+      }
+    }
+  }
+}
+
+void MarchBrick(const std::vector<uint8_t> &buffer, const size_t dim[3],
+                const BrickGrid &grid, size_t brickIndex, BrickMesh *result)
+{
+  ilastik::Mesh mesh = ilastik::march(
+        buffer.data(), dim[0], dim[1], dim[2], 1);
+
+  size_t ox = (brickIndex % grid.bw) * grid.blockSize;
+  size_t oy = ((brickIndex / grid.bw) % grid.bh) * grid.blockSize;
+  size_t oz = (brickIndex / grid.bw / grid.bh) * grid.blockSize;
+
+  //Each vertex is at the middle of an edge along the axis with a fractional
+  //coordinate.
+  result->vertexKey.resize(mesh.vertexCount);
+  for (size_t i = 0; i < mesh.vertexCount; ++i) {
+    const ilastik::Point &pt = mesh.vertices[i];
+    size_t x = size_t(pt[0]);
+    size_t y = size_t(pt[1]);
+    size_t z = size_t(pt[2]);
+    int axis = 0;
+    if (pt[1] != float(y)) {
+      axis = 1;
+    } else if (pt[2] != float(z)) {
+      axis = 2;
+    }
+    result->vertexKey[i] = grid.getVertexKey(x + ox, y + oy, z + oz, axis);
+  }
+
+  result->faces.assign(mesh.faces, mesh.faces + mesh.faceCount * 3);
+}
+
+/*
+ * Merge brick meshes into \a mesh. Vertices are ordered by their keys, which
+ * is the order of the vertices marched from the whole volume.
+ */
+void StitchBrickMesh(const std::vector<BrickMesh> &brickMeshArray,
+                     const BrickGrid &grid, ilastik::Mesh *mesh)
+{
+  std::vector<uint64_t> keyArray;
+  size_t faceCount = 0;
+  for (const BrickMesh &brickMesh : brickMeshArray) {
+    keyArray.insert(keyArray.end(), brickMesh.vertexKey.begin(),
+                    brickMesh.vertexKey.end());
+    faceCount += brickMesh.faces.size() / 3;
+  }
+  std::sort(keyArray.begin(), keyArray.end());
+  keyArray.erase(std::unique(keyArray.begin(), keyArray.end()), keyArray.end());
+
+  mesh->vertexCount = keyArray.size();
+  mesh->vertices = new ilastik::Point[mesh->vertexCount];
+  for (size_t i = 0; i < keyArray.size(); ++i) {
+    uint64_t key = keyArray[i];
+    int axis = key % 3;
+    key /= 3;
+    ilastik::Point &pt = mesh->vertices[i];
+    pt[0] = float(key % grid.width);
+    pt[1] = float((key / grid.width) % grid.height);
+    pt[2] = float(key / grid.width / grid.height);
+    pt[axis] += 0.5f;
+  }
+
+  mesh->faceCount = faceCount;
+  mesh->faces = new size_t[faceCount * 3];
+  size_t *face = mesh->faces;
+  std::vector<size_t> vertexIndex;
+  for (const BrickMesh &brickMesh : brickMeshArray) {
+    vertexIndex.resize(brickMesh.vertexKey.size());
+    for (size_t i = 0; i < vertexIndex.size(); ++i) {
+      vertexIndex[i] = std::lower_bound(
+            keyArray.begin(), keyArray.end(), brickMesh.vertexKey[i]) -
+          keyArray.begin();
+    }
+    for (size_t index : brickMesh.faces) {
+      *(face++) = vertexIndex[index];
+    }
+  }
+}
+
+void MarchObject(const ZObject3dScan &obj, size_t blockSize, int threadCount,
+                 ilastik::Mesh *mesh)
+{
+  BrickGrid grid(obj.getBoundBox(), blockSize);
+
+  std::vector<size_t> zStart(grid.depth + 1, 0);
+  for (size_t i = 0; i < obj.getStripeNumber(); ++i) {
+    ++zStart[obj.getStripe(i).getZ() - grid.z0 + 1];
+  }
+  for (size_t k = 1; k < zStart.size(); ++k) {
+    zStart[k] += zStart[k - 1];
+  }
+
+  std::vector<size_t> brickList = GetBrickList(obj, grid);
+  std::vector<BrickMesh> brickMeshArray(brickList.size());
+
+  std::atomic<size_t> nextBrick(0);
+  auto marchFunc = [&]() {
+    std::vector<uint8_t> buffer;
+    size_t dim[3];
+    for (size_t i = nextBrick++; i < brickList.size(); i = nextBrick++) {
+      FillBrick(obj, zStart, grid, brickList[i], &buffer, dim);
+      MarchBrick(buffer, dim, grid, brickList[i], &(brickMeshArray[i]));
+    }
+  };
+
+  int workerCount = std::min(threadCount, int(brickList.size()));
+  if (workerCount > 1) {
+    std::vector<QFuture<void> > futureArray;
+    for (int i = 0; i < workerCount; ++i) {
+      futureArray.push_back(QtConcurrent::run(marchFunc));
+    }
+    for (QFuture<void> &future : futureArray) {
+      future.waitForFinished();
+    }
+  } else {
+    marchFunc();
+  }
+
+  StitchBrickMesh(brickMeshArray, grid, mesh);
+}
+
 }
 
 ZMesh* ZMarchingCube::March(
@@ -99,6 +408,41 @@ ZMesh* ZMarchingCube::march(const ZStack &stack)
   return out;
 }
 
+ZMesh* ZMarchingCube::march(const ZObject3dScan &obj)
+{
+  if (!obj.hasVoxel()) {
+    return m_result;
+  }
+
+  if (m_blockSize <= 0) {
+    ZStack *stack = obj.toStackObjectWithMargin(1, 1);
+    ZMesh *out = march(*stack);
+    delete stack;
+
+    return out;
+  }
+
+  const ZObject3dScan *source = &obj;
+  ZObject3dScan canonizedObj;
+  if (!obj.isCanonized()) {
+    canonizedObj = obj;
+    canonizedObj.canonize();
+    source = &canonizedObj;
+  }
+
+  ilastik::Mesh mesh;
+  MarchObject(*source, m_blockSize, m_threadCount, &mesh);
+
+  ilastik::smooth(mesh, m_smooth);
+
+  ZIntCuboid box = source->getBoundBox();
+  ZMesh *out = ConvertMeshToZMesh(
+        mesh, box.getFirstCorner() - 1, source->getDsIntv(), m_offsetAdjust,
+        m_result);
+
+  return out;
+}
+
 /*
 ZMesh* ZMarchingCube::March(const ZStack &stack, ZMesh *out)
 {
@@ -3,6 +3,7 @@
 
 class ZStack;
 class ZMesh;
+class ZObject3dScan;
 
 class ZMarchingCube
 {
@@ -13,15 +14,42 @@ public:
   void setSmooth(int smooth);
   void setResultHost(ZMesh *mesh);
 
+  /*!
+   * \brief Set the brick size for marching an object
+   *
+   * An object is marched in bricks of \a size^3 cubes, so that the memory of
+   * voxel data is bounded by the brick size instead of the bounding box of
+   * the object. A non-positive size means marching the object at once.
+   */
+  void setBlockSize(int size);
+
+  /*!
+   * \brief Set the maximum number of threads for marching bricks.
+   */
+  void setThreadCount(int n);
+
 //  static ZMesh* March(const ZStack &stack, ZMesh *out = nullptr);
   static ZMesh* March(const ZStack &stack, int smooth, bool offsetAdjust, ZMesh *out);
 
   ZMesh* march(const ZStack &stack);
 
+  /*!
+   * \brief Extract the surface of an object
+   *
+   * The result is the same as marching the stack of the object with a one
+   * voxel margin (ZObject3dScan::toStackObjectWithMargin(1, 1)), except for
+   * the order of triangles. Bricks are extracted from the object without
+   * densifying the whole object, marched in parallel and stitched by their
+   * shared boundary vertices.
+   */
+  ZMesh* march(const ZObject3dScan &obj);
+
 private:
   bool m_offsetAdjust = false;
   int m_smooth = 3;
   ZMesh *m_result = nullptr;
+  int m_blockSize = 64;
+  int m_threadCount = 4;
 };
 
 #endif // ZMARCHINGCUBE_H
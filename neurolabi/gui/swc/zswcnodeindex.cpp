@@ -0,0 +1,306 @@
+#include "zswcnodeindex.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "swctreenode.h"
+
+ZSwcNodeIndex::ZSwcNodeIndex()
+{
+  clear();
+}
+
+void ZSwcNodeIndex::clear()
+{
+  m_nodeArray.clear();
+  m_record.clear();
+  m_cellStart.clear();
+  m_largeNode.clear();
+  for (int i = 0; i < 3; ++i) {
+    m_origin[i] = 0.0;
+    m_dim[i] = 0;
+  }
+  m_cellSize = 1.0;
+}
+
+void ZSwcNodeIndex::build(const std::vector<Swc_Tree_Node *> &nodeArray)
+{
+  clear();
+
+  for (Swc_Tree_Node *tn : nodeArray) {
+    if (SwcTreeNode::isRegular(tn)) {
+      m_nodeArray.push_back(tn);
+    }
+  }
+
+  if (m_nodeArray.empty()) {
+    return;
+  }
+
+  std::vector<NodeRecord> recordArray(m_nodeArray.size());
+  double minCorner[3] = {Infinity, Infinity, Infinity};
+  double maxCorner[3] = {-Infinity, -Infinity, -Infinity};
+  std::vector<double> radiusArray(m_nodeArray.size());
+  for (size_t i = 0; i < m_nodeArray.size(); ++i) {
+    const Swc_Tree_Node *tn = m_nodeArray[i];
+    NodeRecord &record = recordArray[i];
+    record.x = SwcTreeNode::x(tn);
+    record.y = SwcTreeNode::y(tn);
+    record.z = SwcTreeNode::z(tn);
+    record.r = SwcTreeNode::radius(tn);
+    record.index = i;
+    radiusArray[i] = record.r;
+
+    double pos[3] = {record.x, record.y, record.z};
+    for (int j = 0; j < 3; ++j) {
+      minCorner[j] = std::min(minCorner[j], pos[j]);
+      maxCorner[j] = std::max(maxCorner[j], pos[j]);
+    }
+  }
+
+  //A cell is a few times of a typical node and holds a few nodes on average
+  std::nth_element(radiusArray.begin(),
+                   radiusArray.begin() + radiusArray.size() / 2,
+                   radiusArray.end());
+  double medianRadius = radiusArray[radiusArray.size() / 2];
+  double volume = 1.0;
+  for (int j = 0; j < 3; ++j) {
+    volume *= std::max(1.0, maxCorner[j] - minCorner[j]);
+  }
+  m_cellSize = std::max(
+        1.0, std::max(medianRadius * 4.0, std::cbrt(volume / recordArray.size())));
+
+  //Keep the number of cells linear to the number of nodes
+  const double maxCellNumber = 4.0 * recordArray.size() + 64.0;
+  for (;;) {
+    double cellNumber = 1.0;
+    for (int j = 0; j < 3; ++j) {
+      m_dim[j] = int(std::floor((maxCorner[j] - minCorner[j]) / m_cellSize)) + 1;
+      cellNumber *= m_dim[j];
+    }
+    if (cellNumber <= maxCellNumber) {
+      break;
+    }
+    m_cellSize *= 1.5;
+  }
+
+  for (int j = 0; j < 3; ++j) {
+    m_origin[j] = minCorner[j];
+  }
+
+  //Counting sort by cells, which keeps the original order within a cell
+  size_t cellNumber = size_t(m_dim[0]) * m_dim[1] * m_dim[2];
+  std::vector<size_t> cellIndexArray(recordArray.size());
+  m_cellStart.assign(cellNumber + 1, 0);
+  for (size_t i = 0; i < recordArray.size(); ++i) {
+    const NodeRecord &record = recordArray[i];
+    cellIndexArray[i] = getCellIndex(getCellCoord(record.x, 0),
+                                     getCellCoord(record.y, 1),
+                                     getCellCoord(record.z, 2));
+    ++m_cellStart[cellIndexArray[i] + 1];
+  }
+  for (size_t i = 1; i <= cellNumber; ++i) {
+    m_cellStart[i] += m_cellStart[i - 1];
+  }
+
+  m_record.resize(recordArray.size());
+  std::vector<size_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+  for (size_t i = 0; i < recordArray.size(); ++i) {
+    size_t pos = cursor[cellIndexArray[i]]++;
+    m_record[pos] = recordArray[i];
+    if (recordArray[i].r > m_cellSize) {
+      m_largeNode.push_back(pos);
+    }
+  }
+}
+
+int ZSwcNodeIndex::getCellCoord(double v, int axis) const
+{
+  //Clamp before converting to int to handle infinite or far away values
+  double c = std::floor((v - m_origin[axis]) / m_cellSize);
+
+  return int(std::min(std::max(c, 0.0), double(m_dim[axis] - 1)));
+}
+
+size_t ZSwcNodeIndex::getCellIndex(int ix, int iy, int iz) const
+{
+  return (size_t(iz) * m_dim[1] + iy) * m_dim[0] + ix;
+}
+
+void ZSwcNodeIndex::collectNodeInRange(
+    int ix0, int iy0, int iz0, int ix1, int iy1, int iz1,
+    std::vector<size_t> *indexArray) const
+{
+  for (int iz = iz0; iz <= iz1; ++iz) {
+    for (int iy = iy0; iy <= iy1; ++iy) {
+      //Cells along x are contiguous in the record array
+      size_t start = m_cellStart[getCellIndex(ix0, iy, iz)];
+      size_t end = m_cellStart[getCellIndex(ix1, iy, iz) + 1];
+      for (size_t i = start; i < end; ++i) {
+        indexArray->push_back(i);
+      }
+    }
+  }
+}
+
+std::vector<Swc_Tree_Node*> ZSwcNodeIndex::toNodeArray(
+    std::vector<size_t> &indexArray) const
+{
+  std::vector<size_t> nodeIndexArray(indexArray.size());
+  for (size_t i = 0; i < indexArray.size(); ++i) {
+    nodeIndexArray[i] = m_record[indexArray[i]].index;
+  }
+  std::sort(nodeIndexArray.begin(), nodeIndexArray.end());
+  nodeIndexArray.erase(
+        std::unique(nodeIndexArray.begin(), nodeIndexArray.end()),
+        nodeIndexArray.end());
+
+  std::vector<Swc_Tree_Node*> nodeArray(nodeIndexArray.size());
+  for (size_t i = 0; i < nodeIndexArray.size(); ++i) {
+    nodeArray[i] = m_nodeArray[nodeIndexArray[i]];
+  }
+
+  return nodeArray;
+}
+
+std::vector<Swc_Tree_Node*> ZSwcNodeIndex::getNodeNear(
+    double x, double y, double z, double margin) const
+{
+  std::vector<size_t> indexArray;
+
+  if (!isEmpty()) {
+    //Nodes in the grid have radius <= m_cellSize
+    double range = m_cellSize + std::max(0.0, margin);
+    std::vector<size_t> candidate;
+    collectNodeInRange(
+          getCellCoord(x - range, 0), getCellCoord(y - range, 1),
+          getCellCoord(z - range, 2), getCellCoord(x + range, 0),
+          getCellCoord(y + range, 1), getCellCoord(z + range, 2), &candidate);
+    candidate.insert(candidate.end(), m_largeNode.begin(), m_largeNode.end());
+
+    for (size_t i : candidate) {
+      const NodeRecord &record = m_record[i];
+      double dx = record.x - x;
+      double dy = record.y - y;
+      double dz = record.z - z;
+      if (std::sqrt(dx * dx + dy * dy + dz * dz) < record.r + margin) {
+        indexArray.push_back(i);
+      }
+    }
+  }
+
+  return toNodeArray(indexArray);
+}
+
+std::vector<Swc_Tree_Node*> ZSwcNodeIndex::getNodeNearXY(
+    double x, double y, double margin) const
+{
+  std::vector<size_t> indexArray;
+
+  if (!isEmpty()) {
+    double range = m_cellSize + std::max(0.0, margin);
+    std::vector<size_t> candidate;
+    collectNodeInRange(
+          getCellCoord(x - range, 0), getCellCoord(y - range, 1), 0,
+          getCellCoord(x + range, 0), getCellCoord(y + range, 1),
+          m_dim[2] - 1, &candidate);
+    candidate.insert(candidate.end(), m_largeNode.begin(), m_largeNode.end());
+
+    for (size_t i : candidate) {
+      const NodeRecord &record = m_record[i];
+      double dx = record.x - x;
+      double dy = record.y - y;
+      if (std::sqrt(dx * dx + dy * dy) < record.r + margin) {
+        indexArray.push_back(i);
+      }
+    }
+  }
+
+  return toNodeArray(indexArray);
+}
+
+std::vector<Swc_Tree_Node*> ZSwcNodeIndex::getNodeInBox(
+    double x0, double y0, double z0, double x1, double y1, double z1) const
+{
+  std::vector<size_t> indexArray;
+
+  if (!isEmpty() && x0 <= x1 && y0 <= y1 && z0 <= z1) {
+    std::vector<size_t> candidate;
+    collectNodeInRange(
+          getCellCoord(x0, 0), getCellCoord(y0, 1), getCellCoord(z0, 2),
+          getCellCoord(x1, 0), getCellCoord(y1, 1), getCellCoord(z1, 2),
+          &candidate);
+    for (size_t i : candidate) {
+      const NodeRecord &record = m_record[i];
+      if (record.x >= x0 && record.x <= x1 && record.y >= y0 &&
+          record.y <= y1 && record.z >= z0 && record.z <= z1) {
+        indexArray.push_back(i);
+      }
+    }
+  }
+
+  return toNodeArray(indexArray);
+}
+
+Swc_Tree_Node* ZSwcNodeIndex::findClosestNode(
+    double x, double y, double z) const
+{
+  if (isEmpty()) {
+    return NULL;
+  }
+
+  int center[3] = {
+    getCellCoord(x, 0), getCellCoord(y, 1), getCellCoord(z, 2)
+  };
+  int maxRing = std::max(m_dim[0], std::max(m_dim[1], m_dim[2]));
+
+  const NodeRecord *best = NULL;
+  double minDistSquare = 0.0;
+
+  //Visit cells ring by ring. Cells beyond ring k are at least k * m_cellSize
+  //away from the point projected into the grid, and thus from the point.
+  for (int k = 0; k <= maxRing; ++k) {
+    int lower[3], upper[3];
+    for (int j = 0; j < 3; ++j) {
+      lower[j] = std::max(0, center[j] - k);
+      upper[j] = std::min(m_dim[j] - 1, center[j] + k);
+    }
+
+    for (int iz = lower[2]; iz <= upper[2]; ++iz) {
+      for (int iy = lower[1]; iy <= upper[1]; ++iy) {
+        bool onShell = (std::abs(iz - center[2]) == k ||
+                        std::abs(iy - center[1]) == k);
+        int step = onShell ? 1 : 2 * k;
+        for (int ix = center[0] - k; ix <= center[0] + k;
+             ix += std::max(1, step)) {
+          if (ix < lower[0] || ix > upper[0]) {
+            continue;
+          }
+          size_t cellIndex = getCellIndex(ix, iy, iz);
+          for (size_t i = m_cellStart[cellIndex];
+               i < m_cellStart[cellIndex + 1]; ++i) {
+            const NodeRecord &record = m_record[i];
+            double dx = record.x - x;
+            double dy = record.y - y;
+            double dz = record.z - z;
+            double distSquare = dx * dx + dy * dy + dz * dz;
+            if (best == NULL || distSquare < minDistSquare ||
+                (distSquare == minDistSquare && record.index < best->index)) {
+              best = &record;
+              minDistSquare = distSquare;
+            }
+          }
+        }
+      }
+    }
+
+    if (best != NULL) {
+      double bound = k * m_cellSize;
+      if (minDistSquare < bound * bound) {
+        break;
+      }
+    }
+  }
+
+  return m_nodeArray[best->index];
+}
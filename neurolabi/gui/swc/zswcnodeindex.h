@@ -0,0 +1,100 @@
+#ifndef ZSWCNODEINDEX_H
+#define ZSWCNODEINDEX_H
+
+#include <vector>
+#include <cstddef>
+
+#include "tz_swc_tree.h"
+
+/*!
+ * \brief Spatial index of SWC nodes
+ *
+ * The nodes are bucketed into a uniform grid by their centers. The cell size
+ * is chosen from the node radii and the node density, so that a query only
+ * visits a few cells around the query point. Nodes with radius larger than
+ * the cell size are also kept in a separate list, which is checked by every
+ * sphere query.
+ *
+ * The index does not own the nodes and does not track changes of them. It
+ * must be rebuilt after the nodes are modified (see ZSwcTree::deprecate()).
+ *
+ * All queries return nodes in the order of the array used to build the
+ * index, so ties are resolved in the same way as a linear scan of the array.
+ */
+class ZSwcNodeIndex
+{
+public:
+  ZSwcNodeIndex();
+
+  /*!
+   * \brief Build the index
+   *
+   * Only regular nodes in \a nodeArray are indexed.
+   */
+  void build(const std::vector<Swc_Tree_Node*> &nodeArray);
+  void clear();
+
+  bool isEmpty() const { return m_nodeArray.empty(); }
+  size_t getNodeNumber() const { return m_nodeArray.size(); }
+  double getCellSize() const { return m_cellSize; }
+
+  /*!
+   * \brief Get nodes near a point
+   *
+   * A node is included if the distance from its center to (\a x, \a y, \a z)
+   * is less than its radius + \a margin.
+   */
+  std::vector<Swc_Tree_Node*> getNodeNear(
+      double x, double y, double z, double margin) const;
+
+  /*!
+   * \brief Get nodes whose X-Y projection is near a point
+   *
+   * It is the same as getNodeNear() except that only X-Y coordinates are
+   * used for computing the distance.
+   */
+  std::vector<Swc_Tree_Node*> getNodeNearXY(
+      double x, double y, double margin) const;
+
+  /*!
+   * \brief Get nodes with center in a box
+   *
+   * The box is [\a x0, \a x1] x [\a y0, \a y1] x [\a z0, \a z1].
+   */
+  std::vector<Swc_Tree_Node*> getNodeInBox(
+      double x0, double y0, double z0, double x1, double y1, double z1) const;
+
+  /*!
+   * \brief Get the node whose center is closest to a point
+   *
+   * \return NULL iff the index is empty.
+   */
+  Swc_Tree_Node* findClosestNode(double x, double y, double z) const;
+
+private:
+  struct NodeRecord {
+    double x;
+    double y;
+    double z;
+    double r;
+    size_t index; //Index in the original array
+  };
+
+  int getCellCoord(double v, int axis) const;
+  size_t getCellIndex(int ix, int iy, int iz) const;
+  void collectNodeInRange(
+      int ix0, int iy0, int iz0, int ix1, int iy1, int iz1,
+      std::vector<size_t> *indexArray) const;
+  std::vector<Swc_Tree_Node*> toNodeArray(std::vector<size_t> &indexArray) const;
+
+private:
+  std::vector<Swc_Tree_Node*> m_nodeArray;
+  std::vector<NodeRecord> m_record; //Sorted by cells
+  std::vector<size_t> m_cellStart; //Records in cell i: [start[i], start[i+1])
+  std::vector<size_t> m_largeNode; //Indices of records with large radius
+  double m_origin[3];
+  int m_dim[3];
+  double m_cellSize;
+};
+
+#endif // ZSWCNODEINDEX_H
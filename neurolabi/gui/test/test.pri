@@ -73,4 +73,11 @@ HEADERS += \
     $$PWD/zdviddataslicetest.h \
     $$PWD/zstackviewparamtest.h \
     $$PWD/zflyembodymanagertest.h \
-    $$PWD/zflyemtaskhelpertest.h
+    $$PWD/zflyemtaskhelpertest.h \
+    $$PWD/zmeshfactorytest.h \
+    $$PWD/ztaskqueuetest.h \
+    $$PWD/zroiindextest.h \
+    $$PWD/zdvidannotationdecodertest.h \
+    $$PWD/zboundedqueuetest.h \
+    $$PWD/zneurontracertest.h \
+    $$PWD/zdvidgrayscaleblockfetchertest.h
@@ -0,0 +1,177 @@
+#ifndef ZBOUNDEDQUEUETEST_H
+#define ZBOUNDEDQUEUETEST_H
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+
+#include "ztestheader.h"
+#include "neutubeconfig.h"
+#include "concurrent/zboundedqueue.h"
+#include "flyem/zflyembodyskeletonizebatch.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZBoundedQueue, Capacity)
+{
+  ZBoundedQueue<int> queue(2);
+  ASSERT_TRUE(queue.push(1));
+  ASSERT_TRUE(queue.push(2));
+  ASSERT_EQ(2, int(queue.size()));
+
+  std::atomic<bool> pushed(false);
+  std::thread producer([&]() {
+    queue.push(3);
+    pushed = true;
+  });
+
+  //The producer is blocked while the queue is full
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_FALSE(pushed);
+  ASSERT_EQ(2, int(queue.size()));
+
+  int item = 0;
+  ASSERT_TRUE(queue.pop(&item));
+  ASSERT_EQ(1, item);
+  producer.join();
+  ASSERT_TRUE(pushed);
+  ASSERT_EQ(2, int(queue.size()));
+
+  ASSERT_TRUE(queue.pop(&item));
+  ASSERT_EQ(2, item);
+  ASSERT_TRUE(queue.pop(&item));
+  ASSERT_EQ(3, item);
+  ASSERT_EQ(0, int(queue.size()));
+
+  ZBoundedQueue<int> queue2(0);
+  ASSERT_TRUE(queue2.push(1));
+  ASSERT_EQ(1, int(queue2.size()));
+
+  //Items are passed in order between threads
+  ZBoundedQueue<int> queue3(3);
+  std::thread producer2([&]() {
+    for (int i = 0; i < 1000; ++i) {
+      queue3.push(i);
+    }
+    queue3.close();
+  });
+  std::vector<int> result;
+  while (queue3.pop(&item)) {
+    ASSERT_GE(3, int(queue3.size()));
+    result.push_back(item);
+  }
+  producer2.join();
+  ASSERT_EQ(1000, int(result.size()));
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(i, result[i]);
+  }
+}
+
+TEST(ZBoundedQueue, Close)
+{
+  ZBoundedQueue<int> queue(2);
+  queue.push(1);
+  queue.push(2);
+  queue.close();
+
+  ASSERT_FALSE(queue.push(3));
+
+  //Remaining items are still available after closing
+  int item = 0;
+  ASSERT_TRUE(queue.pop(&item));
+  ASSERT_EQ(1, item);
+  ASSERT_TRUE(queue.pop(&item));
+  ASSERT_EQ(2, item);
+  ASSERT_FALSE(queue.pop(&item));
+  ASSERT_FALSE(queue.pop(&item));
+
+  //Closing releases blocked consumers
+  ZBoundedQueue<int> emptyQueue(2);
+  std::atomic<int> releasedCount(0);
+  std::vector<std::thread> consumerArray;
+  for (int i = 0; i < 3; ++i) {
+    consumerArray.emplace_back([&]() {
+      int item = 0;
+      if (!emptyQueue.pop(&item)) {
+        ++releasedCount;
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(0, int(releasedCount));
+  emptyQueue.close();
+  for (std::thread &consumer : consumerArray) {
+    consumer.join();
+  }
+  ASSERT_EQ(3, int(releasedCount));
+
+  //Closing releases blocked producers without adding their items
+  ZBoundedQueue<int> fullQueue(1);
+  fullQueue.push(1);
+  bool pushed = true;
+  std::thread producer([&]() {
+    pushed = fullQueue.push(2);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  fullQueue.close();
+  producer.join();
+  ASSERT_FALSE(pushed);
+  ASSERT_EQ(1, int(fullQueue.size()));
+  ASSERT_TRUE(fullQueue.pop(&item));
+  ASSERT_EQ(1, item);
+  ASSERT_FALSE(fullQueue.pop(&item));
+}
+
+TEST(ZFlyEmBodySkeletonizeBatch, Checkpoint)
+{
+  std::string path = GET_TEST_DATA_DIR + "/test.checkpoint";
+  std::remove(path.c_str());
+
+  ZFlyEmBodySkeletonizeBatch::TCheckpoint checkpoint =
+      ZFlyEmBodySkeletonizeBatch::LoadCheckpoint(path);
+  ASSERT_TRUE(checkpoint.empty());
+
+  {
+    std::ofstream stream(path.c_str());
+    ZFlyEmBodySkeletonizeBatch::AppendCheckpoint(stream, 1, 10);
+    ZFlyEmBodySkeletonizeBatch::AppendCheckpoint(stream, 2, 20);
+    //Written by an older version without mutation ID
+    stream << 3 << std::endl;
+    stream << std::endl;
+  }
+
+  //Resumed run appending to the same file
+  {
+    std::ofstream stream(path.c_str(), std::ios_base::app);
+    ZFlyEmBodySkeletonizeBatch::AppendCheckpoint(stream, 2, 25);
+    ZFlyEmBodySkeletonizeBatch::AppendCheckpoint(stream, 4, 40);
+  }
+
+  checkpoint = ZFlyEmBodySkeletonizeBatch::LoadCheckpoint(path);
+  ASSERT_EQ(4, int(checkpoint.size()));
+  ASSERT_EQ(10, checkpoint[1]);
+  ASSERT_EQ(25, checkpoint[2]);
+  ASSERT_EQ(0, checkpoint[3]);
+  ASSERT_EQ(40, checkpoint[4]);
+
+  ASSERT_TRUE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 1, 10));
+  ASSERT_TRUE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 2, 25));
+  ASSERT_TRUE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 4, 40));
+
+  //Modified after the checkpoint
+  ASSERT_FALSE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 1, 11));
+  ASSERT_FALSE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 2, 20));
+  ASSERT_FALSE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 3, 30));
+
+  //Not in the checkpoint
+  ASSERT_FALSE(ZFlyEmBodySkeletonizeBatch::IsDone(checkpoint, 5, 0));
+
+  std::remove(path.c_str());
+}
+
+#endif
+
+#endif // ZBOUNDEDQUEUETEST_H
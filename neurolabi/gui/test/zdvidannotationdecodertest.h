@@ -0,0 +1,275 @@
+#ifndef ZDVIDANNOTATIONDECODERTEST_H
+#define ZDVIDANNOTATIONDECODERTEST_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include "ztestheader.h"
+#include "neutubeconfig.h"
+#include "tz_utilities.h"
+#include "zjsonarray.h"
+#include "zjsonobject.h"
+#include "dvid/zdvidannotationdecoder.h"
+#include "dvid/zdvidsynapse.h"
+#include "flyem/zflyemtodoitem.h"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+template <typename T>
+std::vector<T> LoadAnnotationFromJson(
+    const std::string &data, flyem::EDvidAnnotationLoadMode mode)
+{
+  std::vector<T> annotationArray;
+
+  ZJsonArray obj;
+  obj.decodeString(data.c_str());
+  for (size_t i = 0; i < obj.size(); ++i) {
+    ZJsonObject annotationJson(obj.at(i), ZJsonValue::SET_INCREASE_REF_COUNT);
+    if (annotationJson.hasKey("Pos")) {
+      T annotation;
+      annotation.loadJsonObject(annotationJson, mode);
+      annotationArray.push_back(annotation);
+    }
+  }
+
+  return annotationArray;
+}
+
+template <typename T>
+std::vector<T> DecodeAnnotation(
+    const std::string &data, flyem::EDvidAnnotationLoadMode mode)
+{
+  return ZDvidAnnotationDecoder::Decode<T>(data.c_str(), data.size(), mode);
+}
+
+template <typename T>
+void CheckAnnotationDecoding(
+    const std::string &data, flyem::EDvidAnnotationLoadMode mode)
+{
+  std::vector<T> expected = LoadAnnotationFromJson<T>(data, mode);
+  std::vector<T> result = DecodeAnnotation<T>(data, mode);
+
+  ASSERT_EQ(expected.size(), result.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i].getPosition(), result[i].getPosition());
+    ASSERT_EQ(expected[i].getKind(), result[i].getKind());
+    ASSERT_EQ(expected[i].getRadius(), result[i].getRadius());
+    ASSERT_EQ(expected[i].getPartners(), result[i].getPartners());
+    ASSERT_EQ(expected[i].toJsonObject().dumpString(0),
+              result[i].toJsonObject().dumpString(0));
+  }
+}
+
+//Synthetic response of <synapse>/elements with \a n pre-synaptic elements,
+//each followed by two post-synaptic partners.
+std::string MakeSynapsePayload(int n)
+{
+  std::ostringstream stream;
+  stream << "[";
+  for (int i = 0; i < n; ++i) {
+    int x = (i * 37) % 4096;
+    int y = (i * 101) % 4096;
+    int z = i / 64;
+    if (i > 0) {
+      stream << ",";
+    }
+    stream << "{\"Pos\":[" << x << "," << y << "," << z << "],"
+           << "\"Kind\":\"PreSyn\",\"Tags\":[\"synthetic\"],"
+           << "\"Rels\":[{\"Rel\":\"PreSynTo\",\"To\":["
+           << x + 5 << "," << y << "," << z << "]},"
+           << "{\"Rel\":\"PreSynTo\",\"To\":["
+           << x << "," << y + 5 << "," << z << "]}],"
+           << "\"Prop\":{\"conf\":\"0.9\",\"user\":\"tester\"}}";
+    for (int j = 1; j <= 2; ++j) {
+      stream << ",{\"Pos\":[" << x + 5 * (2 - j) << "," << y + 5 * (j - 1)
+             << "," << z << "],\"Kind\":\"PostSyn\",\"Tags\":[],"
+             << "\"Rels\":[{\"Rel\":\"PostSynTo\",\"To\":["
+             << x << "," << y << "," << z << "]}],"
+             << "\"Prop\":{\"conf\":\"0.5\"}}";
+    }
+  }
+  stream << "]";
+
+  return stream.str();
+}
+
+}
+
+TEST(ZDvidAnnotationDecoder, Basic)
+{
+  std::vector<ZDvidSynapse> synapseArray = DecodeAnnotation<ZDvidSynapse>(
+        "", flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+  ASSERT_TRUE(synapseArray.empty());
+
+  synapseArray = DecodeAnnotation<ZDvidSynapse>(
+        "null", flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+  ASSERT_TRUE(synapseArray.empty());
+
+  synapseArray = DecodeAnnotation<ZDvidSynapse>(
+        " [ ] ", flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+  ASSERT_TRUE(synapseArray.empty());
+
+  std::string data =
+      "[{\"Pos\":[1,-2,3],\"Kind\":\"PreSyn\",\"Tags\":[\"a\\\"b\",\"\\u00e9\"],"
+      "\"Rels\":[{\"Rel\":\"PreSynTo\",\"To\":[4,5,6]},{\"To\":[7,8,9]}],"
+      "\"Prop\":{\"conf\":\"0.9\",\"user\":\"]\"}},"
+      "{\"Kind\":\"Note\"}, 3,"
+      "{\"Pos\":[10,20,30],\"Kind\":\"PostSyn\",\"Extra\":{\"a\":[[]]}}]";
+
+  synapseArray = DecodeAnnotation<ZDvidSynapse>(
+        data, flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION);
+  ASSERT_EQ(2, (int) synapseArray.size());
+  ASSERT_EQ(ZIntPoint(1, -2, 3), synapseArray[0].getPosition());
+  ASSERT_EQ(ZDvidAnnotation::EKind::KIND_PRE_SYN, synapseArray[0].getKind());
+  ASSERT_TRUE(synapseArray[0].hasTag("a\"b"));
+  ASSERT_TRUE(synapseArray[0].hasTag("\xc3\xa9"));
+  ASSERT_EQ(1, (int) synapseArray[0].getPartners().size());
+  ASSERT_EQ(ZIntPoint(4, 5, 6), synapseArray[0].getPartners()[0]);
+  ASSERT_EQ("]", synapseArray[0].getProperty<std::string>("user"));
+  ASSERT_EQ(ZIntPoint(10, 20, 30), synapseArray[1].getPosition());
+
+  ZDvidAnnotationDecoder decoder(
+        data.c_str(), data.size(),
+        flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+  int count = 0;
+  int elementCount = 0;
+  while (decoder.hasNext()) {
+    ZDvidSynapse synapse;
+    if (decoder.next(&synapse)) {
+      ASSERT_TRUE(synapse.getPartners().empty());
+      ++count;
+    }
+    ++elementCount;
+  }
+  ASSERT_EQ(2, count);
+  ASSERT_EQ(4, elementCount);
+  ASSERT_FALSE(decoder.hasError());
+
+  CheckAnnotationDecoding<ZDvidSynapse>(
+        data, flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+  CheckAnnotationDecoding<ZDvidSynapse>(
+        data, flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION);
+  CheckAnnotationDecoding<ZDvidSynapse>(
+        data, flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON);
+
+  data = "[{\"Pos\":[1,2,3],\"Kind\":\"Note\",\"Tags\":[\"action:merge\"],"
+      "\"Prop\":{\"checked\":\"1\",\"action\":\"to merge\","
+      "\"comment\":\"split \\\"here\\\"\"},"
+      "\"Rels\":[{\"Rel\":\"GroupedWith\",\"To\":[3,4,5]}]},"
+      "{\"Pos\":[4,5,6],\"Kind\":\"Note\"}]";
+  std::vector<ZFlyEmToDoItem> itemArray = DecodeAnnotation<ZFlyEmToDoItem>(
+        data, flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON);
+  ASSERT_EQ(2, (int) itemArray.size());
+  ASSERT_TRUE(itemArray[0].isChecked());
+  ASSERT_EQ(neutube::EToDoAction::TO_MERGE, itemArray[0].getAction());
+  ASSERT_EQ(1, (int) itemArray[0].getRelationJson().size());
+  CheckAnnotationDecoding<ZFlyEmToDoItem>(
+        data, flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON);
+}
+
+TEST(ZDvidAnnotationDecoder, Error)
+{
+  std::string data = "[{\"Pos\":[1,2,3],\"Kind\":\"PostSyn\"},{\"Pos\":[1,2";
+  ZDvidAnnotationDecoder decoder(
+        data.c_str(), data.size(), flyem::EDvidAnnotationLoadMode::NO_PARTNER);
+  int count = 0;
+  while (decoder.hasNext()) {
+    ZDvidSynapse synapse;
+    if (decoder.next(&synapse)) {
+      ++count;
+    }
+  }
+  ASSERT_EQ(1, count);
+  ASSERT_TRUE(decoder.hasError());
+
+  //A partial result is not returned
+  ASSERT_TRUE(DecodeAnnotation<ZDvidSynapse>(
+                data, flyem::EDvidAnnotationLoadMode::NO_PARTNER).empty());
+
+  data = "[{\"Pos\":[1,2,3]} {\"Pos\":[1,2,3]}]";
+  ASSERT_TRUE(DecodeAnnotation<ZDvidSynapse>(
+                data, flyem::EDvidAnnotationLoadMode::NO_PARTNER).empty());
+
+  data = "{\"Pos\":[1,2,3]}";
+  ASSERT_TRUE(DecodeAnnotation<ZDvidSynapse>(
+                data, flyem::EDvidAnnotationLoadMode::NO_PARTNER).empty());
+}
+
+//Recorded DVID responses are read from GET_BENCHMARK_DIR/flyem/dvid if they
+//exist:
+//  synapse_elements.json: GET <synapse>/elements/<size>/<offset>
+//  synapse_label.json: GET <synapse>/label/<body>?relationships=true
+//  todo_elements.json: GET <todo>/elements/<size>/<offset>
+//A synthetic synapse payload is always included.
+//Run with --gtest_also_run_disabled_tests.
+TEST(ZDvidAnnotationDecoder, DISABLED_Benchmark)
+{
+  struct Payload {
+    std::string name;
+    std::string data;
+    flyem::EDvidAnnotationLoadMode mode;
+  };
+
+  const std::string synthetic = MakeSynapsePayload(20000);
+  std::vector<Payload> payloadArray = {
+    {"synthetic (no partner)", synthetic,
+     flyem::EDvidAnnotationLoadMode::NO_PARTNER},
+    {"synthetic (partner location)", synthetic,
+     flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION},
+    {"synthetic (partner json)", synthetic,
+     flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON}
+  };
+
+  const std::string dataDir = GET_BENCHMARK_DIR + "/flyem/dvid";
+  std::vector<std::pair<std::string, flyem::EDvidAnnotationLoadMode> >
+      recordedArray = {
+    {"synapse_elements.json", flyem::EDvidAnnotationLoadMode::NO_PARTNER},
+    {"synapse_label.json", flyem::EDvidAnnotationLoadMode::PARTNER_LOCATION},
+    {"todo_elements.json", flyem::EDvidAnnotationLoadMode::PARTNER_RELJSON}
+  };
+  for (const auto &recorded : recordedArray) {
+    std::ifstream stream((dataDir + "/" + recorded.first).c_str());
+    if (!stream.good()) {
+      std::cout << "Payload not found: " << recorded.first << std::endl;
+      continue;
+    }
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    payloadArray.push_back({recorded.first, buffer.str(), recorded.second});
+  }
+
+  for (const Payload &payload : payloadArray) {
+    std::cout << payload.name << " (" << payload.data.size() << " bytes)"
+              << std::endl;
+
+    tic();
+    std::vector<ZDvidSynapse> expected = LoadAnnotationFromJson<ZDvidSynapse>(
+          payload.data, payload.mode);
+    std::cout << "ZJsonArray + loadJsonObject: ";
+    ptoc();
+
+    tic();
+    std::vector<ZDvidSynapse> result = DecodeAnnotation<ZDvidSynapse>(
+          payload.data, payload.mode);
+    std::cout << "ZDvidAnnotationDecoder: ";
+    ptoc();
+
+    ASSERT_FALSE(result.empty());
+    ASSERT_EQ(expected.size(), result.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(expected[i].getPosition(), result[i].getPosition());
+      ASSERT_EQ(expected[i].getPartners(), result[i].getPartners());
+      ASSERT_EQ(expected[i].toJsonObject().dumpString(0),
+                result[i].toJsonObject().dumpString(0));
+    }
+  }
+}
+
+#endif
+
+#endif // ZDVIDANNOTATIONDECODERTEST_H
@@ -1,9 +1,17 @@
 #ifndef ZDVIDDATASLICETEST_H
 #define ZDVIDDATASLICETEST_H
 
+#include <set>
+#include <map>
+
 #include "ztestheader.h"
+#include "neutube_def.h"
+#include "tz_utilities.h"
 #include "dvid/zdviddataslicehelper.h"
 #include "zstackviewparam.h"
+#include "flyem/zlabelremapper.h"
+#include "dvid/zdvidslicecache.h"
+#include "zslicescrollmotion.h"
 
 #ifdef _USE_GTEST_
 
@@ -126,8 +134,195 @@ TEST(ZDvidDataSliceHelper, Resolution)
   ASSERT_TRUE(helper.needHighResUpdate());
 }
 
+TEST(ZLabelRemapper, Basic)
+{
+  ZLabelRemapper remapper;
+
+  std::vector<uint64_t> src = {5, 5, 1, 0, 1, 1, 7, 5};
+  std::vector<uint64_t> dst(src.size());
+
+  int callCount = 0;
+  remapper.remap(src.data(), src.size(), dst.data(), [&](uint64_t label) {
+    ++callCount;
+    return label * 10;
+  });
+
+  ASSERT_EQ(4, callCount);
+  ASSERT_EQ(std::vector<uint64_t>({0, 1, 5, 7}), remapper.getLabelArray());
+  for (size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(src[i] * 10, dst[i]);
+  }
+
+  //In place
+  remapper.remap(src.data(), src.size(), src.data(), [](uint64_t label) {
+    return label == 5 ? 0 : label;
+  });
+  ASSERT_EQ(std::vector<uint64_t>({0, 0, 1, 0, 1, 1, 7, 0}), src);
+
+  remapper.remap(NULL, 0, NULL, [](uint64_t label) { return label; });
+  ASSERT_TRUE(remapper.getLabelArray().empty());
+
+  //Parallel remapping
+  remapper.setThreadCount(4);
+  remapper.setMinParallelSize(16);
+  src.resize(1000);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = (i / 7) % 13;
+  }
+  dst.resize(src.size());
+  remapper.remap(src.data(), src.size(), dst.data(), [](uint64_t label) {
+    return label + 100;
+  });
+  ASSERT_EQ(13, (int) remapper.getLabelArray().size());
+  for (size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(src[i] + 100, dst[i]);
+  }
+}
+
+TEST(ZLabelRemapper, DISABLED_Benchmark)
+{
+  //A 1024x1024 slice with 256x4 patches of 300 bodies
+  const size_t width = 1024;
+  const size_t height = 1024;
+  std::vector<uint64_t> src(width * height);
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      src[y * width + x] = 1000000 + ((x / 256) * 97 + (y / 4) * 31) % 300;
+    }
+  }
+
+  std::set<uint64_t> selected;
+  std::map<uint64_t, uint64_t> bodyMap;
+  for (uint64_t i = 0; i < 300; i += 10) {
+    selected.insert(1000000 + i);
+    bodyMap[1000000 + i + 1] = 1000000 + i + 2;
+  }
+
+  auto resolve = [&](uint64_t label) {
+    if (selected.count(label) > 0) {
+      return flyem::LABEL_ID_SELECTION;
+    }
+    auto iter = bodyMap.find(label);
+    return iter == bodyMap.end() ? label : iter->second;
+  };
+
+  std::vector<uint64_t> expected(src.size());
+  tic();
+  for (size_t i = 0; i < src.size(); ++i) {
+    expected[i] = resolve(src[i]);
+  }
+  std::cout << "Per-pixel lookup: ";
+  ptoc();
+
+  ZLabelRemapper remapper;
+  std::vector<uint64_t> dst(src.size());
+  tic();
+  remapper.remap(src.data(), src.size(), dst.data(), resolve);
+  std::cout << "ZLabelRemapper: ";
+  ptoc();
+
+  ASSERT_EQ(expected, dst);
+}
+
 
 
+TEST(ZDvidSliceCache, Basic)
+{
+  typedef ZDvidSliceCache<std::vector<int> > TCache;
+  TCache cache;
+  cache.setByteBudget(30);
+
+  QRect viewPort(0, 0, 100, 100);
+  TCache::Key key1(neutube::EAxis::Z, 1, 0, viewPort, 256, 256, true);
+  TCache::Key key2(neutube::EAxis::Z, 2, 0, viewPort, 256, 256, true);
+  TCache::Key key3(neutube::EAxis::Z, 3, 0, viewPort, 256, 256, true);
+
+  ASSERT_FALSE(cache.get(key1));
+  cache.add(key1, new std::vector<int>(1, 1), 10);
+  cache.add(key2, new std::vector<int>(1, 2), 10);
+  ASSERT_EQ(2, (int) cache.size());
+  ASSERT_EQ(20, (int) cache.getByteCount());
+  ASSERT_EQ(1, (*cache.get(key1))[0]);
+
+  ASSERT_FALSE(cache.contains(
+                 TCache::Key(neutube::EAxis::Z, 1, 1, viewPort, 256, 256, true)));
+  ASSERT_FALSE(cache.contains(
+                 TCache::Key(neutube::EAxis::Z, 1, 0, QRect(1, 0, 100, 100),
+                             256, 256, true)));
+  //The center cut size is ignored without center cut
+  cache.add(TCache::Key(neutube::EAxis::Z, 1, 0, viewPort, 256, 256, false),
+            new std::vector<int>(1, 4), 5);
+  ASSERT_TRUE(cache.contains(
+                TCache::Key(neutube::EAxis::Z, 1, 0, viewPort, 0, 0, false)));
+  cache.clear();
+
+  cache.add(key1, new std::vector<int>(1, 1), 10);
+  cache.add(key2, new std::vector<int>(1, 2), 10);
+  cache.get(key1);
+  //key2 is the least recently used
+  cache.add(key3, new std::vector<int>(1, 3), 15);
+  ASSERT_TRUE(cache.contains(key1));
+  ASSERT_FALSE(cache.contains(key2));
+  ASSERT_TRUE(cache.contains(key3));
+  ASSERT_EQ(25, (int) cache.getByteCount());
+
+  std::shared_ptr<const std::vector<int> > data =
+      cache.add(key2, new std::vector<int>(1, 5), 100);
+  ASSERT_EQ(5, (*data)[0]);
+  ASSERT_FALSE(cache.contains(key2));
+
+  uint64_t version = cache.getVersion();
+  cache.clear();
+  ASSERT_EQ(0, (int) cache.size());
+  ASSERT_FALSE(cache.add(key1, new std::vector<int>(1, 1), 10, version));
+  ASSERT_FALSE(cache.contains(key1));
+  ASSERT_TRUE(cache.add(key1, new std::vector<int>(1, 1), 10,
+                        cache.getVersion()));
+  ASSERT_TRUE(cache.contains(key1));
+}
+
+TEST(ZSliceScrollMotion, Basic)
+{
+  ZSliceScrollMotion motion;
+  ASSERT_FALSE(motion.isMoving());
+  ASSERT_TRUE(motion.predict(10, 3).empty());
+
+  motion.update(10, 0);
+  ASSERT_FALSE(motion.isMoving());
+
+  motion.update(12, 100);
+  ASSERT_TRUE(motion.isMoving());
+  ASSERT_EQ(1, motion.getDirection());
+  ASSERT_EQ(2, motion.getStep());
+  ASSERT_DOUBLE_EQ(20.0, motion.getVelocity());
+  ASSERT_EQ(std::vector<int>({14, 16, 18}), motion.predict(12, 3));
+
+  motion.update(14, 300);
+  ASSERT_DOUBLE_EQ(15.0, motion.getVelocity());
+  ASSERT_FALSE(motion.isFast());
+
+  motion.update(13, 310);
+  ASSERT_EQ(-1, motion.getDirection());
+  ASSERT_EQ(1, motion.getStep());
+  ASSERT_DOUBLE_EQ(100.0, motion.getVelocity());
+  ASSERT_TRUE(motion.isFast());
+  ASSERT_EQ(std::vector<int>({12, 11}), motion.predict(13, 2));
+
+  //Panning does not change the motion
+  motion.update(13, 500);
+  ASSERT_TRUE(motion.isMoving());
+  ASSERT_EQ(-1, motion.getDirection());
+
+  //Idle
+  motion.update(13, 1500);
+  ASSERT_FALSE(motion.isMoving());
+
+  motion.update(14, 3000);
+  ASSERT_TRUE(motion.isMoving());
+  ASSERT_EQ(1, motion.getDirection());
+  ASSERT_FALSE(motion.isFast());
+}
+
 #endif
 
 
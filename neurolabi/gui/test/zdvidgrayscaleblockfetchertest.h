@@ -0,0 +1,92 @@
+#ifndef ZDVIDGRAYSCALEBLOCKFETCHERTEST_H
+#define ZDVIDGRAYSCALEBLOCKFETCHERTEST_H
+
+#include <vector>
+#include <algorithm>
+
+#include "ztestheader.h"
+#include "dvid/zdvidgrayscaleblockfetcher.h"
+#include "bigdata/zstackblockgrid.h"
+#include "zobject3dscan.h"
+#include "zstack.hxx"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+void CheckBlockRequest(
+    const ZDvidGrayscaleBlockFetcher::Request &request,
+    int x, int y, int z, int blockNumber, const std::vector<int> &bridgedX)
+{
+  ASSERT_EQ(ZIntPoint(x, y, z), request.blockIndex);
+  ASSERT_EQ(blockNumber, request.blockNumber);
+  for (int i = 0; i < blockNumber; ++i) {
+    bool bridged = std::find(bridgedX.begin(), bridgedX.end(), x + i) !=
+        bridgedX.end();
+    ASSERT_EQ(bridged, request.isBridged(i));
+  }
+}
+
+}
+
+TEST(ZDvidGrayscaleBlockFetcher, makeRequest)
+{
+  ZObject3dScan blockObj;
+  blockObj.addSegment(0, 0, 0, 3);
+  blockObj.addSegment(0, 0, 6, 7); //2-block gap
+  blockObj.addSegment(0, 0, 12, 13); //4-block gap
+  blockObj.addSegment(0, 1, 0, 9);
+
+  ZDvidGrayscaleBlockFetcher fetcher;
+  fetcher.setMaxGap(2);
+  fetcher.setMaxBlockNumberPerRequest(4);
+
+  //Coalesced spans are split into requests of at most 4 blocks
+  std::vector<ZDvidGrayscaleBlockFetcher::Request> requestArray =
+      fetcher.makeRequest(blockObj, NULL);
+  ASSERT_EQ(6, (int) requestArray.size());
+  CheckBlockRequest(requestArray[0], 0, 0, 0, 4, {});
+  CheckBlockRequest(requestArray[1], 4, 0, 0, 4, {4, 5});
+  CheckBlockRequest(requestArray[2], 12, 0, 0, 2, {});
+  CheckBlockRequest(requestArray[3], 0, 1, 0, 4, {});
+  CheckBlockRequest(requestArray[4], 4, 1, 0, 4, {});
+  CheckBlockRequest(requestArray[5], 8, 1, 0, 2, {});
+
+  //Loaded blocks are skipped, and a gap with a loaded block is not bridged
+  ZStackBlockGrid grid;
+  grid.setGridSize(20, 4, 4);
+  grid.setBlockSize(1, 1, 1);
+  grid.consumeStack(ZIntPoint(1, 0, 0), new ZStack(GREY, 1, 1, 1, 1));
+  grid.consumeStack(ZIntPoint(5, 0, 0), new ZStack(GREY, 1, 1, 1, 1));
+  grid.consumeStack(ZIntPoint(3, 1, 0), new ZStack(GREY, 1, 1, 1, 1));
+
+  requestArray = fetcher.makeRequest(blockObj, &grid);
+  ASSERT_EQ(7, (int) requestArray.size());
+  CheckBlockRequest(requestArray[0], 0, 0, 0, 1, {});
+  CheckBlockRequest(requestArray[1], 2, 0, 0, 2, {});
+  CheckBlockRequest(requestArray[2], 6, 0, 0, 2, {});
+  CheckBlockRequest(requestArray[3], 12, 0, 0, 2, {});
+  CheckBlockRequest(requestArray[4], 0, 1, 0, 3, {});
+  CheckBlockRequest(requestArray[5], 4, 1, 0, 4, {});
+  CheckBlockRequest(requestArray[6], 8, 1, 0, 2, {});
+
+  //No bridging
+  fetcher.setMaxGap(0);
+  fetcher.setMaxBlockNumberPerRequest(64);
+  requestArray = fetcher.makeRequest(blockObj, NULL);
+  ASSERT_EQ(4, (int) requestArray.size());
+  CheckBlockRequest(requestArray[0], 0, 0, 0, 4, {});
+  CheckBlockRequest(requestArray[1], 6, 0, 0, 2, {});
+  CheckBlockRequest(requestArray[2], 12, 0, 0, 2, {});
+  CheckBlockRequest(requestArray[3], 0, 1, 0, 10, {});
+
+  //Block range
+  fetcher.setBlockRange(ZIntCuboid(ZIntPoint(2, 1, 0), ZIntPoint(5, 1, 0)));
+  requestArray = fetcher.makeRequest(blockObj, NULL);
+  ASSERT_EQ(1, (int) requestArray.size());
+  CheckBlockRequest(requestArray[0], 2, 1, 0, 4, {});
+}
+
+#endif
+
+#endif // ZDVIDGRAYSCALEBLOCKFETCHERTEST_H
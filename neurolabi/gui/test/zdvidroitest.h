@@ -33,6 +33,23 @@ TEST(ZDvidRoi, Basic)
   ASSERT_TRUE(roi.contains(7, 5, 3));
   ASSERT_FALSE(roi.contains(8, 5, 3));
 
+  std::vector<ZIntPoint> ptArray;
+  ptArray.push_back(ZIntPoint(6, 4, 2));
+  ptArray.push_back(ZIntPoint(8, 5, 3));
+  ptArray.push_back(ZIntPoint(7, 5, 3));
+  std::vector<bool> result = roi.contains(ptArray);
+  ASSERT_EQ(3, (int) result.size());
+  ASSERT_TRUE(result[0]);
+  ASSERT_FALSE(result[1]);
+  ASSERT_TRUE(result[2]);
+  ASSERT_EQ(2, (int) roi.countContained(ptArray));
+
+  //Modifying the ROI updates the index
+  std::shared_ptr<const ZRoiIndex> index = roi.getIndex();
+  roi.getRoiRef()->addSegment(1, 2, 4, 4);
+  ASSERT_TRUE(roi.contains(8, 5, 3));
+  ASSERT_FALSE(index->contains(8, 5, 3));
+
 
 #if 0
   ZDvidRoi roi;
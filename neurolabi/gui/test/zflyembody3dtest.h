@@ -5,6 +5,8 @@
 #include "flyem/zflyembody3ddoc.h"
 #include "neutubeconfig.h"
 #include "zstackobjectsourcefactory.h"
+#include "zobject3dscan.h"
+#include "flyem/zflyembodyobjectcache.h"
 
 #ifdef _USE_GTEST_
 TEST(FlyEmBody3d, source)
@@ -39,6 +41,69 @@ TEST(FlyEmBody3d, source)
   ASSERT_EQ(1, zoom);
 }
 
+TEST(ZFlyEmBodyObjectCache, basic)
+{
+  auto makeObject = [](int segmentNumber) {
+    ZObject3dScan *obj = new ZObject3dScan;
+    for (int i = 0; i < segmentNumber; ++i) {
+      obj->addSegment(i, 0, 0, 10);
+    }
+    return obj;
+  };
+
+  ZObject3dScan *obj = makeObject(10);
+  size_t byteCount = ZFlyEmBodyObjectCache::EstimateByteCount(obj);
+  ASSERT_LT(0, (int) byteCount);
+
+  ZFlyEmBodyObjectCache cache;
+  cache.setByteBudget(byteCount * 2);
+
+  typedef ZFlyEmBodyObjectCache::Key Key;
+  Key key1(1, 0, flyem::EBodyLabelType::BODY, 0);
+  Key key2(2, 0, flyem::EBodyLabelType::BODY, 0);
+  Key key3(3, 0, flyem::EBodyLabelType::BODY, 0);
+
+  cache.add(key1, obj);
+  cache.add(key2, makeObject(10));
+  ASSERT_EQ(2, (int) cache.size());
+  ASSERT_EQ(byteCount * 2, cache.getByteCount());
+
+  //Touch key1 so that key2 becomes the least recently used one
+  ZObject3dScan copy;
+  ASSERT_TRUE(cache.copyTo(key1, &copy));
+  ASSERT_EQ(obj->getVoxelNumber(), copy.getVoxelNumber());
+
+  cache.add(key3, makeObject(10));
+  ASSERT_EQ(2, (int) cache.size());
+  ASSERT_EQ(NULL, cache.take<ZObject3dScan>(key2));
+
+  ZFlyEmBodyObjectCache::Stat stat = cache.getStat();
+  ASSERT_EQ(1, (int) stat.hitCount);
+  ASSERT_EQ(1, (int) stat.missCount);
+  ASSERT_EQ(1, (int) stat.evictionCount);
+  ASSERT_EQ(byteCount, stat.evictedByteCount);
+
+  //Different label type or mutation ID misses
+  ASSERT_EQ(NULL, cache.take<ZObject3dScan>(
+              Key(1, 0, flyem::EBodyLabelType::SUPERVOXEL, 0)));
+  ASSERT_EQ(NULL, cache.take<ZObject3dScan>(
+              Key(1, 0, flyem::EBodyLabelType::BODY, 1)));
+
+  ZObject3dScan *taken = cache.take<ZObject3dScan>(key1);
+  ASSERT_EQ(obj, taken);
+  ASSERT_EQ(1, (int) cache.size());
+  ASSERT_EQ(byteCount, cache.getByteCount());
+  delete taken;
+
+  //Too large to cache
+  cache.add(key1, makeObject(100));
+  ASSERT_EQ(1, (int) cache.size());
+
+  cache.removeBody(3);
+  ASSERT_EQ(0, (int) cache.size());
+  ASSERT_EQ(0, (int) cache.getByteCount());
+}
+
 #endif
 
 #endif // ZFLYEMBODY3DTEST_H
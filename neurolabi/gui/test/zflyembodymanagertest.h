@@ -1,7 +1,13 @@
 #ifndef ZFLYEMBODYMANAGERTEST_H
 #define ZFLYEMBODYMANAGERTEST_H
 
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <iostream>
+
 #include "ztestheader.h"
+#include "tz_utilities.h"
 #include "flyem/zflyembodymanager.h"
 #include "flyem/zflyembodyconfig.h"
 
@@ -115,6 +121,183 @@ TEST(ZFlyEmBodyManager, Basic)
   ASSERT_TRUE(bm.isSupervoxel(1));
 }
 
+TEST(ZFlyEmBodyManager, Batch)
+{
+  ZFlyEmBodyManager bm;
+
+  bm.beginBatch();
+  bm.registerBody(1, QSet<uint64_t>({100, 200}));
+  bm.registerSupervoxel(300);
+  ASSERT_TRUE(bm.contains(1)); //Visible to the updating thread
+
+  bool visible = true;
+  std::thread reader([&]() {
+    visible = bm.contains(1) || bm.isSupervoxel(300);
+  });
+  reader.join();
+  ASSERT_FALSE(visible);
+
+  bm.beginBatch();
+  bm.registerBody(2);
+  bm.endBatch();
+
+  reader = std::thread([&]() {
+    visible = bm.contains(2);
+  });
+  reader.join();
+  ASSERT_FALSE(visible);
+  bm.endBatch();
+
+  reader = std::thread([&]() {
+    visible = bm.contains(1) && bm.contains(2) && bm.isOrphanSupervoxel(
+          ZFlyEmBodyManager::EncodeSupervoxel(300));
+  });
+  reader.join();
+  ASSERT_TRUE(visible);
+
+  ASSERT_EQ(1, (int) bm.getAggloId(100));
+  ASSERT_EQ(0, (int) bm.getAggloId(300));
+  ASSERT_TRUE(bm.isSupervoxel(200));
+
+  bm.registerBody(1, QSet<uint64_t>({200}));
+  ASSERT_EQ(100, (int) bm.getAggloId(100));
+  ASSERT_FALSE(bm.isSupervoxel(100));
+
+  bm.deregisterBody(1);
+  ASSERT_FALSE(bm.isSupervoxel(200));
+
+  bm.registerBody(3, 400);
+  bm.registerBody(1, 400);
+  ASSERT_EQ(1, (int) bm.getAggloId(400));
+  bm.eraseSupervoxel(400);
+  ASSERT_EQ(3, (int) bm.getAggloId(400));
+
+  bm.clear();
+  ASSERT_TRUE(bm.isEmpty());
+  ASSERT_FALSE(bm.isSupervoxel(400));
+}
+
+TEST(ZFlyEmBodyManager, ManyBodies)
+{
+  //Enough entries to split the shards
+  ZFlyEmBodyManager bm;
+  const uint64_t bodyCount = 3000;
+  for (uint64_t bodyId = 1; bodyId <= bodyCount; ++bodyId) {
+    bm.registerBody(bodyId, QSet<uint64_t>({bodyId * 10, bodyId * 10 + 1}));
+    if (bodyId % 2 == 0) {
+      bm.setSynapseLoaded(bodyId);
+    }
+  }
+  bm.registerSupervoxel(7);
+
+  ASSERT_EQ(int(bodyCount), bm.getNormalBodySet().size());
+  for (uint64_t bodyId = 1; bodyId <= bodyCount; ++bodyId) {
+    ASSERT_TRUE(bm.contains(bodyId));
+    ASSERT_EQ(2, bm.getMappedSet(bodyId).size());
+    ASSERT_EQ(bodyId, bm.getAggloId(bodyId * 10 + 1));
+    ASSERT_EQ(bodyId % 2 == 0, bm.isSynapseLoaded(bodyId));
+  }
+  ASSERT_TRUE(bm.isOrphanSupervoxel(ZFlyEmBodyManager::EncodeSupervoxel(7)));
+
+  for (uint64_t bodyId = 1; bodyId <= bodyCount; bodyId += 2) {
+    bm.deregisterBody(bodyId);
+  }
+  ASSERT_EQ(int(bodyCount / 2), bm.getNormalBodySet().size());
+  for (uint64_t bodyId = 1; bodyId <= bodyCount; ++bodyId) {
+    ASSERT_EQ(bodyId % 2 == 0, bm.contains(bodyId));
+    ASSERT_EQ(bodyId % 2 == 0, bm.isSupervoxel(bodyId * 10));
+  }
+
+  bm.clear();
+  ASSERT_TRUE(bm.isEmpty());
+  ASSERT_FALSE(bm.contains(2));
+}
+
+TEST(ZFlyEmBodyManager, DISABLED_Benchmark)
+{
+  //Bulk loading with concurrent readers
+  ZFlyEmBodyManager bm;
+
+  const uint64_t bodyCount = 5000;
+  const uint64_t batchSize = 100;
+  const uint64_t svCount = 10; //supervoxels per body
+  std::atomic<bool> loading(true);
+  std::atomic<bool> consistent(true);
+  std::atomic<size_t> queryCount(0);
+
+  std::vector<std::thread> readerArray;
+  for (int i = 0; i < 4; ++i) {
+    readerArray.emplace_back([&, i]() {
+      size_t count = 0;
+      uint64_t bodyId = i + 1;
+      while (loading) {
+        //A body is always visible with all its supervoxels
+        if (bm.contains(bodyId)) {
+          if (bm.getMappedSet(bodyId).size() != svCount ||
+              bm.getAggloId(bodyId * svCount * 2) != bodyId) {
+            consistent = false;
+          }
+        }
+        bodyId = bodyId % bodyCount + 1;
+        ++count;
+      }
+      queryCount += count;
+    });
+  }
+
+  tic();
+  for (uint64_t start = 1; start <= bodyCount; start += batchSize) {
+    bm.beginBatch();
+    for (uint64_t bodyId = start; bodyId < start + batchSize; ++bodyId) {
+      QSet<uint64_t> svSet;
+      for (uint64_t sv = 0; sv < svCount; ++sv) {
+        svSet.insert(bodyId * svCount * 2 + sv);
+      }
+      bm.registerBody(bodyId, svSet);
+      bm.setTodoLoaded(bodyId);
+    }
+    bm.endBatch();
+  }
+  std::cout << "Loading " << bodyCount << " bodies: ";
+  ptoc();
+
+  loading = false;
+  for (std::thread &reader : readerArray) {
+    reader.join();
+  }
+  std::cout << queryCount << " queries during loading" << std::endl;
+
+  ASSERT_TRUE(consistent);
+  ASSERT_EQ(int(bodyCount), bm.getNormalBodySet().size());
+  ASSERT_TRUE(bm.isTodoLoaded(bodyCount));
+  ASSERT_EQ(bodyCount, bm.getAggloId(bodyCount * svCount * 2 + svCount - 1));
+
+  tic();
+  bm.beginBatch();
+  for (uint64_t bodyId = 1; bodyId <= bodyCount; ++bodyId) {
+    bm.deregisterBody(bodyId);
+  }
+  bm.endBatch();
+  std::cout << "Unloading " << bodyCount << " bodies: ";
+  ptoc();
+
+  ASSERT_TRUE(bm.isEmpty());
+
+  //Unbatched registration, as each loaded mesh archive does
+  tic();
+  for (uint64_t bodyId = 1; bodyId <= bodyCount * 4; ++bodyId) {
+    QSet<uint64_t> svSet;
+    for (uint64_t sv = 0; sv < svCount; ++sv) {
+      svSet.insert(bodyId * svCount * 2 + sv);
+    }
+    bm.registerBody(bodyId, svSet);
+  }
+  std::cout << "Loading " << bodyCount * 4 << " bodies one by one: ";
+  ptoc();
+
+  ASSERT_EQ(int(bodyCount * 4), bm.getNormalBodySet().size());
+}
+
 TEST(ZFlyEmBodyManager, encode)
 {
   ASSERT_EQ(uint64_t(1), ZFlyEmBodyManager::encode(1, 0, false));
@@ -49,6 +49,54 @@ TEST(ZFlyEmBodyMerger, Basic)
   ASSERT_EQ(6, (int) merger.getFinalLabel(5));
 }
 
+TEST(ZFlyEmBodyMerger, OriginalLabel)
+{
+  ZFlyEmBodyMerger merger;
+  merger.pushMap(1, 2);
+  merger.pushMap(2, 3);
+  merger.pushMap(4, 3);
+
+  ASSERT_EQ(QSet<uint64_t>({1, 2, 3, 4}), merger.getOriginalLabelSet(3));
+  ASSERT_EQ(QList<uint64_t>({1, 2, 4, 3}), merger.getOriginalLabelList(3));
+  ASSERT_EQ(QSet<uint64_t>({5}), merger.getOriginalLabelSet(5));
+  ASSERT_TRUE(merger.isMerged(3));
+  ASSERT_FALSE(merger.isMerged(5));
+
+  //Pairs in the same map are applied at the same time
+  ZFlyEmBodyMerger::TLabelMap labelMap;
+  labelMap[3] = 5;
+  labelMap[5] = 6;
+  merger.pushMap(labelMap);
+  ASSERT_EQ(5, (int) merger.getFinalLabel(1));
+  ASSERT_EQ(6, (int) merger.getFinalLabel(5));
+  ASSERT_EQ(QSet<uint64_t>({1, 2, 3, 4, 5}), merger.getOriginalLabelSet(5));
+  ASSERT_EQ(QSet<uint64_t>({5, 6}), merger.getOriginalLabelSet(6));
+
+  //A label that has been merged is not mapped again
+  merger.pushMap(2, 7);
+  ASSERT_EQ(5, (int) merger.getFinalLabel(2));
+  ASSERT_EQ(7, (int) merger.getFinalLabel(7));
+
+  merger.undo();
+  merger.undo();
+  ASSERT_EQ(3, (int) merger.getFinalLabel(1));
+  ASSERT_EQ(5, (int) merger.getFinalLabel(5));
+  ASSERT_EQ(QSet<uint64_t>({1, 2, 3, 4}), merger.getOriginalLabelSet(3));
+
+  merger.unmerge(4);
+  ASSERT_EQ(4, (int) merger.getFinalLabel(4));
+  ASSERT_EQ(QSet<uint64_t>({1, 2, 3}), merger.getOriginalLabelSet(3));
+
+  ZFlyEmBodyMerger::TLabelMap finalMap = merger.getFinalMap();
+  ASSERT_EQ(2, finalMap.size());
+  ASSERT_EQ(3, (int) finalMap[1]);
+  ASSERT_EQ(3, (int) finalMap[2]);
+
+  merger.clear();
+  ASSERT_EQ(1, (int) merger.getFinalLabel(1));
+  ASSERT_FALSE(merger.isMerged(3));
+}
+
 TEST(ZFlyEmBodyMerger, Json)
 {
   ZFlyEmBodyMerger bodyMerger;
@@ -6,6 +6,8 @@
 #include "zstackfactory.h"
 #include "zstack.hxx"
 #include "zcontrastprotocol.h"
+#include "imgproc/zlabelcolorizer.h"
+#include "tz_utilities.h"
 
 #ifdef _USE_GTEST_
 
@@ -81,6 +83,104 @@ TEST(ZImage, setData)
   ASSERT_EQ(255, qAlpha(color));
 }
 
+static void ColorizeLabelReference(
+    const uint64_t *data, int width, int height, const std::vector<int> &colorTable,
+    int bgColor, int selColor, bool transposing, uint32_t *out)
+{
+  int colorCount = colorTable.size();
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      uint64_t v = transposing ? data[i * height + j] : data[j * width + i];
+      if (v == 0) {
+        *out++ = bgColor;
+      } else if (v == flyem::LABEL_ID_SELECTION) {
+        *out++ = selColor;
+      } else {
+        *out++ = colorTable[v % colorCount];
+      }
+    }
+  }
+}
+
+TEST(ZLabelColorizer, Basic)
+{
+  int width = 67;
+  int height = 45;
+  std::vector<uint64_t> data(width * height);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (i * 7919) % 1000;
+  }
+  data[1] = 0;
+  data[2] = flyem::LABEL_ID_SELECTION;
+  data[5] = 0xFFFFFFFF12345ull;
+  data[data.size() - 1] = flyem::LABEL_ID_SELECTION;
+
+  std::vector<uint32_t> expected(data.size());
+  std::vector<uint32_t> result(data.size());
+  for (int colorCount : {64, 50}) {
+    std::vector<int> colorTable(colorCount);
+    for (int i = 0; i < colorCount; ++i) {
+      colorTable[i] = 0xA4000000 + i * 3;
+    }
+
+    ZLabelColorizer colorizer(
+          &(colorTable[0]), colorTable.size(), 1, 0xFFFFFFFF);
+    for (bool usingSimd : {true, false}) {
+      colorizer.setUsingSimd(usingSimd);
+
+      ColorizeLabelReference(&(data[0]), width, height, colorTable, 1,
+          0xFFFFFFFF, false, &(expected[0]));
+      colorizer.colorize(&(data[0]), width, height, (uint8_t*) &(result[0]),
+          width * 4);
+      ASSERT_EQ(expected, result);
+
+      ColorizeLabelReference(&(data[0]), width, height, colorTable, 1,
+          0xFFFFFFFF, true, &(expected[0]));
+      colorizer.colorizeTranspose(
+            &(data[0]), width, height, (uint8_t*) &(result[0]), width * 4);
+      ASSERT_EQ(expected, result);
+    }
+  }
+}
+
+TEST(ZLabelColorizer, DISABLED_Benchmark)
+{
+  int width = 2048;
+  int height = 2048;
+  std::vector<uint64_t> data(width * height);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = 1000000 + i / 97;
+  }
+
+  std::vector<int> colorTable(64);
+  for (size_t i = 0; i < colorTable.size(); ++i) {
+    colorTable[i] = 0xA4000000 + i;
+  }
+  std::vector<uint32_t> result(data.size());
+
+  std::cout << "Reference loop:" << std::endl;
+  tic();
+  ColorizeLabelReference(&(data[0]), width, height, colorTable, 0,
+      0xFFFFFFFF, false, &(result[0]));
+  ptoc();
+  tic();
+  ColorizeLabelReference(&(data[0]), width, height, colorTable, 0,
+      0xFFFFFFFF, true, &(result[0]));
+  ptoc();
+
+  ZLabelColorizer colorizer(
+        &(colorTable[0]), colorTable.size(), 0, 0xFFFFFFFF);
+  std::cout << "Colorizer (SIMD: " << colorizer.usingSimd() << "):" << std::endl;
+  tic();
+  colorizer.colorize(&(data[0]), width, height, (uint8_t*) &(result[0]),
+      width * 4);
+  ptoc();
+  tic();
+  colorizer.colorizeTranspose(
+        &(data[0]), width, height, (uint8_t*) &(result[0]), width * 4);
+  ptoc();
+}
+
 TEST(ZContrastProtocol, Basic)
 {
   ZContrastProtocol cp(0, 1, ZContrastProtocol::NONLINEAR_NONE);
@@ -0,0 +1,60 @@
+#ifndef ZMESHFACTORYTEST_H
+#define ZMESHFACTORYTEST_H
+
+#include <cmath>
+
+#include "ztestheader.h"
+#include "zmeshfactory.h"
+#include "zmesh.h"
+#include "zobject3dscan.h"
+#include "misc/zmarchingcube.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZMarchingCube, Block)
+{
+  ZObject3dScan obj;
+  for (int z = 0; z < 20; ++z) {
+    for (int y = 0; y < 20; ++y) {
+      int r2 = (z - 10) * (z - 10) + (y - 10) * (y - 10);
+      if (r2 < 81) {
+        int h = int(std::sqrt(81.0 - r2));
+        obj.addSegment(z, y, 10 - h, 10 + h);
+      }
+    }
+  }
+  obj.addSegment(3, 25, 0, 30);
+  obj.canonize();
+
+  ZMarchingCube marcher;
+  marcher.setSmooth(3);
+  marcher.setOffsetAdjust(true);
+  marcher.setBlockSize(0);
+  ZMesh *mesh = marcher.march(obj);
+
+  for (int blockSize : {1, 4, 7, 64}) {
+    marcher.setBlockSize(blockSize);
+    ZMesh *blockMesh = marcher.march(obj);
+    ASSERT_EQ(mesh->numVertices(), blockMesh->numVertices());
+    ASSERT_EQ(mesh->numTriangles(), blockMesh->numTriangles());
+    for (size_t i = 0; i < mesh->numVertices(); ++i) {
+      ASSERT_EQ(mesh->vertices()[i], blockMesh->vertices()[i]);
+    }
+    delete blockMesh;
+  }
+
+  delete mesh;
+
+  ZMeshFactory factory;
+  factory.setDsIntv(-1);
+  mesh = factory.makeMesh(obj);
+  ASSERT_TRUE(mesh != NULL);
+  ASSERT_LT(0, (int) mesh->numTriangles());
+  delete mesh;
+
+  ASSERT_TRUE(factory.makeMesh(ZObject3dScan()) == NULL);
+}
+
+#endif
+
+#endif // ZMESHFACTORYTEST_H
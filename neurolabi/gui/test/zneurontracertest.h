@@ -0,0 +1,253 @@
+#ifndef ZNEURONTRACERTEST_H
+#define ZNEURONTRACERTEST_H
+
+#include <cmath>
+#include <vector>
+
+#include "ztestheader.h"
+#include "zneurontracer.h"
+#include "c_stack.h"
+#include "tz_locseg_chain.h"
+#include "tz_geo3d_scalar_field.h"
+#include "tz_neuron_structure.h"
+#include "tz_neuron_component.h"
+
+#ifdef _USE_GTEST_
+
+namespace {
+
+//Tubes along Y crossed by a tube along X on a noisy background
+Stack* MakeTracingTestStack(int width, int height, int depth)
+{
+  Stack *stack = C_Stack::make(GREY, width, height, depth);
+  srand(1);
+  for (size_t i = 0; i < C_Stack::voxelNumber(stack); ++i) {
+    stack->array[i] = rand() % 20;
+  }
+
+  int cz = depth / 2;
+  for (int t = 0; t * 40 + 20 < width; ++t) {
+    for (int y = 10; y < height - 10; ++y) {
+      int x = int(20 + t * 40 + 10 * std::sin(y * 0.05 + t));
+      for (int z = cz - 3; z <= cz + 3; ++z) {
+        for (int dx = -3; dx <= 3; ++dx) {
+          if (dx * dx + (z - cz) * (z - cz) <= 9 && x + dx >= 0 &&
+              x + dx < width) {
+            C_Stack::setPixel(stack, x + dx, y, z, 0, 200);
+          }
+        }
+      }
+    }
+  }
+
+  int cy = height / 2;
+  for (int x = 10; x < width - 10; ++x) {
+    for (int z = cz - 2; z <= cz + 2; ++z) {
+      for (int dy = -2; dy <= 2; ++dy) {
+        if (dy * dy + (z - cz) * (z - cz) <= 4) {
+          C_Stack::setPixel(stack, x, cy + dy, z, 0, 200);
+        }
+      }
+    }
+  }
+
+  return stack;
+}
+
+std::vector<Locseg_Chain*> TraceTestStack(ZNeuronTracer &tracer, Stack *stack)
+{
+  tracer.initTraceWorkspace(stack);
+  tracer.initConnectionTestWorkspace();
+
+  int width = C_Stack::width(stack);
+  int height = C_Stack::height(stack);
+  int cz = C_Stack::depth(stack) / 2;
+
+  Geo3d_Scalar_Field *seed = Make_Geo3d_Scalar_Field(1000);
+  seed->size = 0;
+  for (int t = 0; t * 40 + 20 < width; ++t) {
+    for (int y = 14; y < height - 14; y += 6) {
+      seed->points[seed->size][0] =
+          int(20 + t * 40 + 10 * std::sin(y * 0.05 + t));
+      seed->points[seed->size][1] = y;
+      seed->points[seed->size][2] = cz;
+      seed->values[seed->size++] = 3.0;
+    }
+  }
+  for (int x = 14; x < width - 14; x += 6) {
+    seed->points[seed->size][0] = x;
+    seed->points[seed->size][1] = height / 2;
+    seed->points[seed->size][2] = cz;
+    seed->values[seed->size++] = 2.0;
+  }
+
+  ZNeuronTraceSeeder seeder;
+  tracer.prepareTraceScoreThreshold(ZNeuronTracer::TRACING_SEED);
+  Stack *seedMask = seeder.sortSeed(seed, stack, tracer.getTraceWorkspace());
+  Kill_Geo3d_Scalar_Field(seed);
+  C_Stack::kill(seedMask);
+
+  return tracer.trace(stack, seeder.getSeedArray(), seeder.getScoreArray());
+}
+
+std::vector<Locseg_Chain*> TraceTestStack(
+    Stack *stack, int threadCount, int tileSize)
+{
+  ZNeuronTracer tracer;
+  tracer.setThreadCount(threadCount);
+  tracer.setTraceTileSize(tileSize);
+
+  return TraceTestStack(tracer, stack);
+}
+
+void CheckSameChain(const std::vector<Locseg_Chain*> &chainArray1,
+                    const std::vector<Locseg_Chain*> &chainArray2)
+{
+  ASSERT_EQ(chainArray1.size(), chainArray2.size());
+  for (size_t i = 0; i < chainArray1.size(); ++i) {
+    Locseg_Chain *chain1 = chainArray1[i];
+    Locseg_Chain *chain2 = chainArray2[i];
+    ASSERT_EQ(Locseg_Chain_Length(chain1), Locseg_Chain_Length(chain2));
+    Locseg_Chain_Iterator_Start(chain1, DL_HEAD);
+    Locseg_Chain_Iterator_Start(chain2, DL_HEAD);
+    Local_Neuroseg *locseg1 = NULL;
+    while ((locseg1 = Locseg_Chain_Next_Seg(chain1)) != NULL) {
+      Local_Neuroseg *locseg2 = Locseg_Chain_Next_Seg(chain2);
+      double center1[3];
+      double center2[3];
+      Local_Neuroseg_Center(locseg1, center1);
+      Local_Neuroseg_Center(locseg2, center2);
+      for (int k = 0; k < 3; ++k) {
+        ASSERT_DOUBLE_EQ(center1[k], center2[k]);
+      }
+      ASSERT_DOUBLE_EQ(locseg1->seg.r1, locseg2->seg.r1);
+      ASSERT_DOUBLE_EQ(locseg1->seg.theta, locseg2->seg.theta);
+      ASSERT_DOUBLE_EQ(locseg1->seg.psi, locseg2->seg.psi);
+    }
+  }
+}
+
+Neuron_Component* MakeChainComponent(
+    const std::vector<Locseg_Chain*> &chainArray)
+{
+  Neuron_Component *comp = Make_Neuron_Component_Array(chainArray.size());
+  for (size_t i = 0; i < chainArray.size(); ++i) {
+    Set_Neuron_Component(comp + i, NEUROCOMP_TYPE_LOCSEG_CHAIN,
+                         Copy_Locseg_Chain(chainArray[i]));
+  }
+
+  return comp;
+}
+
+void KillChainComponent(Neuron_Component *comp, int n)
+{
+  Clean_Neuron_Component_Array(comp, n);
+  free(comp);
+}
+
+void CheckSameNeuronStructure(const Neuron_Structure *ns1,
+                              const Neuron_Structure *ns2, int n)
+{
+  ASSERT_EQ(ns1->graph->nedge, ns2->graph->nedge);
+  for (int e = 0; e < ns1->graph->nedge; ++e) {
+    ASSERT_EQ(ns1->graph->edges[e][0], ns2->graph->edges[e][0]);
+    ASSERT_EQ(ns1->graph->edges[e][1], ns2->graph->edges[e][1]);
+    ASSERT_EQ(ns1->conn[e].mode, ns2->conn[e].mode);
+    ASSERT_EQ(ns1->conn[e].info[0], ns2->conn[e].info[0]);
+    ASSERT_EQ(ns1->conn[e].info[1], ns2->conn[e].info[1]);
+    ASSERT_DOUBLE_EQ(ns1->conn[e].cost, ns2->conn[e].cost);
+  }
+
+  //Interpolated segments
+  std::vector<Locseg_Chain*> chainArray1(n);
+  std::vector<Locseg_Chain*> chainArray2(n);
+  for (int i = 0; i < n; ++i) {
+    chainArray1[i] = NEUROCOMP_LOCSEG_CHAIN(ns1->comp + i);
+    chainArray2[i] = NEUROCOMP_LOCSEG_CHAIN(ns2->comp + i);
+  }
+  CheckSameChain(chainArray1, chainArray2);
+}
+
+void KillChainArray(std::vector<Locseg_Chain*> &chainArray)
+{
+  for (Locseg_Chain *chain : chainArray) {
+    Kill_Locseg_Chain(chain);
+  }
+  chainArray.clear();
+}
+
+}
+
+TEST(ZNeuronTracer, ThreadCount)
+{
+  Stack *stack = MakeTracingTestStack(128, 128, 16);
+
+  std::vector<Locseg_Chain*> chainArray1 = TraceTestStack(stack, 1, 48);
+  ASSERT_FALSE(chainArray1.empty());
+
+  for (int threadCount : {2, 4}) {
+    std::vector<Locseg_Chain*> chainArray = TraceTestStack(
+          stack, threadCount, 48);
+    CheckSameChain(chainArray1, chainArray);
+    KillChainArray(chainArray);
+  }
+
+  //Default tiles
+  std::vector<Locseg_Chain*> chainArray2 = TraceTestStack(stack, 2, 0);
+  std::vector<Locseg_Chain*> chainArray4 = TraceTestStack(stack, 4, 0);
+  ASSERT_FALSE(chainArray2.empty());
+  CheckSameChain(chainArray2, chainArray4);
+
+  KillChainArray(chainArray1);
+  KillChainArray(chainArray2);
+  KillChainArray(chainArray4);
+  C_Stack::kill(stack);
+}
+
+TEST(ZNeuronConstructor, ConnectionGraph)
+{
+  Stack *stack = MakeTracingTestStack(128, 128, 16);
+
+  ZNeuronTracer tracer;
+  std::vector<Locseg_Chain*> chainArray = TraceTestStack(tracer, stack);
+  int n = chainArray.size();
+  ASSERT_LT(1, n);
+
+  Connection_Test_Workspace *ws = tracer.getConnectionTestWorkspace();
+
+  for (int spTest = 0; spTest <= 1; ++spTest) {
+    ws->sp_test = spTest;
+
+    //All ordered pairs are tested
+    Neuron_Component *comp = MakeChainComponent(chainArray);
+    Neuron_Structure *ns = Locseg_Chain_Comp_Neurostruct(
+          comp, n, stack, 1.0, ws);
+    ASSERT_LT(0, ns->graph->nedge);
+
+    for (int threadCount : {1, 2, 4}) {
+      ZNeuronConstructor constructor;
+      constructor.setWorkspace(ws);
+      constructor.setSignal(stack);
+      constructor.setThreadCount(threadCount);
+
+      Neuron_Component *comp2 = MakeChainComponent(chainArray);
+      Neuron_Structure *ns2 = constructor.buildNeuronStructure(comp2, n, 1.0);
+      CheckSameNeuronStructure(ns, ns2, n);
+
+      ns2->comp = NULL;
+      Kill_Neuron_Structure(ns2);
+      KillChainComponent(comp2, n);
+    }
+
+    ns->comp = NULL;
+    Kill_Neuron_Structure(ns);
+    KillChainComponent(comp, n);
+  }
+
+  KillChainArray(chainArray);
+  C_Stack::kill(stack);
+}
+
+#endif
+
+#endif // ZNEURONTRACERTEST_H
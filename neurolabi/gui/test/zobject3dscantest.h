@@ -3,6 +3,8 @@
 
 #include "ztestheader.h"
 #include "zobject3dscan.h"
+#include "zobject3dflatscan.h"
+#include "dvid/zdvidsparsevoldecoder.h"
 #include "neutubeconfig.h"
 #include "zgraph.h"
 #include "tz_iarray.h"
@@ -2237,6 +2239,87 @@ TEST(ZObject3dScan, subtract)
 //  subtracted.print();
 }
 
+TEST(ZObject3dScan, UnifySubtractVoxel)
+{
+  //Random objects checked voxel by voxel
+  srand(1);
+  for (int trial = 0; trial < 20; ++trial) {
+    ZObject3dScan obj1;
+    ZObject3dScan obj2;
+    for (int i = 0; i < 30; ++i) {
+      int x0 = rand() % 20;
+      obj1.addSegment(rand() % 4, rand() % 4, x0, x0 + rand() % 5, false);
+      x0 = rand() % 20;
+      obj2.addSegment(rand() % 4, rand() % 4, x0, x0 + rand() % 5, false);
+    }
+    obj1.setLabel(1);
+    obj1.setDsIntv(1, 1, 0);
+    obj2.setLabel(2);
+
+    ZObject3dScan unified = obj1;
+    unified.unify(obj2);
+
+    ZObject3dScan remained = obj1;
+    ZObject3dScan subtracted = remained.subtract(obj2);
+
+    ZObject3dScan remained2 = obj1;
+    remained2.subtractSliently(obj2);
+
+    for (ZObject3dScan *obj : {&unified, &remained, &subtracted, &remained2}) {
+      ASSERT_TRUE(obj->isCanonizedActually());
+      ASSERT_EQ(1, (int) obj->getLabel());
+      ASSERT_EQ(ZIntPoint(1, 1, 0), obj->getDsIntv());
+    }
+    ASSERT_TRUE(remained.equalsLiterally(remained2));
+
+    obj1.canonize();
+    obj2.canonize();
+    for (int z = 0; z < 4; ++z) {
+      for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 26; ++x) {
+          bool in1 = obj1.contains(x, y, z);
+          bool in2 = obj2.contains(x, y, z);
+          ASSERT_EQ(in1 || in2, unified.contains(x, y, z));
+          ASSERT_EQ(in1 && !in2, remained.contains(x, y, z));
+          ASSERT_EQ(in1 && in2, subtracted.contains(x, y, z));
+        }
+      }
+    }
+  }
+
+  //Small pieces merged into a canonized body stripe by stripe
+  for (int trial = 0; trial < 20; ++trial) {
+    ZObject3dScan obj1;
+    for (int z = 0; z < 4; ++z) {
+      for (int y = 0; y < 16; y += 2) {
+        int x0 = rand() % 20;
+        obj1.addSegment(z, y, x0, x0 + rand() % 5, false);
+        obj1.addSegment(z, y, x0 + 8, x0 + 10, false);
+      }
+    }
+    obj1.canonize();
+    obj1.setLabel(1);
+
+    ZObject3dScan obj2;
+    for (int i = 0; i < 3; ++i) {
+      int x0 = rand() % 30;
+      obj2.addSegment(rand() % 5, rand() % 16, x0, x0 + rand() % 5, false);
+    }
+    obj2.canonize();
+    ASSERT_LT(obj2.getStripeNumber() * 8, obj1.getStripeNumber());
+
+    ZObject3dScan unified = obj1;
+    unified.unify(obj2);
+    ASSERT_TRUE(unified.isCanonizedActually());
+    ASSERT_EQ(1, (int) unified.getLabel());
+
+    ZObject3dScan expected = obj1;
+    expected.concat(obj2);
+    expected.canonize();
+    ASSERT_TRUE(expected.equalsLiterally(unified));
+  }
+}
+
 TEST(ZObject3dScan, Mainpulate)
 {
   ZObject3dScan obj;
@@ -2361,6 +2444,245 @@ TEST(ZObject3dScan, remove)
 
 }
 
+TEST(ZObject3dFlatScan, Basic)
+{
+  ZObject3dFlatScan obj;
+  ASSERT_TRUE(obj.isEmpty());
+  ASSERT_TRUE(obj.isCanonized());
+
+  obj.addSegment(0, 0, 0, 2, false);
+  obj.addSegment(0, 0, 3, 5, false);
+  ASSERT_EQ(1, (int) obj.getSegmentNumber());
+  ASSERT_TRUE(obj.isCanonized());
+
+  obj.addSegment(1, 0, 1, 2, false);
+  obj.addSegment(0, 1, 1, 2, false);
+  ASSERT_FALSE(obj.isCanonized());
+  ASSERT_EQ(3, (int) obj.getStripeNumber());
+
+  obj.canonize();
+  ASSERT_TRUE(obj.isCanonized());
+  ASSERT_EQ(3, (int) obj.getStripeNumber());
+  ASSERT_EQ(10, (int) obj.getVoxelNumber());
+  ASSERT_EQ(8, (int) obj.getVoxelNumber(0));
+
+  ZObject3dFlatScan::Stripe stripe = obj.getStripe(1);
+  ASSERT_EQ(0, stripe.getZ());
+  ASSERT_EQ(1, stripe.getY());
+  ASSERT_EQ(1, stripe.getSegmentNumber());
+  ASSERT_EQ(1, stripe.getSegmentStart(0));
+  ASSERT_EQ(2, stripe.getSegmentEnd(0));
+
+  int z, y, x0, x1;
+  ASSERT_TRUE(obj.getSegment(2, &z, &y, &x0, &x1));
+  ASSERT_EQ(1, z);
+  ASSERT_EQ(0, y);
+  ASSERT_EQ(1, x0);
+  ASSERT_EQ(2, x1);
+  ASSERT_FALSE(obj.getSegment(3, &z, &y, &x0, &x1));
+
+  ASSERT_TRUE(obj.contains(5, 0, 0));
+  ASSERT_FALSE(obj.contains(6, 0, 0));
+  ASSERT_TRUE(obj.contains(1, 0, 1));
+  ASSERT_FALSE(obj.contains(0, 0, 1));
+
+  std::pair<size_t, size_t> range = obj.getSliceStripeRange(0);
+  ASSERT_EQ(0, (int) range.first);
+  ASSERT_EQ(2, (int) range.second);
+  range = obj.getSliceStripeRange(2);
+  ASSERT_EQ(range.first, range.second);
+
+  ZIntCuboid box = obj.getBoundBox();
+  ASSERT_EQ(ZIntPoint(0, 0, 0), box.getFirstCorner());
+  ASSERT_EQ(ZIntPoint(5, 1, 1), box.getLastCorner());
+
+  ZObject3dFlatScan obj2;
+  ZObject3dFlatScan::Appender appender(&obj2);
+  appender.addCodeSegment(uint8_t(0x36), 0, 0, 0);
+  ASSERT_EQ(2, (int) obj2.getSegmentNumber());
+  ASSERT_TRUE(obj2.contains(1, 0, 0));
+  ASSERT_TRUE(obj2.contains(5, 0, 0));
+  ASSERT_FALSE(obj2.contains(3, 0, 0));
+}
+
+TEST(ZObject3dFlatScan, Conversion)
+{
+  ZObject3dScan obj;
+  obj.addSegment(0, 0, 0, 5);
+  obj.addSegment(0, 1, 4, 7);
+  obj.addSegment(2, 1, 4, 7);
+
+  ZObject3dFlatScan flatObj(obj);
+  ASSERT_EQ(obj.getStripeNumber(), flatObj.getStripeNumber());
+  ASSERT_EQ(obj.getVoxelNumber(), flatObj.getVoxelNumber());
+  ASSERT_TRUE(obj.equalsLiterally(flatObj.toObject3dScan()));
+}
+
+TEST(ZObject3dFlatScan, Unify)
+{
+  ZObject3dScan obj1;
+  obj1.addSegment(0, 0, 0, 2);
+  obj1.addSegment(1, 1, 1, 3);
+
+  ZObject3dScan obj2;
+  obj2.addSegment(0, 0, 3, 4);
+  obj2.addSegment(2, 0, 0, 2);
+  obj2.addSegment(3, 1, 1, 3);
+
+  ZObject3dFlatScan flatObj1(obj1);
+  ZObject3dFlatScan flatObj2(obj2);
+
+  obj1.unify(obj2);
+  flatObj1.unify(flatObj2);
+  ASSERT_TRUE(flatObj1.isCanonized());
+  ASSERT_TRUE(obj1.equalsLiterally(flatObj1.toObject3dScan()));
+
+  flatObj2.unify(ZObject3dFlatScan(obj1));
+  ASSERT_TRUE(flatObj1.equalsLiterally(flatObj2));
+}
+
+TEST(ZObject3dFlatScan, subtract)
+{
+  ZObject3dScan obj;
+  obj.addSegment(0, 0, 0, 5);
+  obj.addSegment(0, 1, 4, 7);
+
+  ZObject3dScan obj2;
+  obj2.addSegment(0, 0, 2, 3);
+  obj2.addSegment(0, 1, 2, 3);
+  obj2.addSegment(0, 1, 5, 7);
+  obj2.addSegment(0, 2, 2, 3);
+
+  ZObject3dFlatScan flatObj(obj);
+  ZObject3dFlatScan flatObj2(obj2);
+
+  ZObject3dScan subtracted = obj.subtract(obj2);
+  ZObject3dFlatScan flatSubtracted = flatObj.subtract(flatObj2);
+
+  ASSERT_TRUE(obj.equalsLiterally(flatObj.toObject3dScan()));
+  ASSERT_TRUE(subtracted.equalsLiterally(flatSubtracted.toObject3dScan()));
+  ASSERT_EQ(5, (int) flatObj.getVoxelNumber());
+  ASSERT_EQ(5, (int) flatSubtracted.getVoxelNumber());
+}
+
+TEST(ZDvidSparsevolDecoder, Basic)
+{
+  //Spans: (x, y, z, length)
+  int32_t spanArray[] = {
+    1, 2, 3, 4,
+    5, 2, 3, 2,
+    0, 3, 3, 2,
+    2, 1, 4, 3
+  };
+
+  std::vector<char> payload(ZDvidSparsevolDecoder::HEADER_SIZE);
+  payload[1] = 3;
+  uint32_t spanNumber = 4;
+  memcpy(&(payload[8]), &spanNumber, sizeof(spanNumber));
+  payload.insert(payload.end(), (char*) spanArray,
+                 (char*) spanArray + sizeof(spanArray));
+
+  ZObject3dScan obj;
+  ZDvidSparsevolDecoder decoder(&obj);
+  ASSERT_TRUE(decoder.consume(&(payload[0]), payload.size()));
+  ASSERT_TRUE(decoder.finish());
+  ASSERT_EQ(4, (int) decoder.getDecodedSpanNumber());
+  ASSERT_TRUE(obj.isCanonized());
+  ASSERT_TRUE(obj.isCanonizedActually());
+  ASSERT_EQ(3, (int) obj.getStripeNumber());
+  ASSERT_EQ(11, (int) obj.getVoxelNumber());
+  ASSERT_TRUE(obj.contains(6, 2, 3));
+
+  //Feed byte by byte
+  ZObject3dScan obj2;
+  decoder.setResult(&obj2);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    ASSERT_TRUE(decoder.consume(&(payload[i]), 1));
+  }
+  ASSERT_TRUE(decoder.finish());
+  ASSERT_TRUE(obj.equalsLiterally(obj2));
+
+  ZObject3dScan obj3;
+  obj3.importDvidObjectBuffer(&(payload[0]), payload.size());
+  ASSERT_TRUE(obj.equalsLiterally(obj3));
+
+  //Unsorted spans
+  std::swap_ranges(payload.begin() + 12, payload.begin() + 28,
+                   payload.begin() + 44);
+  decoder.setResult(&obj2);
+  decoder.consume(&(payload[0]), 20);
+  decoder.consume(&(payload[20]), payload.size() - 20);
+  ASSERT_TRUE(decoder.finish());
+  ASSERT_FALSE(obj2.isCanonized());
+  obj2.canonize();
+  ASSERT_TRUE(obj.equalsLiterally(obj2));
+
+  //Slice along X
+  ZObject3dScan obj4;
+  obj4.setSliceAxis(neutube::EAxis::X);
+  decoder.setResult(&obj4);
+  decoder.consume(&(payload[0]), payload.size());
+  ASSERT_TRUE(decoder.finish());
+  ASSERT_TRUE(obj4.isCanonizedActually());
+  ASSERT_EQ(11, (int) obj4.getVoxelNumber());
+  ASSERT_EQ(11, (int) obj4.getStripeNumber());
+  ASSERT_TRUE(obj4.contains(6, 2, 3));
+
+  //Truncated payload
+  decoder.setResult(&obj2);
+  decoder.consume(&(payload[0]), payload.size() - 1);
+  ASSERT_FALSE(decoder.finish());
+
+  payload[1] = 2;
+  decoder.setResult(&obj2);
+  ASSERT_FALSE(decoder.consume(&(payload[0]), payload.size()));
+  ASSERT_TRUE(obj2.isEmpty());
+}
+
+TEST(ZObject3dFlatScan, DISABLED_Benchmark)
+{
+  ZObject3dScan body;
+  body.load(GET_BENCHMARK_DIR + "/29.sobj");
+  if (body.isEmpty()) {
+    return;
+  }
+
+  QByteArray payload = body.toDvidPayload();
+
+  std::cout << "Stripe array:" << std::endl;
+  ZObject3dScan obj;
+  tic();
+  obj.importDvidObjectBuffer(payload.constData(), payload.size());
+  obj.canonize();
+  ptoc();
+
+  ZObject3dScan part = obj;
+  part.translate(3, 1, 0);
+  tic();
+  ZObject3dScan unified = obj;
+  unified.unify(part);
+  ZObject3dScan subtracted = unified.subtract(part);
+  ptoc();
+
+  std::cout << "Flat run array:" << std::endl;
+  ZObject3dFlatScan flatObj;
+  tic();
+  flatObj.importDvidObjectBuffer(payload.constData(), payload.size());
+  flatObj.canonize();
+  ptoc();
+
+  ZObject3dFlatScan flatPart = flatObj;
+  flatPart.translate(3, 1, 0);
+  tic();
+  ZObject3dFlatScan flatUnified = flatObj;
+  flatUnified.unify(flatPart);
+  ZObject3dFlatScan flatSubtracted = flatUnified.subtract(flatPart);
+  ptoc();
+
+  ASSERT_EQ(unified.getVoxelNumber(), flatUnified.getVoxelNumber());
+  ASSERT_EQ(subtracted.getVoxelNumber(), flatSubtracted.getVoxelNumber());
+}
+
 #endif
 
 #endif // ZOBJECT3DSCANTEST_H
@@ -0,0 +1,181 @@
+#ifndef ZROIINDEXTEST_H
+#define ZROIINDEXTEST_H
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+
+#include "ztestheader.h"
+#include "tz_utilities.h"
+#include "zobject3dscan.h"
+#include "zroiindex.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZRoiIndex, Basic)
+{
+  ZRoiIndex index;
+  ASSERT_TRUE(index.isEmpty());
+  ASSERT_FALSE(index.contains(0, 0, 0));
+
+  ZObject3dScan obj;
+  obj.addSegment(1, 2, 3, 5);
+  obj.addSegment(1, 2, 8, 9);
+  obj.addSegment(1, 3, 0, 20);
+  obj.addSegment(4, 2, 3, 5);
+
+  index = ZRoiIndex(obj);
+  ASSERT_FALSE(index.isEmpty());
+  ASSERT_EQ(ZIntCuboid(0, 2, 1, 20, 3, 4), index.getBoundBox());
+
+  ASSERT_TRUE(index.contains(3, 2, 1));
+  ASSERT_TRUE(index.contains(5, 2, 1));
+  ASSERT_FALSE(index.contains(6, 2, 1));
+  ASSERT_FALSE(index.contains(7, 2, 1));
+  ASSERT_TRUE(index.contains(8, 2, 1));
+  ASSERT_TRUE(index.contains(9, 2, 1));
+  ASSERT_FALSE(index.contains(10, 2, 1));
+  ASSERT_FALSE(index.contains(2, 2, 1));
+  ASSERT_TRUE(index.contains(0, 3, 1));
+  ASSERT_TRUE(index.contains(20, 3, 1));
+  ASSERT_FALSE(index.contains(21, 3, 1));
+  ASSERT_FALSE(index.contains(3, 2, 2));
+  ASSERT_TRUE(index.contains(4, 2, 4));
+  ASSERT_FALSE(index.contains(4, 2, 5));
+
+  std::vector<ZIntPoint> ptArray;
+  ptArray.push_back(ZIntPoint(3, 2, 1));
+  ptArray.push_back(ZIntPoint(6, 2, 1));
+  ptArray.push_back(ZIntPoint(4, 2, 4));
+  std::vector<bool> result = index.contains(ptArray);
+  ASSERT_EQ(3, (int) result.size());
+  ASSERT_TRUE(result[0]);
+  ASSERT_FALSE(result[1]);
+  ASSERT_TRUE(result[2]);
+  ASSERT_EQ(2, (int) index.countContained(ptArray));
+
+  index = ZRoiIndex(obj, ZIntPoint(2, 2, 2));
+  ASSERT_TRUE(index.contains(6, 4, 2));
+  ASSERT_TRUE(index.contains(11, 5, 3));
+  ASSERT_FALSE(index.contains(12, 5, 3));
+
+  index = ZRoiIndex(obj, ZIntPoint(0, 2, 2));
+  ASSERT_TRUE(index.isEmpty());
+
+  obj.clear();
+  obj.addSegment(-1, -1, -3, -1);
+  index = ZRoiIndex(obj, ZIntPoint(4, 4, 4));
+  ASSERT_TRUE(index.contains(-1, -1, -1));
+  ASSERT_TRUE(index.contains(-12, -4, -4));
+  ASSERT_FALSE(index.contains(-13, -4, -4));
+  ASSERT_FALSE(index.contains(0, -1, -1));
+  ASSERT_FALSE(index.contains(-1, 0, -1));
+}
+
+TEST(ZRoiIndex, Consistency)
+{
+  //A ball with a hole, whose index has full, empty and partial cells
+  ZObject3dScan obj;
+  const int radius = 40;
+  for (int z = -radius; z <= radius; ++z) {
+    for (int y = -radius; y <= radius; ++y) {
+      int r2 = radius * radius - y * y - z * z;
+      if (r2 >= 0) {
+        int x = iround(std::sqrt(r2));
+        if (y * y + z * z < 100) {
+          obj.addSegment(z, y, -x, -5, false);
+          obj.addSegment(z, y, 5, x, false);
+        } else {
+          obj.addSegment(z, y, -x, x, false);
+        }
+      }
+    }
+  }
+  obj.canonize();
+
+  ZRoiIndex index(obj);
+
+  std::vector<ZIntPoint> ptArray;
+  for (int z = -radius - 2; z <= radius + 2; ++z) {
+    for (int y = -radius - 2; y <= radius + 2; ++y) {
+      for (int x = -radius - 2; x <= radius + 2; ++x) {
+        ptArray.push_back(ZIntPoint(x, y, z));
+      }
+    }
+  }
+
+  std::vector<bool> expected(ptArray.size());
+  for (size_t i = 0; i < ptArray.size(); ++i) {
+    expected[i] = obj.contains(ptArray[i]);
+  }
+
+  ASSERT_EQ(expected, index.contains(ptArray));
+
+  std::vector<const ZRoiIndex*> roiArray;
+  ZObject3dScan hole;
+  hole.addSegment(0, 0, -4, 4);
+  ZRoiIndex holeIndex(hole);
+  roiArray.push_back(&holeIndex);
+  roiArray.push_back(&index);
+
+  std::vector<int> labelArray = ZRoiIndex::LabelPoint(ptArray, roiArray);
+  for (size_t i = 0; i < ptArray.size(); ++i) {
+    const ZIntPoint &pt = ptArray[i];
+    if (pt.getZ() == 0 && pt.getY() == 0 && std::abs(pt.getX()) <= 4) {
+      ASSERT_EQ(0, labelArray[i]);
+    } else if (expected[i]) {
+      ASSERT_EQ(1, labelArray[i]);
+    } else {
+      ASSERT_EQ(-1, labelArray[i]);
+    }
+  }
+}
+
+TEST(ZRoiIndex, DISABLED_Benchmark)
+{
+  ZObject3dScan obj;
+  const int radius = 100;
+  for (int z = -radius; z <= radius; ++z) {
+    for (int y = -radius; y <= radius; ++y) {
+      int r2 = radius * radius - y * y - z * z;
+      if (r2 >= 0) {
+        int x = iround(std::sqrt(r2));
+        obj.addSegment(z, y, -x, x, false);
+      }
+    }
+  }
+  obj.canonize();
+
+  std::vector<ZIntPoint> ptArray;
+  for (int i = 0; i < 1000000; ++i) {
+    ptArray.push_back(ZIntPoint(rand() % 256 - 128, rand() % 256 - 128,
+                                rand() % 256 - 128));
+  }
+
+  tic();
+  size_t expected = 0;
+  for (const ZIntPoint &pt : ptArray) {
+    if (obj.contains(pt)) {
+      ++expected;
+    }
+  }
+  std::cout << "ZObject3dScan::contains: ";
+  ptoc();
+
+  tic();
+  ZRoiIndex index(obj);
+  std::cout << "ZRoiIndex building: ";
+  ptoc();
+
+  tic();
+  size_t count = index.countContained(ptArray);
+  std::cout << "ZRoiIndex::countContained: ";
+  ptoc();
+
+  ASSERT_EQ(expected, count);
+}
+
+#endif
+
+#endif // ZROIINDEXTEST_H
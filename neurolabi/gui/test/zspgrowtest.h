@@ -1,10 +1,16 @@
 #ifndef ZSPGROWTEST_H
 #define ZSPGROWTEST_H
 
+#include <vector>
+#include <iostream>
+
 #include "ztestheader.h"
 #include "zspgrowparser.h"
 #include "c_stack.h"
 #include "tz_darray.h"
+#include "tz_stack_graph.h"
+#include "tz_int_arraylist.h"
+#include "tz_utilities.h"
 
 #ifdef _USE_GTEST_
 TEST(ZSpGrowParser, Basic)
@@ -30,6 +36,123 @@ TEST(ZSpGrowParser, Basic)
  C_Stack::kill(distStack);
 }
 
+namespace {
+
+Stack* MakeSpGrowTestStack(int size, int levels, unsigned int seed)
+{
+  srand(seed);
+  Stack *stack = C_Stack::make(GREY, size, size, size);
+  size_t voxelNumber = C_Stack::voxelNumber(stack);
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    stack->array[i] = rand() % levels;
+  }
+
+  return stack;
+}
+
+//Source and target at the opposite corners with scattered conductors
+std::vector<uint8_t> MakeSpGrowTestMask(size_t voxelNumber)
+{
+  std::vector<uint8_t> mask(voxelNumber, 0);
+  for (size_t i = 0; i < voxelNumber; ++i) {
+    if (rand() % 100 < 3) {
+      mask[i] = SP_GROW_CONDUCTOR;
+    }
+  }
+  mask[0] = SP_GROW_SOURCE;
+  mask[voxelNumber - 1] = SP_GROW_TARGET;
+
+  return mask;
+}
+
+Sp_Grow_Workspace* MakeSpGrowTestWorkspace(
+    int queueOption, int spOption, uint8_t *mask)
+{
+  Sp_Grow_Workspace *sgw = New_Sp_Grow_Workspace();
+  sgw->conn = 26;
+  sgw->wf = Stack_Voxel_Weight_I;
+  sgw->sp_option = spOption;
+  sgw->queue_option = queueOption;
+  Sp_Grow_Workspace_Set_Mask(sgw, mask);
+
+  return sgw;
+}
+
+}
+
+TEST(ZSpGrow, KeyedHeap)
+{
+  //Low intensities give many ties
+  for (int levels : {4, 256}) {
+    for (int spOption = 0; spOption <= 1; ++spOption) {
+      for (unsigned int seed = 1; seed <= 20; ++seed) {
+        Stack *stack = MakeSpGrowTestStack(20, levels, seed);
+        size_t voxelNumber = C_Stack::voxelNumber(stack);
+        std::vector<uint8_t> mask = MakeSpGrowTestMask(voxelNumber);
+
+        Sp_Grow_Workspace *sgw[2];
+        Int_Arraylist *path[2];
+        for (int i = 0; i < 2; ++i) {
+          sgw[i] = MakeSpGrowTestWorkspace(
+                (i == 0) ? SP_GROW_BINARY_HEAP : SP_GROW_KEYED_HEAP,
+                spOption, mask.data());
+          path[i] = Stack_Sp_Grow(stack, NULL, 0, NULL, 0, sgw[i]);
+        }
+
+        ASSERT_EQ(path[0]->length, path[1]->length);
+        for (int i = 0; i < path[0]->length; ++i) {
+          ASSERT_EQ(path[0]->array[i], path[1]->array[i]);
+        }
+        ASSERT_EQ(sgw[0]->value, sgw[1]->value);
+
+        for (size_t i = 0; i < voxelNumber; ++i) {
+          ASSERT_EQ(sgw[0]->checked[i], sgw[1]->checked[i]);
+          ASSERT_EQ(sgw[0]->path[i], sgw[1]->path[i]);
+          if (sgw[0]->checked[i] == 1) {
+            ASSERT_EQ(sgw[0]->dist[i], sgw[1]->dist[i]);
+          }
+        }
+
+        for (int i = 0; i < 2; ++i) {
+          Kill_Int_Arraylist(path[i]);
+          Kill_Sp_Grow_Workspace(sgw[i]);
+        }
+        C_Stack::kill(stack);
+      }
+    }
+  }
+}
+
+//Run with --gtest_also_run_disabled_tests.
+TEST(ZSpGrow, DISABLED_Benchmark)
+{
+  for (int levels : {4, 256}) {
+    Stack *stack = MakeSpGrowTestStack(120, levels, 1);
+    size_t voxelNumber = C_Stack::voxelNumber(stack);
+    //Flood the whole stack from the center
+    std::vector<uint8_t> mask(voxelNumber, 0);
+    mask[voxelNumber / 2 + 60 * 120] = SP_GROW_SOURCE;
+
+    double value[2];
+    for (int i = 0; i < 2; ++i) {
+      Sp_Grow_Workspace *sgw = MakeSpGrowTestWorkspace(
+            (i == 0) ? SP_GROW_BINARY_HEAP : SP_GROW_KEYED_HEAP, 0,
+            mask.data());
+      tic();
+      Int_Arraylist *path = Stack_Sp_Grow(stack, NULL, 0, NULL, 0, sgw);
+      std::cout << "Intensity levels " << levels
+                << ((i == 0) ? ", binary heap: " : ", keyed heap: ");
+      ptoc();
+      value[i] = sgw->value;
+      Kill_Int_Arraylist(path);
+      Kill_Sp_Grow_Workspace(sgw);
+    }
+    ASSERT_EQ(value[0], value[1]);
+
+    C_Stack::kill(stack);
+  }
+}
+
 #endif
 
 #endif // ZSPGROWTEST_H
@@ -18,6 +18,7 @@
 #include "zswcforest.h"
 #include "neutubeconfig.h"
 #include "zswcutil.h"
+#include "swc/zswcnodeindex.h"
 
 #ifdef _USE_GTEST_
 
@@ -673,6 +674,138 @@ TEST(SwcTree, Util)
   ASSERT_EQ(tn, nodeArray.front());
 }
 
+
+TEST(SwcTree, NodeIndex)
+{
+  ZSwcNodeIndex index;
+  ASSERT_TRUE(index.isEmpty());
+  ASSERT_TRUE(index.getNodeNear(0, 0, 0, 1.0).empty());
+  ASSERT_EQ(NULL, index.findClosestNode(0, 0, 0));
+
+  ZSwcTree tree;
+  Swc_Tree_Node *parent = NULL;
+  srand(1);
+  for (int i = 0; i < 500; ++i) {
+    Swc_Tree_Node *tn = SwcTreeNode::makePointer();
+    SwcTreeNode::setNode(tn, i + 1, 2, rand() % 200, rand() % 100,
+                         rand() % 50, 0.5 + (rand() % 40) * 0.1, -1);
+    if (i == 100) {
+      SwcTreeNode::setRadius(tn, 60.0);
+    }
+    if (parent == NULL || i % 50 == 0) {
+      tree.addRegularRoot(tn);
+    } else {
+      SwcTreeNode::setParent(tn, parent);
+    }
+    parent = tn;
+  }
+
+  const std::vector<Swc_Tree_Node*> &nodeArray =
+      tree.getSwcTreeNodeArray(ZSwcTree::DEPTH_FIRST_ITERATOR);
+  std::vector<Swc_Tree_Node*> regularArray;
+  for (Swc_Tree_Node *tn : nodeArray) {
+    if (SwcTreeNode::isRegular(tn)) {
+      regularArray.push_back(tn);
+    }
+  }
+
+  const ZSwcNodeIndex &treeIndex = tree.getNodeIndex();
+  ASSERT_EQ(regularArray.size(), treeIndex.getNodeNumber());
+
+  for (int k = 0; k < 200; ++k) {
+    double x = rand() % 220 - 10;
+    double y = rand() % 120 - 10;
+    double z = rand() % 70 - 10;
+
+    std::vector<Swc_Tree_Node*> expected;
+    std::vector<Swc_Tree_Node*> expectedXY;
+    std::vector<Swc_Tree_Node*> expectedBox;
+    Swc_Tree_Node *closest = NULL;
+    double minDist = 0.0;
+    for (Swc_Tree_Node *tn : regularArray) {
+      double dist = SwcTreeNode::distance(tn, x, y, z);
+      if (dist < SwcTreeNode::radius(tn) + 2.0) {
+        expected.push_back(tn);
+      }
+      double dx = SwcTreeNode::x(tn) - x;
+      double dy = SwcTreeNode::y(tn) - y;
+      if (std::sqrt(dx * dx + dy * dy) < SwcTreeNode::radius(tn) + 2.0) {
+        expectedXY.push_back(tn);
+      }
+      if (SwcTreeNode::x(tn) >= x && SwcTreeNode::x(tn) <= x + 30 &&
+          SwcTreeNode::y(tn) >= y && SwcTreeNode::y(tn) <= y + 20 &&
+          SwcTreeNode::z(tn) >= z && SwcTreeNode::z(tn) <= z + 10) {
+        expectedBox.push_back(tn);
+      }
+      if (closest == NULL || dist < minDist) {
+        closest = tn;
+        minDist = dist;
+      }
+    }
+
+    ASSERT_EQ(expected, treeIndex.getNodeNear(x, y, z, 2.0));
+    ASSERT_EQ(expectedXY, treeIndex.getNodeNearXY(x, y, 2.0));
+    ASSERT_EQ(expectedBox,
+              treeIndex.getNodeInBox(x, y, z, x + 30, y + 20, z + 10));
+    ASSERT_EQ(closest, treeIndex.findClosestNode(x, y, z));
+    ASSERT_EQ(closest, tree.queryNode(ZPoint(x, y, z)));
+  }
+
+  Swc_Tree_Node *tn = regularArray[10];
+  ASSERT_EQ(tn, tree.hitTest(SwcTreeNode::x(tn), SwcTreeNode::y(tn),
+                             SwcTreeNode::z(tn)));
+
+  //Moving a node invalidates the index after deprecation
+  SwcTreeNode::setPos(tn, 1000, 1000, 1000);
+  tree.deprecate(ZSwcTree::ALL_COMPONENT);
+  ASSERT_EQ(tn, tree.hitTest(1000, 1000, 1000));
+  ASSERT_EQ(tn, tree.queryNode(ZPoint(900, 900, 900)));
+}
+
+TEST(SwcTree, NodeIndexTransform)
+{
+  ZSwcTree tree;
+  Swc_Tree_Node *tn1 = SwcTreeNode::makePointer();
+  SwcTreeNode::setNode(tn1, 1, 2, 10, 10, 10, 1.0, -1);
+  Swc_Tree_Node *tn2 = SwcTreeNode::makePointer();
+  SwcTreeNode::setNode(tn2, 2, 2, 50, 10, 10, 1.0, -1);
+  tree.addRegularRoot(tn1);
+  SwcTreeNode::setParent(tn2, tn1);
+
+  //Build the index before transforming the tree
+  ASSERT_EQ(tn1, tree.hitTest(10, 10, 10));
+
+  tree.translate(100, 0, 0);
+  ASSERT_EQ(NULL, tree.hitTest(10, 10, 10));
+  ASSERT_EQ(tn1, tree.hitTest(110, 10, 10));
+  ASSERT_EQ(tn2, tree.queryNode(ZPoint(148, 10, 10)));
+
+  tree.scale(0.5, 1.0, 1.0);
+  ASSERT_EQ(tn1, tree.hitTest(55, 10, 10));
+  ASSERT_EQ(tn2, tree.hitTest(75, 10, 10));
+
+  tree.rescale(2.0, 1.0, 1.0);
+  ASSERT_EQ(tn1, tree.hitTest(110, 10, 10));
+
+  tree.translateRootTo(0, 0, 0);
+  ASSERT_EQ(tn1, tree.hitTest(0, 0, 0));
+  ASSERT_EQ(tn2, tree.hitTest(40, 0, 0));
+
+  tree.rotate(0.0, M_PI / 2, ZPoint(0, 0, 0), false);
+  ASSERT_EQ(NULL, tree.hitTest(40, 0, 0));
+  ASSERT_EQ(tn2, tree.queryNode(SwcTreeNode::center(tn2)));
+  ASSERT_EQ(tn2, tree.hitTest(SwcTreeNode::x(tn2), SwcTreeNode::y(tn2),
+                              SwcTreeNode::z(tn2)));
+
+  //Radius changes
+  ZPoint pos = SwcTreeNode::center(tn2);
+  ASSERT_EQ(NULL, tree.hitTest(pos.x() + 5, pos.y(), pos.z()));
+  tree.changeRadius(9.0, 1.0);
+  ASSERT_EQ(tn2, tree.hitTest(pos.x() + 5, pos.y(), pos.z()));
+  tree.changeRadius(0.0, 0.1);
+  ASSERT_EQ(NULL, tree.hitTest(pos.x() + 5, pos.y(), pos.z()));
+}
+
 #endif
 
 #endif // ZSWCTREETEST_H
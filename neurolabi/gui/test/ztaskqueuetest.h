@@ -0,0 +1,156 @@
+#ifndef ZTASKQUEUETEST_H
+#define ZTASKQUEUETEST_H
+
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include "ztestheader.h"
+#include "ztask.h"
+#include "concurrent/ztaskqueue.h"
+#include "concurrent/ztaskscheduler.h"
+
+#ifdef _USE_GTEST_
+
+TEST(ZTaskQueue, Priority)
+{
+  QObject parent;
+  ZTaskQueue queue;
+
+  ZTask *lowTask = new ZSquareTask(&parent);
+  lowTask->setPriority(ZTask::PRIORITY_LOW);
+  ZTask *task1 = new ZSquareTask(&parent);
+  ZTask *highTask = new ZSquareTask(&parent);
+  highTask->setPriority(ZTask::PRIORITY_HIGH);
+  ZTask *task2 = new ZSquareTask(&parent);
+
+  queue.add(lowTask);
+  queue.add(task1);
+  queue.add(highTask);
+  queue.add(task2);
+  ASSERT_EQ(4, int(queue.getStat().pendingCount));
+
+  ASSERT_EQ(highTask, queue.get());
+  ASSERT_EQ(task1, queue.get());
+  ASSERT_EQ(task2, queue.get());
+  ASSERT_EQ(lowTask, queue.get());
+  ASSERT_TRUE(queue.isEmpty());
+  ASSERT_EQ(4, int(queue.getStat().runningCount));
+
+  for (int i = 0; i < 4; ++i) {
+    queue.finishTask("");
+  }
+  ZTaskQueue::Stat stat = queue.getStat();
+  ASSERT_EQ(0, int(stat.runningCount));
+  ASSERT_EQ(4, int(stat.finishedCount));
+
+  queue.add(NULL);
+  ASSERT_TRUE(queue.get() == NULL);
+}
+
+TEST(ZTaskQueue, Key)
+{
+  QObject parent;
+  ZTaskQueue queue;
+
+  ZTask *task1 = new ZSquareTask(&parent);
+  task1->setKey("label slice");
+  ZTask *task2 = new ZSquareTask(&parent);
+  task2->setKey("label slice");
+  ZTask *task3 = new ZSquareTask(&parent);
+  task3->setPriority(ZTask::PRIORITY_LOW);
+
+  //task2 supersedes task1
+  queue.add(task1);
+  queue.add(task2);
+  queue.add(task3);
+  ASSERT_EQ(2, int(queue.getStat().pendingCount));
+  ASSERT_EQ(1, int(queue.getStat().canceledCount));
+  ASSERT_EQ(task2, queue.get());
+
+  //task4 waits until task2 is finished
+  ZTask *task4 = new ZSquareTask(&parent);
+  task4->setKey("label slice");
+  task4->setPriority(ZTask::PRIORITY_HIGH);
+  queue.add(task4);
+  ASSERT_EQ(task3, queue.get());
+  queue.finishTask("label slice");
+  ASSERT_EQ(task4, queue.get());
+  queue.finishTask("label slice");
+  queue.finishTask("");
+
+  ZTask *task5 = new ZSquareTask(&parent);
+  task5->setKey("gray slice");
+  queue.add(task5);
+  queue.cancel("gray slice");
+  ASSERT_TRUE(queue.isEmpty());
+  ASSERT_EQ(2, int(queue.getStat().canceledCount));
+}
+
+TEST(ZTaskQueue, Delay)
+{
+  QObject parent;
+  ZTaskQueue queue;
+
+  ZTask *delayedTask = new ZSquareTask(&parent);
+  delayedTask->setPriority(ZTask::PRIORITY_HIGH);
+  delayedTask->setDelay(100);
+  ZTask *task = new ZSquareTask(&parent);
+
+  queue.add(delayedTask);
+  queue.add(task);
+  ASSERT_EQ(task, queue.get());
+  ASSERT_EQ(delayedTask, queue.get());
+  ASSERT_LE(0, int(queue.getStat().maxLatency));
+}
+
+TEST(ZTaskScheduler, Basic)
+{
+  QObject parent;
+
+  {
+    ZTaskScheduler scheduler(3);
+    ASSERT_EQ(3, scheduler.getWorkerCount());
+
+    std::vector<ZSquareTask*> taskArray;
+    for (int i = 0; i < 10; ++i) {
+      ZSquareTask *task = new ZSquareTask(&parent);
+      task->setValue(i);
+      taskArray.push_back(task);
+      scheduler.addTask(task);
+    }
+
+    for (int i = 0; i < 500; ++i) {
+      if (scheduler.getStat().finishedCount == taskArray.size()) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(taskArray.size(), size_t(scheduler.getStat().finishedCount));
+    for (size_t i = 0; i < taskArray.size(); ++i) {
+      ASSERT_EQ(double(i * i), taskArray[i]->getResult());
+    }
+  } //Destroying the scheduler stops the workers
+
+  //Destroyed with pending tasks
+  {
+    ZTaskScheduler scheduler(2);
+    for (int i = 0; i < 10; ++i) {
+      scheduler.addTask(new ZSquareTask(&parent));
+    }
+  }
+
+  //Destroyed without any task
+  {
+    ZTaskScheduler scheduler(1);
+  }
+
+  ZTaskScheduler scheduler(2);
+  scheduler.quit();
+  ASSERT_EQ(0, scheduler.getWorkerCount());
+  scheduler.quit();
+}
+
+#endif
+
+#endif // ZTASKQUEUETEST_H
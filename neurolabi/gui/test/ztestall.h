@@ -71,5 +71,12 @@
 #include "test/zdviddataslicetest.h"
 #include "test/zstackviewparamtest.h"
 #include "test/zflyembodymanagertest.h"
+#include "test/zmeshfactorytest.h"
+#include "test/ztaskqueuetest.h"
+#include "test/zroiindextest.h"
+#include "test/zdvidannotationdecodertest.h"
+#include "test/zboundedqueuetest.h"
+#include "test/zneurontracertest.h"
+#include "test/zdvidgrayscaleblockfetchertest.h"
 
 #endif // ZTESTALL_H
@@ -3,6 +3,15 @@
 
 #include "ztestheader.h"
 #include "flyem/zstackwatershedcontainer.h"
+#include "imgproc/zsparsestackwatershed.h"
+#include "imgproc/zstackparallelwatershed.h"
+#include "zsparsestack.h"
+#include "zobject3dscan.h"
+#include "zobject3dscanarray.h"
+#include "zobject3d.h"
+#include "zstack.hxx"
+#include "c_stack.h"
+#include "tz_stack_watershed.h"
 
 #ifdef _USE_GTEST_
 
@@ -11,6 +20,208 @@ TEST(ZStackWatershedContainer, test)
   ASSERT_TRUE(ZStackWatershedContainer::Test());
 }
 
+TEST(ZSparseStackWatershed, run)
+{
+  ZSparseStack spStack;
+
+  ZObject3dScan *obj = new ZObject3dScan;
+  obj->addSegment(0, 0, 0, 9);
+  obj->addSegment(0, 2, 0, 3); //Isolated part
+  spStack.setObjectMask(obj);
+
+  ZStackBlockGrid *stackGrid = new ZStackBlockGrid;
+  stackGrid->setBlockSize(16, 16, 16);
+  stackGrid->setGridSize(1, 1, 1);
+  ZStack *stack = new ZStack(GREY, 16, 16, 16, 1);
+  stack->setZero();
+  for (int x = 0; x < 10; ++x) {
+    stack->setIntValue(x, 0, 0, 0, 9);
+    stack->setIntValue(x, 2, 0, 0, 9);
+  }
+  stack->setIntValue(4, 0, 0, 0, 1);
+  stackGrid->consumeStack(ZIntPoint(0, 0, 0), stack);
+  spStack.setGreyScale(stackGrid);
+
+  ZObject3d seed1;
+  seed1.append(0, 0, 0);
+  seed1.setLabel(1);
+  ZObject3d seed2;
+  seed2.append(9, 0, 0);
+  seed2.setLabel(2);
+  std::vector<ZObject3d*> seedArray;
+  seedArray.push_back(&seed1);
+  seedArray.push_back(&seed2);
+
+  ZSparseStackWatershed watershed;
+  ZObject3dScanArray *result = watershed.run(spStack, seedArray);
+  ASSERT_EQ(14, (int) watershed.getVoxelNumber());
+  ASSERT_EQ(2, (int) result->size());
+  ASSERT_EQ(1, (int) (*result)[0]->getLabel());
+  ASSERT_EQ(5, (int) (*result)[0]->getVoxelNumber());
+  ASSERT_TRUE((*result)[0]->contains(4, 0, 0));
+  ASSERT_EQ(2, (int) (*result)[1]->getLabel());
+  ASSERT_EQ(5, (int) (*result)[1]->getVoxelNumber());
+  delete result;
+
+  //Zero-valued voxels are barriers
+  spStack.setBaseValue(0);
+  spStack.getStackGrid()->getStack(ZIntPoint(0, 0, 0))->setIntValue(
+        4, 0, 0, 0, 0);
+  result = watershed.run(spStack, seedArray);
+  ASSERT_EQ(4, (int) (*result)[0]->getVoxelNumber());
+  ASSERT_EQ(5, (int) (*result)[1]->getVoxelNumber());
+  delete result;
+
+  watershed.setFloodingZero(true);
+  watershed.setRange(ZIntCuboid(0, 0, 0, 7, 0, 0));
+  result = watershed.run(spStack, seedArray);
+  ASSERT_EQ(8, (int) watershed.getVoxelNumber());
+  ASSERT_EQ(1, (int) result->size());
+  ASSERT_EQ(8, (int) (*result)[0]->getVoxelNumber());
+  delete result;
+}
+
+TEST(ZStackParallelWatershed, run)
+{
+  const int width = 20;
+  const int height = 6;
+  const int depth = 30;
+  Stack *signal = C_Stack::make(GREY, width, height, depth);
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        //A wall at x = 10 with a varying texture on both sides
+        int v = (x == 10) ? 50 : 100 + (x * 7 + y * 13 + z * 5) % 100;
+        C_Stack::setPixel(signal, x, y, z, 0, v);
+      }
+    }
+  }
+
+  ZStackParallelWatershed watershed;
+  watershed.setBlockDepth(4);
+  watershed.setThreadCount(3);
+  watershed.setSignal(signal);
+  watershed.addSeed(0, 0, 0, 1);
+  watershed.addSeed(19, 5, 29, 300);
+  ASSERT_TRUE(watershed.run());
+  ASSERT_LT(0, watershed.getReconcilePassNumber());
+  ASSERT_EQ(300, (int) watershed.getMaxLabel());
+
+  const std::vector<uint32_t> &label = watershed.getLabelArray();
+  ASSERT_EQ(C_Stack::voxelNumber(signal), label.size());
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        uint32_t v = label[C_Stack::offset(x, y, z, width, height, depth)];
+        if (x < 10) {
+          ASSERT_EQ(1, (int) v);
+        } else if (x > 10) {
+          ASSERT_EQ(300, (int) v);
+        }
+      }
+    }
+  }
+
+  //Labels larger than 255 need a 16-bit stack
+  ZStack *labelStack = watershed.makeLabelStack();
+  ASSERT_EQ(GREY16, labelStack->kind());
+  ASSERT_EQ(300, labelStack->getIntValue(19, 0, 0));
+  delete labelStack;
+
+  //The result does not depend on the number of threads
+  std::vector<uint32_t> label3 = label;
+  watershed.setThreadCount(1);
+  watershed.run();
+  ASSERT_EQ(label3, watershed.getLabelArray());
+
+  //A single block is the same as Stack_Watershed()
+  Stack_Watershed_Workspace *ws = Make_Stack_Watershed_Workspace(signal);
+  ws->conn = 6;
+  ws->mask = C_Stack::make(GREY, width, height, depth);
+  C_Stack::setZero(ws->mask);
+  ws->mask->array[0] = 1;
+  ws->mask->array[C_Stack::offset(19, 5, 29, width, height, depth)] = 2;
+  Stack *out = Stack_Watershed(signal, ws);
+
+  watershed.setBlockDepth(0);
+  watershed.setSignal(signal);
+  watershed.addSeed(0, 0, 0, 1);
+  watershed.addSeed(19, 5, 29, 2);
+  watershed.run();
+  labelStack = watershed.makeLabelStack();
+  ASSERT_EQ(GREY, labelStack->kind());
+  for (size_t i = 0; i < label.size(); ++i) {
+    ASSERT_EQ(out->array[i], labelStack->array8()[i]);
+  }
+
+  delete labelStack;
+  C_Stack::kill(out);
+  Kill_Stack_Watershed_Workspace(ws);
+  C_Stack::kill(signal);
+}
+
+TEST(ZStackParallelWatershed, ManySeeds)
+{
+  //A seed on every even x gives more labels than a GREY16 stack can hold
+  const int width = 600;
+  const int height = 150;
+  const int depth = 2;
+  Stack *signal = C_Stack::make(GREY, width, height, depth);
+  C_Stack::setOne(signal);
+
+  ZStackParallelWatershed watershed;
+  watershed.setBlockDepth(1);
+  watershed.setThreadCount(2);
+  watershed.setSignal(signal);
+  uint32_t label = 0;
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; x += 2) {
+        watershed.addSeed(x, y, z, ++label);
+      }
+    }
+  }
+  ASSERT_EQ(90000, (int) label);
+  ASSERT_TRUE(watershed.run());
+  ASSERT_EQ(label, watershed.getMaxLabel());
+
+  const std::vector<uint32_t> &labelArray = watershed.getLabelArray();
+  label = 0;
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        uint32_t v = labelArray[C_Stack::offset(x, y, z, width, height, depth)];
+        if (x % 2 == 0) {
+          ASSERT_EQ(++label, v);
+        } else {
+          ASSERT_LT(0, (int) v);
+        }
+      }
+    }
+  }
+
+  //No truncated stack
+  ASSERT_TRUE(watershed.makeLabelStack() == NULL);
+
+  ZObject3dScanArray *objArray = watershed.makeLabelObjectArray();
+  ASSERT_EQ(90000, (int) objArray->size());
+  size_t voxelNumber = 0;
+  for (const ZObject3dScan *obj : *objArray) {
+    ASSERT_LT(0, (int) obj->getLabel());
+    const ZObject3dStripe &stripe = obj->getStripe(0);
+    ASSERT_EQ(obj->getLabel(),
+              labelArray[C_Stack::offset(
+                stripe.getSegmentStart(0), stripe.getY(), stripe.getZ(),
+                width, height, depth)]);
+    voxelNumber += obj->getVoxelNumber();
+  }
+  ASSERT_EQ(C_Stack::voxelNumber(signal), voxelNumber);
+  objArray->clearAll();
+  delete objArray;
+
+  C_Stack::kill(signal);
+}
+
 #endif
 
 #endif // ZWATERSHEDTEST_H
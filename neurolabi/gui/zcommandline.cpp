@@ -44,6 +44,7 @@
 #include "misc/miscutility.h"
 #include "dvid/zdvidversiondag.h"
 #include "zflyemutilities.h"
+#include "flyem/zflyembodyskeletonizebatch.h"
 
 //Incude your module headers here
 #include "command/zcommandmodule.h"
@@ -92,6 +93,7 @@ void ZCommandLine::init()
   m_forceUpdate = false;
   m_namedOnly = false;
   m_intvSpecified = false;
+  m_threadCount = 1;
 }
 
 void ZCommandLine::registerModule()
@@ -1132,21 +1134,32 @@ int ZCommandLine::skeletonizeDvid()
 
   ZRandomGenerator rnd;
   std::vector<int> rank = rnd.randperm(bodyIdArray.size());
-  std::set<uint64_t> excluded;
-  //excluded.insert(16493);
-  //excluded.insert(8772496);
+  std::vector<uint64_t> orderedBodyIdArray(bodyIdArray.size());
+  for (size_t i = 0; i < bodyIdArray.size(); ++i) {
+    orderedBodyIdArray[i] = bodyIdArray[rank[i] - 1];
+  }
 
-  ZStackSkeletonizer skeletonizer;
+  ZFlyEmBodySkeletonizeBatch batch;
+  batch.setDvidTarget(reader.getDvidTarget());
+  if (savingToFile) {
+    batch.setOutputDir(outputDir.absolutePath());
+  } else {
+    batch.setBodyDvidTarget(bodyReader.getDvidTarget());
+  }
 
   ZJsonObject config = getSkeletonizeConfig(reader);
   if (!config.isEmpty()) {
-    skeletonizer.configure(config);
+    batch.setSkeletonizeConfig(config);
   }
 
   if (m_intvSpecified) {
-    skeletonizer.setDownsampleInterval(m_intv[0], m_intv[1], m_intv[2]);
+    batch.setDownsampleInterval(m_intv[0], m_intv[1], m_intv[2]);
   }
 
+  batch.setForceUpdate(m_forceUpdate);
+  batch.setWorkerCount(m_threadCount);
+  batch.setCheckpointPath(m_checkpointPath);
+
   std::ofstream stream;
   if (!m_output.empty() && !m_outputFlag.empty()) {
     if (m_outputFlag == "thickness") {
@@ -1154,83 +1167,22 @@ int ZCommandLine::skeletonizeDvid()
     }
   }
 
-  for (size_t i = 0; i < bodyIdArray.size(); ++i) {
-    uint64_t bodyId = bodyIdArray[rank[i] - 1];
-    if (excluded.count(bodyId) == 0) {
-      std::cout << "Skeletonizing " << bodyId << std::endl;
-      ZSwcTree *tree = NULL;
-      QFileInfo outputFileInfo(outputDir.absoluteFilePath(QString("%1.swc").arg(bodyId)));
-
-      const int mid = bodyReader.readBodyMutationId(bodyId);
-      if (!m_forceUpdate || mid > 0) {
-        if (savingToFile) {
-          if (outputFileInfo.exists()) {
-            tree = new ZSwcTree;
-            tree->load(outputFileInfo.absoluteFilePath().toStdString());
-//            if (tree->isEmpty()) {
-//              delete tree;
-//              tree = NULL;
-//            }
-//            LINFO() << outputFileInfo.absoluteFilePath().toStdString() + " exists.";
-          }
-        } else {
-          tree = reader.readSwc(bodyId);
-        }
-      }
-
-      if (tree != NULL && mid > 0) {
-        if (flyem::GetMutationId(tree) != mid) {
-          delete tree;
-          tree = NULL;
-        }
-      }
-
-      if (tree == NULL) {
-        ZObject3dScan obj;
-
-        int zoom = 0;
-        if (bodyReader.getDvidTarget().hasMultiscaleSegmentation()) {
-          const int blockCount = bodyReader.readBodyBlockCount(bodyId);
-          constexpr int maxBlockCount = 3000;
-          int scale = std::ceil(misc::GetExpansionScale(blockCount, maxBlockCount));
-          zoom = std::min(2, zgeom::GetZoomLevel(int(std::ceil(scale))));
-          zoom = std::min(zoom, bodyReader.getDvidTarget().getMaxLabelZoom());
-        }
-
-        std::cout << "Reading body..." << std::endl;
-//        reader.readBody(bodyId, true, &obj);
-        bodyReader.readMultiscaleBody(bodyId, zoom, true, &obj);
-        std::cout << "Skeletonzing..." << std::endl;
-        tree = skeletonizer.makeSkeleton(obj);
-        if (tree != NULL) {
-          if (mid > 0) {
-            flyem::SetMutationId(tree, mid);
-          }
-          if (savingToFile) {
-            tree->save(outputFileInfo.absoluteFilePath().toStdString());
-          } else {
-            writer.writeSwc(bodyId, tree);
-          }
-        } else {
-          LWARN() << "Skeletonization failed for" << bodyId;
-        }
+  if (stream.is_open()) {
+    batch.setResultFunc([&](uint64_t bodyId, const ZSwcTree *tree) {
+      if (m_outputFlag == "thickness") {
+        stream << bodyId << " "
+               << SwcTreeNode::radius(tree->getThickestNode())
+               << std::endl;
       }
+    });
+  }
 
-      if (tree != NULL) {
-        if (stream.is_open()) {
-          if (m_outputFlag == "thickness") {
-            stream << bodyId << " "
-                   << SwcTreeNode::radius(tree->getThickestNode())
-                   << std::endl;
-          }
-        }
-      }
-      delete tree;
-      LINFO() << "Output:" << m_output;
-      LINFO() << ">>>>>>>>skeletonized>>>>>>>>>>" << i + 1 << " / " << bodyIdArray.size();
-    }
+  if (!batch.run(orderedBodyIdArray)) {
+    return 1;
   }
 
+  LINFO() << "Output:" << m_output;
+
   return 0;
 }
 
@@ -1343,6 +1295,7 @@ int ZCommandLine::run(int argc, char *argv[])
     "[-o <string>]",
     "[--config <string>]", "[--intv <int> <int> <int>]",
     "[--skeletonize] [--force] [--bodyid <string>] [--named_only]",
+    "[--thread <int>] [--checkpoint <string>]",
     "[--general <string>]",
     "[--compare_swc] [--scale <double>]",
     "[--trace] [--level <int>]","[--separate <string>]", "[--foutput <string>]",
@@ -1413,6 +1366,14 @@ int ZCommandLine::run(int argc, char *argv[])
     m_namedOnly = true;
   }
 
+  if (Is_Arg_Matched(const_cast<char*>("--thread"))) {
+    m_threadCount = Get_Int_Arg(const_cast<char*>("--thread"));
+  }
+
+  if (Is_Arg_Matched(const_cast<char*>("--checkpoint"))) {
+    m_checkpointPath = Get_String_Arg(const_cast<char*>("--checkpoint"));
+  }
+
   if (Is_Arg_Matched(const_cast<char*>("--foutput"))) {
     m_outputFlag = Get_String_Arg(const_cast<char*>("--foutput"));
   }
@@ -108,6 +108,8 @@ private:
   bool m_isVerbose;
   bool m_forceUpdate;
   bool m_namedOnly;
+  int m_threadCount; //number of skeletonizing workers
+  std::string m_checkpointPath;
   std::vector<uint64_t> m_bodyIdArray;
   ZMessageReporter m_reporter;
 
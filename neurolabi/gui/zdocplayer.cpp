@@ -78,6 +78,12 @@ ZTask* ZDocPlayer::getFutureTask(ZStackDoc */*doc*/) const
   return NULL;
 }
 
+ZTask* ZDocPlayer::getPrefetchTask(
+    ZStackDoc */*doc*/, const ZSliceScrollMotion &/*motion*/) const
+{
+  return NULL;
+}
+
 /*************************************/
 ZDocPlayerList::~ZDocPlayerList()
 {
@@ -724,6 +730,17 @@ ZTask* ZDvidGraySlicePlayer::getFutureTask(ZStackDoc *doc) const
   return NULL;
 }
 
+ZTask* ZDvidGraySlicePlayer::getPrefetchTask(
+    ZStackDoc *doc, const ZSliceScrollMotion &motion) const
+{
+  ZDvidGraySlice *obj = getCompleteData();
+  if (obj != NULL) {
+    return obj->makePrefetchTask(doc, motion);
+  }
+
+  return NULL;
+}
+
 /////////////////////////////
 
 
@@ -764,6 +781,17 @@ ZTask* ZDvidLabelSlicePlayer::getFutureTask(ZStackDoc *doc) const
   return NULL;
 }
 
+ZTask* ZDvidLabelSlicePlayer::getPrefetchTask(
+    ZStackDoc *doc, const ZSliceScrollMotion &motion) const
+{
+  ZDvidLabelSlice *obj = getCompleteData();
+  if (obj != NULL) {
+    return obj->makePrefetchTask(doc, motion);
+  }
+
+  return NULL;
+}
+
 
 /////////////////////////////
 ZDvidTileEnsemblePlayer::ZDvidTileEnsemblePlayer(ZStackObject *data) :
@@ -29,6 +29,7 @@ class ZArbSliceViewParam;
 class ZDvidTileEnsemble;
 class ZTask;
 class ZStackDoc;
+class ZSliceScrollMotion;
 
 /*!
  * \brief The basic class of manage roles to a stack object
@@ -86,6 +87,12 @@ public:
   virtual ZTask* getFutureTask() const;
   virtual ZTask* getFutureTask(ZStackDoc *doc) const;
 
+  /*!
+   * \brief Get the task of prefetching data for the slices ahead of \a motion.
+   */
+  virtual ZTask* getPrefetchTask(
+      ZStackDoc *doc, const ZSliceScrollMotion &motion) const;
+
   inline ZStackObject* getData() const {
     return m_data;
   }
@@ -345,6 +352,8 @@ public:
   bool updateData(const ZStackViewParam &viewParam) const;
   ZDvidGraySlice *getCompleteData() const;
   ZTask* getFutureTask(ZStackDoc *doc) const;
+  ZTask* getPrefetchTask(
+      ZStackDoc *doc, const ZSliceScrollMotion &motion) const;
 };
 
 /**************************************************/
@@ -358,6 +367,8 @@ public:
   bool updateData(const ZStackViewParam &viewParam) const;
   ZDvidLabelSlice *getCompleteData() const;
   ZTask* getFutureTask(ZStackDoc *doc) const;
+  ZTask* getPrefetchTask(
+      ZStackDoc *doc, const ZSliceScrollMotion &motion) const;
 };
 
 /**************************************************/
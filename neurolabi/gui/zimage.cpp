@@ -11,6 +11,7 @@
 #include "neutube_def.h"
 #include "tz_math.h"
 #include "zjsonobject.h"
+#include "imgproc/zlabelcolorizer.h"
 
 ZImage::ZImage() : QImage()
 {
@@ -832,51 +833,20 @@ void ZImage::setCData(const uint8_t *data, uint8_t alpha)
 void ZImage::drawLabelField(
     uint64_t *data, const QVector<int> &colorTable, int bgColor, int selColor)
 {
-  int colorCount = colorTable.size();
-  if (colorCount > 0) {
-    int h = height();
-    int w = width();
-
-    for (int j = 0; j < h; j++) {
-      int *line = (int*) scanLine(j);
-      for (int i = 0; i < w; i++) {
-        uint64_t v = *data++;
-        if (v == 0) {
-          *line++ = bgColor;
-        } else if (v == flyem::LABEL_ID_SELECTION) {
-          *line++ = selColor;
-        } else {
-          *line++ = colorTable[v % colorCount] ;
-        }
-      }
-    }
+  if (!colorTable.isEmpty()) {
+    ZLabelColorizer colorizer(
+          colorTable.constData(), colorTable.size(), bgColor, selColor);
+    colorizer.colorize(data, width(), height(), bits(), bytesPerLine());
   }
 }
 
 void ZImage::drawLabelFieldTranspose(
     uint64_t *data, const QVector<int> &colorTable, int bgColor, int selColor)
 {
-  int colorCount = colorTable.size();
-  if (colorCount > 0) {
-    int h = height();
-    int w = width();
-
-    uint64_t *dataLine = data;
-    for (int j = 0; j < h; j++) {
-      int *line = (int*) scanLine(j);
-      dataLine = data + j;
-      for (int i = 0; i < w; i++) {
-        uint64_t v = *dataLine;
-        dataLine += h;
-        if (v == 0) {
-          *line++ = bgColor;
-        } else if (v == flyem::LABEL_ID_SELECTION) {
-          *line++ = selColor;
-        } else {
-          *line++ = colorTable[v % colorCount] ;
-        }
-      }
-    }
+  if (!colorTable.isEmpty()) {
+    ZLabelColorizer colorizer(
+          colorTable.constData(), colorTable.size(), bgColor, selColor);
+    colorizer.colorizeTranspose(data, width(), height(), bits(), bytesPerLine());
   }
 }
 
@@ -38,9 +38,47 @@ ZMesh* ZMeshFactory::MakeMesh(const ZObject3dScan &obj)
   return MakeMesh(obj, 0, 3, true);
 }
 
+void ZMeshFactory::setBlockSize(int size)
+{
+  m_blockSize = size;
+}
+
+void ZMeshFactory::setThreadCount(int n)
+{
+  m_threadCount = n;
+}
+
 ZMesh* ZMeshFactory::makeMesh(const ZObject3dScan &obj)
 {
-  return MakeMesh(obj, m_dsIntv, m_smooth, m_offsetAdjust);
+  if (!obj.hasVoxel()) {
+    return NULL;
+  }
+
+  int dsIntv = m_dsIntv;
+  if (dsIntv == 0) {
+    dsIntv = getAutoDsIntv(obj);
+  }
+
+  const ZObject3dScan *source = &obj;
+  ZObject3dScan dsObj;
+  if (dsIntv > 0) {
+    dsObj = obj;
+    dsObj.downsampleMax(dsIntv, dsIntv, dsIntv);
+    source = &dsObj;
+  }
+
+  ZMarchingCube marcher;
+  marcher.setSmooth(m_smooth);
+  marcher.setOffsetAdjust(m_offsetAdjust);
+  marcher.setBlockSize(m_blockSize);
+  marcher.setThreadCount(m_threadCount);
+  ZMesh *mesh = marcher.march(*source);
+
+  if (dsIntv > 0 && mesh != NULL) {
+    ZStackObjectHelper::SetOverSize(mesh);
+  }
+
+  return mesh;
 }
 
 ZMesh* ZMeshFactory::makeMesh(const ZObject3dScanArray &objArray)
@@ -145,34 +183,26 @@ ZMesh* ZMeshFactory::MakeMesh(
 ZMesh* ZMeshFactory::MakeMesh(
     const ZObject3dScan &obj, int dsIntv, int smooth, bool offsetAdjust)
 {
-  if (!obj.hasVoxel()) {
-    return NULL;
-  }
-
-  ZObject3dScan dsObj = obj;
-
-  if (dsIntv == 0) {
-    ZIntCuboid box = dsObj.getBoundBox();
-    dsIntv = misc::getIsoDsIntvFor3DVolume(box, neutube::ONEGIGA / 2, true);
-  }
+  ZMeshFactory factory;
+  factory.setDsIntv(dsIntv);
+  factory.setSmooth(smooth);
+  factory.setOffsetAdjust(offsetAdjust);
 
-  if (dsIntv > 0) {
-    dsObj.downsampleMax(dsIntv, dsIntv, dsIntv);
-  }
-
-  ZStack *stack = dsObj.toStackObjectWithMargin(1, 1);
-  ZMesh *mesh = ZMarchingCube::March(*stack, smooth, offsetAdjust, NULL);
+  return factory.makeMesh(obj);
+}
 
-  if (dsIntv > 0 && mesh != NULL) {
-    ZStackObjectHelper::SetOverSize(mesh);
+int ZMeshFactory::getAutoDsIntv(const ZObject3dScan &obj) const
+{
+  if (m_blockSize > 0) {
+    //Brick-wise marching does not need a stack of the bounding box
+    return misc::getIsoDsIntvFor3DVolume(
+          double(obj.getVoxelNumber()) / (neutube::ONEGIGA / 2), true);
   }
 
-  delete stack;
-
-  return mesh;
+  return misc::getIsoDsIntvFor3DVolume(
+        obj.getBoundBox(), neutube::ONEGIGA / 2, true);
 }
 
-
 ZMesh* ZMeshFactory::MakeFaceMesh(const ZObject3dScan &obj, int dsIntv)
 {
   if (obj.isEmpty()) {
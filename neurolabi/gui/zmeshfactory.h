@@ -15,7 +15,25 @@ public:
   void setSmooth(int smooth);
   void setOffsetAdjust(bool on);
 
+  /*!
+   * \brief Set the brick size of marching cubes
+   *
+   * A body is meshed in bricks of \a size^3 voxels (see ZMarchingCube), so
+   * the memory usage does not depend on its bounding box. A non-positive
+   * size turns off brick-wise meshing.
+   */
+  void setBlockSize(int size);
+  void setThreadCount(int n);
+
   static ZMesh* MakeMesh(const ZObject3dScan &obj);
+
+  /*!
+   * \brief Make a mesh from an object
+   *
+   * The object is downsampled by \a dsIntv before meshing. If \a dsIntv is 0,
+   * it is chosen automatically to limit the size of the object. A negative
+   * \a dsIntv means no downsampling.
+   */
   static ZMesh* MakeMesh(
       const ZObject3dScan &obj, int dsIntv, int smooth, bool offsetAdjust);
   static ZMesh* MakeFaceMesh(const ZObject3dScan &obj, int dsIntv = 0);
@@ -27,10 +45,15 @@ public:
   ZMesh* makeMesh(const ZObject3dScanArray &objArray);
 //  static ZMesh* MakeMesh(const ZObject3dScan &obj, const ZIntPoint &dsIntv, int smooth);
 
+private:
+  int getAutoDsIntv(const ZObject3dScan &obj) const;
+
 private:
   int m_dsIntv = 0;
   int m_smooth = 3;
   bool m_offsetAdjust = true;
+  int m_blockSize = 64;
+  int m_threadCount = 4;
 };
 
 #endif // ZMESHFACTORY_H
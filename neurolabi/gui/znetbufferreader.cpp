@@ -76,6 +76,30 @@ void ZNetBufferReader::readPartial(
   waitForReading();
 }
 
+void ZNetBufferReader::readStream(
+    const QString &url,
+    const std::function<void (const char *, size_t)> &consumer,
+    bool outputingUrl)
+{
+  if (outputingUrl) {
+    qDebug() << url;
+  }
+
+  startReading();
+
+  m_consumer = consumer;
+
+  resetNetworkReply();
+  m_networkReply = getNetworkAccessManager()->get(QNetworkRequest(url));
+  connectNetworkReply();
+  connect(m_networkReply, &QNetworkReply::readyRead,
+          this, &ZNetBufferReader::readBufferStream);
+
+  waitForReading();
+
+  m_consumer = nullptr;
+}
+
 void ZNetBufferReader::readHead(const QString &url)
 {
   startReading();
@@ -191,6 +215,14 @@ void ZNetBufferReader::readBuffer()
   m_buffer.append(m_networkReply->readAll());
 }
 
+void ZNetBufferReader::readBufferStream()
+{
+  QByteArray data = m_networkReply->readAll();
+  if (m_consumer && !data.isEmpty()) {
+    m_consumer(data.constData(), data.size());
+  }
+}
+
 void ZNetBufferReader::readBufferPartial()
 {
   m_buffer.append(m_networkReply->readAll());
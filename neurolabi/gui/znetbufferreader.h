@@ -1,6 +1,8 @@
 #ifndef ZNETBUFFERREADER_H
 #define ZNETBUFFERREADER_H
 
+#include <functional>
+
 #include <QObject>
 #include <QByteArray>
 #include <QNetworkReply>
@@ -19,6 +21,16 @@ public:
 
   void read(const QString &url, bool outputingUrl);
   void readPartial(const QString &url, int maxSize, bool outputingUrl);
+
+  /*!
+   * \brief Read data without buffering
+   *
+   * Each chunk is passed to \a consumer as soon as it arrives and the internal
+   * buffer is left empty.
+   */
+  void readStream(const QString &url,
+                  const std::function<void(const char*, size_t)> &consumer,
+                  bool outputingUrl);
   void readHead(const QString &url);
   bool isReadable(const QString &url);
   bool hasHead(const QString &url);
@@ -53,6 +65,7 @@ private slots:
   void cancelReading();
   void readBuffer();
   void readBufferPartial();
+  void readBufferStream();
   void waitForReading();
   void resetNetworkReply();
   void connectNetworkReply();
@@ -75,6 +88,7 @@ private:
   neutube::EReadStatus m_status = neutube::EReadStatus::NONE;
   int m_statusCode = 0;
   int m_maxSize = 0;
+  std::function<void(const char*, size_t)> m_consumer;
 };
 
 #endif // ZNETBUFFERREADER_H
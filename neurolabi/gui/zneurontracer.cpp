@@ -24,8 +24,17 @@
 #include "zneurontracerconfig.h"
 #include "swc/zswcpruner.h"
 #include "tz_stack_threshold.h"
+#include "tz_geo3d_utils.h"
 #include "zintcuboid.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
 ZNeuronTraceSeeder::ZNeuronTraceSeeder()
 {
 }
@@ -125,11 +134,434 @@ Stack* ZNeuronTraceSeeder::sortSeed(
   return seed_mask;
 }
 
-ZNeuronConstructor::ZNeuronConstructor() : m_connWorkspace(NULL), m_signal(NULL)
+namespace {
+
+/*
+ * Bounding ball of a segment in the space scaled by xzRatio, which is the
+ * space used by Locseg_Chain_Connection_Test().
+ */
+Geo3d_Ball GetScaledBallBound(const Local_Neuroseg *locseg, double xzRatio)
+{
+  Local_Neuroseg seg;
+  Local_Neuroseg_Copy(&seg, locseg);
+  Local_Neuroseg_Scale_Z(&seg, xzRatio);
+  Geo3d_Ball ball;
+  Local_Neuroseg_Ball_Bound(&seg, &ball);
+
+  return ball;
+}
+
+std::vector<Geo3d_Ball> GetSegBall(Locseg_Chain *chain, double xzRatio)
+{
+  std::vector<Geo3d_Ball> ballArray;
+  Locseg_Chain_Iterator_Start(chain, DL_HEAD);
+  Local_Neuroseg *locseg = NULL;
+  while ((locseg = Locseg_Chain_Next_Seg(chain)) != NULL) {
+    ballArray.push_back(GetScaledBallBound(locseg, xzRatio));
+  }
+
+  return ballArray;
+}
+
+/*
+ * Bounding balls of the hook ends of a chain, adjusted in the same way as
+ * Locseg_Chain_Connection_Test().
+ */
+std::vector<Geo3d_Ball> GetHookBall(
+    Locseg_Chain *chain, double xzRatio, int hookSpot)
+{
+  Local_Neuroseg head;
+  Local_Neuroseg tail;
+  Local_Neuroseg_Copy(&head, Locseg_Chain_Head_Seg(chain));
+  Local_Neuroseg_Copy(&tail, Locseg_Chain_Tail_Seg(chain));
+  Flip_Local_Neuroseg(&tail);
+  if (Locseg_Chain_Length(chain) >= 1) {
+    head.seg.h = 2.0;
+    tail.seg.h = 2.0;
+  }
+
+  std::vector<Geo3d_Ball> ballArray;
+  if (hookSpot == 0 || hookSpot == -1) {
+    ballArray.push_back(GetScaledBallBound(&head, xzRatio));
+  }
+  if (hookSpot == 1 || hookSpot == -1) {
+    ballArray.push_back(GetScaledBallBound(&tail, xzRatio));
+  }
+
+  return ballArray;
+}
+
+/*
+ * The connection test uses the ball distance as the lower bound of the
+ * distance between a hook end and a segment, so a hook ball farther than
+ * distThre from all segment balls of a chain never connects to the chain.
+ * The small tolerance guards against rounding errors.
+ */
+bool IsBallNear(const Geo3d_Ball &ball1, const Geo3d_Ball &ball2,
+                double distThre)
+{
+  return Geo3d_Dist(ball1.center[0], ball1.center[1], ball1.center[2],
+                    ball2.center[0], ball2.center[1], ball2.center[2]) -
+      ball1.r - ball2.r <= distThre + 1e-6;
+}
+
+/*
+ * Interpolation of a hook-loop connection, which inserts a segment into the
+ * loop chain at the connection point.
+ */
+struct ConnInterpolation {
+  bool pending = false;
+  double pos[3];
+  double ort[3];
+};
+
+double GetXzRatio(const Connection_Test_Workspace *ws)
+{
+  if (ws->resolution[0] != ws->resolution[2]) {
+    return ws->resolution[0] / ws->resolution[2];
+  }
+
+  return 1.0;
+}
+
+/*
+ * Spatial index of the segment balls and hook balls of chains, which finds
+ * the chain pairs that can pass the distance threshold of the connection
+ * test. A chain can be indexed again after it is modified. Its old balls are
+ * kept, which only adds candidates.
+ */
+class ChainNeighborIndex {
+public:
+  ChainNeighborIndex(const std::vector<Locseg_Chain*> &chainArray,
+                     const Connection_Test_Workspace *ws) :
+    m_chainArray(chainArray), m_xzRatio(GetXzRatio(ws)),
+    m_distThre(ws->dist_thre), m_hookSpot(ws->hook_spot),
+    m_cellSize(std::max(1.0, ws->dist_thre)) {
+    for (size_t i = 0; i < chainArray.size(); ++i) {
+      update(i);
+    }
+  }
+
+  void update(int index) {
+    Locseg_Chain *chain = m_chainArray[index];
+    if (Locseg_Chain_Is_Empty(chain)) {
+      return;
+    }
+
+    for (const Geo3d_Ball &ball : GetSegBall(chain, m_xzRatio)) {
+      addBall(ball, 0.0, index, &m_segBallArray, &m_segCellMap);
+    }
+    for (const Geo3d_Ball &ball : GetHookBall(chain, m_xzRatio, m_hookSpot)) {
+      addBall(ball, m_distThre, index, &m_hookBallArray, &m_hookCellMap);
+    }
+  }
+
+  //Sorted indices of the chains that the hooks of a chain can connect to
+  std::vector<int> findLoopChain(int index) const {
+    std::vector<int> hitChain;
+    Locseg_Chain *chain = m_chainArray[index];
+    if (!Locseg_Chain_Is_Empty(chain)) {
+      for (const Geo3d_Ball &hook :
+           GetHookBall(chain, m_xzRatio, m_hookSpot)) {
+        findBall(hook, m_distThre, m_segBallArray, m_segCellMap, &hitChain);
+      }
+    }
+
+    return normalize(hitChain, index);
+  }
+
+  //Sorted indices of the chains whose hooks can connect to a chain
+  std::vector<int> findHookChain(int index) const {
+    std::vector<int> hitChain;
+    Locseg_Chain *chain = m_chainArray[index];
+    if (!Locseg_Chain_Is_Empty(chain)) {
+      for (const Geo3d_Ball &ball : GetSegBall(chain, m_xzRatio)) {
+        findBall(ball, 0.0, m_hookBallArray, m_hookCellMap, &hitChain);
+      }
+    }
+
+    return normalize(hitChain, index);
+  }
+
+private:
+  typedef std::vector<std::pair<Geo3d_Ball, int> > BallArray;
+  typedef std::unordered_map<int64_t, std::vector<int> > CellMap;
+
+  int64_t toCell(double v) const {
+    return int64_t(std::floor(v / m_cellSize));
+  }
+
+  static int64_t CellKey(int64_t x, int64_t y, int64_t z) {
+    return ((x & 0x1FFFFF) << 42) | ((y & 0x1FFFFF) << 21) | (z & 0x1FFFFF);
+  }
+
+  template <typename F>
+  void forEachCell(const Geo3d_Ball &ball, double margin, F f) const {
+    double range = ball.r + margin;
+    int64_t x0 = toCell(ball.center[0] - range);
+    int64_t y0 = toCell(ball.center[1] - range);
+    int64_t z0 = toCell(ball.center[2] - range);
+    int64_t x1 = toCell(ball.center[0] + range);
+    int64_t y1 = toCell(ball.center[1] + range);
+    int64_t z1 = toCell(ball.center[2] + range);
+    for (int64_t z = z0; z <= z1; ++z) {
+      for (int64_t y = y0; y <= y1; ++y) {
+        for (int64_t x = x0; x <= x1; ++x) {
+          f(CellKey(x, y, z));
+        }
+      }
+    }
+  }
+
+  //A ball is registered in all cells overlapped by its box plus the margin
+  void addBall(const Geo3d_Ball &ball, double margin, int chainIndex,
+               BallArray *ballArray, CellMap *cellMap) {
+    int k = ballArray->size();
+    ballArray->push_back(std::make_pair(ball, chainIndex));
+    forEachCell(ball, margin, [&](int64_t key) {
+      (*cellMap)[key].push_back(k);
+    });
+  }
+
+  void findBall(const Geo3d_Ball &ball, double margin,
+                const BallArray &ballArray, const CellMap &cellMap,
+                std::vector<int> *hitChain) const {
+    forEachCell(ball, margin, [&](int64_t key) {
+      auto iter = cellMap.find(key);
+      if (iter != cellMap.end()) {
+        for (int k : iter->second) {
+          if (IsBallNear(ball, ballArray[k].first, m_distThre)) {
+            hitChain->push_back(ballArray[k].second);
+          }
+        }
+      }
+    });
+  }
+
+  static std::vector<int> normalize(std::vector<int> hitChain, int index) {
+    std::sort(hitChain.begin(), hitChain.end());
+    hitChain.erase(std::unique(hitChain.begin(), hitChain.end()),
+                   hitChain.end());
+    hitChain.erase(std::remove(hitChain.begin(), hitChain.end(), index),
+                   hitChain.end());
+
+    return hitChain;
+  }
+
+private:
+  const std::vector<Locseg_Chain*> &m_chainArray;
+  double m_xzRatio;
+  double m_distThre;
+  int m_hookSpot;
+  double m_cellSize;
+  BallArray m_segBallArray;
+  BallArray m_hookBallArray;
+  CellMap m_segCellMap;
+  CellMap m_hookCellMap;
+};
+
+}
+
+ZNeuronConstructor::ZNeuronConstructor() : m_connWorkspace(NULL),
+  m_signal(NULL), m_threadCount(1)
 {
 
 }
 
+Neuron_Structure* ZNeuronConstructor::buildNeuronStructure(
+    Neuron_Component *comp, int n, double zscale)
+{
+  std::vector<Locseg_Chain*> chainArray(n);
+  for (int i = 0; i < n; ++i) {
+    chainArray[i] = NEUROCOMP_LOCSEG_CHAIN(comp + i);
+  }
+
+  ChainNeighborIndex neighborIndex(chainArray, m_connWorkspace);
+  std::vector<std::pair<int, int> > pairArray;
+  for (int i = 0; i < n; ++i) {
+    for (int j : neighborIndex.findLoopChain(i)) {
+      pairArray.push_back(std::make_pair(i, j));
+    }
+  }
+  std::cout << pairArray.size() << " candidate connections in " << n
+            << " chains" << std::endl;
+
+  /* Test the candidates in parallel on the original chains. The test moves
+   * chain iterators, so each thread works on its own copies of the chains.
+   * The interpolation of the test is done on a temporary copy of the loop
+   * chain to obtain the connection mode. The chain is modified later. */
+  Connection_Test_Workspace ws = *m_connWorkspace;
+  ws.interpolate = FALSE;
+
+  std::vector<Neurocomp_Conn> connArray(pairArray.size(), Neurocomp_Conn());
+  std::vector<char> connected(pairArray.size(), 0);
+  std::vector<ConnInterpolation> interpolationArray(pairArray.size());
+  std::atomic<size_t> nextPair(0);
+  auto testPair = [&](const std::vector<Locseg_Chain*> &chain) {
+    for (size_t k = nextPair++; k < pairArray.size(); k = nextPair++) {
+      Neurocomp_Conn &conn = connArray[k];
+      conn.mode = NEUROCOMP_CONN_HL;
+      Locseg_Chain *loop = chain[pairArray[k].second];
+      connected[k] = Locseg_Chain_Connection_Test(
+            chain[pairArray[k].first], loop, m_signal, zscale, &conn,
+            &ws) == TRUE;
+      if (connected[k]) {
+        int loopLength = Locseg_Chain_Length(loop);
+        if (m_connWorkspace->interpolate == TRUE &&
+            conn.mode == NEUROCOMP_CONN_HL) {
+          ConnInterpolation &interpolation = interpolationArray[k];
+          std::copy(conn.pos, conn.pos + 3, interpolation.pos);
+          std::copy(conn.ort, conn.ort + 3, interpolation.ort);
+
+          Locseg_Chain *loopCopy = Copy_Locseg_Chain(loop);
+          int index = Locseg_Chain_Interpolate_L(
+                loopCopy, conn.pos, conn.ort, conn.pos);
+          if (index >= 0) {
+            conn.info[1] = index;
+            interpolation.pending = true;
+            ++loopLength;
+          } else if (conn.info[1] == 0) {
+            conn.mode = NEUROCOMP_CONN_LINK;
+            conn.info[1] = 0;
+          } else if (conn.info[1] == loopLength - 1) {
+            conn.mode = NEUROCOMP_CONN_LINK;
+            conn.info[1] = 1;
+          }
+          Kill_Locseg_Chain(loopCopy);
+        }
+        Neurocomp_Conn_Translate_Mode(loopLength, &conn);
+      }
+    }
+  };
+
+  int threadCount = std::min(m_threadCount, int(pairArray.size()));
+  if (threadCount <= 1) {
+    testPair(chainArray);
+  } else {
+    std::vector<std::vector<Locseg_Chain*> > chainCopy(threadCount);
+    for (std::vector<Locseg_Chain*> &chain : chainCopy) {
+      for (Locseg_Chain *src : chainArray) {
+        chain.push_back(Copy_Locseg_Chain(src));
+      }
+    }
+
+    std::vector<std::thread> threadArray;
+    for (int t = 0; t < threadCount; ++t) {
+      threadArray.emplace_back(testPair, std::cref(chainCopy[t]));
+    }
+    for (std::thread &t : threadArray) {
+      t.join();
+    }
+
+    for (std::vector<Locseg_Chain*> &chain : chainCopy) {
+      for (Locseg_Chain *c : chain) {
+        Kill_Locseg_Chain(c);
+      }
+    }
+  }
+
+  /* Build the graph in the same order as Locseg_Chain_Comp_Neurostruct(),
+   * where an interpolation changes the loop chain for the following tests.
+   * A result from the original chains is used only if neither chain has
+   * been modified. Otherwise the pair is tested again on the current chains,
+   * and so are the new candidates of a modified chain. Pairs that are not
+   * candidates would fail the test anyway. */
+  Neuron_Structure *ns = New_Neuron_Structure();
+  Neuron_Structure_Set_Component_Array(ns, comp, n);
+
+  std::vector<char> modified(n, 0);
+  std::set<std::pair<int, int> > extraPairSet;
+  size_t pairIndex = 0;
+  Graph_Workspace *gw = New_Graph_Workspace();
+  while (pairIndex < pairArray.size() || !extraPairSet.empty()) {
+    std::pair<int, int> pair;
+    int k = -1;
+    bool extraFirst = !extraPairSet.empty() &&
+        (pairIndex >= pairArray.size() ||
+         *extraPairSet.begin() < pairArray[pairIndex]);
+    if (extraFirst) {
+      pair = *extraPairSet.begin();
+      extraPairSet.erase(extraPairSet.begin());
+    } else {
+      k = pairIndex++;
+      pair = pairArray[k];
+      extraPairSet.erase(pair);
+    }
+
+    int i = pair.first;
+    int j = pair.second;
+    Neurocomp_Conn conn;
+    bool isConnected = false;
+    bool loopModified = false;
+    if (k >= 0 && !modified[i] && !modified[j]) {
+      isConnected = connected[k];
+      conn = connArray[k];
+      if (isConnected && interpolationArray[k].pending) {
+        double newPos[3];
+        Locseg_Chain_Interpolate_L(
+              chainArray[j], interpolationArray[k].pos,
+              interpolationArray[k].ort, newPos);
+        loopModified = true;
+      }
+    } else {
+      conn.mode = NEUROCOMP_CONN_HL;
+      int loopLength = Locseg_Chain_Length(chainArray[j]);
+      isConnected = Locseg_Chain_Connection_Test(
+            chainArray[i], chainArray[j], m_signal, zscale, &conn,
+            m_connWorkspace) == TRUE;
+      if (isConnected) {
+        loopModified = (Locseg_Chain_Length(chainArray[j]) != loopLength);
+        Neurocomp_Conn_Translate_Mode(Locseg_Chain_Length(chainArray[j]),
+                                      &conn);
+      }
+    }
+
+    if (loopModified) {
+      modified[j] = 1;
+      neighborIndex.update(j);
+      for (int a : neighborIndex.findHookChain(j)) {
+        if (std::make_pair(a, j) > pair) {
+          extraPairSet.insert(std::make_pair(a, j));
+        }
+      }
+      for (int b : neighborIndex.findLoopChain(j)) {
+        if (std::make_pair(j, b) > pair) {
+          extraPairSet.insert(std::make_pair(j, b));
+        }
+      }
+    }
+
+    if (!isConnected) {
+      continue;
+    }
+
+    bool connExisted = false;
+    if (i > j && ns->graph->nedge > 0) {
+      int edgeIndex = Graph_Edge_Index(j, i, gw);
+      if (edgeIndex >= 0) {
+        if (conn.mode == NEUROCOMP_CONN_LINK) {
+          connExisted = (ns->conn[edgeIndex].info[0] == conn.info[1]);
+        } else if (ns->conn[edgeIndex].mode == NEUROCOMP_CONN_LINK) {
+          connExisted = (ns->conn[edgeIndex].info[1] == conn.info[0]);
+        }
+        if (connExisted && ns->conn[edgeIndex].cost > conn.cost) {
+          Neurocomp_Conn_Copy(ns->conn + edgeIndex, &conn);
+          ns->graph->edges[edgeIndex][0] = i;
+          ns->graph->edges[edgeIndex][1] = j;
+          Graph_Update_Edge_Table(ns->graph, gw);
+        }
+      }
+    }
+
+    if (!connExisted) {
+      Neuron_Structure_Add_Conn(ns, i, j, &conn);
+      Graph_Expand_Edge_Table(i, j, ns->graph->nedge - 1, gw);
+    }
+  }
+  Kill_Graph_Workspace(gw);
+
+  return ns;
+}
 
 ZSwcTree *ZNeuronConstructor::reconstruct(
     std::vector<Locseg_Chain*> &chainArray)
@@ -151,8 +583,8 @@ ZSwcTree *ZNeuronConstructor::reconstruct(
     /* reconstruct neuron */
     /* alloc <ns> */
     double zscale = 1.0;
-    Neuron_Structure *ns = Locseg_Chain_Comp_Neurostruct(
-          neuronComponent, chain_number, m_signal, zscale, m_connWorkspace);
+    Neuron_Structure *ns = buildNeuronStructure(
+          neuronComponent, chain_number, zscale);
 
     Process_Neuron_Structure(ns);
 
@@ -219,6 +651,8 @@ void ZNeuronTracer::init()
 
   m_estimatingRadius = true;
 
+  m_traceTileSize = 0;
+
   config();
 }
 
@@ -235,6 +669,8 @@ void ZNeuronTracer::config()
   m_enhancingMask = config.enhancingMask();
   m_seedingMethod = config.getSeedMethod();
   m_recover = config.getRecoverLevel();
+  m_threadCount = config.getThreadCount();
+  m_screeningSeed = config.screeningSeed();
 
   if (m_traceWorkspace != NULL) {
     m_traceWorkspace->refit = config.isRefit();
@@ -958,6 +1394,10 @@ std::vector<Locseg_Chain*> ZNeuronTracer::trace(const Stack *stack,
 
 //  m_traceWorkspace->min_chain_length = 15.0;
 
+  if ((m_threadCount > 1 || m_traceTileSize > 0) && !locsegArray.empty()) {
+    return traceParallel(stack, locsegArray, values);
+  }
+
   int nchain;
   Locseg_Chain **chain =
       Trace_Locseg_S(stack, 1.0, &(locsegArray[0]), &(values[0]),
@@ -974,6 +1414,295 @@ std::vector<Locseg_Chain*> ZNeuronTracer::trace(const Stack *stack,
   return chainArray;
 }
 
+namespace {
+
+const int TRACE_TILE_MARGIN = 32;
+const int DEFAULT_TRACE_TILE_SIZE = 256;
+
+/* Only nearby chains are tested for connection, so the shortest path test
+ * scales with the number of candidate pairs instead of the square of the
+ * chain number. It is still turned off for extremely dense traces. */
+const size_t MAX_SP_TEST_CHAIN_NUMBER = 5000;
+
+bool IsSegMasked(const Local_Neuroseg *locseg, const Stack *mask)
+{
+  double center[3];
+  Local_Neuroseg_Center(locseg, center);
+  int x = iround(center[0]);
+  int y = iround(center[1]);
+  int z = iround(center[2]);
+
+  if (x >= 0 && y >= 0 && z >= 0 && x < C_Stack::width(mask) &&
+      y < C_Stack::height(mask) && z < C_Stack::depth(mask)) {
+    return Stack_Pixel(mask, x, y, z, 0) > 0.0;
+  }
+
+  return false;
+}
+
+}
+
+std::vector<Locseg_Chain*> ZNeuronTracer::traceTile(
+    const Stack *stack, const ZIntCuboid &box,
+    std::vector<Local_Neuroseg> &locsegArray, std::vector<double> &values)
+{
+  const ZIntPoint &corner = box.getFirstCorner();
+  double offset[3] = { double(corner.getX()), double(corner.getY()),
+                       double(corner.getZ()) };
+  int width = box.getWidth();
+  int height = box.getHeight();
+  int depth = box.getDepth();
+
+  Stack *signal = C_Stack::crop(stack, corner.getX(), corner.getY(),
+                                corner.getZ(), width, height, depth, NULL);
+
+  //The tile workspace shares parameters with the main workspace but owns
+  //its stacks, which are in the coordinates of the tile.
+  Trace_Workspace tw = *m_traceWorkspace;
+  tw.chain_id = 0;
+  tw.canvas = NULL;
+  tw.canvas_updating = FALSE;
+  tw.swc_mask = NULL;
+  tw.save_path[0] = '\0';
+
+  tw.sup_stack = NULL;
+  if (m_traceWorkspace->sup_stack != NULL) {
+    tw.sup_stack = C_Stack::crop(
+          m_traceWorkspace->sup_stack, corner.getX(), corner.getY(),
+          corner.getZ(), width, height, depth, NULL);
+  }
+
+  tw.trace_mask = NULL;
+  if (m_traceWorkspace->trace_mask != NULL) {
+    tw.trace_mask = C_Stack::crop(
+          m_traceWorkspace->trace_mask, corner.getX(), corner.getY(),
+          corner.getZ(), width, height, depth, NULL);
+  } else if (tw.trace_mask_updating == TRUE) {
+    tw.trace_mask = C_Stack::make(GREY16, width, height, depth);
+    C_Stack::setZero(tw.trace_mask);
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    if (tw.trace_range[i] >= 0.0) {
+      tw.trace_range[i] = std::max(0.0, tw.trace_range[i] - offset[i]);
+    }
+    if (tw.trace_range[i + 3] >= 0.0) {
+      tw.trace_range[i + 3] = std::max(0.0, tw.trace_range[i + 3] - offset[i]);
+    }
+  }
+
+  Locseg_Fit_Workspace fws;
+  Locseg_Score_Workspace sws;
+  Stack *fitMask = NULL;
+  if (m_traceWorkspace->fit_workspace != NULL) {
+    Locseg_Fit_Workspace_Copy(
+          &fws, (Locseg_Fit_Workspace*) m_traceWorkspace->fit_workspace);
+    if (fws.sws != NULL) {
+      Locseg_Score_Workspace_Copy(&sws, fws.sws);
+      fws.sws = &sws;
+      if (sws.mask != NULL) {
+        if (sws.mask == m_traceWorkspace->trace_mask) {
+          sws.mask = tw.trace_mask;
+        } else {
+          fitMask = C_Stack::crop(sws.mask, corner.getX(), corner.getY(),
+                                  corner.getZ(), width, height, depth, NULL);
+          sws.mask = fitMask;
+        }
+      }
+    }
+    tw.fit_workspace = &fws;
+  }
+
+  double tileOffset[3] = { -offset[0], -offset[1], -offset[2] };
+  for (Local_Neuroseg &locseg : locsegArray) {
+    Local_Neuroseg_Translate(&locseg, tileOffset);
+  }
+
+  int nchain = 0;
+  Locseg_Chain **chain =
+      Trace_Locseg_S(signal, 1.0, &(locsegArray[0]), &(values[0]),
+      locsegArray.size(), &tw, &nchain);
+
+  std::vector<Locseg_Chain*> chainArray(nchain);
+  for (int i = 0; i < nchain; ++i) {
+    chainArray[i] = chain[i];
+    Locseg_Chain_Translate(chainArray[i], offset);
+  }
+  free(chain);
+
+  C_Stack::kill(signal);
+  if (tw.sup_stack != NULL) {
+    C_Stack::kill(tw.sup_stack);
+  }
+  if (tw.trace_mask != NULL) {
+    C_Stack::kill(tw.trace_mask);
+  }
+  if (fitMask != NULL) {
+    C_Stack::kill(fitMask);
+  }
+
+  return chainArray;
+}
+
+std::vector<Locseg_Chain*> ZNeuronTracer::mergeTileChain(
+    const Stack *stack, std::vector<std::vector<Locseg_Chain*> > &tileChainArray)
+{
+  std::vector<Locseg_Chain*> candidateArray;
+  for (std::vector<Locseg_Chain*> &chainArray : tileChainArray) {
+    candidateArray.insert(
+          candidateArray.end(), chainArray.begin(), chainArray.end());
+    chainArray.clear();
+  }
+
+  //Longer chains take priority. Ties keep the tile order.
+  std::vector<double> lengthArray(candidateArray.size());
+  for (size_t i = 0; i < candidateArray.size(); ++i) {
+    lengthArray[i] = Locseg_Chain_Geolen(candidateArray[i]);
+  }
+  std::vector<size_t> orderArray(candidateArray.size());
+  std::iota(orderArray.begin(), orderArray.end(), 0);
+  std::stable_sort(orderArray.begin(), orderArray.end(),
+                   [&](size_t i1, size_t i2) {
+    return lengthArray[i1] > lengthArray[i2]; });
+
+  bool updatingMask = (m_traceWorkspace->trace_mask_updating == TRUE);
+  Stack *mask = m_traceWorkspace->trace_mask;
+  if (mask == NULL) {
+    mask = C_Stack::make(GREY16, C_Stack::width(stack),
+                         C_Stack::height(stack), C_Stack::depth(stack));
+    C_Stack::setZero(mask);
+    if (updatingMask) {
+      m_traceWorkspace->trace_mask = mask;
+    }
+  }
+
+  Locseg_Label_Workspace *ws = New_Locseg_Label_Workspace();
+  ws->signal = const_cast<Stack*>(stack);
+
+  //A chain overlapping the accepted ones is trimmed at the ends and dropped
+  //if it is still mostly covered, as a sequential tracing would stop there.
+  std::vector<Locseg_Chain*> chainArray;
+  for (size_t index : orderArray) {
+    Locseg_Chain *chain = candidateArray[index];
+    while (!Locseg_Chain_Is_Empty(chain) &&
+           IsSegMasked(Locseg_Chain_Head_Seg(chain), mask)) {
+      Locseg_Chain_Remove_End(chain, DL_HEAD);
+    }
+    while (!Locseg_Chain_Is_Empty(chain) &&
+           IsSegMasked(Locseg_Chain_Tail_Seg(chain), mask)) {
+      Locseg_Chain_Remove_End(chain, DL_TAIL);
+    }
+
+    int length = Locseg_Chain_Length(chain);
+    int maskedCount = 0;
+    Local_Neuroseg *locseg = NULL;
+    Locseg_Chain_Iterator_Start(chain, DL_HEAD);
+    while ((locseg = Locseg_Chain_Next_Seg(chain)) != NULL) {
+      if (IsSegMasked(locseg, mask)) {
+        ++maskedCount;
+      }
+    }
+
+    if (length > 0 && maskedCount * 2 <= length) {
+      ws->sratio = 1.5;
+      ws->sdiff = 0.0;
+      ws->option = 1;
+      ws->value = m_traceWorkspace->chain_id + 1;
+      ws->flag = 0;
+      Locseg_Chain_Label_W(chain, mask, 1.0, 0, length - 1, ws);
+      m_traceWorkspace->chain_id++;
+      chainArray.push_back(chain);
+    } else {
+      Kill_Locseg_Chain(chain);
+    }
+  }
+
+  ws->signal = NULL;
+  Kill_Locseg_Label_Workspace(ws);
+
+  if (mask != m_traceWorkspace->trace_mask) {
+    C_Stack::kill(mask);
+  }
+
+  return chainArray;
+}
+
+std::vector<Locseg_Chain*> ZNeuronTracer::traceParallel(
+    const Stack *stack, std::vector<Local_Neuroseg> &locsegArray,
+    std::vector<double> &values)
+{
+  //The width limit is decided by all seeds as in sequential tracing
+  if (m_traceWorkspace->dyvar[0] < 0.0) {
+    double maxR = Local_Neuroseg_Array_Maxr(
+          &(locsegArray[0]), locsegArray.size()) * 3.0;
+    m_traceWorkspace->dyvar[0] = std::max(maxR, 400.0);
+  }
+
+  //Tiles do not depend on the thread number to make the result reproducible
+  int width = C_Stack::width(stack);
+  int height = C_Stack::height(stack);
+  int depth = C_Stack::depth(stack);
+  int tileSize = DEFAULT_TRACE_TILE_SIZE;
+  if (m_traceTileSize > 0) {
+    tileSize = std::max(TRACE_TILE_MARGIN, m_traceTileSize);
+  }
+  int tileNx = (width + tileSize - 1) / tileSize;
+  int tileNy = (height + tileSize - 1) / tileSize;
+
+  std::vector<std::vector<size_t> > tileSeedArray(tileNx * tileNy);
+  for (size_t i = 0; i < locsegArray.size(); ++i) {
+    double center[3];
+    Local_Neuroseg_Center(&(locsegArray[i]), center);
+    int ix = std::min(std::max(int(center[0]) / tileSize, 0), tileNx - 1);
+    int iy = std::min(std::max(int(center[1]) / tileSize, 0), tileNy - 1);
+    tileSeedArray[iy * tileNx + ix].push_back(i);
+  }
+
+  std::cout << "Tracing " << locsegArray.size() << " seeds in "
+            << tileSeedArray.size() << " tiles ..." << std::endl;
+
+  std::vector<std::vector<Locseg_Chain*> > tileChainArray(
+        tileSeedArray.size());
+  std::atomic<size_t> tileIndex(0);
+  auto traceNextTile = [&]() {
+    for (size_t t = tileIndex++; t < tileSeedArray.size(); t = tileIndex++) {
+      const std::vector<size_t> &seedIndexArray = tileSeedArray[t];
+      if (!seedIndexArray.empty()) {
+        std::vector<Local_Neuroseg> tileLocsegArray;
+        std::vector<double> tileValueArray;
+        for (size_t i : seedIndexArray) {
+          tileLocsegArray.push_back(locsegArray[i]);
+          tileValueArray.push_back(values[i]);
+        }
+
+        int x0 = int(t % tileNx) * tileSize;
+        int y0 = int(t / tileNx) * tileSize;
+        ZIntCuboid box(
+              std::max(0, x0 - TRACE_TILE_MARGIN),
+              std::max(0, y0 - TRACE_TILE_MARGIN), 0,
+              std::min(width - 1, x0 + tileSize - 1 + TRACE_TILE_MARGIN),
+              std::min(height - 1, y0 + tileSize - 1 + TRACE_TILE_MARGIN),
+              depth - 1);
+        tileChainArray[t] = traceTile(
+              stack, box, tileLocsegArray, tileValueArray);
+      }
+    }
+  };
+
+  //The calling thread traces tiles too
+  int threadCount = std::min(m_threadCount, int(tileSeedArray.size()));
+  std::vector<std::thread> threadArray;
+  for (int i = 1; i < threadCount; ++i) {
+    threadArray.emplace_back(traceNextTile);
+  }
+  traceNextTile();
+  for (std::thread &t : threadArray) {
+    t.join();
+  }
+
+  return mergeTileChain(stack, tileChainArray);
+}
+
 void ZNeuronTracer::clearBuffer()
 {
   if (m_mask != NULL) {
@@ -1131,10 +1860,12 @@ Stack* ZNeuronTracer::computeSeedMask(Stack *stack)
 
   int minSeedSize = 0;
 
-  if (seedPointArray->size > 15000) {
-    minSeedSize = 125;
-  } else if (seedPointArray->size > 5000) {
-    minSeedSize = 64;
+  if (m_screeningSeed) {
+    if (seedPointArray->size > 15000) {
+      minSeedSize = 125;
+    } else if (seedPointArray->size > 5000) {
+      minSeedSize = 64;
+    }
   }
 
   if (minSeedSize > 0) {
@@ -1423,11 +2154,12 @@ ZSwcTree* ZNeuronTracer::trace(Stack *signal, bool doResampleAfterTracing)
   ZNeuronConstructor constructor;
   constructor.setWorkspace(m_connWorkspace);
   constructor.setSignal(stack);
+  constructor.setThreadCount(m_threadCount);
 
   //Create neuron structure
 
   BOOL oldSpTest = m_connWorkspace->sp_test;
-  if (chainArray.size() > 500) {
+  if (chainArray.size() > MAX_SP_TEST_CHAIN_NUMBER) {
     std::cout << "Too many chains: " << chainArray.size() << std::endl;
     std::cout << "Turn off shortest path test" << std::endl;
     m_connWorkspace->sp_test = FALSE;
@@ -1765,6 +2497,16 @@ void ZNeuronTracer::loadJsonObject(const ZJsonObject &obj)
   if (obj.hasKey(key)) {
     m_usingEdgePath = ZJsonParser::booleanValue(obj[key]);
   }
+
+  key = ZNeuronTracerConfig::getThreadCountKey();
+  if (obj.hasKey(key)) {
+    m_threadCount = ZJsonParser::integerValue(obj[key]);
+  }
+
+  key = ZNeuronTracerConfig::getSeedScreeningKey();
+  if (obj.hasKey(key)) {
+    m_screeningSeed = ZJsonParser::booleanValue(obj[key]);
+  }
 }
 
 void ZNeuronTracer::test()
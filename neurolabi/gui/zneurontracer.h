@@ -3,6 +3,7 @@
 
 #include <map>
 #include <vector>
+#include <utility>
 
 #include "zswcpath.h"
 #include "tz_trace_defs.h"
@@ -49,11 +50,37 @@ public:
     m_signal = signal;
   }
 
+  /*!
+   * \brief Set the number of threads for connection tests
+   *
+   * Chain pairs are first screened by a spatial index of the chain segments,
+   * so only the pairs that can pass the distance threshold are tested. The
+   * tests, including the shortest path test, run on \a n threads when
+   * \a n > 1. They are tested against the original chains, and a pair is
+   * tested again when an earlier connection has interpolated one of its
+   * chains, so the result is the same as testing all pairs sequentially for
+   * any \a n.
+   */
+  void setThreadCount(int n) { m_threadCount = n; }
+  int getThreadCount() const { return m_threadCount; }
+
   ZSwcTree *reconstruct(std::vector<Locseg_Chain*> &chainArray);
 
+  /*!
+   * \brief Build the connection graph of chain components
+   *
+   * The result is the same as Locseg_Chain_Comp_Neurostruct() with the
+   * workspace and signal of the constructor. The chains of \a comp are
+   * interpolated at hook-loop connections as in that function. The caller
+   * owns the returned structure, which refers to \a comp.
+   */
+  Neuron_Structure* buildNeuronStructure(
+      Neuron_Component *comp, int n, double zscale);
+
 private:
   Connection_Test_Workspace *m_connWorkspace;
   Stack *m_signal;
+  int m_threadCount;
 };
 
 
@@ -159,12 +186,52 @@ public:
   void setGrayOffset(double v) { m_greyOffset = v; }
   void setEstimatingRadius(bool on) { m_estimatingRadius = on; }
 
+  /*!
+   * \brief Set the number of threads for automatic tracing
+   *
+   * When \a n > 1, the seeds are partitioned into tiles of the XY plane,
+   * which are traced concurrently, each with its own workspace and trace
+   * mask. The chains are then merged in a deterministic order, so the result
+   * does not depend on \a n or thread scheduling. \a n <= 1 traces all seeds
+   * sequentially in one workspace unless a tile size is set.
+   */
+  void setThreadCount(int n) { m_threadCount = n; }
+  int getThreadCount() const { return m_threadCount; }
+
+  /*!
+   * \brief Set the tile size for parallel tracing
+   *
+   * A tile is traced in the signal cropped to the tile plus a margin, which
+   * allows chains to grow into the neighboring tiles. With \a size > 0, the
+   * seeds are traced in tiles for any thread count, including 1, and the
+   * chains are the same for all thread counts. With \a size <= 0 (default),
+   * tiles of 256 pixels are used only when the thread count is above 1.
+   */
+  void setTraceTileSize(int size) { m_traceTileSize = size; }
+
+  /*!
+   * \brief Turn on/off removing small seed regions when there are too many
+   *        seeds.
+   */
+  void setSeedScreening(bool on) { m_screeningSeed = on; }
+
 public:
   std::vector<ZWeightedPoint> computeSeedPosition(const Stack *stack);
   std::vector<ZWeightedPoint> computeSeedPosition(const ZStack *stack);
   std::vector<ZWeightedPoint> computeSeedPosition();
   ZSwcTree *computeInitialTrace(const Stack *stack);
 
+  /*!
+   * \brief Trace chains from sorted seeds
+   *
+   * \a locsegArray and \a values are the seeds and their scores, usually
+   * from ZNeuronTraceSeeder::sortSeed(). The trace workspace must have been
+   * initialized. The caller owns the returned chains.
+   */
+  std::vector<Locseg_Chain*> trace(const Stack *stack,
+                                   std::vector<Local_Neuroseg> &locsegArray,
+                                   std::vector<double> &values);
+
   int getRecoverLevel() const;
   void setRecoverLevel(int level);
 
@@ -189,9 +256,15 @@ private:
 
   ZSwcTree *reconstructSwc(const Stack *stack,
                            std::vector<Locseg_Chain*> &chainArray);
-  std::vector<Locseg_Chain*> trace(const Stack *stack,
-                                   std::vector<Local_Neuroseg> &locsegArray,
-                                   std::vector<double> &values);
+  std::vector<Locseg_Chain*> traceParallel(
+      const Stack *stack, std::vector<Local_Neuroseg> &locsegArray,
+      std::vector<double> &values);
+  std::vector<Locseg_Chain*> traceTile(
+      const Stack *stack, const ZIntCuboid &box,
+      std::vector<Local_Neuroseg> &locsegArray, std::vector<double> &values);
+  std::vector<Locseg_Chain*> mergeTileChain(
+      const Stack *stack,
+      std::vector<std::vector<Locseg_Chain*> > &tileChainArray);
   std::vector<Locseg_Chain*> recover(const Stack *stack);
 
   std::vector<Locseg_Chain*> screenChain(const Stack *stack,
@@ -235,6 +308,10 @@ private:
   double m_greyOffset;
   bool m_estimatingRadius;
 
+  int m_threadCount;
+  int m_traceTileSize;
+  bool m_screeningSeed;
+
   /*
   static const char *m_levelKey;
   static const char *m_minimalScoreKey;
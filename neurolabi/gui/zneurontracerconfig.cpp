@@ -23,6 +23,8 @@ const char *ZNeuronTracerConfig::m_seedMethodKey = "seedMethod";
 const char *ZNeuronTracerConfig::m_recoverKey = "recover";
 const char *ZNeuronTracerConfig::m_enhanceLineKey = "enhanceMask";
 const char *ZNeuronTracerConfig::m_maxEucDistKey = "maxEucDist";
+const char *ZNeuronTracerConfig::m_threadCountKey = "threadCount";
+const char *ZNeuronTracerConfig::m_seedScreeningKey = "seedScreening";
 
 
 ZNeuronTracerConfig::ZNeuronTracerConfig()
@@ -45,6 +47,8 @@ void ZNeuronTracerConfig::init()
   m_seedMethod = 1;
   m_recover = 2;
   m_maxEucDist = 20;
+  m_threadCount = 1;
+  m_screeningSeed = true;
 }
 
 void ZNeuronTracerConfig::print() const
@@ -63,6 +67,8 @@ void ZNeuronTracerConfig::print() const
   std::cout << "Seeding method: " << m_seedMethod << std::endl;
   std::cout << "Recovering: " << m_recover << std::endl;
   std::cout << "Maximal gap: " << m_maxEucDist << std::endl;
+  std::cout << "Thread count: " << m_threadCount << std::endl;
+  std::cout << "Seed screening: " << m_screeningSeed << std::endl;
 
   std::cout << "Levels: " << std::endl;
   for (std::map<int, ZJsonObject>::const_iterator iter = m_levelMap.begin();
@@ -185,6 +191,16 @@ void ZNeuronTracerConfig::loadJsonObject(const ZJsonObject &jsonObj)
           m_enhanceMask =
               ZJsonParser::booleanValue(defaultObj[m_enhanceLineKey]);
         }
+
+        if (defaultObj.hasKey(m_threadCountKey)) {
+          m_threadCount =
+              ZJsonParser::integerValue(defaultObj[m_threadCountKey]);
+        }
+
+        if (defaultObj.hasKey(m_seedScreeningKey)) {
+          m_screeningSeed =
+              ZJsonParser::booleanValue(defaultObj[m_seedScreeningKey]);
+        }
       }
 
       if (jsonObj.hasKey("level")) {
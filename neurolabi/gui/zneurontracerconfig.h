@@ -33,6 +33,8 @@ public:
   int getSeedMethod() const { return m_seedMethod; }
   int getRecoverLevel() const { return m_recover; }
   double getMaxEucDist() const { return m_maxEucDist; }
+  int getThreadCount() const { return m_threadCount; }
+  bool screeningSeed() const { return m_screeningSeed; }
 
   ZJsonObject getLevelJson(int level) const;
 
@@ -49,6 +51,8 @@ public:
   static const char * getSeedMethodKey() { return m_seedMethodKey; }
   static const char * getRecoverKey() { return m_recoverKey; }
   static const char * getEnhanceLineKey() { return m_enhanceLineKey; }
+  static const char * getThreadCountKey() { return m_threadCountKey; }
+  static const char * getSeedScreeningKey() { return m_seedScreeningKey; }
 
   void print() const;
 
@@ -69,6 +73,8 @@ private:
   int m_seedMethod;
   int m_recover;
   double m_maxEucDist;
+  int m_threadCount;
+  bool m_screeningSeed;
   std::map<int, ZJsonObject> m_levelMap;
 
   static const char *m_levelKey;
@@ -85,5 +91,7 @@ private:
   static const char *m_recoverKey;
   static const char *m_enhanceLineKey;
   static const char *m_maxEucDistKey;
+  static const char *m_threadCountKey;
+  static const char *m_seedScreeningKey;
 };
 #endif // ZNEURONTRACERCONFIG_H
@@ -298,10 +298,22 @@ void ZObject3dFactory::AdjustResolution(
 std::map<uint64_t, ZObject3dScan*>* ZObject3dFactory::ExtractAllForegroundObject(
     ZStack &stack, bool upsampling)
 {
-  std::map<uint64_t, ZObject3dScan*> *bodySet =
-      ZObject3dScan::extractAllForegroundObject(
-        stack.array8(), stack.width(), stack.height(), stack.depth(),
-        neutube::EAxis::Z);
+  std::map<uint64_t, ZObject3dScan*> *bodySet = NULL;
+  switch (stack.kind()) {
+  case GREY:
+    bodySet = ZObject3dScan::extractAllForegroundObject(
+          stack.array8(), stack.width(), stack.height(), stack.depth(),
+          neutube::EAxis::Z);
+    break;
+  case GREY16:
+    bodySet = ZObject3dScan::extractAllForegroundObject(
+          stack.array16(), stack.width(), stack.height(), stack.depth(),
+          neutube::EAxis::Z);
+    break;
+  default:
+    break;
+  }
+
   if (bodySet != NULL) {
     for (auto &bodyIter : *bodySet) {
       ZObject3dScan *body = bodyIter.second;
@@ -0,0 +1,710 @@
+#include "zobject3dflatscan.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "zerror.h"
+#include "zobject3dscan.h"
+#include "zobject3dstripe.h"
+
+int ZObject3dFlatScan::Stripe::getMinX() const
+{
+  if (isEmpty()) {
+    return 0;
+  }
+
+  return m_runs[0].x0;
+}
+
+int ZObject3dFlatScan::Stripe::getMaxX() const
+{
+  if (isEmpty()) {
+    return 0;
+  }
+
+  return m_runs[m_size - 1].x1;
+}
+
+size_t ZObject3dFlatScan::Stripe::getVoxelNumber() const
+{
+  size_t voxelNumber = 0;
+  for (size_t i = 0; i < m_size; ++i) {
+    voxelNumber += m_runs[i].x1 - m_runs[i].x0 + 1;
+  }
+
+  return voxelNumber;
+}
+
+bool ZObject3dFlatScan::Stripe::containsX(int x) const
+{
+  const Run *end = m_runs + m_size;
+  const Run *iter = std::upper_bound(
+        m_runs, end, x, [](int v, const Run &run) { return v < run.x0; });
+  if (iter != m_runs) {
+    --iter;
+    return x <= iter->x1;
+  }
+
+  return false;
+}
+
+///////////////////////////////////////////////////
+
+ZObject3dFlatScan::ZObject3dFlatScan()
+{
+}
+
+ZObject3dFlatScan::ZObject3dFlatScan(const ZObject3dScan &obj)
+{
+  load(obj);
+}
+
+bool ZObject3dFlatScan::isDeprecated(EComponent comp) const
+{
+  switch (comp) {
+  case COMPONENT_STRIPE_INDEX:
+    return m_stripeOffset.empty();
+  case COMPONENT_SLICE_INDEX:
+    return m_sliceOffset.empty();
+  default:
+    break;
+  }
+
+  return false;
+}
+
+void ZObject3dFlatScan::deprecate(EComponent comp)
+{
+  switch (comp) {
+  case COMPONENT_STRIPE_INDEX:
+    m_stripeOffset.clear();
+    deprecate(COMPONENT_SLICE_INDEX);
+    break;
+  case COMPONENT_SLICE_INDEX:
+    m_sliceOffset.clear();
+    break;
+  case COMPONENT_ALL:
+    deprecate(COMPONENT_STRIPE_INDEX);
+    deprecate(COMPONENT_SLICE_INDEX);
+    break;
+  }
+}
+
+void ZObject3dFlatScan::clear()
+{
+  m_runArray.clear();
+  m_isCanonized = true;
+  deprecate(COMPONENT_ALL);
+}
+
+void ZObject3dFlatScan::reserve(size_t n)
+{
+  m_runArray.reserve(n);
+}
+
+bool ZObject3dFlatScan::IsLessThan(const Run &r1, const Run &r2)
+{
+  if (r1.z != r2.z) {
+    return r1.z < r2.z;
+  }
+
+  if (r1.y != r2.y) {
+    return r1.y < r2.y;
+  }
+
+  return r1.x0 < r2.x0;
+}
+
+void ZObject3dFlatScan::pushRun(int z, int y, int x0, int x1)
+{
+  if (x0 > x1) {
+    std::swap(x0, x1);
+  }
+
+  if (!m_runArray.empty()) {
+    Run &last = m_runArray.back();
+    if (last.z == z && last.y == y) {
+      if (x0 >= last.x0 && x0 <= last.x1 + 1) { //Mergable with the last run
+        last.x1 = std::max(last.x1, x1);
+        return;
+      }
+      if (x0 < last.x0) {
+        m_isCanonized = false;
+      }
+    } else if (z < last.z || (z == last.z && y < last.y)) {
+      m_isCanonized = false;
+    }
+  }
+
+  Run run;
+  run.z = z;
+  run.y = y;
+  run.x0 = x0;
+  run.x1 = x1;
+  m_runArray.push_back(run);
+}
+
+void ZObject3dFlatScan::addSegment(
+    int z, int y, int x0, int x1, bool canonizing)
+{
+  pushRun(z, y, x0, x1);
+  deprecate(COMPONENT_ALL);
+
+  if (canonizing) {
+    canonize();
+  }
+}
+
+void ZObject3dFlatScan::addSegment(int x0, int x1, bool canonizing)
+{
+  if (!isEmpty()) {
+    addSegment(m_runArray.back().z, m_runArray.back().y, x0, x1, canonizing);
+  }
+}
+
+void ZObject3dFlatScan::appendSortedRuns(const Run *runs, size_t n)
+{
+  if (n > 0) {
+    m_runArray.reserve(m_runArray.size() + n);
+    for (size_t i = 0; i < n; ++i) {
+      const Run &run = runs[i];
+      pushRun(run.z, run.y, run.x0, run.x1);
+    }
+    deprecate(COMPONENT_ALL);
+  }
+}
+
+void ZObject3dFlatScan::canonize()
+{
+  if (!isCanonized()) {
+    std::sort(m_runArray.begin(), m_runArray.end(), IsLessThan);
+
+    //Merge overlapping or touching runs in place
+    size_t length = 1;
+    for (size_t i = 1; i < m_runArray.size(); ++i) {
+      Run &last = m_runArray[length - 1];
+      const Run &run = m_runArray[i];
+      if (run.z == last.z && run.y == last.y && run.x0 <= last.x1 + 1) {
+        last.x1 = std::max(last.x1, run.x1);
+      } else {
+        m_runArray[length++] = run;
+      }
+    }
+    m_runArray.resize(length);
+
+    m_isCanonized = true;
+    deprecate(COMPONENT_ALL);
+  }
+}
+
+void ZObject3dFlatScan::buildStripeIndex() const
+{
+  if (isDeprecated(COMPONENT_STRIPE_INDEX)) {
+    m_stripeOffset.clear();
+    for (size_t i = 0; i < m_runArray.size(); ++i) {
+      if (i == 0 || m_runArray[i].z != m_runArray[i - 1].z ||
+          m_runArray[i].y != m_runArray[i - 1].y) {
+        m_stripeOffset.push_back(i);
+      }
+    }
+    m_stripeOffset.push_back(m_runArray.size());
+  }
+}
+
+void ZObject3dFlatScan::buildSliceIndex() const
+{
+  if (isDeprecated(COMPONENT_SLICE_INDEX)) {
+    buildStripeIndex();
+    m_sliceOffset.clear();
+    size_t stripeNumber = m_stripeOffset.size() - 1;
+    for (size_t i = 0; i < stripeNumber; ++i) {
+      int z = m_runArray[m_stripeOffset[i]].z;
+      if (m_sliceOffset.empty() || m_sliceOffset.back().first != z) {
+        m_sliceOffset.push_back(std::pair<int, size_t>(z, i));
+      }
+    }
+    m_sliceOffset.push_back(std::pair<int, size_t>(0, stripeNumber));
+  }
+}
+
+size_t ZObject3dFlatScan::getStripeNumber() const
+{
+  buildStripeIndex();
+
+  return m_stripeOffset.size() - 1;
+}
+
+ZObject3dFlatScan::Stripe ZObject3dFlatScan::getStripe(size_t index) const
+{
+  buildStripeIndex();
+
+  if (index + 1 < m_stripeOffset.size()) {
+    size_t start = m_stripeOffset[index];
+    return Stripe(&(m_runArray[start]), m_stripeOffset[index + 1] - start);
+  }
+
+  return Stripe();
+}
+
+bool ZObject3dFlatScan::getSegment(
+    size_t index, int *z, int *y, int *x0, int *x1) const
+{
+  if (index < m_runArray.size()) {
+    const Run &run = m_runArray[index];
+    *z = run.z;
+    *y = run.y;
+    *x0 = run.x0;
+    *x1 = run.x1;
+    return true;
+  }
+
+  return false;
+}
+
+size_t ZObject3dFlatScan::getVoxelNumber() const
+{
+  size_t voxelNumber = 0;
+  for (const Run &run : m_runArray) {
+    voxelNumber += run.x1 - run.x0 + 1;
+  }
+
+  return voxelNumber;
+}
+
+size_t ZObject3dFlatScan::getVoxelNumber(int z) const
+{
+  size_t voxelNumber = 0;
+  for (const Run &run : m_runArray) {
+    if (run.z == z) {
+      voxelNumber += run.x1 - run.x0 + 1;
+    }
+  }
+
+  return voxelNumber;
+}
+
+int ZObject3dFlatScan::getMinZ() const
+{
+  if (isEmpty()) {
+    return 0;
+  }
+
+  if (isCanonized()) {
+    return m_runArray.front().z;
+  }
+
+  int minZ = m_runArray.front().z;
+  for (const Run &run : m_runArray) {
+    minZ = std::min(minZ, run.z);
+  }
+
+  return minZ;
+}
+
+int ZObject3dFlatScan::getMaxZ() const
+{
+  if (isEmpty()) {
+    return 0;
+  }
+
+  if (isCanonized()) {
+    return m_runArray.back().z;
+  }
+
+  int maxZ = m_runArray.front().z;
+  for (const Run &run : m_runArray) {
+    maxZ = std::max(maxZ, run.z);
+  }
+
+  return maxZ;
+}
+
+ZIntCuboid ZObject3dFlatScan::getBoundBox() const
+{
+  ZIntCuboid boundBox;
+
+  if (!isEmpty()) {
+    const Run &first = m_runArray.front();
+    boundBox.set(first.x0, first.y, first.z, first.x1, first.y, first.z);
+    for (const Run &run : m_runArray) {
+      boundBox.joinX(run.x0);
+      boundBox.joinX(run.x1);
+      boundBox.joinY(run.y);
+      boundBox.joinZ(run.z);
+    }
+  }
+
+  return boundBox;
+}
+
+std::pair<size_t, size_t> ZObject3dFlatScan::getSliceStripeRange(int z) const
+{
+  buildSliceIndex();
+
+  auto end = m_sliceOffset.end() - 1;
+  auto iter = std::lower_bound(
+        m_sliceOffset.begin(), end, z,
+        [](const std::pair<int, size_t> &slice, int v) {
+    return slice.first < v; });
+  if (iter != end && iter->first == z) {
+    return std::pair<size_t, size_t>(iter->second, (iter + 1)->second);
+  }
+
+  return std::pair<size_t, size_t>(0, 0);
+}
+
+bool ZObject3dFlatScan::contains(int x, int y, int z) const
+{
+  Run key;
+  key.z = z;
+  key.y = y;
+  key.x0 = x;
+  key.x1 = x;
+
+  //The first run that starts after (z, y, x)
+  auto iter = std::upper_bound(
+        m_runArray.begin(), m_runArray.end(), key, IsLessThan);
+  if (iter != m_runArray.begin()) {
+    --iter;
+    return iter->z == z && iter->y == y && x <= iter->x1;
+  }
+
+  return false;
+}
+
+void ZObject3dFlatScan::translate(int dx, int dy, int dz)
+{
+  for (Run &run : m_runArray) {
+    run.x0 += dx;
+    run.x1 += dx;
+    run.y += dy;
+    run.z += dz;
+  }
+
+  if (dy != 0 || dz != 0) {
+    deprecate(COMPONENT_SLICE_INDEX);
+  }
+}
+
+void ZObject3dFlatScan::concat(const ZObject3dFlatScan &obj)
+{
+  if (!obj.isEmpty()) {
+    bool canonized = isCanonized() && obj.isCanonized();
+    appendSortedRuns(&(obj.m_runArray[0]), obj.m_runArray.size());
+    if (!canonized) {
+      m_isCanonized = false;
+    }
+  }
+}
+
+void ZObject3dFlatScan::MergeSorted(
+    const std::vector<Run> &runArray1, const std::vector<Run> &runArray2,
+    std::vector<Run> *result)
+{
+  result->clear();
+  result->reserve(runArray1.size() + runArray2.size());
+
+  auto push = [&](const Run &run) {
+    if (!result->empty()) {
+      Run &last = result->back();
+      if (last.z == run.z && last.y == run.y && run.x0 <= last.x1 + 1) {
+        last.x1 = std::max(last.x1, run.x1);
+        return;
+      }
+    }
+    result->push_back(run);
+  };
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < runArray1.size() && j < runArray2.size()) {
+    if (IsLessThan(runArray2[j], runArray1[i])) {
+      push(runArray2[j++]);
+    } else {
+      push(runArray1[i++]);
+    }
+  }
+
+  for (; i < runArray1.size(); ++i) {
+    push(runArray1[i]);
+  }
+
+  for (; j < runArray2.size(); ++j) {
+    push(runArray2[j]);
+  }
+}
+
+void ZObject3dFlatScan::unify(const ZObject3dFlatScan &obj)
+{
+  if (obj.isEmpty()) {
+    return;
+  }
+
+  if (isEmpty()) {
+    *this = obj;
+    canonize();
+    return;
+  }
+
+  canonize();
+
+  if (obj.isCanonized()) {
+    if (IsLessThan(m_runArray.back(), obj.m_runArray.front())) {
+      concat(obj);
+    } else {
+      std::vector<Run> result;
+      MergeSorted(m_runArray, obj.m_runArray, &result);
+      m_runArray.swap(result);
+      deprecate(COMPONENT_ALL);
+    }
+  } else {
+    ZObject3dFlatScan canonizedObj = obj;
+    canonizedObj.canonize();
+    unify(canonizedObj);
+  }
+}
+
+ZObject3dFlatScan ZObject3dFlatScan::subtract(const ZObject3dFlatScan &obj)
+{
+  ZObject3dFlatScan subtracted;
+
+  if (isEmpty() || obj.isEmpty()) {
+    return subtracted;
+  }
+
+  canonize();
+
+  if (!obj.isCanonized()) {
+    ZObject3dFlatScan canonizedObj = obj;
+    canonizedObj.canonize();
+    return subtract(canonizedObj);
+  }
+
+  ZObject3dFlatScan remained;
+  remained.reserve(m_runArray.size());
+
+  const std::vector<Run> &runArray2 = obj.m_runArray;
+  auto isBefore = [](const Run &r1, const Run &r2) {
+    return r1.z < r2.z || (r1.z == r2.z && r1.y < r2.y);
+  };
+
+  size_t j = 0;
+  for (const Run &run : m_runArray) {
+    //Skip runs on previous stripes or ending before the current run
+    while (j < runArray2.size() &&
+           (isBefore(runArray2[j], run) ||
+            (!isBefore(run, runArray2[j]) && runArray2[j].x1 < run.x0))) {
+      ++j;
+    }
+
+    int x = run.x0;
+    for (size_t k = j; k < runArray2.size() && x <= run.x1; ++k) {
+      const Run &run2 = runArray2[k];
+      if (run2.z != run.z || run2.y != run.y || run2.x0 > run.x1) {
+        break;
+      }
+      if (run2.x0 > x) {
+        remained.pushRun(run.z, run.y, x, run2.x0 - 1);
+      }
+      subtracted.pushRun(
+            run.z, run.y, std::max(x, run2.x0), std::min(run.x1, run2.x1));
+      x = run2.x1 + 1;
+    }
+
+    if (x <= run.x1) {
+      remained.pushRun(run.z, run.y, x, run.x1);
+    }
+  }
+
+  m_runArray.swap(remained.m_runArray);
+  m_isCanonized = true;
+  deprecate(COMPONENT_ALL);
+
+  return subtracted;
+}
+
+bool ZObject3dFlatScan::equalsLiterally(const ZObject3dFlatScan &obj) const
+{
+  if (m_runArray.size() != obj.m_runArray.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < m_runArray.size(); ++i) {
+    const Run &r1 = m_runArray[i];
+    const Run &r2 = obj.m_runArray[i];
+    if (r1.z != r2.z || r1.y != r2.y || r1.x0 != r2.x0 || r1.x1 != r2.x1) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ZObject3dFlatScan::load(const ZObject3dScan &obj)
+{
+  clear();
+  m_runArray.reserve(obj.getSegmentNumber());
+
+  size_t stripeNumber = obj.getStripeNumber();
+  for (size_t i = 0; i < stripeNumber; ++i) {
+    const ZObject3dStripe &stripe = obj.getStripe(i);
+    int nseg = stripe.getSegmentNumber();
+    for (int j = 0; j < nseg; ++j) {
+      pushRun(stripe.getZ(), stripe.getY(),
+              stripe.getSegmentStart(j), stripe.getSegmentEnd(j));
+    }
+  }
+}
+
+void ZObject3dFlatScan::toObject3dScan(ZObject3dScan *obj) const
+{
+  if (obj == NULL) {
+    return;
+  }
+
+  //Stripes already in obj are reused to keep their segment buffers, and the
+  //attributes of obj, such as the slice axis, are not touched.
+  size_t stripeNumber = getStripeNumber();
+  std::vector<ZObject3dStripe> &stripeArray = obj->getStripeArray();
+  stripeArray.resize(stripeNumber);
+  for (size_t i = 0; i < stripeNumber; ++i) {
+    ZObject3dStripe &stripe = stripeArray[i];
+    const Run &firstRun = m_runArray[m_stripeOffset[i]];
+    stripe.setZ(firstRun.z);
+    stripe.setY(firstRun.y);
+    std::vector<int> &segmentArray = stripe.getSegmentArray();
+    segmentArray.clear();
+    segmentArray.reserve((m_stripeOffset[i + 1] - m_stripeOffset[i]) * 2);
+    for (size_t j = m_stripeOffset[i]; j < m_stripeOffset[i + 1]; ++j) {
+      segmentArray.push_back(m_runArray[j].x0);
+      segmentArray.push_back(m_runArray[j].x1);
+    }
+    stripe.setCanonized(isCanonized());
+  }
+
+  obj->deprecate(ZObject3dScan::COMPONENT_ALL);
+  obj->setCanonized(isCanonized());
+}
+
+ZObject3dScan ZObject3dFlatScan::toObject3dScan() const
+{
+  ZObject3dScan obj;
+  toObject3dScan(&obj);
+
+  return obj;
+}
+
+bool ZObject3dFlatScan::importDvidObjectBuffer(
+    const char *byteArray, size_t byteNumber)
+{
+  clear();
+
+  //Header: flag, #dims, dim of run, reserved, #voxels, #spans
+  const size_t headerSize = 12;
+  const size_t spanSize = 16;
+
+  if (byteArray == NULL || byteNumber <= headerSize) {
+    RECORD_ERROR_UNCOND("Invalid byte buffer");
+    return false;
+  }
+
+  if (byteArray[1] != 3) {
+    RECORD_ERROR_UNCOND("Current version only supports 3D");
+    return false;
+  }
+
+  if (byteArray[2] != 0) {
+    RECORD_ERROR_UNCOND("Unspported run dimension");
+    return false;
+  }
+
+  uint32_t numberOfSpans = 0;
+  memcpy(&numberOfSpans, byteArray + 8, sizeof(numberOfSpans));
+
+  if (byteNumber - headerSize < (size_t) numberOfSpans * spanSize) {
+    RECORD_ERROR_UNCOND("Buffer ended prematurely.");
+    return false;
+  }
+
+  m_runArray.reserve(numberOfSpans);
+
+  const char *spanPtr = byteArray + headerSize;
+  for (uint32_t span = 0; span < numberOfSpans; ++span) {
+    int32_t value[4];
+    memcpy(value, spanPtr, spanSize);
+    spanPtr += spanSize;
+
+    if (value[3] <= 0) {
+      RECORD_ERROR_UNCOND("Invalid run length");
+      clear();
+      return false;
+    }
+
+    pushRun(value[2], value[1], value[0], value[0] + value[3] - 1);
+  }
+
+  return true;
+}
+
+void ZObject3dFlatScan::print() const
+{
+  std::cout << "Flat RLE object: " << getStripeNumber() << " stripes; "
+            << m_runArray.size() << " runs" << std::endl;
+  for (const Run &run : m_runArray) {
+    std::cout << "  " << run.z << " " << run.y << ": "
+              << run.x0 << " - " << run.x1 << std::endl;
+  }
+}
+
+///////////////////////////////////////////////////
+
+void ZObject3dFlatScan::Appender::addSegment(int z, int y, int x0, int x1)
+{
+  if (m_obj) {
+    m_obj->addSegment(z, y, x0, x1, false);
+  }
+}
+
+void ZObject3dFlatScan::Appender::addSegment(int x0, int x1)
+{
+  if (m_obj) {
+    m_obj->addSegment(x0, x1, false);
+  }
+}
+
+void ZObject3dFlatScan::Appender::addCodeSegment(
+    uint8_t dvidCode, int x0, int y0, int z0)
+{
+  if (dvidCode > 0) {
+    bool onSeg = false;
+    int segStart = 0;
+    for (int i = 0; i < 8; ++i) {
+      if (onSeg) {
+        if ((dvidCode & 1) == 0) {
+          addSegment(z0, y0, segStart, x0 + i - 1);
+          onSeg = false;
+        }
+      } else {
+        if ((dvidCode & 1) > 0) {
+          segStart = x0 + i;
+          onSeg = true;
+        }
+      }
+      dvidCode >>= 1;
+    }
+
+    if (onSeg) {
+      addSegment(z0, y0, segStart, x0 + 7);
+    }
+  }
+}
+
+void ZObject3dFlatScan::Appender::addCodeSegment(
+    uint64_t dvidCode, int x0, int y0, int z0)
+{
+  uint8_t *codeArray = reinterpret_cast<uint8_t*>(&dvidCode);
+  for (size_t i = 0; i < 8; ++i) {
+    addCodeSegment(codeArray[i], x0, y0++, z0);
+  }
+}
@@ -0,0 +1,233 @@
+#ifndef ZOBJECT3DFLATSCAN_H
+#define ZOBJECT3DFLATSCAN_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+#include "zintcuboid.h"
+
+class ZObject3dScan;
+
+/*!
+ * \brief The class of RLE object stored in a single run array
+ *
+ * ZObject3dFlatScan encodes the same voxel set as ZObject3dScan, but all
+ * segments live in one contiguous array of (z, y, x0, x1) runs instead of a
+ * stripe array where each stripe owns its own segment buffer. Stripes and
+ * slices are only described by an offset index, which is built on demand and
+ * deprecated whenever the runs change. This keeps large bodies in a handful of
+ * allocations and makes canonizing, unifying and subtracting linear passes
+ * over sorted memory.
+ *
+ * The canonical form is the same as that of ZObject3dScan: runs are sorted by
+ * (z, y, x0) and no two runs on the same stripe overlap or touch.
+ */
+class ZObject3dFlatScan
+{
+public:
+  ZObject3dFlatScan();
+  explicit ZObject3dFlatScan(const ZObject3dScan &obj);
+
+  struct Run {
+    int z;
+    int y;
+    int x0;
+    int x1;
+  };
+
+  /*!
+   * \brief Read-only view of a stripe
+   *
+   * It mirrors the accessors of ZObject3dStripe, but points into the run
+   * array of its host object, so it becomes invalid once the host changes.
+   */
+  class Stripe {
+  public:
+    Stripe(const Run *runs = NULL, size_t n = 0) : m_runs(runs), m_size(n) {}
+
+    inline int getY() const { return m_size > 0 ? m_runs[0].y : 0; }
+    inline int getZ() const { return m_size > 0 ? m_runs[0].z : 0; }
+    inline size_t getSize() const { return m_size; }
+    inline int getSegmentNumber() const { return m_size; }
+    inline bool isEmpty() const { return m_size == 0; }
+    inline int getSegmentStart(size_t index) const {
+      return m_runs[index].x0;
+    }
+    inline int getSegmentEnd(size_t index) const {
+      return m_runs[index].x1;
+    }
+    inline const int* getSegment(size_t index) const {
+      return &(m_runs[index].x0);
+    }
+
+    int getMinX() const;
+    int getMaxX() const;
+    size_t getVoxelNumber() const;
+
+    /*!
+     * \brief Test if an X is within the range of the segments
+     *
+     * The stripe must be canonized.
+     */
+    bool containsX(int x) const;
+
+  private:
+    const Run *m_runs;
+    size_t m_size;
+  };
+
+  enum EComponent {
+    COMPONENT_STRIPE_INDEX, COMPONENT_SLICE_INDEX, COMPONENT_ALL
+  };
+
+  bool isDeprecated(EComponent comp) const;
+  void deprecate(EComponent comp);
+
+  void clear();
+  bool isEmpty() const { return m_runArray.empty(); }
+
+  inline bool isCanonized() const { return isEmpty() || m_isCanonized; }
+  void canonize();
+
+  /*!
+   * \brief Reserve space for \a n runs.
+   */
+  void reserve(size_t n);
+
+  void addSegment(int z, int y, int x0, int x1, bool canonizing = true);
+
+  /*!
+   * \brief Add a segment to the last stripe
+   *
+   * Nothing is done if the object is empty.
+   */
+  void addSegment(int x0, int x1, bool canonizing = true);
+
+  /*!
+   * \brief Append runs that are already sorted in the canonical order.
+   *
+   * No check is done on the order of \a runs, so the caller must make sure
+   * that the result is still canonical (e.g. by appending slices in ascending
+   * Z).
+   */
+  void appendSortedRuns(const Run *runs, size_t n);
+
+  size_t getStripeNumber() const;
+  Stripe getStripe(size_t index) const;
+
+  size_t getSegmentNumber() const { return m_runArray.size(); }
+  bool getSegment(size_t index, int *z, int *y, int *x0, int *x1) const;
+  const Run& getRun(size_t index) const { return m_runArray[index]; }
+  const std::vector<Run>& getRunArray() const { return m_runArray; }
+
+  size_t getVoxelNumber() const;
+  size_t getVoxelNumber(int z) const;
+
+  int getMinZ() const;
+  int getMaxZ() const;
+
+  ZIntCuboid getBoundBox() const;
+
+  /*!
+   * \brief Range of stripe indices of a slice.
+   *
+   * \return [first, last) stripe indices at \a z. The range is empty if the
+   *         object has nothing at \a z. The object must be canonized.
+   */
+  std::pair<size_t, size_t> getSliceStripeRange(int z) const;
+
+  /*!
+   * \brief Test if the object contains a voxel
+   *
+   * The object must be canonized.
+   */
+  bool contains(int x, int y, int z) const;
+
+  void translate(int dx, int dy, int dz);
+
+  /*!
+   * \brief Concatenate two objects
+   *
+   * The result is canonized only when both objects are canonized and \a obj
+   * starts after the current object ends.
+   */
+  void concat(const ZObject3dFlatScan &obj);
+
+  /*!
+   * \brief Unify two objects
+   *
+   * Unify \a obj to the current object and keep the result canonized.
+   */
+  void unify(const ZObject3dFlatScan &obj);
+
+  /*!
+   * \brief Subtract an object
+   *
+   * Same as ZObject3dScan::subtract. The current object becomes the remained
+   * part and the removed part is returned.
+   */
+  ZObject3dFlatScan subtract(const ZObject3dFlatScan &obj);
+
+  bool equalsLiterally(const ZObject3dFlatScan &obj) const;
+
+  void load(const ZObject3dScan &obj);
+
+  /*!
+   * \brief Write the runs into the stripe array of \a obj
+   *
+   * Only the voxels of \a obj are replaced. Its other attributes, such as the
+   * label and the slice axis, are kept.
+   */
+  void toObject3dScan(ZObject3dScan *obj) const;
+  ZObject3dScan toObject3dScan() const;
+
+  /*!
+   * \brief Import object from a DVID sparsevol buffer
+   *
+   * It supports the same format as ZObject3dScan::importDvidObjectBuffer.
+   */
+  bool importDvidObjectBuffer(const char *byteArray, size_t byteNumber);
+
+  void print() const;
+
+  class Appender {
+  public:
+    Appender(ZObject3dFlatScan *obj) : m_obj(obj) {}
+    void addSegment(int z, int y, int x0, int x1);
+    void addSegment(int x0, int x1);
+
+    /*!
+     * \brief Add segments by parsing a 8-bit mask from dvid block
+     *
+     * See ZObject3dScan::Appender::addCodeSegment.
+     */
+    void addCodeSegment(uint8_t dvidCode, int x0, int y0, int z0);
+    void addCodeSegment(uint64_t dvidCode, int x0, int y0, int z0);
+
+  private:
+    ZObject3dFlatScan *m_obj = nullptr;
+  };
+
+private:
+  void pushRun(int z, int y, int x0, int x1);
+  void buildStripeIndex() const;
+  void buildSliceIndex() const;
+
+  static bool IsLessThan(const Run &r1, const Run &r2);
+  static void MergeSorted(const std::vector<Run> &runArray1,
+                          const std::vector<Run> &runArray2,
+                          std::vector<Run> *result);
+
+private:
+  std::vector<Run> m_runArray;
+  bool m_isCanonized = true;
+
+  //Offset of each stripe in the run array, ending with the size of the array
+  mutable std::vector<size_t> m_stripeOffset;
+  //(z, first stripe index) of each slice, ending with the stripe number
+  mutable std::vector<std::pair<int, size_t> > m_sliceOffset;
+};
+
+#endif // ZOBJECT3DFLATSCAN_H
@@ -42,6 +42,8 @@
 #include "zstackwriter.h"
 #include "zobject3dfactory.h"
 #include "core/memorystream.h"
+#include "dvid/zdvidsparsevoldecoder.h"
+#include "zobject3dflatscan.h"
 
 ///////////////////////////////////////////////////
 
@@ -971,7 +973,7 @@ void ZObject3dScan::sortedCanonize()
     std::vector<ZObject3dStripe> newStripeArray(m_stripeArray.size());
     size_t length = 0;
     //newStripeArray.reserve(m_stripeArray.size());
-    m_stripeArray[0].sortedCanonize();
+    m_stripeArray[0].canonize(); //Its segments are not necessarily sorted
     //newStripeArray.push_back(m_stripeArray[0]);
     newStripeArray[length++] = m_stripeArray[0];
     for (size_t i = 1; i < m_stripeArray.size(); ++i) {
@@ -1069,6 +1071,13 @@ void ZObject3dScan::canonizeConst() const
   const_cast<ZObject3dScan&>(*this).canonize();
 }
 
+static bool ZObject3dStripeLess(
+    const ZObject3dStripe &s1, const ZObject3dStripe &s2)
+{
+  return (s1.getZ() < s2.getZ()) ||
+      ((s1.getZ() == s2.getZ()) && (s1.getY() < s2.getY()));
+}
+
 void ZObject3dScan::unify(const ZObject3dScan &obj)
 {
   bool processed = false;
@@ -1077,12 +1086,39 @@ void ZObject3dScan::unify(const ZObject3dScan &obj)
       concat(obj);
       setCanonized(true);
       processed = true;
+    } else if (obj.getStripeNumber() * 8 < getStripeNumber()) {
+      //A small piece only touches a few stripes of a big body
+      std::vector<ZObject3dStripe> newStripeArray;
+      std::vector<ZObject3dStripe>::iterator iter = m_stripeArray.begin();
+      for (const ZObject3dStripe &stripe : obj.m_stripeArray) {
+        iter = std::lower_bound(
+              iter, m_stripeArray.end(), stripe, ZObject3dStripeLess);
+        if (iter != m_stripeArray.end() &&
+            iter->getZ() == stripe.getZ() && iter->getY() == stripe.getY()) {
+          iter->unify(stripe);
+        } else {
+          newStripeArray.push_back(stripe);
+        }
+      }
+
+      if (!newStripeArray.empty()) {
+        size_t oldSize = m_stripeArray.size();
+        m_stripeArray.insert(m_stripeArray.end(), newStripeArray.begin(),
+                             newStripeArray.end());
+        std::inplace_merge(m_stripeArray.begin(),
+                           m_stripeArray.begin() + oldSize,
+                           m_stripeArray.end(), ZObject3dStripeLess);
+      }
+      processEvent(EVENT_OBJECT_MODEL_CHANGED);
+      processed = true;
     }
   }
 
   if (processed == false) {
-    concat(obj);
-    canonize();
+    //Merging sorted runs is cheaper than sorting the joined stripes
+    ZObject3dFlatScan flatObj(*this);
+    flatObj.unify(ZObject3dFlatScan(obj));
+    flatObj.toObject3dScan(this);
   }
 }
 
@@ -3515,64 +3551,12 @@ bool ZObject3dScan::importDvidObjectBuffer(
     return false;
   }
 
-  size_t currentIndex = 0;
-  tz_uint8 flag = 0;
-  READ_BYTE_BUFFER(flag, tz_uint8);
-  UNUSED_PARAMETER(flag);
-
-
-  tz_uint8 numberOfDimensions = 0;
-  READ_BYTE_BUFFER(numberOfDimensions, tz_uint8);
-
-  if (numberOfDimensions != 3) {
-    RECORD_ERROR_UNCOND("Current version only supports 3D");
-    return false;
-  }
-
-  tz_uint8 dimOfRun = 0;
-  READ_BYTE_BUFFER(dimOfRun, tz_uint8);
-  if (dimOfRun != 0) {
-    RECORD_ERROR_UNCOND("Unspported run dimension");
-    return false;
-  }
-
-  //tz_uint8 reserved = *static_cast<tz_uint8*>(byteArray + currentIndex);
-  ++currentIndex;
-
-  //tz_uint32 numberOfVoxels = *static_cast<tz_uint32*>(byteArray + currentIndex);
-  currentIndex += 4;
-
-  tz_uint32 numberOfSpans = 0;
-  READ_BYTE_BUFFER(numberOfSpans, tz_uint32);
-
-  for (tz_uint32 span = 0; span < numberOfSpans; ++span) {
-    tz_int32 coord[3];
-    for (int i = 0; i < 3; ++i) {
-      READ_BYTE_BUFFER(coord[i], tz_int32);
-    }
-
-    tz_int32 runLength = 0;
-    READ_BYTE_BUFFER(runLength, tz_int32);
-
-    if (runLength <= 0) {
-      RECORD_ERROR_UNCOND("Invalid run length");
-      return false;
-    }
-
-//    addStripeFast(coord[2], coord[1]);
-//    addSegmentFast(coord[0], coord[0] + runLength - 1);
-    zgeom::shiftSliceAxis(coord[0], coord[1], coord[2], getSliceAxis());
-
-    if (getSliceAxis() == neutube::EAxis::X) {
-      for (int i = 0; i < runLength; ++i) {
-        addSegment(coord[2] + i, coord[1], coord[0], coord[0], false);
-      }
-    } else {
-      addSegment(coord[2], coord[1], coord[0], coord[0] + runLength - 1, false);
-    }
-  }
+  //Spans arrive in ZYX order, so the decoder appends them to the stripe array
+  //directly and leaves the object canonized without an extra pass.
+  ZDvidSparsevolDecoder decoder(this);
+  decoder.consume(byteArray, byteNumber);
 
-  return true;
+  return decoder.finish();
 }
 
 bool ZObject3dScan::importDvidBlockBuffer(
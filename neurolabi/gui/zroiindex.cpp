@@ -0,0 +1,340 @@
+#include "zroiindex.h"
+
+#include <algorithm>
+
+#include "zobject3dscan.h"
+#include "geometry/zgeometry.h"
+
+namespace {
+
+//Maximum number of coarse cells. Cells are enlarged for a huge ROI.
+const size_t MAX_CELL_COUNT = size_t(1) << 24;
+
+//Rows are indexed densely unless the bounding box is much larger than the
+//number of rows.
+const size_t MIN_DENSE_ROW_COUNT = size_t(1) << 20;
+
+}
+
+ZRoiIndex::ZRoiIndex() : m_blockSize(1, 1, 1)
+{
+}
+
+ZRoiIndex::ZRoiIndex(const ZObject3dScan &roi) : m_blockSize(1, 1, 1)
+{
+  build(roi);
+}
+
+ZRoiIndex::ZRoiIndex(const ZObject3dScan &roi, const ZIntPoint &blockSize) :
+  m_blockSize(blockSize)
+{
+  if (blockSize.getX() > 0 && blockSize.getY() > 0 && blockSize.getZ() > 0) {
+    build(roi);
+  }
+}
+
+bool ZRoiIndex::isEmpty() const
+{
+  return m_intervalArray.empty();
+}
+
+ZIntCuboid ZRoiIndex::getBoundBox() const
+{
+  if (isEmpty()) {
+    return ZIntCuboid();
+  }
+
+  return ZIntCuboid(m_x0, m_y0, m_z0, m_x0 + m_width - 1,
+                    m_y0 + m_height - 1, m_z0 + m_depth - 1);
+}
+
+ZIntPoint ZRoiIndex::getBlockSize() const
+{
+  return m_blockSize;
+}
+
+int ZRoiIndex::FloorDiv(int v, int d)
+{
+  return (v >= 0) ? v / d : -((d - 1 - v) / d);
+}
+
+void ZRoiIndex::build(const ZObject3dScan &roi)
+{
+  m_sliceAxis = roi.getSliceAxis();
+
+  const ZObject3dScan *source = &roi;
+  ZObject3dScan canonizedRoi;
+  if (!roi.isCanonized()) {
+    canonizedRoi = roi;
+    canonizedRoi.canonize();
+    source = &canonizedRoi;
+  }
+
+  //Bounding box of the non-empty stripes
+  bool first = true;
+  int x1 = 0;
+  int y1 = 0;
+  int z1 = 0;
+  size_t rowCount = 0;
+  size_t intervalCount = 0;
+  for (size_t i = 0; i < source->getStripeNumber(); ++i) {
+    const ZObject3dStripe &stripe = source->getStripe(i);
+    if (stripe.getSegmentNumber() > 0) {
+      if (first) {
+        m_x0 = stripe.getMinX();
+        m_y0 = stripe.getY();
+        m_z0 = stripe.getZ();
+        x1 = stripe.getMaxX();
+        y1 = m_y0;
+        z1 = m_z0;
+        first = false;
+      } else {
+        m_x0 = std::min(m_x0, stripe.getMinX());
+        m_y0 = std::min(m_y0, stripe.getY());
+        m_z0 = std::min(m_z0, stripe.getZ());
+        x1 = std::max(x1, stripe.getMaxX());
+        y1 = std::max(y1, stripe.getY());
+        z1 = std::max(z1, stripe.getZ());
+      }
+      ++rowCount;
+      intervalCount += stripe.getSegmentNumber();
+    }
+  }
+
+  if (rowCount == 0) {
+    return;
+  }
+
+  m_width = x1 - m_x0 + 1;
+  m_height = y1 - m_y0 + 1;
+  m_depth = z1 - m_z0 + 1;
+
+  size_t denseRowCount = size_t(m_height) * m_depth;
+  bool dense = (denseRowCount <= std::max(MIN_DENSE_ROW_COUNT, rowCount * 4));
+
+  m_intervalArray.reserve(intervalCount);
+  if (dense) {
+    m_rowOffset.assign(denseRowCount + 1, 0);
+  } else {
+    m_rowKeyArray.reserve(rowCount);
+    m_rowOffset.reserve(rowCount + 1);
+    m_rowOffset.push_back(0);
+  }
+
+  //Stripes of a canonized object are sorted by (z, y) without duplicates, so
+  //the intervals are appended in the order of row keys.
+  for (size_t i = 0; i < source->getStripeNumber(); ++i) {
+    const ZObject3dStripe &stripe = source->getStripe(i);
+    if (stripe.getSegmentNumber() > 0) {
+      for (size_t j = 0; j < stripe.getSegmentNumber(); ++j) {
+        Interval interval;
+        interval.start = stripe.getSegmentStart(j);
+        interval.end = stripe.getSegmentEnd(j);
+        m_intervalArray.push_back(interval);
+      }
+
+      uint64_t key = uint64_t(stripe.getZ() - m_z0) * m_height +
+          (stripe.getY() - m_y0);
+      if (dense) {
+        m_rowOffset[key + 1] = stripe.getSegmentNumber();
+      } else {
+        m_rowKeyArray.push_back(key);
+        m_rowOffset.push_back(m_intervalArray.size());
+      }
+    }
+  }
+
+  if (dense) {
+    for (size_t i = 1; i < m_rowOffset.size(); ++i) {
+      m_rowOffset[i] += m_rowOffset[i - 1];
+    }
+  }
+
+  buildCellMap();
+}
+
+void ZRoiIndex::buildCellMap()
+{
+  m_cellShift = 3;
+  size_t cellCount = 0;
+  for (;;) {
+    int cellSize = 1 << m_cellShift;
+    m_cellWidth = (m_width + cellSize - 1) >> m_cellShift;
+    m_cellHeight = (m_height + cellSize - 1) >> m_cellShift;
+    m_cellDepth = (m_depth + cellSize - 1) >> m_cellShift;
+    cellCount = size_t(m_cellWidth) * m_cellHeight * m_cellDepth;
+    if (cellCount <= MAX_CELL_COUNT) {
+      break;
+    }
+    ++m_cellShift;
+  }
+
+  //Count the ROI voxels in each cell
+  std::vector<uint64_t> voxelCount(cellCount, 0);
+  auto countRow = [&](uint64_t key, size_t begin, size_t end) {
+    int y = int(key % m_height);
+    int z = int(key / m_height);
+    size_t cellOffset =
+        (size_t(z >> m_cellShift) * m_cellHeight + (y >> m_cellShift)) *
+        m_cellWidth;
+    for (size_t i = begin; i < end; ++i) {
+      int x0 = m_intervalArray[i].start - m_x0;
+      int x1 = m_intervalArray[i].end - m_x0;
+      for (int cx = (x0 >> m_cellShift); cx <= (x1 >> m_cellShift); ++cx) {
+        int cellStart = std::max(x0, cx << m_cellShift);
+        int cellEnd = std::min(x1, ((cx + 1) << m_cellShift) - 1);
+        voxelCount[cellOffset + cx] += cellEnd - cellStart + 1;
+      }
+    }
+  };
+
+  if (m_rowKeyArray.empty()) {
+    for (size_t key = 0; key + 1 < m_rowOffset.size(); ++key) {
+      countRow(key, m_rowOffset[key], m_rowOffset[key + 1]);
+    }
+  } else {
+    for (size_t i = 0; i < m_rowKeyArray.size(); ++i) {
+      countRow(m_rowKeyArray[i], m_rowOffset[i], m_rowOffset[i + 1]);
+    }
+  }
+
+  //A cell on the border is clipped by the bounding box
+  auto getCellLength = [&](int c, int length) {
+    return std::min(1 << m_cellShift, length - (c << m_cellShift));
+  };
+
+  m_cellMap.resize(cellCount);
+  size_t index = 0;
+  for (int cz = 0; cz < m_cellDepth; ++cz) {
+    uint64_t d = getCellLength(cz, m_depth);
+    for (int cy = 0; cy < m_cellHeight; ++cy) {
+      uint64_t h = getCellLength(cy, m_height);
+      for (int cx = 0; cx < m_cellWidth; ++cx, ++index) {
+        uint64_t volume = getCellLength(cx, m_width) * h * d;
+        if (voxelCount[index] == 0) {
+          m_cellMap[index] = ECellState::EMPTY;
+        } else if (voxelCount[index] == volume) {
+          m_cellMap[index] = ECellState::FULL;
+        } else {
+          m_cellMap[index] = ECellState::PARTIAL;
+        }
+      }
+    }
+  }
+}
+
+bool ZRoiIndex::hitRow(int x, int y, int z) const
+{
+  uint64_t key = uint64_t(z - m_z0) * m_height + (y - m_y0);
+
+  size_t rowIndex = key;
+  if (!m_rowKeyArray.empty()) {
+    auto iter = std::lower_bound(
+          m_rowKeyArray.begin(), m_rowKeyArray.end(), key);
+    if (iter == m_rowKeyArray.end() || *iter != key) {
+      return false;
+    }
+    rowIndex = iter - m_rowKeyArray.begin();
+  }
+
+  auto begin = m_intervalArray.begin() + m_rowOffset[rowIndex];
+  auto end = m_intervalArray.begin() + m_rowOffset[rowIndex + 1];
+
+  //The first interval starting after x
+  auto iter = std::upper_bound(
+        begin, end, x, [](int v, const Interval &interval) {
+    return v < interval.start;
+  });
+
+  return (iter != begin) && ((iter - 1)->end >= x);
+}
+
+bool ZRoiIndex::hit(int x, int y, int z) const
+{
+  int rx = x - m_x0;
+  int ry = y - m_y0;
+  int rz = z - m_z0;
+  if (rx < 0 || ry < 0 || rz < 0 ||
+      rx >= m_width || ry >= m_height || rz >= m_depth) {
+    return false;
+  }
+
+  size_t cellIndex =
+      (size_t(rz >> m_cellShift) * m_cellHeight + (ry >> m_cellShift)) *
+      m_cellWidth + (rx >> m_cellShift);
+  switch (m_cellMap[cellIndex]) {
+  case ECellState::EMPTY:
+    return false;
+  case ECellState::FULL:
+    return true;
+  case ECellState::PARTIAL:
+    break;
+  }
+
+  return hitRow(x, y, z);
+}
+
+bool ZRoiIndex::contains(int x, int y, int z) const
+{
+  if (isEmpty()) {
+    return false;
+  }
+
+  x = FloorDiv(x, m_blockSize.getX());
+  y = FloorDiv(y, m_blockSize.getY());
+  z = FloorDiv(z, m_blockSize.getZ());
+  zgeom::shiftSliceAxis(x, y, z, m_sliceAxis);
+
+  return hit(x, y, z);
+}
+
+bool ZRoiIndex::contains(const ZIntPoint &pt) const
+{
+  return contains(pt.getX(), pt.getY(), pt.getZ());
+}
+
+std::vector<bool> ZRoiIndex::contains(
+    const std::vector<ZIntPoint> &ptArray) const
+{
+  std::vector<bool> result(ptArray.size(), false);
+  if (!isEmpty()) {
+    for (size_t i = 0; i < ptArray.size(); ++i) {
+      result[i] = contains(ptArray[i]);
+    }
+  }
+
+  return result;
+}
+
+size_t ZRoiIndex::countContained(const std::vector<ZIntPoint> &ptArray) const
+{
+  size_t count = 0;
+  if (!isEmpty()) {
+    for (const ZIntPoint &pt : ptArray) {
+      if (contains(pt)) {
+        ++count;
+      }
+    }
+  }
+
+  return count;
+}
+
+std::vector<int> ZRoiIndex::LabelPoint(
+    const std::vector<ZIntPoint> &ptArray,
+    const std::vector<const ZRoiIndex*> &roiArray)
+{
+  std::vector<int> labelArray(ptArray.size(), -1);
+  for (size_t i = 0; i < ptArray.size(); ++i) {
+    for (size_t j = 0; j < roiArray.size(); ++j) {
+      if (roiArray[j] != NULL) {
+        if (roiArray[j]->contains(ptArray[i])) {
+          labelArray[i] = int(j);
+          break;
+        }
+      }
+    }
+  }
+
+  return labelArray;
+}
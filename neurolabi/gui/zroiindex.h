@@ -0,0 +1,133 @@
+#ifndef ZROIINDEX_H
+#define ZROIINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "neutube_def.h"
+#include "zintpoint.h"
+#include "zintcuboid.h"
+
+class ZObject3dScan;
+
+/*!
+ * \brief The class of fast point-in-ROI queries
+ *
+ * The index is built once from an ROI object and never changes afterwards, so
+ * all queries are const and can be run from multiple threads without locking.
+ * Unlike ZObject3dScan::contains(), it does not canonize the object or search
+ * the stripes for every query.
+ *
+ * Two levels of lookup are used:
+ *   1. A coarse map of cells (8x8x8 voxels of the ROI by default), each of
+ *      which is marked as empty, full or partial. Most points inside or far
+ *      from a smooth ROI are resolved here.
+ *   2. An interval index of each (y, z) row for the points in partial cells.
+ *
+ * A block size can be specified for an ROI defined in blocks, such as a DVID
+ * ROI. A query point (x, y, z) is then mapped to the ROI voxel
+ * (floor(x / bw), floor(y / bh), floor(z / bd)).
+ *
+ * Usage:
+ *   ZRoiIndex index(roi, ZIntPoint(32, 32, 32));
+ *   if (index.contains(x, y, z)) {
+ *     ...
+ *   }
+ *   size_t count = index.countContained(ptArray);
+ */
+class ZRoiIndex
+{
+public:
+  ZRoiIndex();
+  explicit ZRoiIndex(const ZObject3dScan &roi);
+
+  /*!
+   * \brief Build an index for an ROI in blocks of \a blockSize.
+   *
+   * The index is empty if any dimension of \a blockSize is not positive.
+   */
+  ZRoiIndex(const ZObject3dScan &roi, const ZIntPoint &blockSize);
+
+  bool isEmpty() const;
+
+  /*!
+   * \brief Get the bounding box of the ROI in block coordinates.
+   */
+  ZIntCuboid getBoundBox() const;
+
+  ZIntPoint getBlockSize() const;
+
+  bool contains(int x, int y, int z) const;
+  bool contains(const ZIntPoint &pt) const;
+
+  /*!
+   * \brief Test a batch of points
+   *
+   * \return A boolean array, the ith element of which is true iff
+   *         \a ptArray[i] is in the ROI.
+   */
+  std::vector<bool> contains(const std::vector<ZIntPoint> &ptArray) const;
+
+  /*!
+   * \brief Count the points in the ROI.
+   */
+  size_t countContained(const std::vector<ZIntPoint> &ptArray) const;
+
+  /*!
+   * \brief Label points by ROIs
+   *
+   * \return An array of the same size as \a ptArray. Its ith element is the
+   *         index of the first ROI in \a roiArray that contains \a ptArray[i],
+   *         or -1 if no ROI contains the point.
+   */
+  static std::vector<int> LabelPoint(
+      const std::vector<ZIntPoint> &ptArray,
+      const std::vector<const ZRoiIndex*> &roiArray);
+
+private:
+  enum class ECellState : uint8_t {
+    EMPTY, PARTIAL, FULL
+  };
+
+  struct Interval {
+    int start;
+    int end;
+  };
+
+  void build(const ZObject3dScan &roi);
+  void buildCellMap();
+  bool hit(int x, int y, int z) const; //(x, y, z) in ROI coordinates
+  bool hitRow(int x, int y, int z) const;
+
+  static int FloorDiv(int v, int d);
+
+private:
+  ZIntPoint m_blockSize;
+  neutube::EAxis m_sliceAxis = neutube::EAxis::Z;
+
+  //Bounding box of the ROI
+  int m_x0 = 0;
+  int m_y0 = 0;
+  int m_z0 = 0;
+  int m_width = 0;
+  int m_height = 0;
+  int m_depth = 0;
+
+  //Coarse map of (1 << m_cellShift)^3 cells
+  int m_cellShift = 3;
+  int m_cellWidth = 0;
+  int m_cellHeight = 0;
+  int m_cellDepth = 0;
+  std::vector<ECellState> m_cellMap;
+
+  //Intervals of the row (y, z) are m_intervalArray[m_rowOffset[i]] to
+  //m_intervalArray[m_rowOffset[i + 1] - 1], sorted and disjoint, where i is
+  //the row key (z - m_z0) * m_height + (y - m_y0) if m_rowKeyArray is empty,
+  //or the position of the row key in m_rowKeyArray otherwise.
+  std::vector<uint64_t> m_rowKeyArray;
+  std::vector<uint32_t> m_rowOffset;
+  std::vector<Interval> m_intervalArray;
+};
+
+#endif // ZROIINDEX_H
@@ -0,0 +1,70 @@
+#include "zslicescrollmotion.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+ZSliceScrollMotion::ZSliceScrollMotion()
+{
+}
+
+void ZSliceScrollMotion::reset()
+{
+  m_lastTime = -1;
+  m_direction = 0;
+  m_step = 0;
+  m_velocity = 0.0;
+}
+
+void ZSliceScrollMotion::update(int z, int64_t time)
+{
+  if (m_lastTime >= 0) {
+    int64_t interval = time - m_lastTime;
+    if (z == m_lastZ) {
+      //Staying on the same slice, e.g. panning
+      if (interval > m_idleInterval) {
+        m_direction = 0;
+        m_step = 0;
+        m_velocity = 0.0;
+      }
+      return;
+    }
+
+    int direction = (z > m_lastZ) ? 1 : -1;
+    if (interval > m_idleInterval || direction != m_direction) {
+      //A new motion
+      m_velocity = 0.0;
+    }
+
+    m_direction = direction;
+    m_step = std::abs(z - m_lastZ);
+
+    if (interval <= m_idleInterval) {
+      double velocity = m_step * 1000.0 / std::max(int64_t(1), interval);
+      if (m_velocity == 0.0) {
+        m_velocity = velocity;
+      } else {
+        m_velocity = 0.5 * (m_velocity + velocity);
+      }
+    }
+  }
+
+  m_lastZ = z;
+  m_lastTime = time;
+}
+
+bool ZSliceScrollMotion::isFast() const
+{
+  return isMoving() && m_velocity >= m_fastVelocity;
+}
+
+std::vector<int> ZSliceScrollMotion::predict(int z, int n) const
+{
+  std::vector<int> zArray;
+  if (isMoving()) {
+    for (int i = 1; i <= n; ++i) {
+      zArray.push_back(z + m_direction * m_step * i);
+    }
+  }
+
+  return zArray;
+}
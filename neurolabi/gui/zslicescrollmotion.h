@@ -0,0 +1,93 @@
+#ifndef ZSLICESCROLLMOTION_H
+#define ZSLICESCROLLMOTION_H
+
+#include <vector>
+#include <cstdint>
+
+/*!
+ * \brief The class of tracking how a view scrolls through slices
+ *
+ * It estimates the scrolling direction, step and velocity from the time
+ * series of slice positions, which are used to predict the slices to be
+ * shown next. The motion is reset when the view stays on a slice longer than
+ * the idle interval.
+ *
+ * Usage:
+ *   ZSliceScrollMotion motion;
+ *   motion.update(z, timer.elapsed());
+ *   std::vector<int> zArray = motion.predict(z, 4);
+ */
+class ZSliceScrollMotion
+{
+public:
+  ZSliceScrollMotion();
+
+  /*!
+   * \brief Record that the view is at slice \a z at \a time (ms).
+   *
+   * The time of staying on the same slice counts as idle time.
+   */
+  void update(int z, int64_t time);
+
+  void reset();
+
+  /*!
+   * \brief Scrolling direction
+   *
+   * \return 1 for increasing z, -1 for decreasing z and 0 for no motion.
+   */
+  int getDirection() const {
+    return m_direction;
+  }
+
+  /*!
+   * \brief Number of slices of the last step
+   */
+  int getStep() const {
+    return m_step;
+  }
+
+  /*!
+   * \brief Smoothed scrolling velocity in slices per second
+   */
+  double getVelocity() const {
+    return m_velocity;
+  }
+
+  bool isMoving() const {
+    return m_direction != 0;
+  }
+
+  /*!
+   * \brief Check if the scrolling is fast.
+   *
+   * Slices of a coarser zoom level should be prefetched for fast scrolling.
+   */
+  bool isFast() const;
+
+  /*!
+   * \brief Predict the next \a n slices after \a z.
+   *
+   * \return Empty if there is no motion.
+   */
+  std::vector<int> predict(int z, int n) const;
+
+  void setFastVelocity(double v) {
+    m_fastVelocity = v;
+  }
+
+  void setIdleInterval(int64_t interval) {
+    m_idleInterval = interval;
+  }
+
+private:
+  int m_lastZ = 0;
+  int64_t m_lastTime = -1;
+  int m_direction = 0;
+  int m_step = 0;
+  double m_velocity = 0.0;
+  double m_fastVelocity = 20.0;
+  int64_t m_idleInterval = 1000;
+};
+
+#endif // ZSLICESCROLLMOTION_H
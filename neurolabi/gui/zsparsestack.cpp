@@ -366,6 +366,19 @@ void ZSparseStack::cacheStackSource(const ZIntCuboid blockRange, int zoom)
   }
 }
 
+void ZSparseStack::cacheStackSourceInBox(const ZIntCuboid &box)
+{
+  if (m_stackSource.hasBlockFactory()) {
+    if (box.isEmpty()) {
+      cacheStackSource(0);
+    } else {
+      ZIntCuboid blockRange = box;
+      blockRange.scaleDownBlock(m_stackSource.getBlockSize());
+      cacheStackSource(blockRange, 0);
+    }
+  }
+}
+
 int ZSparseStack::getOptimalZoom(int xintv, int yintv, int zintv) const
 {
   int zoom = 0;
@@ -475,11 +488,7 @@ ZStack* ZSparseStack::makeStack(
       } else {
         out = new ZStack(GREY, cuboid, 1);
         out->setZero();
-        if (m_stackSource.hasBlockFactory()) {
-          ZIntCuboid blockRange = box;
-          blockRange.scaleDownBlock(m_stackSource.getBlockSize());
-          cacheStackSource(blockRange, 0);
-        }
+        cacheStackSourceInBox(box);
         assignStackValue(out, *obj, *getStackGrid(), m_baseValue);
         out->pushDsIntv(getDsIntv());
         delete obj;
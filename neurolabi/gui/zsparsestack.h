@@ -154,6 +154,13 @@ public:
   void cacheStackSource(int zoom);
   void cacheStackSource(const ZIntCuboid blockRange, int zoom);
 
+  /*!
+   * \brief Cache the full-resolution blocks intersecting a box
+   *
+   * All blocks in the block mask are cached if \a box is empty.
+   */
+  void cacheStackSourceInBox(const ZIntCuboid &box);
+
 private:
   static void assignStackValue(ZStack *stack, const ZObject3dScan &obj,
                                const ZStackBlockGrid &stackGrid,
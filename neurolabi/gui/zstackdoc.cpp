@@ -118,8 +118,7 @@
 #include "zobject3d.h"
 #include "data3d/utilities.h"
 #include "zobjsmodelmanager.h"
-#include "concurrent/zworker.h"
-#include "concurrent/zworkthread.h"
+#include "concurrent/ztaskscheduler.h"
 #include "ztask.h"
 
 using namespace std;
@@ -192,24 +191,16 @@ ZStackDoc::~ZStackDoc()
 
 void ZStackDoc::endWorkThread()
 {
-  if (m_worker != NULL) {
-    m_worker->quit();
-    m_worker = NULL;
-  }
-  if (m_workThread != NULL) {
-    m_workThread->quit();
-    m_workThread->wait();
-    m_workThread = NULL;
+  if (m_taskScheduler != NULL) {
+    delete m_taskScheduler;
+    m_taskScheduler = NULL;
   }
 }
 
-void ZStackDoc::startWorkThread()
+void ZStackDoc::startWorkThread(int workerCount)
 {
-  if (m_workThread == NULL) {
-    m_worker = new ZWorker(ZWorker::EMode::SCHEDULE);
-    m_workThread = new ZWorkThread(m_worker);
-    connect(m_workThread, SIGNAL(finished()), m_workThread, SLOT(deleteLater()));
-    m_workThread->start();
+  if (m_taskScheduler == NULL) {
+    m_taskScheduler = new ZTaskScheduler(workerCount);
   }
 }
 
@@ -482,26 +473,21 @@ void ZStackDoc::updateSwcNodeAction()
 void ZStackDoc::addTask(ZTask *task)
 {
 //  LDEBUG() << "Task added in thread: " << QThread::currentThreadId();
-  if (m_worker != NULL) {
-    if (task->getDelay() > 0) {
-      if (m_worker->getMode() == ZWorker::EMode::QUEUE) {
-        QTimer::singleShot(task->getDelay(), this, [=]() {
-          this->addTaskSlot(task);
-        });
-      } else {
-        addTaskSlot(task);
-      }
-    } else {
-      addTaskSlot(task);
-    }
-  }
+  //The delay of the task is handled by the task queue
+  addTaskSlot(task);
 }
 
 void ZStackDoc::addTaskSlot(ZTask *task)
 {
-//  task->moveToThread(m_worker->thread());
-  if (m_worker != NULL) {
-    m_worker->addTask(task);
+  if (m_taskScheduler != NULL) {
+    m_taskScheduler->addTask(task);
+  }
+}
+
+void ZStackDoc::cancelTask(const QString &key)
+{
+  if (m_taskScheduler != NULL) {
+    m_taskScheduler->cancelTask(key);
   }
 }
 
@@ -10342,6 +10328,13 @@ void ZStackDoc::ActiveViewObjectUpdater::update(const ZStackViewParam &param)
         if (task != NULL) {
           m_doc->addTask(task);
         }
+        if (m_scrollMotion.isMoving()) {
+          ZTask *prefetchTask =
+              player->getPrefetchTask(m_doc.get(), m_scrollMotion);
+          if (prefetchTask != NULL) {
+            m_doc->addTask(prefetchTask);
+          }
+        }
       }
     }
   }
@@ -48,6 +48,7 @@
 //#include "zmesh.h"
 #include "zstackobjectinfo.h"
 #include "zresolution.h"
+#include "zslicescrollmotion.h"
 #include "core/utilities.h"
 
 class ZStackFrame;
@@ -96,8 +97,7 @@ class ZMesh;
 class ZObject3d;
 class ZArbSliceViewParam;
 class ZObjsModelManager;
-class ZWorker;
-class ZWorkThread;
+class ZTaskScheduler;
 class ZTask;
 
 /*!
@@ -1097,6 +1097,13 @@ public:
       m_doc = doc;
     }
 
+    /*!
+     * \brief Set the scrolling motion for prefetching slices.
+     */
+    void setScrollMotion(const ZSliceScrollMotion &motion) {
+      m_scrollMotion = motion;
+    }
+
     static void SetUpdateEnabled(
         ZSharedPointer<ZStackDoc> doc, ZStackObject::EType type, bool on);
 
@@ -1105,6 +1112,7 @@ public:
     QSet<ZStackObject::EType> m_excludeSet;
     QSet<ZStackObject::ETarget> m_excludeTarget;
     QSet<ZStackObject::ETarget> m_updatedTarget;
+    ZSliceScrollMotion m_scrollMotion;
   };
 
   void addObjectUnsync(ZStackObject *obj, bool uniqueSource = true);
@@ -1362,8 +1370,9 @@ protected:
   virtual void makeKeyProcessor();
   void addTask(ZTask *task);
   void addTaskSlot(ZTask *task);
+  void cancelTask(const QString &key);
   void endWorkThread();
-  void startWorkThread();
+  void startWorkThread(int workerCount = 3);
 
 private:
   void init();
@@ -1480,8 +1489,7 @@ private:
   QSet<ZStackObject::EType> m_unsavedSet;
   bool m_changingSaveState;
 
-  ZWorker *m_worker = NULL;
-  ZWorkThread *m_workThread = NULL;
+  ZTaskScheduler *m_taskScheduler = NULL;
 
 protected:
   ZObjectColorScheme m_objColorSheme;
@@ -27,6 +27,7 @@
 #include "zstackarray.h"
 #include "zarray.h"
 #include "misc/miscutility.h"
+#include "imgproc/zstackprocessor.h"
 
 ZStackFactory::ZStackFactory()
 {
@@ -350,7 +351,6 @@ ZStack* ZStackFactory::makeDensityMap(const ZPointArray &ptArray, double sigma)
     }
   } else {
     stack = MakeZeroStack(GREY, stackBox);
-    Filter_3d *filter = Gaussian_Filter_3d(sigma, sigma, sigma);
 
     for (ZPointArray::const_iterator iter = ptArray.begin();
          iter != ptArray.end(); ++iter) {
@@ -358,9 +358,8 @@ ZStack* ZStackFactory::makeDensityMap(const ZPointArray &ptArray, double sigma)
       stack->addIntValue(iround(pt.x()), iround(pt.y()), iround(pt.z()), 0, 1);
     }
 
-    Stack *stack2 = Filter_Stack(stack->c_stack(), filter);
-
-    Kill_FMatrix(filter);
+    Stack *stack2 = ZStackProcessor::GaussianSmooth(
+          stack->c_stack(), sigma, sigma, sigma);
 
     ZStack *out = new ZStack;
     out->consume(stack2);
@@ -460,10 +459,8 @@ ZStack* ZStackFactory::makeDensityMap(
     }
 
     if (sigma > 0.0) {
-      Filter_3d *filter = Gaussian_Filter_3d(sigma, sigma, sigma);
-      Stack *stack2 = Filter_Stack(stack->c_stack(), filter);
-
-      Kill_FMatrix(filter);
+      Stack *stack2 = ZStackProcessor::GaussianSmooth(
+            stack->c_stack(), sigma, sigma, sigma);
 
       ZStack *out = new ZStack;
       out->consume(stack2);
@@ -23,6 +23,7 @@
 #include "tz_stack_threshold.h"
 #include "zintcuboid.h"
 #include "zstackarray.h"
+#include "imgproc/zstackprocessor.h"
 
 using namespace std;
 
@@ -299,7 +300,8 @@ ZSwcTree* ZStackSkeletonizer::makeSkeletonWithoutDsTest(Stack *stackData)
       }
     } else {
       cout << "Build distance map ..." << endl;
-      Stack *tmpdist = Stack_Bwdist_L_U16P(croppedObjStack, NULL, 0);
+      Stack *tmpdist =
+          ZStackProcessor::BwdistSqr(croppedObjStack, NULL, 0, true);
 
       cout << "Shortest path grow ..." << endl;
       Sp_Grow_Workspace *sgw = New_Sp_Grow_Workspace();
@@ -676,7 +678,8 @@ ZSwcTree* ZStackSkeletonizer::makeSkeletonWithoutDs(
       }
     } else {
       cout << "Build distance map ..." << endl;
-      Stack *tmpdist = Stack_Bwdist_L_U16P(croppedObjStack, NULL, 0);
+      Stack *tmpdist =
+          ZStackProcessor::BwdistSqr(croppedObjStack, NULL, 0, true);
 
       cout << "Shortest path grow ..." << endl;
       Sp_Grow_Workspace *sgw = New_Sp_Grow_Workspace();
@@ -198,6 +198,7 @@ void ZStackView::init()
   blockViewChangeEvent(false);
 
   m_sliceStrategy = new ZScrollSliceStrategy(this);
+  m_scrollClock.start();
 }
 
 void ZStackView::enableMessageManager()
@@ -3014,6 +3015,8 @@ QSet<ZStackObject::ETarget> ZStackView::updateViewData(
     updater.exclude(ZStackObject::TARGET_DYNAMIC_OBJECT_CANVAS);
   }
 
+  m_scrollMotion.update(param.getZ(), m_scrollClock.elapsed());
+  updater.setScrollMotion(m_scrollMotion);
   updater.update(param);
 
   return updater.getUpdatedTargetSet();
@@ -3036,6 +3039,8 @@ QSet<ZStackObject::ETarget> ZStackView::updateViewData()
   }
 
   ZStackViewParam param = getViewParameter();
+  m_scrollMotion.update(param.getZ(), m_scrollClock.elapsed());
+  updater.setScrollMotion(m_scrollMotion);
   updater.update(param);
 
   return updater.getUpdatedTargetSet();
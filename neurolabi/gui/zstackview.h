@@ -11,6 +11,7 @@
 #include <QPixmap>
 #include <vector>
 #include <QCheckBox>
+#include <QElapsedTimer>
 
 #include "zstackframe.h"
 #include "zparameter.h"
@@ -22,6 +23,7 @@
 #include "zpainter.h"
 #include "zmultiscalepixmap.h"
 #include "zarbsliceviewparam.h"
+#include "zslicescrollmotion.h"
 
 //#include "zstackdoc.h"
 
@@ -657,6 +659,8 @@ protected:
   bool m_viewChangeEventBlocked;
 
   ZScrollSliceStrategy *m_sliceStrategy;
+  ZSliceScrollMotion m_scrollMotion; //for prefetching slices
+  QElapsedTimer m_scrollClock;
 
   QRect m_defaultViewPort;
   ZStackViewParam m_oldViewParam;
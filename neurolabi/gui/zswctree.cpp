@@ -1453,10 +1453,60 @@ ZSwcTree* ZSwcTree::createBoundBoxSwc(double margin)
   return tree;
 }
 
+const ZSwcNodeIndex& ZSwcTree::getNodeIndex() const
+{
+  if (isDeprecated(NODE_INDEX)) {
+    if (data() != NULL) {
+      m_nodeIndex.build(getSwcTreeNodeArray(DEPTH_FIRST_ITERATOR));
+    }
+  }
+
+  return m_nodeIndex;
+}
+
+namespace {
+
+/*
+ * The node with the smallest distance/radius ratio. Nodes are in depth-first
+ * order, so the first one wins in a tie as a linear scan does. Only X-Y
+ * coordinates are used for distance if \a projecting is true.
+ */
+Swc_Tree_Node* GetClosestHitNode(
+    const std::vector<Swc_Tree_Node*> &nodeArray, double x, double y, double z,
+    bool projecting = false)
+{
+  static const double Regularize_Number = 0.1;
+
+  Swc_Tree_Node *hit = NULL;
+  double mindist = Infinity;
+  for (Swc_Tree_Node *tn : nodeArray) {
+    double dist = projecting ?
+          Geo3d_Dist(SwcTreeNode::x(tn), SwcTreeNode::y(tn), 0.0, x, y, 0.0) :
+          SwcTreeNode::distance(tn, x, y, z);
+    dist /= SwcTreeNode::radius(tn) + Regularize_Number;
+    if (dist < mindist) {
+      mindist = dist;
+      hit = tn;
+    }
+  }
+
+  return hit;
+}
+
+}
+
 Swc_Tree_Node* ZSwcTree::hitTest(double x, double y, double z)
 {
   if (data() != NULL) {
-    return Swc_Tree_Hit_Node(data(), x, y, z);
+    //A positive margin keeps the nodes touching the point as candidates
+    std::vector<Swc_Tree_Node*> nodeArray;
+    for (Swc_Tree_Node *tn : getNodeIndex().getNodeNear(x, y, z, 1.0)) {
+      if (SwcTreeNode::distance(tn, x, y, z) <= SwcTreeNode::radius(tn)) {
+        nodeArray.push_back(tn);
+      }
+    }
+
+    return GetClosestHitNode(nodeArray, x, y, z);
   }
 
   return NULL;
@@ -1472,32 +1522,19 @@ bool ZSwcTree::hit(double x, double y, double z)
 Swc_Tree_Node* ZSwcTree::hitTest(double x, double y, double z, double margin)
 {
 #ifdef _QT_GUI_USED_
-  const std::vector<Swc_Tree_Node *> &nodeArray = getSwcTreeNodeArray();
-
-  const Swc_Tree_Node *hit = NULL;
-  double mindist = Infinity;
-
-  static const double Regularize_Number = 0.1;
+  if (data() == NULL) {
+    return NULL;
+  }
 
-  for (std::vector<Swc_Tree_Node *>::const_iterator
-       iter = REGULAR_SWC_NODE_BEGIN(nodeArray[0], nodeArray.begin());
-       iter != nodeArray.end(); ++iter) {
-    const Swc_Tree_Node *tn = *iter;
-    TZ_ASSERT(SwcTreeNode::isRegular(tn), "Unexpected virtual node.");
+  std::vector<Swc_Tree_Node*> nodeArray;
+  for (Swc_Tree_Node *tn : getNodeIndex().getNodeNear(x, y, z, margin)) {
     if (ZStackBall::isCuttingPlane(
           SwcTreeNode::z(tn), SwcTreeNode::radius(tn), z, 1.0)) {
-      double dist = SwcTreeNode::distance(tn, x, y, z);
-      if (dist < SwcTreeNode::radius(tn) + margin) {
-        dist /= SwcTreeNode::radius(tn) + Regularize_Number;
-        if (dist < mindist) {
-          mindist = dist;
-          hit = tn;
-        }
-      }
+      nodeArray.push_back(tn);
     }
   }
 
-  return const_cast<Swc_Tree_Node*>(hit);
+  return GetClosestHitNode(nodeArray, x, y, z);
 #else
   return NULL;
 #endif
@@ -1507,7 +1544,14 @@ Swc_Tree_Node* ZSwcTree::hitTest(double x, double y, neutube::EAxis axis)
 {
   if (axis == neutube::EAxis::Z) {
     if (data() != NULL) {
-      return Swc_Tree_Hit_Node_P(data(), x, y);
+      std::vector<Swc_Tree_Node*> nodeArray;
+      for (Swc_Tree_Node *tn : getNodeIndex().getNodeNearXY(x, y, 1.0)) {
+        if (Swc_Tree_Node_Hit_Test_P(tn, x, y)) {
+          nodeArray.push_back(tn);
+        }
+      }
+
+      return GetClosestHitNode(nodeArray, x, y, 0.0, true);
     }
   }
 
@@ -1548,6 +1592,8 @@ void ZSwcTree::translateRootTo(double x, double y, double z)
       Swc_Tree_Node_Data(tn)->z += offset[2];
     }
   }
+
+  deprecate(BOUND_BOX);
 }
 
 void ZSwcTree::rescale(
@@ -1555,6 +1601,7 @@ void ZSwcTree::rescale(
 {
   if (m_tree != NULL) {
     Swc_Tree_Resize(m_tree, scaleX, scaleY, scaleZ, changingRadius);
+    deprecate(BOUND_BOX);
   }
 #if 0
   if (scaleX != 1.0 || scaleY != 1.0 || scaleZ != 1.0) {
@@ -1608,6 +1655,8 @@ void ZSwcTree::rescaleRadius(double scale, int startdepth, int enddepth)
       break;
     }
   }
+
+  deprecate(BOUND_BOX);
 }
 
 void ZSwcTree::changeRadius(double dr, double scale)
@@ -1617,6 +1666,8 @@ void ZSwcTree::changeRadius(double dr, double scale)
   for (Swc_Tree_Node *tn = begin(); tn != end(); tn = next()) {
     SwcTreeNode::changeRadius(tn, dr, scale);
   }
+
+  deprecate(BOUND_BOX);
 }
 
 int ZSwcTree::swcNodeDepth(Swc_Tree_Node *tn)
@@ -2251,10 +2302,11 @@ Swc_Tree_Node* ZSwcTree::queryNode(int id, int iterOption)
 
 Swc_Tree_Node* ZSwcTree::queryNode(const ZPoint &pt)
 {
-  double pos[3];
-  pt.toArray(pos);
+  if (data() == NULL) {
+    return NULL;
+  }
 
-  return Swc_Tree_Closest_Node(data(), pos);
+  return getNodeIndex().findClosestNode(pt.x(), pt.y(), pt.z());
 }
 
 std::vector<Swc_Tree_Node*> ZSwcTree::getNodeOnPlane(int z)
@@ -2786,6 +2838,7 @@ void ZSwcTree::translate(double x, double y, double z)
 {
   if (x != 0.0 || y != 0.0 || z != 0.0) {
     Swc_Tree_Translate(data(), x, y, z);
+    deprecate(BOUND_BOX);
   }
 }
 
@@ -2802,6 +2855,7 @@ void ZSwcTree::translate(const ZIntPoint &offset)
 void ZSwcTree::scale(double x, double y, double z)
 {
   Swc_Tree_Resize(data(), x, y, z, FALSE);
+  deprecate(BOUND_BOX);
 }
 
 void ZSwcTree::rotate(double theta, double psi, const ZPoint &center, bool inverse)
@@ -2810,6 +2864,8 @@ void ZSwcTree::rotate(double theta, double psi, const ZPoint &center, bool inver
   for (Swc_Tree_Node *tn = begin(); tn != NULL; tn = next()) {
     SwcTreeNode::rotate(tn, theta, psi, center, inverse);
   }
+
+  deprecate(BOUND_BOX);
 }
 
 void ZSwcTree::resample(double step)
@@ -3261,6 +3317,8 @@ bool ZSwcTree::isDeprecated(EComponent component) const
     std::cout << "isDeprecated: " << m_boundBox.isValid() << std::endl;
 #endif
     return !m_boundBox.isValid();
+  case NODE_INDEX:
+    return m_nodeIndex.isEmpty();
   default:
     break;
   }
@@ -3276,9 +3334,13 @@ void ZSwcTree::deprecateDependent(EComponent component)
     deprecate(BRANCH_POINT_ARRAY);
     deprecate(TERMINAL_ARRAY);
     deprecate(Z_SORTED_ARRAY);
+    deprecate(NODE_INDEX);
     break;
   case BREADTH_FIRST_ARRAY:
     break;
+  case BOUND_BOX: //Node geometry changed
+    deprecate(NODE_INDEX);
+    break;
   default:
     break;
   }
@@ -3310,6 +3372,9 @@ void ZSwcTree::deprecate(EComponent component)
   case BOUND_BOX:
     m_boundBox.invalidate();
     break;
+  case NODE_INDEX:
+    m_nodeIndex.clear();
+    break;
   case ALL_COMPONENT:
     deprecate(DEPTH_FIRST_ARRAY);
     deprecate(BREADTH_FIRST_ARRAY);
@@ -3707,10 +3772,11 @@ ZClosedCurve ZSwcTree::toClosedCurve() const
 void ZSwcTree::selectNode(const ZRect2d &roi, bool appending)
 {
   std::vector<Swc_Tree_Node*> nodeList;
-  DepthFirstIterator iter(this);
-  while (iter.hasNext()) {
-    Swc_Tree_Node *tn = iter.next();
-    if (SwcTreeNode::isRegular(tn)) {
+  if (data() != NULL) {
+    std::vector<Swc_Tree_Node*> candidate = getNodeIndex().getNodeInBox(
+          roi.getFirstX(), roi.getFirstY(), -Infinity,
+          roi.getLastX() + 1, roi.getLastY() + 1, Infinity);
+    for (Swc_Tree_Node *tn : candidate) {
       if (roi.contains(SwcTreeNode::x(tn), SwcTreeNode::y(tn))) {
         nodeList.push_back(tn);
       }
@@ -19,6 +19,7 @@
 #include "zcuboid.h"
 #include "zuncopyable.h"
 #include "zswctreenodeselector.h"
+#include "swc/zswcnodeindex.h"
 
 class ZStack;
 class ZSwcForest;
@@ -270,7 +271,7 @@ public:
 
   enum EComponent {
     DEPTH_FIRST_ARRAY, BREADTH_FIRST_ARRAY, LEAF_ARRAY, TERMINAL_ARRAY,
-    BRANCH_POINT_ARRAY, Z_SORTED_ARRAY, BOUND_BOX, ALL_COMPONENT
+    BRANCH_POINT_ARRAY, Z_SORTED_ARRAY, BOUND_BOX, NODE_INDEX, ALL_COMPONENT
   };
 
   bool isDeprecated(EComponent component) const;
@@ -401,8 +402,20 @@ public:
   static ZSwcTree* CreateCuboidSwc(const ZCuboid &box, double radius = 1.0);
   ZSwcTree* createBoundBoxSwc(double margin = 0.0);
 
+  /*!
+   * \brief Get the spatial index of the regular nodes.
+   *
+   * The index is built when it is deprecated. It is deprecated together with
+   * the depth-first array, i.e. any structural or geometrical change that
+   * calls deprecate(ALL_COMPONENT) also invalidates the index.
+   */
+  const ZSwcNodeIndex& getNodeIndex() const;
+
   /*!
    * \brief Hit test.
+   *
+   * \return The node containing (\a x, \a y, \a z) with the smallest
+   *         distance/radius ratio. NULL if no node is hit.
    */
   Swc_Tree_Node* hitTest(double x, double y, double z);
 
@@ -897,6 +910,7 @@ private:
   mutable ZSwcTreeNodeSelector m_selector;
 
   mutable ZCuboid m_boundBox;
+  mutable ZSwcNodeIndex m_nodeIndex;
 
   static const int m_nodeStateCosmetic;
 
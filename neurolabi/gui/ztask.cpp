@@ -48,6 +48,26 @@ int ZTask::getDelay() const
   return m_delay;
 }
 
+void ZTask::setPriority(int priority)
+{
+  m_priority = priority;
+}
+
+int ZTask::getPriority() const
+{
+  return m_priority;
+}
+
+void ZTask::setKey(const QString &key)
+{
+  m_key = key;
+}
+
+QString ZTask::getKey() const
+{
+  return m_key;
+}
+
 void ZTask::slotTest()
 {
   LDEBUG() << "slot test";
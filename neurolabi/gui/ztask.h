@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QRunnable>
+#include <QString>
 
 class ZTask : public QObject, public QRunnable
 {
@@ -23,6 +24,31 @@ public:
   void setDelay(int delay);
   int getDelay() const;
 
+  /*!
+   * \brief Priorities of tasks
+   *
+   * A task with a higher priority is run first in a task queue.
+   */
+  enum EPriority {
+    PRIORITY_LOW = -1, //such as prefetching
+    PRIORITY_NORMAL = 0,
+    PRIORITY_HIGH = 1 //such as updating the visible view
+  };
+
+  void setPriority(int priority);
+  int getPriority() const;
+
+  /*!
+   * \brief Set the key of the task.
+   *
+   * Tasks with the same non-empty key do the same kind of work, such as
+   * updating the label slice of a view. A task queued later supersedes a
+   * pending one with the same key, and tasks with the same key never run
+   * concurrently.
+   */
+  void setKey(const QString &key);
+  QString getKey() const;
+
   void abort();
 
 public slots:
@@ -35,6 +61,8 @@ signals:
 
 private:
   int m_delay = 0;
+  int m_priority = PRIORITY_NORMAL;
+  QString m_key;
 };
 
 /////////////Moc class for testing//////////////